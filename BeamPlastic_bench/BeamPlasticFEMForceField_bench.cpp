@@ -0,0 +1,327 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <BeamPlastic/forcefield/BeamPlasticFEMForceField.h>
+
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/simpleapi/SimpleApi.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/simulation/Simulation.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <functional>
+
+/**
+ * Microbenchmarks of the element kernels of BeamPlasticFEMForceField, on a
+ * single beam element of a steel wire (E = 203 GPa, yield stress = 480 MPa,
+ * 50 um square section). The stress states are those of the element bent until
+ * its outermost Gauss points reach the yield surface: further bending gives
+ * plastic corrections at these points, and unloading elastic predictors only.
+ */
+
+namespace
+{
+
+using sofa::defaulttype::Rigid3dTypes;
+using beamplastic::forcefield::BeamPlasticFEMForceField;
+
+constexpr double YoungModulus = 2.03e11;
+constexpr double PoissonRatio = 0.3;
+constexpr double YieldStress = 4.8e8;
+constexpr double Length = 5e-4;
+constexpr double Section = 5e-5;
+constexpr unsigned int NbGaussPoints = 27;
+
+/// Exposes the element kernels of the force field
+class BenchForceField : public BeamPlasticFEMForceField<Rigid3dTypes>
+{
+public:
+    SOFA_CLASS(BenchForceField, SOFA_TEMPLATE(BeamPlasticFEMForceField, Rigid3dTypes));
+
+    BenchForceField()
+        : BeamPlasticFEMForceField<Rigid3dTypes>(PoissonRatio, YoungModulus, YieldStress, Section, Section, true, false)
+    {}
+
+    using BeamPlasticFEMForceField<Rigid3dTypes>::BeamInfo;
+    using BeamPlasticFEMForceField<Rigid3dTypes>::LocalNewtonStatistics;
+    using BeamPlasticFEMForceField<Rigid3dTypes>::m_beamsData;
+    using BeamPlasticFEMForceField<Rigid3dTypes>::m_materials;
+    using BeamPlasticFEMForceField<Rigid3dTypes>::d_useConsistentTangentOperator;
+    using BeamPlasticFEMForceField<Rigid3dTypes>::computeHardeningStressIncrement;
+    using BeamPlasticFEMForceField<Rigid3dTypes>::computePerfectPlasticStressIncrement;
+    using BeamPlasticFEMForceField<Rigid3dTypes>::updateTangentStiffness;
+    using BeamPlasticFEMForceField<Rigid3dTypes>::beTCBeMult;
+    using BeamPlasticFEMForceField<Rigid3dTypes>::computeLocalDisplacement;
+    using BeamPlasticFEMForceField<Rigid3dTypes>::equivalentStress;
+};
+
+typedef BenchForceField::BeamInfo BeamInfo;
+typedef BenchForceField::VecCoord VecCoord;
+typedef BenchForceField::Coord Coord;
+typedef BenchForceField::Real Real;
+typedef BenchForceField::Vec12 Vec12;
+typedef BenchForceField::Matrix12x1 Matrix12x1;
+typedef BenchForceField::Matrix6x12 Matrix6x12;
+typedef BenchForceField::VoigtTensor2 VoigtTensor2;
+typedef BenchForceField::StorageVoigtTensor2 StorageVoigtTensor2;
+typedef BenchForceField::MechanicalState MechanicalState;
+
+/// Single beam element, with the stress states at the onset of plastic bending
+struct BenchElement
+{
+    sofa::simulation::Node::SPtr root;
+    BenchForceField::SPtr forceField;
+
+    VecCoord restPositions;
+    VecCoord positions; ///< bent configuration
+    sofa::type::Vec<NbGaussPoints, VoigtTensor2> stresses; ///< stresses in the bent configuration
+    sofa::type::Vec<NbGaussPoints, VoigtTensor2> strainIncrements; ///< strain increments of further bending
+
+    BeamInfo* beam = nullptr;
+
+    BenchElement()
+    {
+        sofa::simpleapi::importPlugin("Sofa.Component.StateContainer");
+        sofa::simpleapi::importPlugin("Sofa.Component.Topology.Container.Constant");
+
+        const auto simulation = sofa::simpleapi::createSimulation("DAG");
+        root = sofa::simpleapi::createRootNode(simulation, "root");
+        sofa::simpleapi::createObject(root, "MechanicalObject", {{"template", "Rigid3d"},
+                                                                 {"position", "0 0 0 0 0 0 1  5e-4 0 0 0 0 0 1"}});
+        sofa::simpleapi::createObject(root, "MeshTopology", {{"lines", "0 1"}});
+
+        forceField = sofa::core::objectmodel::New<BenchForceField>();
+        forceField->d_useConsistentTangentOperator.setValue(true);
+        root->addObject(forceField);
+        sofa::simulation::node::initRoot(root.get());
+
+        beam = &(*forceField->m_beamsData.beginEdit())[0];
+        forceField->m_beamsData.endEdit();
+
+        restPositions.resize(2);
+        restPositions[1].getCenter()[0] = Length;
+
+        // Pure bending about z, at the yield curvature of the section (the stresses
+        // are then scaled so that the outermost Gauss points are on the yield surface)
+        const Real curvature = 2 * YieldStress / (YoungModulus * Section);
+        const Real angle = curvature * Length;
+        positions = restPositions;
+        positions[1].getCenter() = Coord::Pos(std::sin(angle) / curvature, (1 - std::cos(angle)) / curvature, 0);
+        positions[1].getOrientation() = sofa::type::Quat<Real>::createFromRotationVector(Coord::Pos(0, 0, angle));
+
+        Vec12 displacement;
+        forceField->computeLocalDisplacement(positions, restPositions, displacement, *beam, 0, 1);
+
+        Matrix12x1 u, du;
+        for (unsigned int k = 0; k < 12; k++)
+        {
+            u(k) = displacement[k];
+            du(k) = 1e-2 * displacement[k];
+        }
+
+        const auto& C = forceField->m_materials[0]._materialBehaviour;
+        Real maxEquivalentStress = 0;
+        for (unsigned int gp = 0; gp < NbGaussPoints; gp++)
+        {
+            const Matrix6x12 Be(beam->_BeMatrices[gp]);
+            stresses[gp] = C * (Be * u);
+            strainIncrements[gp] = Be * du;
+            maxEquivalentStress = std::max(maxEquivalentStress, forceField->equivalentStress(stresses[gp]));
+        }
+        for (unsigned int gp = 0; gp < NbGaussPoints; gp++)
+            stresses[gp] *= 0.999 * YieldStress / maxEquivalentStress;
+    }
+
+    /// Restores the elastic history of a Gauss point, modified by the return mapping
+    void resetGaussPoint(BeamInfo& b, unsigned int gp) const
+    {
+        b._localYieldStresses[gp] = YieldStress;
+        b._backStresses[gp] = StorageVoigtTensor2();
+        b._plasticStrainHistory[gp] = StorageVoigtTensor2();
+        b._effectivePlasticStrains[gp] = 0;
+        b._plasticMultipliers[gp] = 0;
+    }
+};
+
+BenchElement& getBenchElement()
+{
+    static BenchElement element;
+    return element;
+}
+
+/// Return mapping with mixed hardening, at the 27 Gauss points. Arg: 0 for the
+/// elastic predictor only (unloading), 1 for a plastic correction (further loading).
+void BM_computeHardeningStressIncrement(benchmark::State& state)
+{
+    BenchElement& element = getBenchElement();
+    BeamInfo& beam = *element.beam;
+    const Real sign = state.range(0) ? 1 : -1;
+    BenchForceField::LocalNewtonStatistics statistics;
+
+    for (auto _ : state)
+    {
+        for (unsigned int gp = 0; gp < NbGaussPoints; gp++)
+        {
+            element.resetGaussPoint(beam, gp);
+            VoigtTensor2 newStress;
+            MechanicalState pointState = MechanicalState::ELASTIC;
+            element.forceField->computeHardeningStressIncrement(beam, gp, element.stresses[gp], newStress,
+                                                                element.strainIncrements[gp] * sign, pointState, statistics);
+            benchmark::DoNotOptimize(newStress);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * NbGaussPoints);
+}
+BENCHMARK(BM_computeHardeningStressIncrement)->Arg(0)->Arg(1);
+
+/// Radial return for perfect plasticity, at the 27 Gauss points. Same argument as above.
+void BM_computePerfectPlasticStressIncrement(benchmark::State& state)
+{
+    BenchElement& element = getBenchElement();
+    BeamInfo& beam = *element.beam;
+    const Real sign = state.range(0) ? 1 : -1;
+
+    for (auto _ : state)
+    {
+        for (unsigned int gp = 0; gp < NbGaussPoints; gp++)
+        {
+            element.resetGaussPoint(beam, gp);
+            VoigtTensor2 newStress;
+            MechanicalState pointState = MechanicalState::ELASTIC;
+            element.forceField->computePerfectPlasticStressIncrement(beam, gp, element.stresses[gp], newStress,
+                                                                     element.strainIncrements[gp] * sign, pointState);
+            benchmark::DoNotOptimize(newStress);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * NbGaussPoints);
+}
+BENCHMARK(BM_computePerfectPlasticStressIncrement)->Arg(0)->Arg(1);
+
+/// Tangent stiffness of a plastic element. Arg: 0 for the continuum tangent
+/// operator, 1 for the consistent tangent operator.
+void BM_updateTangentStiffness(benchmark::State& state)
+{
+    BenchElement& element = getBenchElement();
+    BeamInfo& beam = *element.beam;
+    element.forceField->d_useConsistentTangentOperator.setValue(state.range(0) != 0);
+
+    for (unsigned int gp = 0; gp < NbGaussPoints; gp++)
+    {
+        element.resetGaussPoint(beam, gp);
+        beam._pointMechanicalState[gp] = MechanicalState::PLASTIC;
+        beam._prevStresses[gp] = StorageVoigtTensor2(element.stresses[gp]);
+        beam._elasticPredictors[gp] = StorageVoigtTensor2(element.stresses[gp]
+                + element.forceField->m_materials[0]._materialBehaviour * element.strainIncrements[gp]);
+        beam._plasticMultipliers[gp] = 1e-4;
+        beam._effectivePlasticStrains[gp] = 1e-3;
+    }
+
+    for (auto _ : state)
+    {
+        element.forceField->updateTangentStiffness(beam);
+        benchmark::DoNotOptimize(beam._Kt_loc);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_updateTangentStiffness)->Arg(0)->Arg(1);
+
+/// Be^T C Be product of the stiffness integration, at the 27 Gauss points
+void BM_beTCBeMult(benchmark::State& state)
+{
+    BenchElement& element = getBenchElement();
+    BeamInfo& beam = *element.beam;
+    const auto& C = element.forceField->m_materials[0]._materialBehaviour;
+
+    for (auto _ : state)
+    {
+        for (unsigned int gp = 0; gp < NbGaussPoints; gp++)
+        {
+            const Matrix6x12 Be(beam._BeMatrices[gp]);
+            auto K = element.forceField->beTCBeMult(Be.transposed(), C, PoissonRatio, YoungModulus);
+            benchmark::DoNotOptimize(K);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * NbGaussPoints);
+}
+BENCHMARK(BM_beTCBeMult);
+
+/// Corotational local displacement of the bent element
+void BM_computeLocalDisplacement(benchmark::State& state)
+{
+    BenchElement& element = getBenchElement();
+    BeamInfo& beam = *element.beam;
+
+    for (auto _ : state)
+    {
+        Vec12 displacement;
+        element.forceField->computeLocalDisplacement(element.positions, element.restPositions, displacement, beam, 0, 1);
+        benchmark::DoNotOptimize(displacement);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_computeLocalDisplacement);
+
+/// Element initialisation: Gauss point matrices and shape functions. Arg: 1 for
+/// the Timoshenko beam theory, 0 for Euler-Bernoulli.
+void BM_BeamInfoInit(benchmark::State& state)
+{
+    BeamInfo beam;
+    const bool isTimoshenko = state.range(0) != 0;
+
+    for (auto _ : state)
+    {
+        beam.init(YoungModulus, YieldStress, Length, PoissonRatio, Section, Section, isTimoshenko);
+        benchmark::DoNotOptimize(beam._BeMatrices);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BeamInfoInit)->Arg(0)->Arg(1);
+
+/// Overhead of the 27-point Gaussian quadrature itself, with a trivial integrand
+void BM_quadratureIntegrate(benchmark::State& state)
+{
+    typedef ozp::quadrature::Gaussian<3> GaussianQuadratureType;
+    typedef std::function<void(double, double, double, double, double, double)> LambdaType;
+
+    BenchElement& element = getBenchElement();
+    const ozp::quadrature::detail::Interval<3> interval = element.beam->_integrationInterval;
+
+    double volume = 0;
+    LambdaType addWeight = [&](double, double, double, double w1, double w2, double w3)
+    {
+        volume += w1*w2*w3;
+    };
+
+    for (auto _ : state)
+    {
+        volume = 0;
+        ozp::quadrature::integrate<GaussianQuadratureType, 3, LambdaType>(interval, addWeight);
+        benchmark::DoNotOptimize(volume);
+    }
+    state.SetItemsProcessed(state.iterations() * NbGaussPoints);
+}
+BENCHMARK(BM_quadratureIntegrate);
+
+} // namespace
+
+BENCHMARK_MAIN();
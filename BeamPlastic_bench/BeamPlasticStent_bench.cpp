@@ -0,0 +1,367 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "StentGenerator.h"
+
+#include <BeamPlastic/forcefield/BeamPlasticFEMForceField.h>
+
+#include <sofa/component/statecontainer/MechanicalObject.h>
+#include <sofa/component/topology/container/constant/MeshTopology.h>
+#include <sofa/core/MechanicalParams.h>
+#include <sofa/simpleapi/SimpleApi.h>
+#include <sofa/simulation/MainTaskSchedulerFactory.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/simulation/Simulation.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/**
+ * Throughput harness of BeamPlasticFEMForceField on synthetic stents.
+ *
+ * For each requested number of beam elements, a stent is generated and crimped
+ * down to a fraction of its radius in a given number of steps. Each step is one
+ * force computation (with the plastic corrections of the Gauss points) followed
+ * by a given number of stiffness products, as in a time step of an implicit
+ * solver using a conjugate gradient. The steps per second, the time per element
+ * of the force computations, the init time and the peak resident memory are
+ * reported, in a table or in CSV to plot thread-scaling curves.
+ *
+ * With maxScalingRatio, the harness fails if the time per element of addForce
+ * on any stent exceeds this ratio times the one of the smallest stent, so that
+ * it can be used as a regression test of the scaling with the problem size.
+ *
+ * Usage: BeamPlasticStent_bench [--beams=1000,10000,...] [--pattern=zigzag|helical]
+ *        [--steps=20] [--cgIterations=10] [--crimpRatio=0.6] [--threads=0]
+ *        [--parallelStrategy=coloring] [--batchKernel=none] [--csv]
+ *        [--maxScalingRatio=0]
+ */
+
+namespace
+{
+
+using sofa::defaulttype::Rigid3dTypes;
+using beamplastic::bench::StentGenerator;
+using beamplastic::bench::StentParameters;
+
+typedef beamplastic::forcefield::BeamPlasticFEMForceField<Rigid3dTypes> ForceField;
+typedef sofa::component::statecontainer::MechanicalObject<Rigid3dTypes> MechanicalObject;
+typedef sofa::component::topology::container::constant::MeshTopology MeshTopology;
+typedef Rigid3dTypes::VecCoord VecCoord;
+typedef Rigid3dTypes::VecDeriv VecDeriv;
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+    std::vector<unsigned int> nbBeams { 1000, 10000, 100000 };
+    std::string pattern { "zigzag" };
+    unsigned int nbSteps { 20 };
+    unsigned int nbCGIterations { 10 };
+    double crimpRatio { 0.6 };
+    unsigned int nbThreads { 0 };
+    std::string parallelStrategy { "coloring" };
+    std::string batchKernel { "none" };
+    bool csv { false };
+    double maxScalingRatio { 0 };
+};
+
+struct Result
+{
+    unsigned int nbBeams;
+    unsigned int nbNodes;
+    double initMilliseconds;
+    double stepsPerSecond;
+    double addForceNsPerElement;
+    double addDForceNsPerElement;
+    double peakRSSMegabytes;
+    unsigned int nbPlasticGaussPoints;
+    unsigned int nbLocalNewtonFailures;
+};
+
+/// Peak resident memory of the process since its start
+double getPeakRSSMegabytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+    return usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+#endif
+}
+
+/// Value of an output Data of the force field
+unsigned int getOutput(const ForceField* forceField, const std::string& name)
+{
+    const auto* data = dynamic_cast<const sofa::Data<unsigned int>*>(forceField->findData(name));
+    return data ? data->getValue() : 0;
+}
+
+template<class T>
+T parseValue(const std::string& option, const std::string& value)
+{
+    std::istringstream iss(value);
+    T result;
+    if (!(iss >> result) || !iss.eof())
+        throw std::invalid_argument("invalid value " + value + " for option " + option);
+    return result;
+}
+
+Options parseOptions(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        const std::size_t separator = argument.find('=');
+        const std::string option = argument.substr(0, separator);
+        const std::string value = separator == std::string::npos ? "" : argument.substr(separator + 1);
+
+        if (option == "--beams")
+        {
+            options.nbBeams.clear();
+            std::istringstream iss(value);
+            std::string item;
+            while (std::getline(iss, item, ','))
+                options.nbBeams.push_back(parseValue<unsigned int>(option, item));
+            std::sort(options.nbBeams.begin(), options.nbBeams.end());
+        }
+        else if (option == "--pattern")
+            options.pattern = value;
+        else if (option == "--steps")
+            options.nbSteps = std::max(1u, parseValue<unsigned int>(option, value));
+        else if (option == "--cgIterations")
+            options.nbCGIterations = parseValue<unsigned int>(option, value);
+        else if (option == "--crimpRatio")
+            options.crimpRatio = parseValue<double>(option, value);
+        else if (option == "--threads")
+            options.nbThreads = parseValue<unsigned int>(option, value);
+        else if (option == "--parallelStrategy")
+            options.parallelStrategy = value;
+        else if (option == "--batchKernel")
+            options.batchKernel = value;
+        else if (option == "--csv")
+            options.csv = true;
+        else if (option == "--maxScalingRatio")
+            options.maxScalingRatio = parseValue<double>(option, value);
+        else
+            throw std::invalid_argument("unknown option " + argument);
+    }
+    if (options.nbBeams.empty())
+        throw std::invalid_argument("no stent size given");
+    return options;
+}
+
+/// Crimping of a generated stent, see the description of the harness above
+Result runStent(const Options& options, const unsigned int nbBeams)
+{
+    StentParameters parameters;
+    parameters.pattern = StentParameters::patternFromName(options.pattern);
+    parameters.nbBeams = nbBeams;
+    const StentGenerator stent(parameters);
+
+    VecCoord positions;
+    stent.computePositions(parameters.radius, positions);
+
+    const auto simulation = sofa::simpleapi::createSimulation("DAG");
+    const auto root = sofa::simpleapi::createRootNode(simulation, "root");
+
+    auto* mstate = dynamic_cast<MechanicalObject*>(
+        sofa::simpleapi::createObject(root, "MechanicalObject", {{"template", "Rigid3d"}}).get());
+    mstate->x.setValue(positions);
+    mstate->x0.setValue(positions);
+
+    auto* topology = dynamic_cast<MeshTopology*>(sofa::simpleapi::createObject(root, "MeshTopology", {}).get());
+    for (const StentGenerator::Edge& edge : stent.getEdges())
+        topology->addEdge(edge[0], edge[1]);
+
+    // 316L stainless steel wire, 100 um square section
+    auto* forceField = dynamic_cast<ForceField*>(
+        sofa::simpleapi::createObject(root, "BeamPlasticFEMForceField", {
+            {"poissonRatio", "0.3"}, {"youngModulus", "1.93e11"}, {"initialYieldStress", "2.05e8"},
+            {"zSection", "1e-4"}, {"ySection", "1e-4"}, {"isTimoshenko", "true"},
+            {"usePrecomputedStiffness", "false"}, {"headless", "true"},
+            {"parallelStrategy", options.parallelStrategy}, {"batchKernel", options.batchKernel}}).get());
+
+    const Clock::time_point initStart = Clock::now();
+    sofa::simulation::node::initRoot(root.get());
+    const Clock::duration initTime = Clock::now() - initStart;
+
+    sofa::core::MechanicalParams mparams;
+    mparams.setKFactor(1.0);
+    sofa::Data<VecDeriv> force, dForce, velocity, dx;
+    velocity.setValue(VecDeriv(stent.getNbNodes()));
+    {
+        // Arbitrary but reproducible direction of the stiffness products
+        VecDeriv& v = *dx.beginEdit();
+        v.resize(stent.getNbNodes());
+        for (std::size_t i = 0; i < v.size(); i++)
+            for (unsigned int k = 0; k < 6; k++)
+                v[i][k] = 1e-6 * ((i*6 + k) % 7) - 3e-6;
+        dx.endEdit();
+    }
+
+    Clock::duration addForceTime { 0 };
+    Clock::duration addDForceTime { 0 };
+    const Clock::time_point start = Clock::now();
+
+    for (unsigned int step = 1; step <= options.nbSteps; step++)
+    {
+        const double ratio = 1 - (1 - options.crimpRatio) * step / options.nbSteps;
+        stent.computePositions(parameters.radius * ratio, positions);
+        mstate->x.setValue(positions);
+
+        force.setValue(VecDeriv(stent.getNbNodes()));
+        const Clock::time_point forceStart = Clock::now();
+        forceField->addForce(&mparams, force, mstate->x, velocity);
+        addForceTime += Clock::now() - forceStart;
+
+        const Clock::time_point dForceStart = Clock::now();
+        for (unsigned int k = 0; k < options.nbCGIterations; k++)
+        {
+            dForce.setValue(VecDeriv(stent.getNbNodes()));
+            forceField->addDForce(&mparams, dForce, dx);
+        }
+        addDForceTime += Clock::now() - dForceStart;
+    }
+
+    const double totalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const double nbElementSteps = double(stent.getNbBeams()) * options.nbSteps;
+
+    Result result;
+    result.nbBeams = stent.getNbBeams();
+    result.nbNodes = stent.getNbNodes();
+    result.initMilliseconds = std::chrono::duration<double, std::milli>(initTime).count();
+    result.stepsPerSecond = options.nbSteps / totalSeconds;
+    result.addForceNsPerElement = std::chrono::duration<double, std::nano>(addForceTime).count() / nbElementSteps;
+    result.addDForceNsPerElement = options.nbCGIterations > 0
+            ? std::chrono::duration<double, std::nano>(addDForceTime).count() / (nbElementSteps * options.nbCGIterations)
+            : 0;
+    result.peakRSSMegabytes = getPeakRSSMegabytes();
+    result.nbPlasticGaussPoints = getOutput(forceField, "nbPlasticGaussPoints");
+    result.nbLocalNewtonFailures = getOutput(forceField, "nbLocalNewtonFailures");
+
+    sofa::simulation::node::unload(root);
+    return result;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    try
+    {
+        options = parseOptions(argc, argv);
+        StentParameters::patternFromName(options.pattern);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    sofa::simpleapi::importPlugin("Sofa.Component.StateContainer");
+    sofa::simpleapi::importPlugin("Sofa.Component.Topology.Container.Constant");
+    sofa::simpleapi::importPlugin("BeamPlastic");
+
+    // The force field uses the task scheduler of the registry, if it is already initialised
+    const unsigned int nbThreads = options.nbThreads > 0 ? options.nbThreads
+                                                         : std::max(1u, std::thread::hardware_concurrency());
+    sofa::simulation::MainTaskSchedulerFactory::createInRegistry()->init(nbThreads);
+
+    if (options.csv)
+        std::cout << "pattern,beams,nodes,threads,parallelStrategy,batchKernel,steps,cgIterations,initMilliseconds,"
+                     "stepsPerSecond,addForceNsPerElement,addDForceNsPerElement,peakRSSMegabytes,plasticGaussPoints" << std::endl;
+    else
+        std::cout << "Crimping of " << options.pattern << " stents to " << options.crimpRatio << " of their radius, "
+                  << options.nbSteps << " steps of 1 addForce and " << options.nbCGIterations << " addDForce, "
+                  << nbThreads << " threads, " << options.parallelStrategy << " parallel strategy\n\n"
+                  << std::setw(10) << "beams" << std::setw(12) << "init (ms)" << std::setw(12) << "steps/s"
+                  << std::setw(18) << "addForce ns/elem"
+                  << std::setw(19) << "addDForce ns/elem" << std::setw(16) << "peak RSS (MB)"
+                  << std::setw(16) << "plastic GPs" << std::endl;
+
+    std::vector<Result> results;
+    for (const unsigned int nbBeams : options.nbBeams)
+    {
+        const Result result = runStent(options, nbBeams);
+        results.push_back(result);
+
+        if (options.csv)
+            std::cout << options.pattern << "," << result.nbBeams << "," << result.nbNodes << "," << nbThreads << ","
+                      << options.parallelStrategy << "," << options.batchKernel << "," << options.nbSteps << ","
+                      << options.nbCGIterations << "," << result.initMilliseconds << "," << result.stepsPerSecond << ","
+                      << result.addForceNsPerElement << ","
+                      << result.addDForceNsPerElement << "," << result.peakRSSMegabytes << ","
+                      << result.nbPlasticGaussPoints << std::endl;
+        else
+            std::cout << std::fixed << std::setprecision(1)
+                      << std::setw(10) << result.nbBeams << std::setw(12) << result.initMilliseconds
+                      << std::setw(12) << result.stepsPerSecond
+                      << std::setw(18) << result.addForceNsPerElement << std::setw(19) << result.addDForceNsPerElement
+                      << std::setw(16) << result.peakRSSMegabytes << std::setw(16) << result.nbPlasticGaussPoints
+                      << std::endl;
+
+        if (result.nbLocalNewtonFailures > 0)
+            std::cerr << result.nbLocalNewtonFailures << " plastic corrections did not converge on the stent of "
+                      << result.nbBeams << " beams" << std::endl;
+    }
+
+    if (options.maxScalingRatio > 0)
+    {
+        const double reference = results.front().addForceNsPerElement;
+        for (const Result& result : results)
+        {
+            if (result.addForceNsPerElement > options.maxScalingRatio * reference)
+            {
+                std::cerr << "Scaling regression: " << result.addForceNsPerElement << " ns per element for "
+                          << result.nbBeams << " beams, more than " << options.maxScalingRatio << " times the "
+                          << reference << " ns for " << results.front().nbBeams << " beams" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,302 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <BeamPlastic/forcefield/BeamPlasticFEMForceField.h>
+#include <BeamPlastic/io/DisplacementTrace.h>
+
+#include <sofa/component/statecontainer/MechanicalObject.h>
+#include <sofa/component/topology/container/constant/MeshTopology.h>
+#include <sofa/core/MechanicalParams.h>
+#include <sofa/simpleapi/SimpleApi.h>
+#include <sofa/simulation/MainTaskSchedulerFactory.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/simulation/Simulation.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+
+/**
+ * Replay of a displacement trace recorded by BeamPlasticFEMForceField (see the
+ * displacementTraceFile attribute and io/DisplacementTrace.h).
+ *
+ * The force field is recreated alone, with the recorded attributes, edges and
+ * rest positions, and the recorded positions are fed to addForce in sequence:
+ * the element kernels go through the same plastic loading path as in the
+ * original simulation, without the solvers, collisions and other components.
+ * Recorded attributes can be overridden, e.g. to compare batch kernels or
+ * parallel strategies on the same loading path.
+ *
+ * The time per element of addForce (and optionally addDForce) is reported,
+ * with checksums of the final forces and plastic state to check that an
+ * optimisation of the kernels does not change the results.
+ *
+ * Usage: BeamPlasticTrace_replay <trace file> [--repeat=1] [--cgIterations=0]
+ *        [--threads=0] [--set=attribute=value ...]
+ */
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+    std::string traceFile;
+    unsigned int nbRepeats { 1 };
+    unsigned int nbCGIterations { 0 };
+    unsigned int nbThreads { 0 };
+    std::map<std::string, std::string> overrides;
+};
+
+template<class T>
+T parseValue(const std::string& option, const std::string& value)
+{
+    std::istringstream iss(value);
+    T result;
+    if (!(iss >> result) || !iss.eof())
+        throw std::invalid_argument("invalid value " + value + " for option " + option);
+    return result;
+}
+
+Options parseOptions(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        if (argument.rfind("--", 0) != 0)
+        {
+            options.traceFile = argument;
+            continue;
+        }
+
+        const std::size_t separator = argument.find('=');
+        const std::string option = argument.substr(0, separator);
+        const std::string value = separator == std::string::npos ? "" : argument.substr(separator + 1);
+
+        if (option == "--repeat")
+            options.nbRepeats = std::max(1u, parseValue<unsigned int>(option, value));
+        else if (option == "--cgIterations")
+            options.nbCGIterations = parseValue<unsigned int>(option, value);
+        else if (option == "--threads")
+            options.nbThreads = parseValue<unsigned int>(option, value);
+        else if (option == "--set")
+        {
+            const std::size_t valueSeparator = value.find('=');
+            if (valueSeparator == std::string::npos)
+                throw std::invalid_argument("--set expects attribute=value, got " + value);
+            options.overrides[value.substr(0, valueSeparator)] = value.substr(valueSeparator + 1);
+        }
+        else
+            throw std::invalid_argument("unknown option " + argument);
+    }
+    if (options.traceFile.empty())
+        throw std::invalid_argument("no trace file given");
+    return options;
+}
+
+template<class DataTypes>
+int replay(const Options& options, const char* templateName)
+{
+    typedef beamplastic::forcefield::BeamPlasticFEMForceField<DataTypes> ForceField;
+    typedef sofa::component::statecontainer::MechanicalObject<DataTypes> MechanicalObject;
+    typedef sofa::component::topology::container::constant::MeshTopology MeshTopology;
+    typedef typename DataTypes::Coord Coord;
+    typedef typename DataTypes::VecCoord VecCoord;
+    typedef typename DataTypes::VecDeriv VecDeriv;
+
+    beamplastic::io::DisplacementTraceReader trace;
+    std::string errorMessage;
+    if (!trace.open<Coord>(options.traceFile, errorMessage))
+    {
+        std::cerr << errorMessage << std::endl;
+        return 1;
+    }
+
+    VecCoord positions(trace.getNbNodes());
+    trace.getRestPositions(positions.data());
+
+    // Force field alone, with the recorded attributes and the overridden ones
+    const auto simulation = sofa::simpleapi::createSimulation("DAG");
+    const auto root = sofa::simpleapi::createRootNode(simulation, "root");
+
+    auto* mstate = dynamic_cast<MechanicalObject*>(
+        sofa::simpleapi::createObject(root, "MechanicalObject", {{"template", templateName}}).get());
+    mstate->x.setValue(positions);
+    mstate->x0.setValue(positions);
+
+    auto* topology = dynamic_cast<MeshTopology*>(sofa::simpleapi::createObject(root, "MeshTopology", {}).get());
+    for (const auto& edge : trace.getEdges())
+        topology->addEdge(edge[0], edge[1]);
+
+    std::map<std::string, std::string> attributes(trace.getAttributes().begin(), trace.getAttributes().end());
+    attributes["headless"] = "true"; // nothing is drawn
+    for (const auto& attribute : options.overrides)
+        attributes[attribute.first] = attribute.second;
+    attributes["template"] = templateName;
+
+    auto* forceField = dynamic_cast<ForceField*>(
+        sofa::simpleapi::createObject(root, "BeamPlasticFEMForceField", attributes).get());
+    if (!forceField)
+    {
+        std::cerr << "Cannot create the force field from the trace attributes" << std::endl;
+        return 1;
+    }
+
+    sofa::simulation::node::initRoot(root.get());
+
+    // reset is protected in the force field
+    sofa::core::objectmodel::BaseObject* component = forceField;
+
+    sofa::core::MechanicalParams mparams;
+    mparams.setKFactor(1.0);
+    sofa::Data<VecDeriv> force, dForce, velocity, dx;
+    velocity.setValue(VecDeriv(positions.size()));
+    {
+        // Arbitrary but reproducible direction of the stiffness products
+        VecDeriv& v = *dx.beginEdit();
+        v.resize(positions.size());
+        for (std::size_t i = 0; i < v.size(); i++)
+            for (unsigned int k = 0; k < 6; k++)
+                v[i][k] = 1e-6 * ((i*6 + k) % 7) - 3e-6;
+        dx.endEdit();
+    }
+
+    unsigned int nbSteps = 0;
+    unsigned int nbResets = 0;
+    Clock::duration addForceTime { 0 };
+    Clock::duration addDForceTime { 0 };
+    const Clock::time_point start = Clock::now();
+
+    for (unsigned int repeat = 0; repeat < options.nbRepeats; repeat++)
+    {
+        if (repeat > 0)
+        {
+            component->reset();
+            trace.rewind();
+        }
+
+        beamplastic::io::DisplacementTraceRecord record;
+        while (trace.readRecord(record, positions.data()))
+        {
+            if (record.type == beamplastic::io::DISPLACEMENT_TRACE_RESET)
+            {
+                component->reset();
+                nbResets++;
+                continue;
+            }
+
+            mstate->x.setValue(positions);
+            force.setValue(VecDeriv(positions.size()));
+            const Clock::time_point forceStart = Clock::now();
+            forceField->addForce(&mparams, force, mstate->x, velocity);
+            addForceTime += Clock::now() - forceStart;
+
+            if (options.nbCGIterations > 0)
+            {
+                const Clock::time_point dForceStart = Clock::now();
+                for (unsigned int k = 0; k < options.nbCGIterations; k++)
+                {
+                    dForce.setValue(VecDeriv(positions.size()));
+                    forceField->addDForce(&mparams, dForce, dx);
+                }
+                addDForceTime += Clock::now() - dForceStart;
+            }
+            nbSteps++;
+        }
+    }
+
+    const double totalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (nbSteps == 0)
+    {
+        std::cerr << "The trace has no position records" << std::endl;
+        return 1;
+    }
+
+    // Checksums of the final state: norm of the forces of the last step, and plastic activity
+    double forceNorm2 = 0;
+    for (const auto& f : force.getValue())
+        for (unsigned int k = 0; k < 6; k++)
+            forceNorm2 += double(f[k]) * double(f[k]);
+
+    const auto getOutput = [forceField](const std::string& name) -> std::string
+    {
+        const sofa::core::BaseData* data = forceField->findData(name);
+        return data ? data->getValueString() : "?";
+    };
+
+    const double nbElementSteps = double(trace.getNbElements()) * nbSteps;
+    std::cout << std::setprecision(6)
+              << "Trace: " << options.traceFile << " (" << trace.getNbElements() << " beams, " << trace.getNbNodes()
+              << " nodes, " << nbSteps / options.nbRepeats << " steps, " << nbResets / options.nbRepeats << " resets)\n"
+              << "Steps replayed: " << nbSteps << " in " << totalSeconds << " s (" << nbSteps / totalSeconds << " steps/s)\n"
+              << "addForce: " << std::chrono::duration<double, std::nano>(addForceTime).count() / nbElementSteps
+              << " ns per element\n";
+    if (options.nbCGIterations > 0)
+        std::cout << "addDForce: " << std::chrono::duration<double, std::nano>(addDForceTime).count()
+                                      / (nbElementSteps * options.nbCGIterations) << " ns per element\n";
+    std::cout << std::setprecision(17)
+              << "Final force norm: " << std::sqrt(forceNorm2) << "\n"
+              << "Plastic Gauss points: " << getOutput("nbPlasticGaussPoints")
+              << ", max effective plastic strain: " << getOutput("maxEffectivePlasticStrain") << "\n"
+              << "Elastic energy: " << getOutput("elasticEnergy")
+              << ", plastic dissipation: " << getOutput("plasticDissipation") << std::endl;
+
+    sofa::simulation::node::unload(root);
+    return 0;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    try
+    {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    sofa::simpleapi::importPlugin("Sofa.Component.StateContainer");
+    sofa::simpleapi::importPlugin("Sofa.Component.Topology.Container.Constant");
+    sofa::simpleapi::importPlugin("BeamPlastic");
+
+    const unsigned int nbThreads = options.nbThreads > 0 ? options.nbThreads
+                                                         : std::max(1u, std::thread::hardware_concurrency());
+    sofa::simulation::MainTaskSchedulerFactory::createInRegistry()->init(nbThreads);
+
+    // The precision of the trace selects the template of the force field
+    if (beamplastic::io::DisplacementTraceReader::getRealSize(options.traceFile) == sizeof(float))
+        return replay<sofa::defaulttype::Rigid3fTypes>(options, "Rigid3f");
+    return replay<sofa::defaulttype::Rigid3dTypes>(options, "Rigid3d");
+}
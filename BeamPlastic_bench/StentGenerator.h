@@ -0,0 +1,274 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/type/vector.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+
+namespace beamplastic::bench
+{
+
+/**
+ * Parameters of a synthetic stent. The struts form a zig-zag pattern wound on
+ * a cylinder, either as closed rings linked by axial connectors, or as a single
+ * helical strip. The number of rings (or helical turns) is derived from the
+ * targeted number of beam elements.
+ */
+struct StentParameters
+{
+    enum class Pattern { ZIGZAG_RINGS, HELICAL };
+
+    Pattern pattern = Pattern::ZIGZAG_RINGS;
+    unsigned int nbBeams = 1000; ///< targeted number of beam elements
+    unsigned int nbCrowns = 8; ///< number of peaks of each ring, or helical turn
+    unsigned int nbElementsPerStrut = 4;
+    unsigned int nbConnectors = 3; ///< number of connectors between two rings (ZIGZAG_RINGS only)
+    unsigned int nbElementsPerConnector = 2;
+    double radius = 1.5e-3;
+    double strutLength = 1e-3;
+    double gap = 3e-4; ///< axial distance between the peaks of a ring (or turn) and the valleys of the next one
+
+    static Pattern patternFromName(const std::string& name)
+    {
+        if (name == "zigzag")
+            return Pattern::ZIGZAG_RINGS;
+        if (name == "helical")
+            return Pattern::HELICAL;
+        throw std::invalid_argument("unknown stent pattern " + name + " (should be zigzag or helical)");
+    }
+};
+
+
+/**
+ * Generator of the beam topology and of the node frames of a synthetic stent,
+ * at any radius of the crimping (or expansion) process.
+ *
+ * The struts are straight and keep their length when the radius changes: the
+ * crowns open or close, and the rings get longer or shorter, as in the crimping
+ * of an actual stent. The frame of each node is aligned with the strut (or
+ * connector) starting at this node, so that the change of the strut angles is
+ * seen as a bending by the elements ending at the crowns. The first element of
+ * each connector starts at a crown node, whose frame follows the ring strut:
+ * the stiffness of this element is then only approximated, which is of no
+ * consequence for the performance measurements.
+ */
+class StentGenerator
+{
+public:
+
+    typedef sofa::defaulttype::Rigid3dTypes DataTypes;
+    typedef DataTypes::Coord Coord;
+    typedef DataTypes::VecCoord VecCoord;
+    typedef sofa::type::Vec<3, double> Vec3;
+    typedef std::array<unsigned int, 2> Edge;
+
+    explicit StentGenerator(const StentParameters& parameters)
+        : m_parameters(parameters)
+    {
+        if (parameters.nbCrowns < 2 || parameters.nbElementsPerStrut < 1 || parameters.nbElementsPerConnector < 1)
+            throw std::invalid_argument("a stent needs at least 2 crowns and 1 element per strut and connector");
+        if (2 * parameters.radius * std::sin(M_PI / (2 * parameters.nbCrowns)) >= parameters.strutLength)
+            throw std::invalid_argument("the strut length is too short for the stent radius and number of crowns");
+
+        const unsigned int nbStruts = 2 * parameters.nbCrowns;
+        const unsigned int m = parameters.nbElementsPerStrut;
+
+        if (parameters.pattern == StentParameters::Pattern::ZIGZAG_RINGS)
+        {
+            const unsigned int nbConnectors = std::min(parameters.nbConnectors, parameters.nbCrowns);
+            const unsigned int nbRingElements = nbStruts * m;
+            const unsigned int nbConnectorElements = nbConnectors * parameters.nbElementsPerConnector;
+            m_nbRings = std::max(1u, (parameters.nbBeams + nbConnectorElements) / (nbRingElements + nbConnectorElements));
+
+            // Closed rings: each node starts the element linking it to the next one
+            m_nbNodes = m_nbRings * nbRingElements;
+            for (unsigned int ring = 0; ring < m_nbRings; ring++)
+                for (unsigned int k = 0; k < nbRingElements; k++)
+                    m_edges.push_back({ring*nbRingElements + k, ring*nbRingElements + (k + 1) % nbRingElements});
+
+            // Axial connectors, from peaks of a ring to the valleys of the next one
+            for (unsigned int ring = 0; ring + 1 < m_nbRings; ring++)
+            {
+                for (unsigned int c = 0; c < nbConnectors; c++)
+                {
+                    const unsigned int peak = 2*(c*parameters.nbCrowns/nbConnectors) + 1;
+                    const unsigned int valley = peak - 1;
+                    const unsigned int peakNode = ring*nbRingElements + peak*m;
+                    const unsigned int valleyNode = (ring + 1)*nbRingElements + valley*m;
+                    unsigned int previous = peakNode;
+                    for (unsigned int k = 1; k < parameters.nbElementsPerConnector; k++)
+                    {
+                        m_connectorNodes.push_back({peakNode, valleyNode, k});
+                        m_edges.push_back({previous, m_nbNodes});
+                        previous = m_nbNodes++;
+                    }
+                    m_edges.push_back({previous, valleyNode});
+                }
+            }
+        }
+        else
+        {
+            // Single open strip: each node but the last starts the element
+            // linking it to the next one
+            const unsigned int nbStrutsTotal = std::max(1u, (parameters.nbBeams + m/2) / m);
+            m_nbRings = (nbStrutsTotal + nbStruts - 1) / nbStruts;
+            m_nbNodes = nbStrutsTotal*m + 1;
+            for (unsigned int k = 0; k + 1 < m_nbNodes; k++)
+                m_edges.push_back({k, k + 1});
+        }
+    }
+
+    const StentParameters& getParameters() const { return m_parameters; }
+
+    /// Number of rings, or of started helical turns
+    unsigned int getNbRings() const { return m_nbRings; }
+    unsigned int getNbNodes() const { return m_nbNodes; }
+    unsigned int getNbBeams() const { return static_cast<unsigned int>(m_edges.size()); }
+    const sofa::type::vector<Edge>& getEdges() const { return m_edges; }
+
+    /// Node positions and frames of the stent at the given radius
+    void computePositions(const double radius, VecCoord& positions) const
+    {
+        positions.resize(m_nbNodes);
+
+        const unsigned int nbStruts = 2 * m_parameters.nbCrowns;
+        const unsigned int m = m_parameters.nbElementsPerStrut;
+        const double strutAngle = M_PI / m_parameters.nbCrowns;
+        const bool rings = m_parameters.pattern == StentParameters::Pattern::ZIGZAG_RINGS;
+
+        double height, pitch;
+        computeStrutHeight(radius, height, pitch);
+
+        // Vertex (crown) j of a ring, or of the helical strip. The rings are
+        // rotated by one strut angle from each other, so that the peaks of a
+        // ring face the valleys of the next one.
+        const auto vertex = [&](const unsigned int ring, const unsigned int j)
+        {
+            const double angle = (ring + j) * strutAngle;
+            const double base = rings ? ring * (height + m_parameters.gap) : j * pitch;
+            return Vec3(radius*std::cos(angle), radius*std::sin(angle), base + (j % 2 ? height : 0));
+        };
+
+        // The nodes of a strut share the same frame: only the elements ending
+        // at a crown are deformed by the opening or closing of the crowns
+        const auto setStrut = [&](const unsigned int ring, const unsigned int j, const unsigned int firstNode,
+                                  const unsigned int nbNodes)
+        {
+            const Vec3 start = vertex(ring, j);
+            const Vec3 end = vertex(ring, j + 1);
+            const Coord::Rot frame = computeFrame(end - start, (ring + j + 0.5) * strutAngle);
+            for (unsigned int k = 0; k < nbNodes; k++)
+            {
+                positions[firstNode + k].getCenter() = start + (end - start) * (double(k) / m);
+                positions[firstNode + k].getOrientation() = frame;
+            }
+        };
+
+        if (rings)
+        {
+            for (unsigned int ring = 0; ring < m_nbRings; ring++)
+                for (unsigned int j = 0; j < nbStruts; j++)
+                    setStrut(ring, j, (ring*nbStruts + j)*m, m);
+
+            for (unsigned int k = 0; k < m_connectorNodes.size(); k++)
+            {
+                const ConnectorNode& node = m_connectorNodes[k];
+                const Coord& start = positions[node.peak];
+                const Vec3& end = positions[node.valley].getCenter();
+                Coord& position = positions[m_nbRings*nbStruts*m + k];
+                position.getCenter() = start.getCenter() + (end - start.getCenter()) * (double(node.rank) / m_parameters.nbElementsPerConnector);
+                position.getOrientation() = computeFrame(Vec3(0, 0, 1), std::atan2(start.getCenter()[1], start.getCenter()[0]));
+            }
+        }
+        else
+        {
+            for (unsigned int j = 0; j*m + 1 < m_nbNodes; j++)
+                setStrut(0, j, j*m, m);
+            positions.back() = positions[m_nbNodes - 2];
+            positions.back().getCenter() = vertex(0, (m_nbNodes - 1) / m);
+        }
+    }
+
+protected:
+
+    /// Axial extent of the struts and axial advance of the helical strip per
+    /// strut, keeping the strut lengths at the given radius
+    void computeStrutHeight(const double radius, double& height, double& pitch) const
+    {
+        const double sinAngle = std::sin(M_PI / (2 * m_parameters.nbCrowns));
+        const double chord2 = 4 * radius*radius * sinAngle*sinAngle;
+        const double length2 = m_parameters.strutLength * m_parameters.strutLength;
+
+        if (m_parameters.pattern == StentParameters::Pattern::ZIGZAG_RINGS)
+        {
+            height = std::sqrt(std::max(length2 - chord2, 0.0));
+            pitch = 0;
+            return;
+        }
+
+        // Helical strip: the rising and descending struts have slightly
+        // different lengths, set at the initial radius
+        const double restChord2 = 4 * m_parameters.radius*m_parameters.radius * sinAngle*sinAngle;
+        const double restHeight = std::sqrt(std::max(length2 - restChord2, 0.0));
+        const double restPitch = (restHeight + m_parameters.gap) / (2 * m_parameters.nbCrowns);
+        const double rising = std::sqrt(std::max(restChord2 + (restHeight + restPitch)*(restHeight + restPitch) - chord2, 0.0));
+        const double descending = std::sqrt(std::max(restChord2 + (restHeight - restPitch)*(restHeight - restPitch) - chord2, 0.0));
+        height = (rising + descending) / 2;
+        pitch = (rising - descending) / 2;
+    }
+
+    /// Frame with x along the given direction, and y as close as possible to
+    /// the outward normal of the cylinder at the given angle
+    static Coord::Rot computeFrame(const Vec3& direction, const double angle)
+    {
+        const Vec3 x = direction.normalized();
+        Vec3 normal(std::cos(angle), std::sin(angle), 0);
+        normal = normal - x * (normal * x);
+        const Vec3 y = normal.normalized();
+        const Vec3 z = sofa::type::cross(x, y);
+        return Coord::Rot::createQuaterFromFrame(x, y, z);
+    }
+
+    /// Intermediate node of a connector
+    struct ConnectorNode
+    {
+        unsigned int peak;
+        unsigned int valley;
+        unsigned int rank; ///< 1 for the node next to the peak
+    };
+
+    StentParameters m_parameters;
+    unsigned int m_nbRings { 0 };
+    unsigned int m_nbNodes { 0 };
+    sofa::type::vector<Edge> m_edges;
+    sofa::type::vector<ConnectorNode> m_connectorNodes;
+};
+
+
+} // namespace beamplastic::bench
@@ -19,18 +19,40 @@
 *                                                                             *
 * Contact information: contact@sofa-framework.org                             *
 ******************************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 using std::string;
 
+#include <BeamPlastic/constitutivelaw/RambergOsgood.h>
+#include <BeamPlastic/constitutivelaw/TabulatedConstitutiveLaw.h>
 #include <BeamPlastic/forcefield/BeamPlasticFEMForceField.h>
+#include <BeamPlastic/io/DisplacementTrace.h>
+#include <BeamPlastic/io/GaussPointHistory.h>
+#include <BeamPlastic/mapping/BeamPlasticShapeFunctionMapping.h>
 
 #include <sofa/defaulttype/RigidTypes.h>
 #include <sofa/component/statecontainer/MechanicalObject.h>
+#include <sofa/component/topology/container/dynamic/EdgeSetTopologyModifier.h>
+#include <sofa/core/behavior/DefaultMultiMatrixAccessor.h>
+#include <sofa/core/visual/VisualParams.h>
+#include <sofa/linearalgebra/FullMatrix.h>
 
 #include <sofa/simulation/SceneLoaderFactory.h>
 using sofa::simulation::SceneLoaderFactory;
 using sofa::simulation::SceneLoader;
 
+#include <sofa/simulation/AnimateEndEvent.h>
 #include <sofa/simulation/graph/DAGSimulation.h>
 #include <sofa/simulation/common/SceneLoaderXML.h>
 using sofa::simulation::SceneLoaderXML;
@@ -39,6 +61,7 @@ using sofa::simulation::SceneLoaderXML;
 using sofa::helper::system::PluginManager;
 
 #include <sofa/testing/BaseSimulationTest.h>
+#include <sofa/testing/TestMessageHandler.h>
 
 #include <sofa/simpleapi/SimpleApi.h>
 
@@ -50,43 +73,1887 @@ using sofa::simulation::Node;
 using sofa::component::statecontainer::MechanicalObject;
 
 using sofa::defaulttype::Rigid3dTypes;
+using sofa::defaulttype::Rigid3fTypes;
+using sofa::defaulttype::Vec3dTypes;
 
 typedef sofa::testing::BaseSimulationTest BaseSimulationTest;
 
+/// Exposes the internals of the force field checked by the tests
+class TestForceField : public beamplastic::forcefield::BeamPlasticFEMForceField<Rigid3dTypes>
+{
+public:
+    SOFA_CLASS(TestForceField, SOFA_TEMPLATE(beamplastic::forcefield::BeamPlasticFEMForceField, Rigid3dTypes));
+
+    typedef beamplastic::forcefield::BeamPlasticFEMForceField<Rigid3dTypes> Inherit;
+
+    using Inherit::BeamInfo;
+    using Inherit::ConstitutiveLawType;
+    using Inherit::LocalNewtonStatistics;
+    using Inherit::m_beamsData;
+    using Inherit::m_materials;
+    using Inherit::d_maxLocalNewtonIterations;
+    using Inherit::initMaterialTables;
+    using Inherit::readHardeningCurve;
+    using Inherit::updateBeams;
+    using Inherit::m_batchStiffness;
+    using Inherit::m_batchElements;
+    using Inherit::m_elementOrder;
+    using Inherit::m_orderedElements;
+    using Inherit::m_coloredElements;
+    using Inherit::m_colorOffsets;
+    using Inherit::m_batchSquaredYieldLimits;
+    using Inherit::computePlasticMultiplier;
+    using Inherit::computeConstPlasticModulus;
+    using Inherit::m_drawGaussPoints;
+    using Inherit::m_drawCentrelinePoints;
+    using Inherit::m_drawLODPoints;
+    using Inherit::m_drawGaussPointShapeFunctions;
+};
+
+/// Hardening curve of constant slope, whose plastic modulus is wrongly reported
+/// as zero: the Newton steps on the plastic multiplier always overshoot.
+class MisleadingLinearLaw : public beamplastic::constitutivelaw::PlasticConstitutiveLaw<Rigid3dTypes>
+{
+public:
+    MisleadingLinearLaw(double yieldStress, double plasticModulus)
+        : m_yieldStress(yieldStress), m_plasticModulus(plasticModulus) {}
+
+    Real getTangentModulusFromStress(const double) override { return 0; }
+    Real getTangentModulusFromStrain(const double) override { return 0; }
+    Real getStressFromStrain(const double effPlasticStrain) override { return m_yieldStress + m_plasticModulus*effPlasticStrain; }
+    Real getPlasticModulusFromStrain(const double) override { return 0; }
+
+private:
+    double m_yieldStress;
+    double m_plasticModulus;
+};
+
 class BeamPlasticFEMForceField_test : public BaseSimulationTest
 {
 public:
 
     typedef BaseSimulationTest::SceneInstance SceneInstance;
+    typedef beamplastic::forcefield::BeamPlasticFEMForceField<Rigid3dTypes> ForceField;
 
-    void check_BeamPlasticfEMForceField_init()
+    /// Two beam elements along x, of 0.5 mm
+    static constexpr const char* TwoBeamNodes = "0 0 0 0 0 0 1  5e-4 0 0 0 0 0 1  1e-3 0 0 0 0 0 1";
+    static constexpr const char* TwoBeamLines = "0 1 1 2";
+
+    static void importBeamPlugins(const string& topologyPlugin = "Sofa.Component.Topology.Container.Constant")
     {
         sofa::simpleapi::importPlugin("Sofa.Component.StateContainer");
-        sofa::simpleapi::importPlugin("Sofa.Component.Topology.Container.Constant");
+        sofa::simpleapi::importPlugin(topologyPlugin);
         sofa::simpleapi::importPlugin("BeamPlastic");
+    }
+
+    /// Scene of the DOFs and the line topology of beam elements, followed by the given components
+    static string makeMeshScene(const string& nodes = TwoBeamNodes, const string& lines = TwoBeamLines,
+                                const string& type = "Rigid3d", const string& components = "")
+    {
+        return
+            "<Node name='root' dt='1e-2' gravity='0.0 0.0 0.0'>                                                 "
+            "   <MechanicalObject template='" + type + "' name='DOFs' position='" + nodes + "' />               "
+            "   <MeshTopology name = 'lines' lines = '" + lines + "' />                                         "
+            + components +
+            "</Node>                                                                                            ";
+    }
 
-        string scene =
+    /// Scene of the DOFs and a line topology which can be modified (by the component 'modifier')
+    static string makeEdgeSetScene(const string& nodes, const string& edges)
+    {
+        return
             "<Node name='root' dt='1e-2' gravity='0.0 0.0 0.0'>                                                 "
-            "   <MechanicalObject template='Rigid3d' name='DOFs' position='0 0 0 0 0 0 1                        "
-            "                                                              5e-4 0 0 0 0 0 1                     "
-            "                                                              1e-3 0 0 0 0 0 1                     "
-            "                                                              1.5e-3 0 0 0 0 0 1                   "
-            "                                                              2e-3 0 0 0 0 0 1                     "
-            "                                                              2.5e-3 0 0 0 0 0 1                   "
-            "                                                              3e-3 0 0 0 0 0 1                     "
-            "                                                              3.5e-3 0 0 0 0 0 1' />               "
-            "   <MeshTopology name = 'lines' lines = '0 1 1 2 2 3 3 4 4 5 5 6 6 7' /> '                         "
-            "   <BeamPlasticFEMForceField name = 'FEM' poissonRatio = '0.3' youngModulus = '2.03e11'            "
-            "                             yieldStress = '4.80e8' zSection = '5e-5' ySection = '5e-5'            "
-            "                             usePrecomputedStiffness = 'false'                                     "
-            "                             useConsistentTangentOperator = 'false'                                "
-            "                             isPerfectlyPlastic = 'false' isTimoshenko = 'true' /> '               "
+            "   <MechanicalObject template='Rigid3d' name='DOFs' position='" + nodes + "' />                    "
+            "   <EdgeSetTopologyContainer name='lines' position='@DOFs.position' edges='" + edges + "' />       "
+            "   <EdgeSetTopologyModifier name='modifier' />                                                     "
             "</Node>                                                                                            ";
+    }
+
+    /// Scene of beam elements with a force field FEM of steel (the default material
+    /// of the tests), with the given additional attributes
+    static string makeBeamScene(const string& attributes, const string& nodes = TwoBeamNodes, const string& lines = TwoBeamLines,
+                                const string& type = "Rigid3d", const string& components = "")
+    {
+        return makeMeshScene(nodes, lines, type,
+            "   <BeamPlasticFEMForceField template='" + type + "' name = 'FEM' poissonRatio = '0.3'             "
+            "                             youngModulus = '2.03e11' initialYieldStress = '4.80e8'                "
+            "                             zSection = '5e-5' ySection = '5e-5'                                   "
+            "                             isPerfectlyPlastic = 'false' isTimoshenko = 'true'                    "
+            "                             " + attributes + " />                                                 "
+            + components);
+    }
+
+    /// Initialised beam scene, with its force field and its DOFs (null if missing)
+    struct BeamScene
+    {
+        std::unique_ptr<SceneInstance> instance;
+        ForceField* forceField = nullptr;
+        MechanicalObject<Rigid3dTypes>* dofs = nullptr;
+
+        bool isLoaded() const { return forceField != nullptr && dofs != nullptr; }
+        Node* getRoot() const { return instance->root.get(); }
+    };
+
+    static BeamScene loadBeamScene(const string& attributes, const string& nodes = TwoBeamNodes,
+                                   const string& lines = TwoBeamLines, const string& components = "")
+    {
+        BeamScene scene;
+        scene.instance = std::make_unique<SceneInstance>("xml", makeBeamScene(attributes, nodes, lines, "Rigid3d", components));
+        if (!scene.instance->root)
+            return scene;
+        scene.instance->initScene();
+        scene.forceField = dynamic_cast<ForceField*>(scene.instance->root->getObject("FEM"));
+        scene.dofs = dynamic_cast<MechanicalObject<Rigid3dTypes>*>(scene.instance->root->getObject("DOFs"));
+        return scene;
+    }
+
+    /// Adds a TestForceField named FEM to the node, of the default material of the
+    /// tests, then with the given Data values
+    static TestForceField::SPtr addTestForceField(Node* node, const std::vector<std::pair<string, string>>& values = {})
+    {
+        TestForceField::SPtr forceField = sofa::core::objectmodel::New<TestForceField>();
+        forceField->setName("FEM");
+        const std::vector<std::pair<string, string>> defaultValues = {
+            {"poissonRatio", "0.3"}, {"youngModulus", "2.03e11"}, {"initialYieldStress", "4.80e8"},
+            {"zSection", "5e-5"}, {"ySection", "5e-5"}, {"isTimoshenko", "true"} };
+        for (const auto& value : defaultValues)
+            forceField->findData(value.first)->read(value.second);
+        for (const auto& value : values)
+            forceField->findData(value.first)->read(value.second);
+        node->addObject(forceField);
+        return forceField;
+    }
+
+    /// Force for the rest positions of the DOFs, modified by the given deformation
+    template<class DataTypes, class Deformation>
+    static typename DataTypes::VecDeriv computeDeformationForce(sofa::core::behavior::ForceField<DataTypes>* forceField,
+                                                                MechanicalObject<DataTypes>* dofs, const Deformation& deformation)
+    {
+        Data<typename DataTypes::VecCoord> x;
+        typename DataTypes::VecCoord& positions = *x.beginEdit();
+        positions = dofs->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+        deformation(positions);
+        x.endEdit();
+
+        Data<typename DataTypes::VecDeriv> force;
+        forceField->addForce(sofa::core::MechanicalParams::defaultInstance(), force, x,
+                             *dofs->read(sofa::core::vec_id::read_access::velocity));
+        return force.getValue();
+    }
+
+    /// Force for the rest positions of the DOFs stretched along x by the given factor,
+    /// and bent along y by a deflection proportional to the node index
+    template<class DataTypes>
+    static typename DataTypes::VecDeriv computeStretchForce(sofa::core::behavior::ForceField<DataTypes>* forceField,
+                                                            MechanicalObject<DataTypes>* dofs, double factor,
+                                                            double deflection = 0)
+    {
+        return computeDeformationForce(forceField, dofs, [&](typename DataTypes::VecCoord& positions)
+        {
+            for (std::size_t i = 0; i < positions.size(); i++)
+            {
+                positions[i].getCenter()[0] *= factor;
+                positions[i].getCenter()[1] += deflection*i;
+            }
+        });
+    }
+
+    void check_BeamPlasticfEMForceField_init()
+    {
+        importBeamPlugins();
+
+        const BeamScene scene = loadBeamScene("usePrecomputedStiffness = 'false' useConsistentTangentOperator = 'false'",
+                                              "0 0 0 0 0 0 1  5e-4 0 0 0 0 0 1  1e-3 0 0 0 0 0 1  1.5e-3 0 0 0 0 0 1 "
+                                              "2e-3 0 0 0 0 0 1  2.5e-3 0 0 0 0 0 1  3e-3 0 0 0 0 0 1  3.5e-3 0 0 0 0 0 1",
+                                              "0 1 1 2 2 3 3 4 4 5 5 6 6 7");
+        ASSERT_TRUE(scene.isLoaded());
+    }
+
+    void check_BeamPlasticfEMForceField_tabulatedLaw_init()
+    {
+        importBeamPlugins();
+
+        const BeamScene scene = loadBeamScene("modelName = 'Tabulated' hardeningCurve = '0 4.80e8  0.01 5.20e8  0.05 5.50e8'");
+        ASSERT_TRUE(scene.isLoaded());
+        EXPECT_NE(scene.forceField->getComponentState(), sofa::core::objectmodel::ComponentState::Invalid);
+    }
+
+    void check_BeamPlasticfEMForceField_constitutiveModel()
+    {
+        importBeamPlugins();
+
+        // Hardening curve starting below the initial yield stress: it is shifted to start at it
+        {
+            SceneInstance testScene = SceneInstance("xml", makeMeshScene());
+            ASSERT_NE(testScene.root.get(), nullptr);
+            TestForceField::SPtr forceField = addTestForceField(testScene.root.get(), {
+                {"modelName", "Tabulated"}, {"hardeningCurve", "0 4.0e8  0.01 4.4e8  0.05 4.7e8"} });
+            {
+                EXPECT_MSG_EMIT(Warning);
+                testScene.initScene();
+            }
+            EXPECT_NE(forceField->getComponentState(), sofa::core::objectmodel::ComponentState::Invalid);
+
+            ASSERT_EQ(forceField->m_materials.size(), 1u);
+            auto* law = forceField->m_materials[0]._constitutiveLaw.get();
+            ASSERT_NE(law, nullptr);
+            EXPECT_NEAR(law->getStressFromStrain(0.0), 4.80e8, 1e-9*4.80e8);
+            EXPECT_NEAR(law->getStressFromStrain(0.01), 5.20e8, 1e-9*5.20e8);
+            EXPECT_NEAR(law->getTangentModulusFromStress(5.0e8), 4e9, 1e-9*4e9);
+        }
+
+        // Unknown model: the component is invalid
+        {
+            SceneInstance testScene = SceneInstance("xml", makeMeshScene());
+            ASSERT_NE(testScene.root.get(), nullptr);
+            TestForceField::SPtr forceField = addTestForceField(testScene.root.get(), {{"modelName", "Unknown"}});
+            {
+                EXPECT_MSG_EMIT(Error);
+                testScene.initScene();
+            }
+            EXPECT_EQ(forceField->getComponentState(), sofa::core::objectmodel::ComponentState::Invalid);
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_materialTables()
+    {
+        importBeamPlugins();
+
+        typedef ForceField::MechanicalState MechanicalState;
+
+        // Steel beam element, followed by a softer element of higher yield stress and twice the section
+        const std::vector<std::pair<string, string>> values = {
+            {"materials", "2.03e11 0.3 4.80e8  1.0e11 0.3 9.60e8"}, {"sections", "5e-5 5e-5  1e-4 5e-5"} };
+
+        {
+            SceneInstance testScene = SceneInstance("xml", makeMeshScene());
+            Node::SPtr root = testScene.root;
+            ASSERT_NE(root.get(), nullptr);
+
+            std::vector<std::pair<string, string>> indices = values;
+            indices.push_back({"materialIndices", "0 1"});
+            indices.push_back({"sectionIndices", "0 1"});
+            TestForceField::SPtr forceField = addTestForceField(root.get(), indices);
+            testScene.initScene();
+            EXPECT_NE(forceField->getComponentState(), sofa::core::objectmodel::ComponentState::Invalid);
+
+            const auto& bd = forceField->m_beamsData.getValue();
+            ASSERT_EQ(bd.size(), 2u);
+            EXPECT_EQ(bd[0]._materialIndex, 0u);
+            EXPECT_EQ(bd[1]._materialIndex, 1u);
+            EXPECT_EQ(bd[0]._sectionIndex, 0u);
+            EXPECT_EQ(bd[1]._sectionIndex, 1u);
+            EXPECT_EQ(bd[0]._E, 2.03e11);
+            EXPECT_EQ(bd[1]._E, 1.0e11);
+            EXPECT_EQ(bd[0]._zDim, 5e-5);
+            EXPECT_EQ(bd[1]._zDim, 1e-4);
+
+            // Axial stiffness EA/L of each element
+            EXPECT_NEAR(bd[0]._k_loc[0][0], 2.03e11 * 5e-5*5e-5 / 5e-4, 1e-9 * bd[0]._k_loc[0][0]);
+            EXPECT_NEAR(bd[1]._k_loc[0][0], 1.0e11 * 1e-4*5e-5 / 5e-4, 1e-9 * bd[1]._k_loc[0][0]);
+            for (unsigned int gp = 0; gp < 27; gp++)
+            {
+                EXPECT_FLOAT_EQ(bd[0]._localYieldStresses[gp], 4.80e8);
+                EXPECT_FLOAT_EQ(bd[1]._localYieldStresses[gp], 9.60e8);
+            }
+
+            // Uniform stretch of 0.3%: 609 MPa in the first element, 300 MPa in the second one
+            auto* dofs = dynamic_cast<MechanicalObject<Rigid3dTypes>*>(root->getObject("DOFs"));
+            ASSERT_NE(dofs, nullptr);
+            computeStretchForce(forceField.get(), dofs, 1 + 3e-3);
+
+            const auto states = forceField->getGaussPointStates();
+            ASSERT_EQ(states.size(), 2u);
+            for (unsigned int gp = 0; gp < 27; gp++)
+            {
+                EXPECT_EQ(states[0][gp], MechanicalState::PLASTIC);
+                EXPECT_EQ(states[1][gp], MechanicalState::ELASTIC);
+            }
+        }
+
+        // Out-of-range index, and wrong number of indices: the component is invalid
+        for (const string& materialIndices : { string("0 2"), string("0 1 1") })
+        {
+            SceneInstance testScene = SceneInstance("xml", makeMeshScene());
+            Node::SPtr root = testScene.root;
+            ASSERT_NE(root.get(), nullptr);
+
+            std::vector<std::pair<string, string>> indices = values;
+            indices.push_back({"materialIndices", materialIndices});
+            TestForceField::SPtr forceField = addTestForceField(root.get(), indices);
+            {
+                EXPECT_MSG_EMIT(Error);
+                testScene.initScene();
+            }
+            EXPECT_EQ(forceField->getComponentState(), sofa::core::objectmodel::ComponentState::Invalid);
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_coloring_init()
+    {
+        importBeamPlugins();
+
+        // Y-shaped mesh: the 3 elements attached to node 1 need 3 different colors
+        const BeamScene scene = loadBeamScene("parallelStrategy = 'coloring'",
+                                              "0 0 0 0 0 0 1  5e-4 0 0 0 0 0 1  1e-3 5e-4 0 0 0 0 1  "
+                                              "1e-3 -5e-4 0 0 0 0 1  1.5e-3 5e-4 0 0 0 0 1",
+                                              "0 1 1 2 1 3 2 4");
+        ASSERT_TRUE(scene.isLoaded());
+        EXPECT_EQ(scene.forceField->findData("nbColors")->getValueString(), "3");
+        EXPECT_EQ(scene.forceField->findData("colorSizes")->getValueString(), "2 1 1");
+    }
+
+    void check_BeamPlasticfEMForceField_batchKernel()
+    {
+        importBeamPlugins();
+
+        // Straight line of 11 elements: with batches of 8 elements, the second batch is padded
+        const unsigned int nbBeams = 11;
+        std::ostringstream positions, lines;
+        for (unsigned int i = 0; i <= nbBeams; i++)
+            positions << i*5e-4 << " 0 0 0 0 0 1 ";
+        for (unsigned int i = 0; i < nbBeams; i++)
+            lines << i << " " << i + 1 << " ";
+
+        // Loading and partial unloading, the axial strain increasing along the line: the
+        // elements yield at different steps, in the middle of the elastic batches
+        const std::vector<unsigned int> loadPath = { 1, 2, 3, 4, 5, 6, 7, 8, 7, 6 };
+        auto computePositions = [&](unsigned int load, Rigid3dTypes::VecCoord& x)
+        {
+            for (unsigned int i = 1; i <= nbBeams; i++)
+            {
+                const double strain = 4e-4*load*(0.5 + 0.1*(i - 1));
+                x[i].getCenter()[0] = x[i-1].getCenter()[0] + 5e-4*(1 + strain);
+                x[i].getCenter()[1] = 1e-7*load*i;
+            }
+        };
+
+        const std::string kernels[3] = { "none", "scalar", "auto" };
+        std::vector<Rigid3dTypes::VecDeriv> forces[3];
+        std::vector<double> elasticEnergies[3];
+        std::vector<double> plasticDissipations[3];
+        std::vector<ForceField::StorageVoigtTensor2> stresses[3];
+        std::vector<ForceField::StorageVoigtTensor2> plasticStrains[3];
+        for (unsigned int kernel = 0; kernel < 3; kernel++)
+        {
+            const BeamScene scene = loadBeamScene("batchKernel = '" + kernels[kernel] + "'", positions.str(), lines.str());
+            ASSERT_TRUE(scene.isLoaded());
+            ForceField* forceField = scene.forceField;
+            const auto* elasticEnergy = dynamic_cast<Data<double>*>(forceField->findData("elasticEnergy"));
+            const auto* plasticDissipation = dynamic_cast<Data<double>*>(forceField->findData("plasticDissipation"));
+            const auto* nbBatchedElements = dynamic_cast<Data<unsigned int>*>(forceField->findData("nbBatchedElements"));
+            const auto* nbPlasticBeams = dynamic_cast<Data<unsigned int>*>(forceField->findData("nbPlasticBeams"));
+            ASSERT_NE(elasticEnergy, nullptr);
+            ASSERT_NE(plasticDissipation, nullptr);
+            ASSERT_NE(nbBatchedElements, nullptr);
+            ASSERT_NE(nbPlasticBeams, nullptr);
+
+            bool hasMixedBatches = false;
+            for (const unsigned int load : loadPath)
+            {
+                forces[kernel].push_back(computeDeformationForce(forceField, scene.dofs, [&](Rigid3dTypes::VecCoord& x)
+                {
+                    computePositions(load, x);
+                }));
+                elasticEnergies[kernel].push_back(elasticEnergy->getValue());
+                plasticDissipations[kernel].push_back(plasticDissipation->getValue());
+
+                if (kernel == 0)
+                    EXPECT_EQ(nbBatchedElements->getValue(), 0u);
+                else if (nbPlasticBeams->getValue() > 0 && nbBatchedElements->getValue() > 0)
+                    hasMixedBatches = true;
+            }
+            if (kernel > 0)
+                EXPECT_TRUE(hasMixedBatches) << kernels[kernel];
+
+            const auto stressView = forceField->getGaussPointStresses();
+            const auto plasticStrainView = forceField->getGaussPointPlasticStrains();
+            ASSERT_EQ(stressView.size(), nbBeams);
+            for (std::size_t i = 0; i < nbBeams; i++)
+            {
+                for (unsigned int gp = 0; gp < 27; gp++)
+                {
+                    stresses[kernel].push_back(stressView[i][gp]);
+                    plasticStrains[kernel].push_back(plasticStrainView[i][gp]);
+                }
+            }
+        }
+
+        // The last elements yielded, not the first one
+        EXPECT_GT(plasticDissipations[0].back(), 0.0);
+        EXPECT_EQ(plasticStrains[0].front()[0][0], 0.0);
+        EXPECT_NE(plasticStrains[0].back()[0][0], 0.0);
+
+        for (unsigned int kernel = 1; kernel < 3; kernel++)
+        {
+            for (std::size_t step = 0; step < loadPath.size(); step++)
+            {
+                for (std::size_t i = 0; i < forces[0][step].size(); i++)
+                    for (unsigned int k = 0; k < 6; k++)
+                        EXPECT_NEAR(forces[kernel][step][i][k], forces[0][step][i][k], 1e-9*(1 + std::abs(forces[0][step][i][k])))
+                            << kernels[kernel] << ", step " << step << ", node " << i << ", coordinate " << k;
+                EXPECT_NEAR(elasticEnergies[kernel][step], elasticEnergies[0][step], 1e-9*elasticEnergies[0][step]);
+                EXPECT_NEAR(plasticDissipations[kernel][step], plasticDissipations[0][step], 1e-9*(1e-12 + plasticDissipations[0][step]));
+            }
+
+            ASSERT_EQ(stresses[kernel].size(), stresses[0].size());
+            for (std::size_t gp = 0; gp < stresses[0].size(); gp++)
+            {
+                for (unsigned int r = 0; r < 6; r++)
+                {
+                    EXPECT_NEAR(stresses[kernel][gp][r][0], stresses[0][gp][r][0], 1e-6*(1 + std::abs(stresses[0][gp][r][0])));
+                    EXPECT_NEAR(plasticStrains[kernel][gp][r][0], plasticStrains[0][gp][r][0], 1e-12);
+                }
+            }
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_float_init()
+    {
+        importBeamPlugins();
+
+        const BeamScene doubleScene = loadBeamScene("");
+        ASSERT_TRUE(doubleScene.isLoaded());
+        SceneInstance floatScene = SceneInstance("xml", makeBeamScene("", TwoBeamNodes, TwoBeamLines, "Rigid3f"));
+        ASSERT_NE(floatScene.root.get(), nullptr);
+        floatScene.initScene();
+
+        auto* floatForceField = dynamic_cast<beamplastic::forcefield::BeamPlasticFEMForceField<Rigid3fTypes>*>(floatScene.root->getObject("FEM"));
+        auto* floatDofs = dynamic_cast<MechanicalObject<Rigid3fTypes>*>(floatScene.root->getObject("DOFs"));
+        ASSERT_NE(floatForceField, nullptr);
+        ASSERT_NE(floatDofs, nullptr);
+
+        // Elastic, then plastic stretch. The displacements are computed from the
+        // difference of nearby float positions, which loses about three digits:
+        // the forces are compared relatively to the largest one.
+        for (const double factor : { 1.001, 1.003 })
+        {
+            const Rigid3dTypes::VecDeriv doubleForce = computeStretchForce(doubleScene.forceField, doubleScene.dofs, factor);
+            const Rigid3fTypes::VecDeriv floatForce = computeStretchForce(floatForceField, floatDofs, factor);
+            ASSERT_EQ(floatForce.size(), doubleForce.size());
+
+            double maxForce = 0;
+            for (std::size_t i = 0; i < doubleForce.size(); i++)
+                for (unsigned int k = 0; k < 6; k++)
+                    maxForce = std::max(maxForce, std::abs(doubleForce[i][k]));
+            EXPECT_GT(maxForce, 0.0);
+
+            for (std::size_t i = 0; i < doubleForce.size(); i++)
+                for (unsigned int k = 0; k < 6; k++)
+                    EXPECT_NEAR(floatForce[i][k], doubleForce[i][k], 1e-3*maxForce)
+                        << "stretch " << factor << ", node " << i << ", coordinate " << k;
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_plasticMultiplier()
+    {
+        typedef TestForceField::LocalNewtonStatistics LocalNewtonStatistics;
+
+        const double youngModulus = 2.03e11;
+        const double yieldStress = 4.80e8;
+        const double mu = youngModulus / (2 * (1 + 0.3));
+        const double sqrt6Mu = std::sqrt(6.0)*mu;
+        const double sqrt2Over3 = std::sqrt(2.0 / 3.0);
+
+        // Trial stress 50% beyond the yield surface
+        const double xiTrialNorm = 1.5*sqrt2Over3*yieldStress;
+        const double trialResidual = xiTrialNorm - sqrt2Over3*yieldStress;
+
+        TestForceField::SPtr forceField = sofa::core::objectmodel::New<TestForceField>();
+        const double tolerance = 1e-10*sqrt2Over3*yieldStress; // default localNewtonTolerance
+
+        // Consistency condition of the radial return, for a given hardening curve
+        auto residual = [&](TestForceField::ConstitutiveLawType& law, double effPlasticStrain, double plasticMultiplier)
+        {
+            return trialResidual - sqrt6Mu*plasticMultiplier
+                 - sqrt2Over3*(law.getStressFromStrain(effPlasticStrain + plasticMultiplier) - law.getStressFromStrain(effPlasticStrain));
+        };
+
+        // Linear hardening (no constitutive law): closed-form solution, in a single iteration
+        {
+            LocalNewtonStatistics statistics;
+            double hardeningIncrement = 0;
+            const double H = TestForceField::computeConstPlasticModulus();
+            const double plasticMultiplier = forceField->computePlasticMultiplier(nullptr, xiTrialNorm, yieldStress, 0.0, mu, 0.0,
+                                                                                  hardeningIncrement, statistics);
+            const double expected = trialResidual / (sqrt6Mu + sqrt2Over3*H);
+            EXPECT_NEAR(plasticMultiplier, expected, 1e-12*expected);
+            EXPECT_NEAR(hardeningIncrement, H*expected, 1e-12*H*expected);
+            EXPECT_EQ(statistics.nbSolves, 1u);
+            EXPECT_EQ(statistics.maxIterationCount, 1u);
+            EXPECT_EQ(statistics.nbFailures, 0u);
+        }
+
+        // Nonlinear hardening curves, from the virgin and from an already hardened state
+        beamplastic::constitutivelaw::RambergOsgood<Rigid3dTypes> rambergOsgood(youngModulus, yieldStress);
+        beamplastic::constitutivelaw::TabulatedConstitutiveLaw<Rigid3dTypes> tabulated(
+            { {0.0, 4.80e8}, {0.01, 5.20e8}, {0.05, 5.50e8} }, 1024);
+        for (TestForceField::ConstitutiveLawType* law : { static_cast<TestForceField::ConstitutiveLawType*>(&rambergOsgood),
+                                                          static_cast<TestForceField::ConstitutiveLawType*>(&tabulated) })
+        {
+            for (const double effPlasticStrain : { 0.0, 0.01 })
+            {
+                LocalNewtonStatistics statistics;
+                double hardeningIncrement = 0;
+                const double plasticMultiplier = forceField->computePlasticMultiplier(law, xiTrialNorm, yieldStress, effPlasticStrain,
+                                                                                      mu, 0.0, hardeningIncrement, statistics);
+                EXPECT_EQ(statistics.nbFailures, 0u);
+                EXPECT_LE(statistics.maxIterationCount, forceField->d_maxLocalNewtonIterations.getValue());
+                EXPECT_GT(plasticMultiplier, 0.0);
+                EXPECT_LT(plasticMultiplier, trialResidual / sqrt6Mu);
+                EXPECT_LE(std::abs(residual(*law, effPlasticStrain, plasticMultiplier)), tolerance);
+                EXPECT_DOUBLE_EQ(hardeningIncrement, law->getStressFromStrain(effPlasticStrain + plasticMultiplier)
+                                                     - law->getStressFromStrain(effPlasticStrain));
+            }
+        }
+
+        // Steep linear hardening with an underestimated plastic modulus: the Newton
+        // steps leave the bracket of the root, and the bisection has to take over
+        {
+            const double H = 1e13;
+            MisleadingLinearLaw law(yieldStress, H);
+            forceField->d_maxLocalNewtonIterations.setValue(100);
+
+            LocalNewtonStatistics statistics;
+            double hardeningIncrement = 0;
+            const double plasticMultiplier = forceField->computePlasticMultiplier(&law, xiTrialNorm, yieldStress, 0.0, mu, 0.0,
+                                                                                  hardeningIncrement, statistics);
+            const double expected = trialResidual / (sqrt6Mu + sqrt2Over3*H);
+            EXPECT_EQ(statistics.nbFailures, 0u);
+            EXPECT_GT(statistics.maxIterationCount, 1u);
+            EXPECT_NEAR(plasticMultiplier, expected, 1e-9*expected);
+        }
+
+        // Iteration cap: the failure is counted, and the last iterate returned
+        {
+            forceField->d_maxLocalNewtonIterations.setValue(1);
+
+            LocalNewtonStatistics statistics;
+            double hardeningIncrement = 0;
+            const double plasticMultiplier = forceField->computePlasticMultiplier(&rambergOsgood, xiTrialNorm, yieldStress, 0.0,
+                                                                                  mu, 0.0, hardeningIncrement, statistics);
+            EXPECT_EQ(statistics.nbFailures, 1u);
+            EXPECT_EQ(statistics.maxIterationCount, 1u);
+            EXPECT_GT(plasticMultiplier, 0.0);
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_plasticModulus()
+    {
+        typedef beamplastic::constitutivelaw::PlasticConstitutiveLaw<Rigid3dTypes> ConstitutiveLaw;
+
+        // Both laws return the plastic modulus H' = d(stress) / d(plastic strain),
+        // whether it is looked up from the plastic strain or from the stress
+        beamplastic::constitutivelaw::RambergOsgood<Rigid3dTypes> rambergOsgood(2.03e11, 4.80e8);
+        beamplastic::constitutivelaw::TabulatedConstitutiveLaw<Rigid3dTypes> tabulated(
+            { {0.0, 4.80e8}, {0.01, 5.20e8}, {0.05, 5.50e8} }, 1024);
+        for (ConstitutiveLaw* law : { static_cast<ConstitutiveLaw*>(&rambergOsgood), static_cast<ConstitutiveLaw*>(&tabulated) })
+        {
+            for (const double effPlasticStrain : { 0.005, 0.03 })
+            {
+                const double plasticModulus = law->getPlasticModulusFromStrain(effPlasticStrain);
+                const double stress = law->getStressFromStrain(effPlasticStrain);
+                EXPECT_GT(plasticModulus, 0.0);
+                EXPECT_NEAR(law->getTangentModulusFromStrain(effPlasticStrain), plasticModulus, 1e-9*plasticModulus);
+                EXPECT_NEAR(law->getTangentModulusFromStress(stress), plasticModulus, 1e-9*plasticModulus);
+            }
+        }
+
+        // Slope of the first segment of the tabulated curve
+        EXPECT_NEAR(tabulated.getTangentModulusFromStrain(0.005), 4e9, 1e-9*4e9);
+    }
+
+    void check_BeamPlasticfEMForceField_tabulatedLaw()
+    {
+        typedef beamplastic::constitutivelaw::TabulatedConstitutiveLaw<Rigid3dTypes> TabulatedLaw;
+
+        // Samples on the resampling grid (steps of 0.01 in plastic strain), so
+        // that the resampled curve is exactly the sampled one
+        TabulatedLaw tabulated({ {0.0, 4.80e8}, {0.01, 5.20e8}, {0.05, 5.50e8} }, 5);
+
+        // Lookup and interpolation
+        EXPECT_NEAR(tabulated.getStressFromStrain(0.0), 4.80e8, 1e-9*4.80e8);
+        EXPECT_NEAR(tabulated.getStressFromStrain(0.005), 5.00e8, 1e-9*5.00e8);
+        EXPECT_NEAR(tabulated.getStressFromStrain(0.01), 5.20e8, 1e-9*5.20e8);
+        EXPECT_NEAR(tabulated.getStressFromStrain(0.03), 5.35e8, 1e-9*5.35e8);
+        EXPECT_NEAR(tabulated.getTangentModulusFromStrain(0.005), 4e9, 1e-9*4e9);
+        EXPECT_NEAR(tabulated.getTangentModulusFromStrain(0.03), 7.5e8, 1e-9*7.5e8);
+        EXPECT_NEAR(tabulated.getTangentModulusFromStress(5.00e8), 4e9, 1e-9*4e9);
+        EXPECT_NEAR(tabulated.getTangentModulusFromStress(5.40e8), 7.5e8, 1e-9*7.5e8);
+
+        // Extrapolation with the slope of the last segment past the last sample,
+        // and of the first segment before the first one
+        EXPECT_NEAR(tabulated.getStressFromStrain(0.07), 5.65e8, 1e-9*5.65e8);
+        EXPECT_NEAR(tabulated.getTangentModulusFromStrain(0.07), 7.5e8, 1e-9*7.5e8);
+        EXPECT_NEAR(tabulated.getTangentModulusFromStress(6.00e8), 7.5e8, 1e-9*7.5e8);
+        EXPECT_NEAR(tabulated.getTangentModulusFromStrain(-0.01), 4e9, 1e-9*4e9);
+        EXPECT_NEAR(tabulated.getTangentModulusFromStress(4.00e8), 4e9, 1e-9*4e9);
+        EXPECT_NEAR(tabulated.getTangentModulusFromStress(std::numeric_limits<double>::quiet_NaN()), 4e9, 1e-9*4e9);
+
+        // Invalid curves
+        std::string errorMessage;
+        EXPECT_FALSE(TabulatedLaw::checkSamples({ {0.0, 4.80e8} }, errorMessage));
+        EXPECT_FALSE(TabulatedLaw::checkSamples({ {0.0, 4.80e8}, {0.02, 5.00e8}, {0.01, 5.20e8} }, errorMessage));
+        EXPECT_NE(errorMessage.find("strictly increasing"), std::string::npos);
+        EXPECT_FALSE(TabulatedLaw::checkSamples({ {0.0, 4.80e8}, {0.01, 5.00e8}, {0.01, 5.20e8} }, errorMessage));
+        EXPECT_NE(errorMessage.find("strictly increasing"), std::string::npos);
+        EXPECT_FALSE(TabulatedLaw::checkSamples({ {0.0, 4.80e8}, {0.01, 5.20e8}, {0.05, 5.00e8} }, errorMessage));
+        EXPECT_NE(errorMessage.find("non-decreasing"), std::string::npos);
+
+        // Non uniformly spaced samples are valid, and resampled on the uniform grids
+        // (steps of 0.001 in plastic strain)
+        const TabulatedLaw::VecSample nonUniform = { {0.0, 4.80e8}, {0.001, 4.90e8}, {0.05, 5.50e8} };
+        EXPECT_TRUE(TabulatedLaw::checkSamples(nonUniform, errorMessage));
+        TabulatedLaw resampled(nonUniform, 50);
+        EXPECT_NEAR(resampled.getStressFromStrain(0.0005), 4.85e8, 1e-9*4.85e8);
+        EXPECT_NEAR(resampled.getStressFromStrain(0.001), 4.90e8, 1e-9*4.90e8);
+        EXPECT_NEAR(resampled.getStressFromStrain(0.0255), 5.20e8, 1e-9*5.20e8);
+        EXPECT_NEAR(resampled.getTangentModulusFromStrain(0.0005), 1e11, 1e-9*1e11);
+        EXPECT_NEAR(resampled.getTangentModulusFromStress(4.85e8), 1e11, 1e-9*1e11);
+        EXPECT_NEAR(resampled.getTangentModulusFromStress(5.20e8), 6e7/0.049, 1e-9*6e7/0.049);
+
+        // Perfect plasticity: a flat curve is valid, of zero slope
+        const TabulatedLaw::VecSample flat = { {0.0, 4.80e8}, {0.05, 4.80e8} };
+        EXPECT_TRUE(TabulatedLaw::checkSamples(flat, errorMessage));
+        TabulatedLaw perfectlyPlastic(flat, 16);
+        EXPECT_EQ(perfectlyPlastic.getTangentModulusFromStress(4.80e8), 0.0);
+        EXPECT_EQ(perfectlyPlastic.getTangentModulusFromStrain(0.01), 0.0);
+        EXPECT_NEAR(perfectlyPlastic.getStressFromStrain(0.1), 4.80e8, 1e-9*4.80e8);
+    }
+
+    void check_BeamPlasticfEMForceField_hardeningCurveFile()
+    {
+        importBeamPlugins();
+
+        typedef beamplastic::constitutivelaw::TabulatedConstitutiveLaw<Rigid3dTypes> TabulatedLaw;
+
+        const string filename = (std::filesystem::temp_directory_path() / "BeamPlasticFEMForceField_test_hardening.csv").string();
+        {
+            std::ofstream file(filename);
+            file << "# effective plastic strain, effective stress\n"
+                 << "0, 4.80e8\n"
+                 << "\n"
+                 << "0.01 5.20e8\n"
+                 << "   # measured\n"
+                 << "0.05,5.50e8\n";
+        }
+
+        // Comments, blank lines, space and comma separated values
+        {
+            SceneInstance testScene = SceneInstance("xml", makeMeshScene());
+            ASSERT_NE(testScene.root.get(), nullptr);
+            TestForceField::SPtr forceField = addTestForceField(testScene.root.get(), {
+                {"modelName", "Tabulated"}, {"hardeningCurveFile", filename} });
+            testScene.initScene();
+            EXPECT_NE(forceField->getComponentState(), sofa::core::objectmodel::ComponentState::Invalid);
+
+            ASSERT_EQ(forceField->m_materials.size(), 1u);
+            const auto* law = dynamic_cast<const TabulatedLaw*>(forceField->m_materials[0]._constitutiveLaw.get());
+            ASSERT_NE(law, nullptr);
+            const TabulatedLaw::VecSample& samples = law->getSamples();
+            ASSERT_EQ(samples.size(), 3u);
+            EXPECT_EQ(samples[0], TabulatedLaw::Sample(0.0, 4.80e8));
+            EXPECT_EQ(samples[1], TabulatedLaw::Sample(0.01, 5.20e8));
+            EXPECT_EQ(samples[2], TabulatedLaw::Sample(0.05, 5.50e8));
+        }
+
+        TestForceField::SPtr forceField = sofa::core::objectmodel::New<TestForceField>();
+        sofa::type::vector<TabulatedLaw::Sample> samples;
+
+        // Line with a single value
+        {
+            std::ofstream file(filename);
+            file << "0 4.80e8\n0.01\n";
+        }
+        {
+            EXPECT_MSG_EMIT(Error);
+            EXPECT_FALSE(forceField->readHardeningCurve(filename, samples));
+        }
+
+        // Missing file
+        std::filesystem::remove(filename);
+        {
+            EXPECT_MSG_EMIT(Error);
+            EXPECT_FALSE(forceField->readHardeningCurve(filename, samples));
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_localNewtonFailures()
+    {
+        importBeamPlugins();
+
+        // Plastic stretch of a cantilever, with the default and a single local Newton iteration
+        for (const unsigned int maxIterations : { 20u, 1u })
+        {
+            const BeamScene scene = loadBeamScene("maxLocalNewtonIterations = '" + std::to_string(maxIterations) + "'");
+            ASSERT_TRUE(scene.isLoaded());
+            const auto* nbLocalNewtonSolves = dynamic_cast<Data<unsigned int>*>(scene.forceField->findData("nbLocalNewtonSolves"));
+            const auto* nbLocalNewtonFailures = dynamic_cast<Data<unsigned int>*>(scene.forceField->findData("nbLocalNewtonFailures"));
+            ASSERT_NE(nbLocalNewtonSolves, nullptr);
+            ASSERT_NE(nbLocalNewtonFailures, nullptr);
+
+            if (maxIterations == 1)
+            {
+                EXPECT_MSG_EMIT(Warning);
+                computeStretchForce(scene.forceField, scene.dofs, 1 + 4e-3);
+            }
+            else
+                computeStretchForce(scene.forceField, scene.dofs, 1 + 4e-3);
+
+            EXPECT_GT(nbLocalNewtonSolves->getValue(), 0u);
+            if (maxIterations == 1)
+                EXPECT_GT(nbLocalNewtonFailures->getValue(), 0u);
+            else
+                EXPECT_EQ(nbLocalNewtonFailures->getValue(), 0u);
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_checkpoint()
+    {
+        importBeamPlugins();
+
+        const BeamScene scene = loadBeamScene("");
+        ASSERT_TRUE(scene.isLoaded());
+        ForceField* forceField = scene.forceField;
+
+        // Plastic stretch and bending of the cantilever
+        auto computeForce = [&](unsigned int step)
+        {
+            return computeStretchForce(forceField, scene.dofs, 1 + 1e-3*step, 1e-5*step);
+        };
+
+        // Copy of the Gauss point state of all the elements
+        typedef std::vector<ForceField::StorageVoigtTensor2> GaussPointState;
+        auto getGaussPointState = [&]()
+        {
+            GaussPointState state;
+            for (const auto& view : { forceField->getGaussPointStresses(), forceField->getGaussPointPlasticStrains(),
+                                      forceField->getGaussPointBackStresses() })
+                for (std::size_t i = 0; i < view.size(); i++)
+                    for (unsigned int gp = 0; gp < 27; gp++)
+                        state.push_back(view[i][gp]);
+            return state;
+        };
+
+        for (unsigned int step = 1; step <= 5; step++)
+            computeForce(step);
+        const GaussPointState savedState = getGaussPointState();
+        EXPECT_NE(forceField->getGaussPointPlasticStrains()[1][0][0][0], 0.0);
+
+        const string filename = (std::filesystem::temp_directory_path() / "BeamPlasticFEMForceField_test.ckpt").string();
+        ASSERT_TRUE(forceField->saveCheckpoint(filename));
+        const Rigid3dTypes::VecDeriv nextForce = computeForce(6);
+
+        // Back to the undeformed state, then to the saved one
+        static_cast<sofa::core::objectmodel::BaseObject*>(forceField)->reset();
+        EXPECT_EQ(forceField->getGaussPointPlasticStrains()[1][0][0][0], 0.0);
+        ASSERT_TRUE(forceField->loadCheckpoint(filename));
+        EXPECT_EQ(getGaussPointState(), savedState);
+
+        // Checkpoints of a different topology or precision are rejected, the state being unchanged
+        const string otherFilename = (std::filesystem::temp_directory_path() / "BeamPlasticFEMForceField_test_other.ckpt").string();
+        const string otherScenes[2] = { makeBeamScene("", string(TwoBeamNodes) + "  1.5e-3 0 0 0 0 0 1", "0 1 1 2 2 3"),
+                                        makeBeamScene("", TwoBeamNodes, TwoBeamLines, "Rigid3f") };
+        for (const string& otherScene : otherScenes)
+        {
+            SceneInstance other = SceneInstance("xml", otherScene);
+            ASSERT_NE(other.root.get(), nullptr);
+            other.initScene();
+            sofa::core::objectmodel::BaseObject* otherForceField = other.root->getObject("FEM");
+            ASSERT_NE(otherForceField, nullptr);
+            if (auto* doubleForceField = dynamic_cast<ForceField*>(otherForceField))
+                ASSERT_TRUE(doubleForceField->saveCheckpoint(otherFilename));
+            else if (auto* floatForceField = dynamic_cast<beamplastic::forcefield::BeamPlasticFEMForceField<sofa::defaulttype::Rigid3fTypes>*>(otherForceField))
+                ASSERT_TRUE(floatForceField->saveCheckpoint(otherFilename));
+            else
+                FAIL();
+
+            {
+                EXPECT_MSG_EMIT(Error);
+                EXPECT_FALSE(forceField->loadCheckpoint(otherFilename));
+            }
+            EXPECT_EQ(getGaussPointState(), savedState);
+        }
+        std::filesystem::remove(otherFilename);
+
+        // Truncated file
+        std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 1);
+        {
+            EXPECT_MSG_EMIT(Error);
+            EXPECT_FALSE(forceField->loadCheckpoint(filename));
+        }
+        EXPECT_EQ(getGaussPointState(), savedState);
+        std::filesystem::remove(filename);
+
+        // The restored state gives the same next force as the original one
+        const Rigid3dTypes::VecDeriv restoredForce = computeForce(6);
+        ASSERT_EQ(restoredForce.size(), nextForce.size());
+        for (std::size_t i = 0; i < nextForce.size(); i++)
+            for (unsigned int k = 0; k < 6; k++)
+                EXPECT_EQ(restoredForce[i][k], nextForce[i][k]) << "node " << i << ", coordinate " << k;
+    }
+
+    void check_BeamPlasticfEMForceField_elementCache()
+    {
+        importBeamPlugins();
+
+        typedef sofa::type::vector<TestForceField::BeamInfo> VecBeamInfo;
+
+        // Elements of different lengths
+        const string scene = makeMeshScene("0 0 0 0 0 0 1  5e-4 0 0 0 0 0 1  1.2e-3 0 0 0 0 0 1");
+
+        const string filename = (std::filesystem::temp_directory_path() / "BeamPlasticFEMForceField_test.bpcache").string();
+        std::filesystem::remove(filename);
+
+        // Element data after init, with or without the element cache
+        auto initBeams = [&](const string& youngModulus, const string& cacheFile)
+        {
+            SceneInstance testScene = SceneInstance("xml", scene);
+            std::vector<std::pair<string, string>> values = { {"youngModulus", youngModulus} };
+            if (!cacheFile.empty())
+                values.push_back({"elementCacheFile", cacheFile});
+            TestForceField::SPtr forceField = addTestForceField(testScene.root.get(), values);
+            testScene.initScene();
+            return VecBeamInfo(forceField->m_beamsData.getValue());
+        };
+
+        auto sameMatrices = [](const VecBeamInfo& a, const VecBeamInfo& b)
+        {
+            if (a.size() != b.size())
+                return false;
+            for (std::size_t i = 0; i < a.size(); i++)
+            {
+                if (std::memcmp(&a[i]._BeMatrices, &b[i]._BeMatrices, sizeof(a[i]._BeMatrices)) != 0
+                    || std::memcmp(&a[i]._Ke_loc, &b[i]._Ke_loc, sizeof(a[i]._Ke_loc)) != 0
+                    || std::memcmp(&a[i]._k_loc, &b[i]._k_loc, sizeof(a[i]._k_loc)) != 0)
+                    return false;
+            }
+            return true;
+        };
+
+        auto readFile = [&]()
+        {
+            std::ifstream file(filename, std::ios::binary);
+            return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        };
+
+        // Missing cache: the matrices are computed and written
+        const VecBeamInfo computed = initBeams("2.03e11", "");
+        ASSERT_EQ(computed.size(), 2u);
+        EXPECT_TRUE(sameMatrices(initBeams("2.03e11", filename), computed));
+        ASSERT_TRUE(std::filesystem::exists(filename));
+        const std::vector<char> contents = readFile();
+
+        // Valid cache: the matrices are reloaded bit for bit, and the file is not rewritten
+        EXPECT_TRUE(sameMatrices(initBeams("2.03e11", filename), computed));
+        EXPECT_EQ(readFile(), contents);
+
+        // The matrices are actually read from the file: the last entry of the
+        // last stiffness matrix is altered
+        {
+            std::vector<char> altered = contents;
+            const double value = 123.0;
+            std::memcpy(altered.data() + altered.size() - sizeof(double), &value, sizeof(double));
+            std::ofstream(filename, std::ios::binary).write(altered.data(), altered.size());
+            EXPECT_EQ(initBeams("2.03e11", filename).back()._k_loc[11][11], value);
+            std::ofstream(filename, std::ios::binary).write(contents.data(), contents.size());
+        }
+
+        // Changed material: the key does not match, the matrices are recomputed and rewritten
+        const VecBeamInfo softComputed = initBeams("1.0e11", "");
+        EXPECT_FALSE(sameMatrices(softComputed, computed));
+        EXPECT_TRUE(sameMatrices(initBeams("1.0e11", filename), softComputed));
+        const std::vector<char> softContents = readFile();
+        EXPECT_EQ(softContents.size(), contents.size());
+        EXPECT_NE(softContents, contents);
+        EXPECT_TRUE(sameMatrices(initBeams("1.0e11", filename), softComputed));
+        EXPECT_EQ(readFile(), softContents);
+
+        // Truncated cache: rejected, the matrices are recomputed and the file rewritten
+        std::filesystem::resize_file(filename, softContents.size() - 1);
+        {
+            EXPECT_MSG_EMIT(Warning);
+            EXPECT_TRUE(sameMatrices(initBeams("1.0e11", filename), softComputed));
+        }
+        EXPECT_EQ(readFile(), softContents);
+
+        std::filesystem::remove(filename);
+    }
+
+    void check_BeamPlasticfEMForceField_topologicalChanges()
+    {
+        importBeamPlugins("Sofa.Component.Topology.Container.Dynamic");
+
+        typedef sofa::component::topology::container::dynamic::EdgeSetTopologyModifier EdgeSetTopologyModifier;
+        typedef sofa::core::topology::BaseMeshTopology::Edge Edge;
+
+        SceneInstance testScene = SceneInstance("xml", makeEdgeSetScene(
+            "0 0 0 0 0 0 1  5e-4 0 0 0 0 0 1  1e-3 0 0 0 0 0 1  1.5e-3 0 0 0 0 0 1  2e-3 0 0 0 0 0 1", "0 1 1 2 2 3 3 4"));
+        Node::SPtr root = testScene.root;
+        ASSERT_NE(root.get(), nullptr);
+        TestForceField::SPtr forceField = addTestForceField(root.get(), {{"parallelStrategy", "coloring"}});
+        testScene.initScene();
+
+        auto* dofs = dynamic_cast<MechanicalObject<Rigid3dTypes>*>(root->getObject("DOFs"));
+        auto* modifier = dynamic_cast<EdgeSetTopologyModifier*>(root->getObject("modifier"));
+        ASSERT_NE(dofs, nullptr);
+        ASSERT_NE(modifier, nullptr);
+
+        // Plastic stretch, increasing along the line so that each element has its own history
+        const std::size_t nbNodes = dofs->getSize();
+        auto computeForce = [&](unsigned int step)
+        {
+            return computeDeformationForce(forceField.get(), dofs, [&](Rigid3dTypes::VecCoord& positions)
+            {
+                for (std::size_t i = 1; i < positions.size(); i++)
+                    positions[i].getCenter()[0] = positions[i-1].getCenter()[0] + 5e-4*(1 + 1e-3*step*(1 + 0.5*i));
+            });
+        };
+        for (unsigned int step = 1; step <= 3; step++)
+            computeForce(step);
+
+        // Gauss point plastic strains and stresses of each element, identified by its nodes
+        typedef std::vector<ForceField::StorageVoigtTensor2> GaussPointState;
+        auto getGaussPointState = [&](std::size_t i)
+        {
+            GaussPointState state;
+            for (unsigned int gp = 0; gp < 27; gp++)
+            {
+                state.push_back(forceField->getGaussPointPlasticStrains()[i][gp]);
+                state.push_back(forceField->getGaussPointStresses()[i][gp]);
+            }
+            return state;
+        };
+        std::map<std::pair<unsigned int, unsigned int>, GaussPointState> states;
+        for (std::size_t i = 0; i < forceField->getElements().size(); i++)
+        {
+            const Edge& edge = forceField->getElements()[i];
+            states[{edge[0], edge[1]}] = getGaussPointState(i);
+        }
+        ASSERT_EQ(states.size(), 4u);
+        EXPECT_NE(states[{1, 2}][0][0][0], 0.0);
+
+        // Removal of the second element: the last one is moved in its place
+        modifier->removeEdges(sofa::type::vector<sofa::Index>{ 1 }, false);
+        ASSERT_EQ(forceField->getElements().size(), 3u);
+        for (std::size_t i = 0; i < forceField->getElements().size(); i++)
+        {
+            const Edge& edge = forceField->getElements()[i];
+            EXPECT_EQ(getGaussPointState(i), (states[{edge[0], edge[1]}])) << "element " << edge[0] << " " << edge[1];
+        }
+
+        // The forces are computed on the new topology: the first element is now alone at node 1
+        Rigid3dTypes::VecDeriv force = computeForce(3);
+        ASSERT_EQ(force.size(), nbNodes);
+        EXPECT_NE(force[1].getLinear()[0], 0.0);
+        EXPECT_NEAR(force[0].getLinear()[0], -force[1].getLinear()[0], 1e-9*std::abs(force[1].getLinear()[0]));
+
+        // Addition of a new element: the existing ones are unchanged, the new one is undeformed
+        modifier->addEdges(sofa::type::vector<Edge>{ Edge(1, 2) });
+        ASSERT_EQ(forceField->getElements().size(), 4u);
+        for (std::size_t i = 0; i < 3; i++)
+        {
+            const Edge& edge = forceField->getElements()[i];
+            EXPECT_EQ(getGaussPointState(i), (states[{edge[0], edge[1]}])) << "element " << edge[0] << " " << edge[1];
+        }
+        EXPECT_EQ(forceField->getElements()[3], Edge(1, 2));
+        EXPECT_EQ(getGaussPointState(3), GaussPointState(2*27));
+
+        // The new element is loaded by the next displacement increment
+        force = computeForce(4);
+        ASSERT_EQ(force.size(), nbNodes);
+        EXPECT_NE(getGaussPointState(3), GaussPointState(2*27));
+    }
+
+    void check_BeamPlasticfEMForceField_incrementalTopologicalChanges()
+    {
+        importBeamPlugins("Sofa.Component.Topology.Container.Dynamic");
+
+        typedef sofa::component::topology::container::dynamic::EdgeSetTopologyModifier EdgeSetTopologyModifier;
+        typedef sofa::core::topology::BaseMeshTopology::Edge Edge;
+
+        const unsigned int nbBeams = 40;
+        std::ostringstream positions, lines;
+        for (unsigned int i = 0; i <= nbBeams; i++)
+            positions << i*5e-4 << " 0 0 0 0 0 1 ";
+        for (unsigned int i = 0; i < nbBeams; i++)
+            lines << i << " " << i + 1 << " ";
+
+        const string scene = makeEdgeSetScene(positions.str(), lines.str());
+
+        // Same topological changes with the batched kernel and element by element
+        const string kernels[2] = { "auto", "none" };
+        SceneInstance scenes[2] = { SceneInstance("xml", scene), SceneInstance("xml", scene) };
+        TestForceField::SPtr forceFields[2];
+        MechanicalObject<Rigid3dTypes>* dofs[2];
+        EdgeSetTopologyModifier* modifiers[2];
+        for (unsigned int s = 0; s < 2; s++)
+        {
+            ASSERT_NE(scenes[s].root.get(), nullptr);
+            forceFields[s] = addTestForceField(scenes[s].root.get(), {
+                {"parallelStrategy", "coloring"}, {"batchKernel", kernels[s]} });
+            scenes[s].initScene();
+            dofs[s] = dynamic_cast<MechanicalObject<Rigid3dTypes>*>(scenes[s].root->getObject("DOFs"));
+            modifiers[s] = dynamic_cast<EdgeSetTopologyModifier*>(scenes[s].root->getObject("modifier"));
+            ASSERT_NE(dofs[s], nullptr);
+            ASSERT_NE(modifiers[s], nullptr);
+        }
+        ASSERT_FALSE(forceFields[0]->m_batchElements.empty());
+
+        // Each element is traversed once, the colors do not share any node, and
+        // each element is in one batch lane
+        auto checkElementStructures = [&](const TestForceField& forceField, bool hasBatches)
+        {
+            const auto& elements = forceField.getElements();
+            const std::size_t nbElements = elements.size();
+            ASSERT_EQ(forceField.m_elementOrder.size(), nbElements);
+            std::vector<unsigned int> order(forceField.m_elementOrder.begin(), forceField.m_elementOrder.end());
+            std::sort(order.begin(), order.end());
+            for (std::size_t k = 0; k < nbElements; k++)
+            {
+                EXPECT_EQ(order[k], k);
+                EXPECT_EQ(forceField.m_orderedElements[k], elements[forceField.m_elementOrder[k]]) << "position " << k;
+            }
+
+            std::vector<unsigned int> colored(forceField.m_coloredElements.begin(), forceField.m_coloredElements.end());
+            std::sort(colored.begin(), colored.end());
+            ASSERT_EQ(colored.size(), nbElements);
+            for (std::size_t k = 0; k < nbElements; k++)
+                EXPECT_EQ(colored[k], k);
+            for (std::size_t color = 0; color + 1 < forceField.m_colorOffsets.size(); color++)
+            {
+                std::vector<sofa::Index> nodes;
+                for (unsigned int j = forceField.m_colorOffsets[color]; j < forceField.m_colorOffsets[color + 1]; j++)
+                {
+                    nodes.push_back(forceField.m_orderedElements[forceField.m_coloredElements[j]][0]);
+                    nodes.push_back(forceField.m_orderedElements[forceField.m_coloredElements[j]][1]);
+                }
+                std::sort(nodes.begin(), nodes.end());
+                EXPECT_EQ(std::adjacent_find(nodes.begin(), nodes.end()), nodes.end()) << "color " << color;
+            }
+
+            if (!hasBatches)
+                return;
+            std::vector<int> batched;
+            for (const int k : forceField.m_batchElements)
+                if (k >= 0)
+                    batched.push_back(k);
+            std::sort(batched.begin(), batched.end());
+            ASSERT_EQ(batched.size(), nbElements);
+            for (std::size_t k = 0; k < nbElements; k++)
+                EXPECT_EQ(batched[k], static_cast<int>(k));
+        };
+
+        // Elastic stretch: the batched forces match the element by element ones
+        auto compareForces = [&](double factor)
+        {
+            const Rigid3dTypes::VecDeriv batchedForce = computeStretchForce(forceFields[0].get(), dofs[0], factor);
+            const Rigid3dTypes::VecDeriv force = computeStretchForce(forceFields[1].get(), dofs[1], factor);
+            ASSERT_EQ(batchedForce.size(), force.size());
+            double maxForce = 0;
+            for (std::size_t n = 0; n < force.size(); n++)
+                maxForce = std::max(maxForce, force[n].getLinear().norm());
+            EXPECT_GT(maxForce, 0.0);
+            for (std::size_t n = 0; n < force.size(); n++)
+                for (unsigned int k = 0; k < 6; k++)
+                    EXPECT_NEAR(batchedForce[n][k], force[n][k], 1e-9*maxForce) << "node " << n << ", coordinate " << k;
+            const auto* nbBatchedElements = dynamic_cast<Data<unsigned int>*>(forceFields[0]->findData("nbBatchedElements"));
+            ASSERT_NE(nbBatchedElements, nullptr);
+            EXPECT_EQ(nbBatchedElements->getValue(), forceFields[0]->getElements().size());
+            checkElementStructures(*forceFields[0], true);
+            checkElementStructures(*forceFields[1], false);
+        };
+        compareForces(1.0002);
+
+        // Removal of one element, the last one being moved in its place: the other
+        // elements keep their traversal position, the moved one is appended
+        for (unsigned int s = 0; s < 2; s++)
+            modifiers[s]->removeEdges(sofa::type::vector<sofa::Index>{ 5 }, false);
+        compareForces(1.0003);
+        for (unsigned int s = 0; s < 2; s++)
+        {
+            const auto& order = forceFields[s]->m_elementOrder;
+            ASSERT_EQ(order.size(), nbBeams - 1);
+            for (unsigned int k = 0; k < 5; k++)
+                EXPECT_EQ(order[k], k);
+            EXPECT_EQ(order.back(), 5u);
+        }
+
+        // Addition of an element, appended as well
+        for (unsigned int s = 0; s < 2; s++)
+            modifiers[s]->addEdges(sofa::type::vector<Edge>{ Edge(5, 6) });
+        compareForces(1.0004);
+        for (unsigned int s = 0; s < 2; s++)
+        {
+            const auto& order = forceFields[s]->m_elementOrder;
+            ASSERT_EQ(order.size(), nbBeams);
+            EXPECT_EQ(order[order.size() - 2], 5u);
+            EXPECT_EQ(order.back(), nbBeams - 1);
+        }
+
+        // Removal of more than a quarter of the elements: full rebuild, in topology order
+        sofa::type::vector<sofa::Index> removed;
+        for (sofa::Index i = 20; i < 35; i++)
+            removed.push_back(i);
+        for (unsigned int s = 0; s < 2; s++)
+            modifiers[s]->removeEdges(removed, false);
+        compareForces(1.0005);
+        for (unsigned int s = 0; s < 2; s++)
+        {
+            const auto& order = forceFields[s]->m_elementOrder;
+            ASSERT_EQ(order.size(), nbBeams - removed.size());
+            for (std::size_t k = 0; k < order.size(); k++)
+                EXPECT_EQ(order[k], k);
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_updateBeams()
+    {
+        importBeamPlugins();
 
-        SceneInstance testScene = SceneInstance("xml", scene);
+        SceneInstance testScene = SceneInstance("xml", makeMeshScene("0 0 0 0 0 0 1  5e-4 0 0 0 0 0 1  1.2e-3 0 0 0 0 0 1"));
+        ASSERT_NE(testScene.root.get(), nullptr);
+        TestForceField::SPtr forceField = addTestForceField(testScene.root.get());
+        testScene.initScene();
+
+        const sofa::type::vector<TestForceField::BeamInfo> initial = forceField->m_beamsData.getValue();
+        ASSERT_EQ(initial.size(), 2u);
+
+        // Yield stress only: no matrix is recomputed
+        forceField->findData("initialYieldStress")->read("5.5e8");
+        ASSERT_TRUE(forceField->initMaterialTables());
+        EXPECT_EQ(forceField->updateBeams(), 0u);
+        {
+            const auto& bd = forceField->m_beamsData.getValue();
+            for (std::size_t i = 0; i < bd.size(); i++)
+            {
+                EXPECT_EQ(std::memcmp(&bd[i]._BeMatrices, &initial[i]._BeMatrices, sizeof(bd[i]._BeMatrices)), 0);
+                EXPECT_EQ(std::memcmp(&bd[i]._k_loc, &initial[i]._k_loc, sizeof(bd[i]._k_loc)), 0);
+                EXPECT_FLOAT_EQ(bd[i]._localYieldStresses[0], 5.5e8);
+            }
+        }
+
+        // Young modulus: the elastic stiffness matrices are recomputed, not the Gauss point matrices
+        const double ratio = 1.0e11 / 2.03e11;
+        forceField->findData("youngModulus")->read("1.0e11");
+        ASSERT_TRUE(forceField->initMaterialTables());
+        EXPECT_EQ(forceField->updateBeams(), 2u);
+        {
+            const auto& bd = forceField->m_beamsData.getValue();
+            for (std::size_t i = 0; i < bd.size(); i++)
+            {
+                EXPECT_EQ(bd[i]._E, 1.0e11);
+                EXPECT_EQ(std::memcmp(&bd[i]._BeMatrices, &initial[i]._BeMatrices, sizeof(bd[i]._BeMatrices)), 0);
+                for (unsigned int r = 0; r < 12; r++)
+                    for (unsigned int c = 0; c < 12; c++)
+                        EXPECT_NEAR(bd[i]._k_loc[r][c], ratio*initial[i]._k_loc[r][c], 1e-12*std::abs(initial[i]._k_loc[r][c]));
+            }
+        }
+
+        // Nothing left to update
+        EXPECT_EQ(forceField->updateBeams(), 0u);
+    }
+
+    void check_BeamPlasticfEMForceField_reinitBatchKernel()
+    {
+        importBeamPlugins();
+
+        SceneInstance testScene = SceneInstance("xml", makeMeshScene("0 0 0 0 0 0 1  5e-4 0 0 0 0 0 1  1.2e-3 0 0 0 0 0 1"));
+        ASSERT_NE(testScene.root.get(), nullptr);
+        TestForceField::SPtr forceField = addTestForceField(testScene.root.get(), {{"batchKernel", "scalar"}});
+        testScene.initScene();
+        ASSERT_FALSE(forceField->m_batchStiffness.empty());
+
+        // Marks the first stiffness operator, to detect whether it is recomputed
+        const double stiffness = forceField->m_batchStiffness[0];
+        forceField->m_batchStiffness[0] = -1;
+
+        // Yield stress only: the yield limits are refreshed, not the other operators
+        forceField->findData("initialYieldStress")->read("5.5e8");
+        forceField->reinit();
+        EXPECT_EQ(forceField->m_batchStiffness[0], -1.0);
+        const double yieldLimit = 5.5e8 * (1 + std::numeric_limits<double>::epsilon());
+        EXPECT_NEAR(forceField->m_batchSquaredYieldLimits[0], yieldLimit*yieldLimit, 1e-12*yieldLimit*yieldLimit);
+
+        // Young modulus: the operators are recomputed
+        forceField->findData("youngModulus")->read("1.0e11");
+        forceField->reinit();
+        EXPECT_NEAR(forceField->m_batchStiffness[0], stiffness * 1.0e11 / 2.03e11, 1e-12*std::abs(stiffness));
+    }
+
+    void check_BeamPlasticfEMForceField_phaseTimes()
+    {
+        importBeamPlugins();
+
+        const string phases[5] = { "corotationTime", "stressUpdateTime", "tangentUpdateTime", "addForceTime", "addDForceTime" };
+        for (unsigned int timePhases = 0; timePhases < 2; timePhases++)
+        {
+            const BeamScene scene = loadBeamScene("timePhases = '" + std::to_string(timePhases) + "'");
+            ASSERT_TRUE(scene.isLoaded());
+            ForceField* forceField = scene.forceField;
+
+            // Plastic stretch, so that the tangent stiffness is updated, and a stiffness product
+            const std::size_t nbNodes = computeStretchForce(forceField, scene.dofs, 1 + 4e-3).size();
+            Data<Rigid3dTypes::VecDeriv> dx, df;
+            dx.setValue(Rigid3dTypes::VecDeriv(nbNodes, Rigid3dTypes::Deriv(type::Vec3d(1e-6, 0, 0), type::Vec3d())));
+            df.setValue(Rigid3dTypes::VecDeriv(nbNodes));
+            forceField->addDForce(sofa::core::MechanicalParams::defaultInstance(), df, dx);
+
+            // The times of the time step are published at its end
+            sofa::simulation::AnimateEndEvent endOfStep(1e-2);
+            forceField->handleEvent(&endOfStep);
+
+            for (const string& phase : phases)
+            {
+                const auto* time = dynamic_cast<Data<double>*>(forceField->findData(phase));
+                ASSERT_NE(time, nullptr) << phase;
+                if (timePhases)
+                    EXPECT_GT(time->getValue(), 0.0) << phase;
+                else
+                    EXPECT_EQ(time->getValue(), 0.0) << phase;
+            }
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_displacementTrace()
+    {
+        importBeamPlugins();
+
+        const string filename = (std::filesystem::temp_directory_path() / "BeamPlasticFEMForceField_test.bptrace").string();
+
+        {
+            // Recorded force computation, the trace being closed with the scene
+            const BeamScene scene = loadBeamScene("displacementTraceFile = '" + filename + "'");
+            ASSERT_TRUE(scene.isLoaded());
+            computeStretchForce(scene.forceField, scene.dofs, 1.0);
+        }
+
+        beamplastic::io::DisplacementTraceReader trace;
+        string errorMessage;
+        ASSERT_TRUE(trace.open<Rigid3dTypes::Coord>(filename, errorMessage)) << errorMessage;
+        EXPECT_EQ(trace.getNbNodes(), 3u);
+        EXPECT_EQ(trace.getNbElements(), 2u);
+
+        const auto& attributes = trace.getAttributes();
+        const auto youngModulus = std::find_if(attributes.begin(), attributes.end(),
+                                               [](const auto& attribute) { return attribute.first == "youngModulus"; });
+        EXPECT_NE(youngModulus, attributes.end());
+
+        Rigid3dTypes::VecCoord positions(trace.getNbNodes());
+        beamplastic::io::DisplacementTraceRecord record;
+        EXPECT_TRUE(trace.readRecord(record, positions.data()));
+        EXPECT_EQ(record.type, beamplastic::io::DISPLACEMENT_TRACE_POSITIONS);
+        EXPECT_EQ(positions[2].getCenter()[0], 1e-3);
+        EXPECT_FALSE(trace.readRecord(record, positions.data()));
+
+        // Corrupted counts in the header are rejected before any allocation
+        const std::size_t countOffsets[3] = { offsetof(beamplastic::io::DisplacementTraceHeader, nbNodes),
+                                              offsetof(beamplastic::io::DisplacementTraceHeader, nbElements),
+                                              offsetof(beamplastic::io::DisplacementTraceHeader, nbAttributes) };
+        const string corruptedFilename = (std::filesystem::temp_directory_path() / "BeamPlasticFEMForceField_test_corrupted.bptrace").string();
+        for (const std::size_t offset : countOffsets)
+        {
+            std::filesystem::copy_file(filename, corruptedFilename, std::filesystem::copy_options::overwrite_existing);
+            {
+                std::fstream file(corruptedFilename, std::ios::in | std::ios::out | std::ios::binary);
+                const std::uint64_t count = std::numeric_limits<std::uint64_t>::max() / 2;
+                file.seekp(offset);
+                file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            }
+
+            beamplastic::io::DisplacementTraceReader corruptedTrace;
+            EXPECT_FALSE(corruptedTrace.open<Rigid3dTypes::Coord>(corruptedFilename, errorMessage)) << "offset " << offset;
+            EXPECT_NE(errorMessage.find("invalid number"), string::npos) << errorMessage;
+        }
+        std::filesystem::remove(corruptedFilename);
+
+        std::filesystem::remove(filename);
+    }
+
+    void check_BeamPlasticfEMForceField_gaussPointHistory()
+    {
+        importBeamPlugins();
+
+        const string prefix = (std::filesystem::temp_directory_path() / "BeamPlasticFEMForceField_test_history").string();
+
+        {
+            const BeamScene scene = loadBeamScene("historyFile = '" + prefix + "' historyElements = '1' historyChunkSize = '2'");
+            ASSERT_TRUE(scene.isLoaded());
+
+            // Three time steps, the files being completed when the scene is destroyed
+            sofa::simulation::AnimateEndEvent endOfStep(1e-2);
+            for (int step = 0; step < 3; step++)
+                scene.forceField->handleEvent(&endOfStep);
+        }
+
+        typedef ForceField::StorageReal StorageReal;
+        beamplastic::io::GaussPointHistoryReader<StorageReal> history;
+        string errorMessage;
+        ASSERT_TRUE(history.open(prefix, errorMessage)) << errorMessage;
+        EXPECT_EQ(history.getNbSnapshots(), 3u);
+        EXPECT_EQ(history.getChunks().size(), 2u);
+        ASSERT_EQ(history.getNbElements(), 1u);
+
+        std::vector<StorageReal> values(history.getNbElements() * history.getNbValuesPerElement());
+        beamplastic::io::GaussPointHistorySnapshot snapshot;
+        EXPECT_TRUE(history.readSnapshot(2, snapshot, values.data()));
+        EXPECT_EQ(snapshot.step, 2u);
+        EXPECT_EQ(history.getElements()[0], 1u);
+        EXPECT_FALSE(history.readSnapshot(3, snapshot, values.data()));
+
+        for (std::size_t chunk = 0; chunk < 2; chunk++)
+            std::filesystem::remove(beamplastic::io::getGaussPointHistoryChunkName(prefix, chunk));
+        std::filesystem::remove(beamplastic::io::getGaussPointHistoryIndexName(prefix));
+    }
+
+    void check_BeamPlasticfEMForceField_energy()
+    {
+        importBeamPlugins();
+
+        const BeamScene scene = loadBeamScene("");
+        ASSERT_TRUE(scene.isLoaded());
+        ForceField* forceField = scene.forceField;
+
+        // Small elastic stretch of the second element
+        const Rigid3dTypes::VecDeriv force = computeDeformationForce(forceField, scene.dofs, [](Rigid3dTypes::VecCoord& x)
+        {
+            x[2].getCenter()[0] += 1e-8;
+        });
+
+        // Linear elasticity: the strain energy is the work of the internal forces
+        const double work = -0.5 * force[2].getLinear()[0] * 1e-8;
+        const double elasticEnergy = forceField->getPotentialEnergy(sofa::core::MechanicalParams::defaultInstance(),
+                                                                    *scene.dofs->read(sofa::core::vec_id::read_access::position));
+        EXPECT_GT(elasticEnergy, 0.0);
+        EXPECT_NEAR(elasticEnergy, work, 1e-6*work);
+
+        const auto* plasticDissipation = dynamic_cast<Data<double>*>(forceField->findData("plasticDissipation"));
+        ASSERT_NE(plasticDissipation, nullptr);
+        EXPECT_EQ(plasticDissipation->getValue(), 0.0);
+
+        // The energies of each element are published at the end of the time step
+        sofa::simulation::AnimateEndEvent endOfStep(1e-2);
+        forceField->handleEvent(&endOfStep);
+        const auto* beamElasticEnergies = dynamic_cast<Data<type::vector<double>>*>(forceField->findData("beamElasticEnergies"));
+        ASSERT_NE(beamElasticEnergies, nullptr);
+        ASSERT_EQ(beamElasticEnergies->getValue().size(), 2u);
+        EXPECT_EQ(beamElasticEnergies->getValue()[0], 0.0);
+        EXPECT_EQ(beamElasticEnergies->getValue()[1], elasticEnergy);
+    }
+
+    void check_BeamPlasticfEMForceField_gaussPointViews()
+    {
+        importBeamPlugins();
+
+        const BeamScene scene = loadBeamScene("");
+        ASSERT_TRUE(scene.isLoaded());
+        ForceField* forceField = scene.forceField;
+
+        // Small elastic stretch of the second element
+        computeDeformationForce(forceField, scene.dofs, [](Rigid3dTypes::VecCoord& x) { x[2].getCenter()[0] += 1e-8; });
+
+        const auto stresses = forceField->getGaussPointStresses();
+        const auto plasticStrains = forceField->getGaussPointPlasticStrains();
+        const auto states = forceField->getGaussPointStates();
+        ASSERT_EQ(stresses.size(), 2u);
+        ASSERT_EQ(plasticStrains.size(), 2u);
+        ASSERT_EQ(states.size(), 2u);
+
+        // Views on the element data, not copies
+        EXPECT_EQ(reinterpret_cast<const char*>(&stresses[1]) - reinterpret_cast<const char*>(&stresses[0]),
+                  static_cast<std::ptrdiff_t>(stresses.getStride()));
+        EXPECT_EQ(forceField->getGaussPointStresses().data(), stresses.data());
+
+        for (unsigned int gp = 0; gp < 27; gp++)
+        {
+            EXPECT_EQ(stresses[0][gp][0][0], 0.0);
+            EXPECT_GT(stresses[1][gp][0][0], 0.0);
+            EXPECT_EQ(plasticStrains[1][gp][0][0], 0.0);
+            EXPECT_EQ(states[1][gp], ForceField::MechanicalState::ELASTIC);
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_draw()
+    {
+        importBeamPlugins();
+
+        SceneInstance testScene = SceneInstance("xml", makeMeshScene());
+        ASSERT_NE(testScene.root.get(), nullptr);
+        TestForceField::SPtr forceField = addTestForceField(testScene.root.get(), {{"drawPlasticGaussPointsOnly", "true"}});
+        testScene.initScene();
+
+        auto* dofs = dynamic_cast<MechanicalObject<Rigid3dTypes>*>(testScene.root->getObject("DOFs"));
+        ASSERT_NE(dofs, nullptr);
+
+        // Without a draw tool, draw only builds the buffers
+        sofa::core::visual::VisualParams vparams;
+        vparams.displayFlags().setShowForceFields(true);
+        auto draw = [&]()
+        {
+            EXPECT_MSG_NOEMIT(Error);
+            forceField->draw(&vparams);
+        };
+
+        // At rest, no Gauss point is plastic: their shape functions are not even computed
+        draw();
+        EXPECT_TRUE(forceField->m_drawGaussPoints.empty());
+        EXPECT_TRUE(forceField->m_drawGaussPointShapeFunctions.empty());
+        EXPECT_EQ(forceField->m_drawCentrelinePoints.size(), 2u*2*10);
+
+        // Plastic stretch, the drawn positions being the ones of the last addForce
+        for (unsigned int step = 1; step <= 5; step++)
+            computeStretchForce(forceField.get(), dofs, 1 + 1e-3*step);
+        {
+            auto x = dofs->writePositions();
+            for (std::size_t i = 0; i < x.size(); i++)
+                x[i].getCenter()[0] *= 1 + 5e-3;
+        }
+        const Rigid3dTypes::VecCoord& x = dofs->read(sofa::core::vec_id::read_access::position)->getValue();
+
+        draw();
+        EXPECT_EQ(forceField->m_drawGaussPoints.size(), 2u*27);
+        EXPECT_EQ(forceField->m_drawGaussPointShapeFunctions.size(), 2u);
+        ASSERT_EQ(forceField->m_drawCentrelinePoints.size(), 2u*2*10);
+        EXPECT_EQ(forceField->m_drawCentrelinePoints.front(), sofa::type::Vec3(x[0].getCenter()));
+        EXPECT_EQ(forceField->m_drawCentrelinePoints.back(), sofa::type::Vec3(x[2].getCenter()));
+        for (const auto& p : forceField->m_drawGaussPoints)
+        {
+            EXPECT_GE(p[0], x[0].getCenter()[0]);
+            EXPECT_LE(p[0], x[2].getCenter()[0]);
+        }
+
+        forceField->findData("drawCentrelineSegments")->read("4");
+        draw();
+        EXPECT_EQ(forceField->m_drawCentrelinePoints.size(), 2u*2*4);
+
+        // Elements shorter than 1e6 pixels on screen are drawn as a single segment
+        const double identity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+        vparams.setModelViewMatrix(identity);
+        vparams.setProjectionMatrix(identity);
+        vparams.viewport()[2] = 800;
+        vparams.viewport()[3] = 600;
+        forceField->findData("drawLODPixelLength")->read("1e6");
+        draw();
+        EXPECT_TRUE(forceField->m_drawGaussPoints.empty());
+        EXPECT_TRUE(forceField->m_drawCentrelinePoints.empty());
+        ASSERT_EQ(forceField->m_drawLODPoints.size(), 2u*2);
+        EXPECT_EQ(forceField->m_drawLODPoints[1], sofa::type::Vec3(x[1].getCenter()));
+        EXPECT_EQ(forceField->m_drawLODPoints[3], sofa::type::Vec3(x[2].getCenter()));
+
+        // In headless mode, the buffers are left untouched
+        forceField->findData("headless")->read("true");
+        forceField->findData("drawLODPixelLength")->read("0");
+        draw();
+        EXPECT_EQ(forceField->m_drawLODPoints.size(), 2u*2);
+        EXPECT_TRUE(forceField->m_drawCentrelinePoints.empty());
+    }
+
+    void check_BeamPlasticfEMForceField_criticalTimeStep()
+    {
+        importBeamPlugins();
+
+        // The second element is the shortest one
+        const string strategies[2] = { "none", "threadBuffers" };
+        for (const string& strategy : strategies)
+        {
+            const BeamScene scene = loadBeamScene("massDensity = '8000' parallelStrategy = '" + strategy + "'",
+                                                  "0 0 0 0 0 0 1  5e-4 0 0 0 0 0 1  8e-4 0 0 0 0 0 1  1.4e-3 0 0 0 0 0 1",
+                                                  "0 1 1 2 2 3");
+            ASSERT_TRUE(scene.isLoaded());
+            ForceField* forceField = scene.forceField;
+            const auto* criticalTimeStep = dynamic_cast<Data<double>*>(forceField->findData("criticalTimeStep"));
+            const auto* criticalElement = dynamic_cast<Data<unsigned int>*>(forceField->findData("criticalElement"));
+            ASSERT_NE(criticalTimeStep, nullptr);
+            ASSERT_NE(criticalElement, nullptr);
+
+            // Conservative estimate: below the critical time step of the axial
+            // vibration of the shortest element alone, L sqrt(rho / E)
+            const double initialTimeStep = criticalTimeStep->getValue();
+            EXPECT_GT(initialTimeStep, 0.0) << strategy;
+            EXPECT_LT(initialTimeStep, 3e-4 * std::sqrt(8000 / 2.03e11)) << strategy;
+            EXPECT_EQ(criticalElement->getValue(), 1u) << strategy;
+
+            // Elastic step: addForce merges the critical elements of its chunks
+            // into the same estimate
+            computeStretchForce(forceField, scene.dofs, 1.0);
+            EXPECT_EQ(criticalTimeStep->getValue(), initialTimeStep) << strategy;
+            EXPECT_EQ(criticalElement->getValue(), 1u) << strategy;
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_explicitMode()
+    {
+        importBeamPlugins();
+
+        // Progressive plastic stretch of a cantilever, without and with the
+        // explicit mode, element by element and with the batched elastic kernel.
+        // The elements yield in their batch, after a few elastic steps.
+        const unsigned int nbSteps = 10;
+        const unsigned int explicitModes[3] = { 0, 1, 1 };
+        const string kernels[3] = { "none", "none", "scalar" };
+        std::vector<Rigid3dTypes::VecDeriv> forces[3];
+        for (unsigned int config = 0; config < 3; config++)
+        {
+            const unsigned int explicitMode = explicitModes[config];
+            const BeamScene scene = loadBeamScene("useConsistentTangentOperator = 'true' "
+                                                  "explicitMode = '" + std::to_string(explicitMode) + "' "
+                                                  "batchKernel = '" + kernels[config] + "'");
+            ASSERT_TRUE(scene.isLoaded());
+            ForceField* forceField = scene.forceField;
+            const auto* nbPlasticBeams = dynamic_cast<Data<unsigned int>*>(forceField->findData("nbPlasticBeams"));
+            const auto* nbTangentUpdates = dynamic_cast<Data<unsigned int>*>(forceField->findData("nbTangentUpdates"));
+            const auto* nbBatchedElements = dynamic_cast<Data<unsigned int>*>(forceField->findData("nbBatchedElements"));
+            ASSERT_NE(nbPlasticBeams, nullptr);
+            ASSERT_NE(nbTangentUpdates, nullptr);
+            ASSERT_NE(nbBatchedElements, nullptr);
+
+            for (unsigned int step = 1; step <= nbSteps; step++)
+            {
+                forces[config].push_back(computeStretchForce(forceField, scene.dofs, 1 + 4e-4*step));
+
+                // Elastic steps in the batch, then the elements which yield are
+                // computed element by element
+                if (config == 2 && step == 1)
+                    EXPECT_EQ(nbBatchedElements->getValue(), 2u);
+            }
+
+            EXPECT_EQ(nbPlasticBeams->getValue(), 2u) << "configuration " << config;
+            EXPECT_EQ(nbBatchedElements->getValue(), 0u) << "configuration " << config;
+            if (explicitMode)
+                EXPECT_EQ(nbTangentUpdates->getValue(), 0u) << "configuration " << config;
+            else
+                EXPECT_EQ(nbTangentUpdates->getValue(), 2u) << "configuration " << config;
+        }
+
+        // The stiffness is not maintained, but the forces are unchanged
+        for (unsigned int config = 1; config < 3; config++)
+        {
+            ASSERT_EQ(forces[config].size(), forces[0].size());
+            for (std::size_t step = 0; step < forces[0].size(); step++)
+            {
+                ASSERT_EQ(forces[config][step].size(), forces[0][step].size());
+                for (std::size_t i = 0; i < forces[0][step].size(); i++)
+                {
+                    for (unsigned int k = 0; k < 6; k++)
+                    {
+                        if (config == 1)
+                            EXPECT_DOUBLE_EQ(forces[config][step][i][k], forces[0][step][i][k]);
+                        else
+                            EXPECT_NEAR(forces[config][step][i][k], forces[0][step][i][k], 1e-9*(1 + std::abs(forces[0][step][i][k])))
+                                << "step " << step << ", node " << i << ", coordinate " << k;
+                    }
+                }
+            }
+        }
+    }
+
+    void check_BeamPlasticShapeFunctionMapping()
+    {
+        importBeamPlugins();
+
+        // Points around the two elements, mapped on the closest one
+        const BeamScene scene = loadBeamScene("", TwoBeamNodes, TwoBeamLines,
+            "   <Node name='Surface'>                                                                           "
+            "       <MechanicalObject template='Vec3d' name='points' position='1e-4 2e-5 0  4e-4 0 -2e-5         "
+            "                                                                  6e-4 -2e-5 0  9e-4 0 2e-5' />    "
+            "       <BeamPlasticShapeFunctionMapping name='mapping' parallel='true' />                          "
+            "   </Node>                                                                                         ");
+        ASSERT_TRUE(scene.isLoaded());
+
+        typedef beamplastic::mapping::BeamPlasticShapeFunctionMapping<Rigid3dTypes, Vec3dTypes> Mapping;
+        Node* surface = scene.getRoot()->getChild("Surface");
+        ASSERT_NE(surface, nullptr);
+        auto* dofs = scene.dofs;
+        auto* mapping = dynamic_cast<Mapping*>(surface->getObject("mapping"));
+        auto* points = dynamic_cast<MechanicalObject<Vec3dTypes>*>(surface->getObject("points"));
+        ASSERT_NE(mapping, nullptr);
+        ASSERT_NE(points, nullptr);
+
+        const auto* pointElements = dynamic_cast<Data<type::vector<unsigned int>>*>(mapping->findData("pointElements"));
+        ASSERT_NE(pointElements, nullptr);
+        EXPECT_EQ(pointElements->getValue(), type::vector<unsigned int>({0, 0, 1, 1}));
+
+        const Vec3dTypes::VecCoord restPoints = points->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+        const auto* mparams = sofa::core::MechanicalParams::defaultInstance();
+
+        // Rigid motion of the beam: the points follow it exactly
+        const type::Quat<double> rotation = type::Quat<double>::createFromRotationVector(type::Vec3d(0.1, -0.2, 0.3));
+        const type::Vec3d translation(1e-4, -2e-4, 3e-4);
+        Data<Rigid3dTypes::VecCoord> x;
+        Rigid3dTypes::VecCoord& frames = *x.beginEdit();
+        frames = dofs->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+        for (auto& frame : frames)
+        {
+            frame.getCenter() = rotation.rotate(frame.getCenter()) + translation;
+            frame.getOrientation() = rotation * frame.getOrientation();
+        }
+        x.endEdit();
+
+        Data<Vec3dTypes::VecCoord> y;
+        mapping->apply(mparams, y, x);
+        ASSERT_EQ(y.getValue().size(), restPoints.size());
+        for (std::size_t i = 0; i < restPoints.size(); i++)
+            for (unsigned int k = 0; k < 3; k++)
+                EXPECT_NEAR(y.getValue()[i][k], (rotation.rotate(restPoints[i]) + translation)[k], 1e-12);
+
+        // applyJT is the transpose of applyJ
+        Data<Rigid3dTypes::VecDeriv> v;
+        Rigid3dTypes::VecDeriv& velocities = *v.beginEdit();
+        velocities.resize(frames.size());
+        for (std::size_t n = 0; n < velocities.size(); n++)
+            velocities[n] = Rigid3dTypes::Deriv(type::Vec3d(1.0, n, -2.0), type::Vec3d(0.5*n, -1.0, 3.0));
+        v.endEdit();
+        Data<Vec3dTypes::VecDeriv> dy;
+        mapping->applyJ(mparams, dy, v);
+
+        Data<Vec3dTypes::VecDeriv> f;
+        Vec3dTypes::VecDeriv& forces = *f.beginEdit();
+        forces.resize(restPoints.size());
+        for (std::size_t i = 0; i < forces.size(); i++)
+            forces[i] = type::Vec3d(i, -1.0, 2.0*i);
+        f.endEdit();
+        Data<Rigid3dTypes::VecDeriv> nodeForces;
+        nodeForces.setValue(Rigid3dTypes::VecDeriv(frames.size()));
+        mapping->applyJT(mparams, nodeForces, f);
+
+        double pointPower = 0, nodePower = 0;
+        for (std::size_t i = 0; i < forces.size(); i++)
+            pointPower += forces[i] * dy.getValue()[i];
+        for (std::size_t n = 0; n < velocities.size(); n++)
+            nodePower += nodeForces.getValue()[n].getLinear() * velocities[n].getLinear()
+                       + nodeForces.getValue()[n].getAngular() * velocities[n].getAngular();
+        EXPECT_NEAR(pointPower, nodePower, 1e-12*std::abs(pointPower));
+    }
+
+    void check_BeamPlasticShapeFunctionMapping_closestElements()
+    {
+        importBeamPlugins();
+
+        // Helix of beam elements, and points around it and far away from it
+        const unsigned int nbBeams = 200;
+        std::ostringstream positions, lines, pointPositions;
+        for (unsigned int i = 0; i <= nbBeams; i++)
+        {
+            const double angle = 0.1*i;
+            positions << 1e-2*std::cos(angle) << " " << 1e-2*std::sin(angle) << " " << 1e-4*i << " 0 0 0 1  ";
+            if (i < nbBeams)
+                lines << i << " " << i + 1 << "  ";
+        }
+        const unsigned int nbPoints = 500;
+        for (unsigned int i = 0; i < nbPoints; i++)
+        {
+            const double scale = (i % 10 == 0) ? 1.0 : 2e-2;
+            pointPositions << scale*std::sin(1.7*i) << " " << scale*std::cos(2.3*i) << " " << scale*std::sin(0.7*i + 1.0) << "  ";
+        }
+
+        const BeamScene scene = loadBeamScene("", positions.str(), lines.str(),
+            "   <Node name='Surface'>                                                                           "
+            "       <MechanicalObject template='Vec3d' name='points' position='" + pointPositions.str() + "' /> "
+            "       <BeamPlasticShapeFunctionMapping name='mapping' />                                          "
+            "   </Node>                                                                                         ");
+        ASSERT_TRUE(scene.isLoaded());
+
+        Node* surface = scene.getRoot()->getChild("Surface");
+        ASSERT_NE(surface, nullptr);
+        sofa::core::objectmodel::BaseObject* mapping = surface->getObject("mapping");
+        auto* points = dynamic_cast<MechanicalObject<Vec3dTypes>*>(surface->getObject("points"));
+        ASSERT_NE(mapping, nullptr);
+        ASSERT_NE(points, nullptr);
+        const auto* pointElements = dynamic_cast<Data<type::vector<unsigned int>>*>(mapping->findData("pointElements"));
+        ASSERT_NE(pointElements, nullptr);
+        ASSERT_EQ(pointElements->getValue().size(), nbPoints);
+
+        // Same element as an exhaustive search
+        const Rigid3dTypes::VecCoord& x0 = scene.dofs->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+        const Vec3dTypes::VecCoord& restPoints = points->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+        for (unsigned int i = 0; i < nbPoints; i++)
+        {
+            double minDistance = std::numeric_limits<double>::max();
+            unsigned int closest = 0;
+            for (unsigned int e = 0; e < nbBeams; e++)
+            {
+                const type::Vec3d& pa = x0[e].getCenter();
+                const type::Vec3d ab = x0[e + 1].getCenter() - pa;
+                const double t = std::clamp((restPoints[i] - pa)*ab / ab.norm2(), 0.0, 1.0);
+                const double distance = (restPoints[i] - pa - ab*t).norm2();
+                if (distance < minDistance)
+                {
+                    minDistance = distance;
+                    closest = e;
+                }
+            }
+            EXPECT_EQ(pointElements->getValue()[i], closest) << "point " << i;
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_stiffnessMatrix()
+    {
+        importBeamPlugins();
+
+        const BeamScene scene = loadBeamScene("");
+        ASSERT_TRUE(scene.isLoaded());
+        ForceField* forceField = scene.forceField;
+        MechanicalObject<Rigid3dTypes>* dofs = scene.dofs;
+
+        // Plastic stretch and bending of the cantilever, for rotated and plastic elements
+        for (unsigned int step = 1; step <= 5; step++)
+            computeStretchForce(forceField, dofs, 1 + 4e-4*step, 2e-5*step);
+        const Rigid3dTypes::VecCoord& x0 = dofs->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+        const auto* nbPlasticBeams = dynamic_cast<Data<unsigned int>*>(forceField->findData("nbPlasticBeams"));
+        ASSERT_NE(nbPlasticBeams, nullptr);
+        EXPECT_GT(nbPlasticBeams->getValue(), 0u);
+
+        sofa::core::MechanicalParams mparams;
+        mparams.setKFactor(2.5);
+
+        const std::size_t nbDofs = 6 * x0.size();
+        sofa::linearalgebra::FullMatrix<double> matrix(nbDofs, nbDofs);
+        matrix.clear();
+        sofa::core::behavior::DefaultMultiMatrixAccessor accessor;
+        accessor.addMechanicalState(dofs);
+        accessor.setGlobalMatrix(&matrix);
+        accessor.setupMatrices();
+        forceField->addKToMatrix(&mparams, &accessor);
+
+        double maxEntry = 0;
+        for (std::size_t row = 0; row < nbDofs; row++)
+            for (std::size_t column = 0; column < nbDofs; column++)
+                maxEntry = std::max(maxEntry, std::abs(matrix.element(row, column)));
+        ASSERT_GT(maxEntry, 0.0);
+
+        // Each column of the assembled matrix is the product of the stiffness by a unit displacement
+        for (std::size_t column = 0; column < nbDofs; column++)
+        {
+            Data<Rigid3dTypes::VecDeriv> dx;
+            Rigid3dTypes::VecDeriv& v = *dx.beginEdit();
+            v.resize(x0.size());
+            v[column / 6][column % 6] = 1;
+            dx.endEdit();
+
+            Data<Rigid3dTypes::VecDeriv> df;
+            df.setValue(Rigid3dTypes::VecDeriv(x0.size()));
+            forceField->addDForce(&mparams, df, dx);
+
+            for (std::size_t row = 0; row < nbDofs; row++)
+                EXPECT_NEAR(matrix.element(row, column), df.getValue()[row / 6][row % 6], 1e-9*maxEntry)
+                    << "row " << row << ", column " << column;
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_elementOrdering()
+    {
+        importBeamPlugins();
+
+        // Branched mesh with scattered node indices, so that the orderings differ from the mesh one
+        const std::string orderings[3] = { "none", "RCM", "Morton" };
+        Rigid3dTypes::VecDeriv forces[3];
+        for (unsigned int o = 0; o < 3; o++)
+        {
+            const BeamScene scene = loadBeamScene("elementOrdering = '" + orderings[o] + "'",
+                                                  "0 0 0 0 0 0 1  1e-3 5e-4 0 0 0 0 1  5e-4 0 0 0 0 0 1  "
+                                                  "1.5e-3 -5e-4 0 0 0 0 1  1e-3 -5e-4 0 0 0 0 1  1.5e-3 5e-4 0 0 0 0 1",
+                                                  "0 2 2 1 4 2 1 5 3 4");
+            ASSERT_TRUE(scene.isLoaded());
+            ForceField* forceField = scene.forceField;
+
+            // The suggested renumbering of the nodes is a permutation
+            const auto* nodePermutation = dynamic_cast<Data<type::vector<unsigned int>>*>(forceField->findData("nodePermutation"));
+            ASSERT_NE(nodePermutation, nullptr);
+            if (orderings[o] == "none")
+                EXPECT_TRUE(nodePermutation->getValue().empty());
+            else
+            {
+                type::vector<unsigned int> sorted = nodePermutation->getValue();
+                std::sort(sorted.begin(), sorted.end());
+                ASSERT_EQ(sorted.size(), 6u);
+                for (unsigned int n = 0; n < sorted.size(); n++)
+                    EXPECT_EQ(sorted[n], n);
+            }
+
+            // Small elastic deformation: the forces do not depend on the traversal order
+            forces[o] = computeDeformationForce(forceField, scene.dofs, [](Rigid3dTypes::VecCoord& positions)
+            {
+                for (std::size_t i = 0; i < positions.size(); i++)
+                {
+                    positions[i].getCenter()[0] *= 1 + 1e-5*i;
+                    positions[i].getCenter()[2] = 1e-7*i*i;
+                }
+            });
+        }
+
+        for (unsigned int o = 1; o < 3; o++)
+        {
+            ASSERT_EQ(forces[o].size(), forces[0].size());
+            for (std::size_t i = 0; i < forces[0].size(); i++)
+                for (unsigned int k = 0; k < 6; k++)
+                    EXPECT_NEAR(forces[o][i][k], forces[0][i][k], 1e-12 + 1e-10*std::abs(forces[0][i][k]))
+                        << orderings[o] << ", node " << i << ", coordinate " << k;
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_parallelInit()
+    {
+        importBeamPlugins();
+
+        // Bent line of 50 beam elements of different lengths, initialised on the
+        // task scheduler (even with the sequential element loops of 'none'),
+        // then one element after the other
+        const unsigned int nbBeams = 50;
+        std::ostringstream positions, lines;
+        for (unsigned int i = 0; i <= nbBeams; i++)
+            positions << i*5e-4 + (i % 3)*1e-4 << " " << 1e-6*i*i << " 0 0 0 0 1 ";
+        for (unsigned int i = 0; i < nbBeams; i++)
+            lines << i << " " << i + 1 << " ";
+
+        SceneInstance testScene = SceneInstance("xml", makeMeshScene(positions.str(), lines.str()));
+        ASSERT_NE(testScene.root.get(), nullptr);
+        TestForceField::SPtr forceField = addTestForceField(testScene.root.get(), {
+            {"usePrecomputedStiffness", "false"}, {"parallelStrategy", "none"} });
+        testScene.initScene();
+        const sofa::type::vector<TestForceField::BeamInfo> parallelBeams = forceField->m_beamsData.getValue();
+
+        for (unsigned int i = 0; i < nbBeams; i++)
+            forceField->reinitBeam(i);
+        const sofa::type::vector<TestForceField::BeamInfo>& sequentialBeams = forceField->m_beamsData.getValue();
+
+        // The element initialisation does not depend on the chunk of elements
+        ASSERT_EQ(parallelBeams.size(), nbBeams);
+        ASSERT_EQ(sequentialBeams.size(), nbBeams);
+        for (unsigned int i = 0; i < nbBeams; i++)
+        {
+            EXPECT_EQ(parallelBeams[i]._L, sequentialBeams[i]._L) << "element " << i;
+            EXPECT_EQ(std::memcmp(&parallelBeams[i]._BeMatrices, &sequentialBeams[i]._BeMatrices, sizeof(sequentialBeams[i]._BeMatrices)), 0) << "element " << i;
+            EXPECT_EQ(std::memcmp(&parallelBeams[i]._Ke_loc, &sequentialBeams[i]._Ke_loc, sizeof(sequentialBeams[i]._Ke_loc)), 0) << "element " << i;
+        }
+    }
+
+    void check_BeamPlasticfEMForceField_startupTime()
+    {
+        importBeamPlugins();
+
+        // Straight line of 100k beam elements, with the default sequential element loops
+        const unsigned int nbBeams = 100000;
+        std::ostringstream positions, lines;
+        for (unsigned int i = 0; i <= nbBeams; i++)
+            positions << i*5e-4 << " 0 0 0 0 0 1 ";
+        for (unsigned int i = 0; i < nbBeams; i++)
+            lines << i << " " << i + 1 << " ";
+
+        SceneInstance testScene = SceneInstance("xml", makeBeamScene("", positions.str(), lines.str()));
         Node::SPtr root = testScene.root;
         ASSERT_NE(root.get(), nullptr);
-        //ASSERT_EQ(root.get(), nullptr);
+
+        const auto start = std::chrono::steady_clock::now();
+        testScene.initScene();
+        const double initTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        auto* forceField = dynamic_cast<ForceField*>(root->getObject("FEM"));
+        ASSERT_NE(forceField, nullptr);
+        EXPECT_EQ(forceField->getElements().size(), nbBeams);
+
+        // Loose bound, to catch a complexity regression rather than to measure performance
+        RecordProperty("initSeconds", std::to_string(initTime));
+        EXPECT_LT(initTime, 60.0);
     }
 };
 
@@ -96,4 +1963,129 @@ TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_init) {
     check_BeamPlasticfEMForceField_init();
 }
 
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_tabulatedLaw_init) {
+    check_BeamPlasticfEMForceField_tabulatedLaw_init();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_constitutiveModel) {
+    check_BeamPlasticfEMForceField_constitutiveModel();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_materialTables) {
+    check_BeamPlasticfEMForceField_materialTables();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_coloring_init) {
+    check_BeamPlasticfEMForceField_coloring_init();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_batchKernel) {
+    check_BeamPlasticfEMForceField_batchKernel();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_float_init) {
+    check_BeamPlasticfEMForceField_float_init();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_plasticMultiplier) {
+    check_BeamPlasticfEMForceField_plasticMultiplier();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_plasticModulus) {
+    check_BeamPlasticfEMForceField_plasticModulus();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_tabulatedLaw) {
+    check_BeamPlasticfEMForceField_tabulatedLaw();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_hardeningCurveFile) {
+    check_BeamPlasticfEMForceField_hardeningCurveFile();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_localNewtonFailures) {
+    check_BeamPlasticfEMForceField_localNewtonFailures();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_checkpoint) {
+    check_BeamPlasticfEMForceField_checkpoint();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_elementCache) {
+    check_BeamPlasticfEMForceField_elementCache();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_topologicalChanges) {
+    check_BeamPlasticfEMForceField_topologicalChanges();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_incrementalTopologicalChanges) {
+    check_BeamPlasticfEMForceField_incrementalTopologicalChanges();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_updateBeams) {
+    check_BeamPlasticfEMForceField_updateBeams();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_reinitBatchKernel) {
+    check_BeamPlasticfEMForceField_reinitBatchKernel();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_phaseTimes) {
+    check_BeamPlasticfEMForceField_phaseTimes();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_displacementTrace) {
+    check_BeamPlasticfEMForceField_displacementTrace();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_gaussPointHistory) {
+    check_BeamPlasticfEMForceField_gaussPointHistory();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_energy) {
+    check_BeamPlasticfEMForceField_energy();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_gaussPointViews) {
+    check_BeamPlasticfEMForceField_gaussPointViews();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_draw) {
+    check_BeamPlasticfEMForceField_draw();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_criticalTimeStep) {
+    check_BeamPlasticfEMForceField_criticalTimeStep();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_explicitMode) {
+    check_BeamPlasticfEMForceField_explicitMode();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticShapeFunctionMapping) {
+    check_BeamPlasticShapeFunctionMapping();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticShapeFunctionMapping_closestElements) {
+    check_BeamPlasticShapeFunctionMapping_closestElements();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_stiffnessMatrix) {
+    check_BeamPlasticfEMForceField_stiffnessMatrix();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_elementOrdering) {
+    check_BeamPlasticfEMForceField_elementOrdering();
+}
+
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_parallelInit) {
+    check_BeamPlasticfEMForceField_parallelInit();
+}
+
+// Run by the BeamPlastic_test_startupTime ctest test, labelled slow
+TEST_F(BeamPlasticFEMForceField_test, check_BeamPlasticfEMForceField_startupTime) {
+    check_BeamPlasticfEMForceField_startupTime();
+}
+
 } // namespace sofa::testing
@@ -25,6 +25,8 @@
 
 #include <sofa/type/Mat.h>
 
+#include <algorithm>
+
 namespace beamplastic::constitutivelaw
 {
 
@@ -39,12 +41,27 @@ public:
 
     virtual ~PlasticConstitutiveLaw() {}
 
-    /* Returns the slope of effective stress VS effective plastic strains, from the stress value */
+    /* Returns the slope of effective stress VS effective plastic strains (the plastic
+       modulus H', not the elastoplastic tangent modulus), from the stress value */
     virtual Real getTangentModulusFromStress(const double effStress) = 0;
 
-    /* Returns the slope of effective stress VS effective plastic strains, from the strain value*/
+    /* Returns the slope of effective stress VS effective plastic strains (the plastic
+       modulus H', not the elastoplastic tangent modulus), from the strain value */
     virtual Real getTangentModulusFromStrain(const double effPlasticStrain) = 0;
 
+    /* Returns the effective stress on the hardening curve, from the effective plastic strain value */
+    virtual Real getStressFromStrain(const double effPlasticStrain) = 0;
+
+    /* Returns the plastic modulus H' (derivative of getStressFromStrain), from the effective plastic
+       strain value. The default implementation uses finite differences. */
+    virtual Real getPlasticModulusFromStrain(const double effPlasticStrain)
+    {
+        const double h = std::max(1e-8, 1e-4*effPlasticStrain);
+        const double lower = std::max(0.0, effPlasticStrain - h);
+        const double upper = effPlasticStrain + h;
+        return (getStressFromStrain(upper) - getStressFromStrain(lower)) / (upper - lower);
+    }
+
 };
 
 } // namespace beamplastic::constitutivelaw
@@ -26,6 +26,9 @@
 #include "PlasticConstitutiveLaw.h"
 #include <sofa/type/Mat.h>
 
+#include <algorithm>
+#include <cmath>
+
 
 namespace beamplastic::constitutivelaw
 {
@@ -39,10 +42,7 @@ public:
     typedef sofa::type::Mat<3, 3, Real> Matrix3;
     typedef sofa::type::Mat<6, 6, Real> Matrix6;
 
-    RambergOsgood(Real E, Real yieldStress,
-                  Real eps1 = (Real)0.00384942, Real sig1 = (Real)6.0e8,
-                  Real eps2 = (Real)0.0030727273, Real sig2 = (Real)5.6e8,
-                  unsigned int n = 15, Real A = (Real)0.002)
+    RambergOsgood(Real E, Real yieldStress, unsigned int n = 15, Real A = (Real)0.002)
     {
         // Initialsation of generic material parameters
         _E = E;
@@ -52,25 +52,31 @@ public:
         _A = A;
         _n = n;
         _K = A * pow(E / yieldStress, n);
-
-        // Initialisation of Ramberg-Osgood alternative form parameters
-        Real m1 = sig1 / (E*eps1);
-        Real m2 = sig2 / (E*eps2);
-        _N = 1 + (log((m1 - 1) / (m2 - 1)) / log(eps1 / eps2));
-        _altK = (m1 - 1) / pow(eps1,_N - 1);
     }
 
     Real getTangentModulusFromStress(const double effStress) override
     {
-        double En1 = pow(_E, _n - 1);
-        Real tangentModulus = (_E*En1) / ( En1 + _K*_n*pow(effStress,_n-1) );
-        return tangentModulus;
+        // Plastic strain eps_p + A = K*(sigma/E)^n reached at this stress, the
+        // hardening curve starting at the yield stress
+        const double stress = std::max(effStress, double(_yieldStress));
+        return stress / (_n*_K*pow(stress / _E, _n));
     }
 
     Real getTangentModulusFromStrain(const double effPlasticStrain) override
     {
-        Real tangentModulus = _E*(1 + _altK*_N*pow(effPlasticStrain,_N-1));
-        return tangentModulus;
+        return getPlasticModulusFromStrain(effPlasticStrain);
+    }
+
+    Real getStressFromStrain(const double effPlasticStrain) override
+    {
+        // Inverse of the Ramberg-Osgood plastic strain eps_p = K*(sigma/E)^n, shifted
+        // by the offset A so that the curve starts at the yield stress for eps_p = 0
+        return _E*pow((effPlasticStrain + _A) / _K, 1.0 / _n);
+    }
+
+    Real getPlasticModulusFromStrain(const double effPlasticStrain) override
+    {
+        return getStressFromStrain(effPlasticStrain) / (_n*(effPlasticStrain + _A));
     }
 
 protected:
@@ -84,10 +90,6 @@ protected:
     Real _K;
     unsigned int _n;
 
-    // Alternative form of Ramberg-Osgood as in Venkateswara Rao and Krishna Murty, 1971
-    Real _altK;
-    Real _N;
-
 };
 
 
@@ -0,0 +1,213 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+
+#include "PlasticConstitutiveLaw.h"
+#include <sofa/type/Vec.h>
+#include <sofa/type/vector.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace beamplastic::constitutivelaw
+{
+
+/**
+ * Piecewise linear hardening curve, defined by measured (effective plastic
+ * strain, effective stress) samples.
+ * At construction, the curve is resampled on two uniform grids (one in strain,
+ * one in stress) storing the slope of each cell, so that the tangent modulus
+ * lookups are a single multiply and index operation, without any search or
+ * transcendental function evaluation.
+ * Outside of the sampled range, the curve is extrapolated with the slope of
+ * the first or last cell.
+ */
+template<class DataTypes>
+class TabulatedConstitutiveLaw : public PlasticConstitutiveLaw<DataTypes> {
+
+public:
+
+    typedef typename DataTypes::Coord::value_type Real;
+    typedef sofa::type::Vec<2, Real> Sample; ///< (effective plastic strain, effective stress)
+    typedef sofa::type::vector<Sample> VecSample;
+
+    /// Checks that the samples describe a valid hardening curve: at least two
+    /// samples, strictly increasing plastic strains and non-decreasing stresses.
+    static bool checkSamples(const VecSample& samples, std::string& errorMessage)
+    {
+        if (samples.size() < 2)
+        {
+            errorMessage = "at least two (plastic strain, stress) samples are required";
+            return false;
+        }
+        for (std::size_t k = 1; k < samples.size(); k++)
+        {
+            if (!(samples[k][0] > samples[k-1][0]))
+            {
+                std::ostringstream oss;
+                oss << "plastic strains must be strictly increasing (sample " << k << ")";
+                errorMessage = oss.str();
+                return false;
+            }
+            if (samples[k][1] < samples[k-1][1])
+            {
+                std::ostringstream oss;
+                oss << "stresses must be non-decreasing (sample " << k << ")";
+                errorMessage = oss.str();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// The samples are expected to be valid, see checkSamples.
+    TabulatedConstitutiveLaw(const VecSample& samples, unsigned int tableSize = 1024)
+        : _samples(samples)
+    {
+        const std::size_t nbCells = std::max(tableSize, 1u);
+
+        // Uniform grid in plastic strain
+        _strainOrigin = samples.front()[0];
+        const Real strainStep = (samples.back()[0] - _strainOrigin) / nbCells;
+        _invStrainStep = 1 / strainStep;
+
+        _stressTable.resize(nbCells + 1);
+        for (std::size_t k = 0; k <= nbCells; k++)
+            _stressTable[k] = interpolateStress(_strainOrigin + k*strainStep);
+
+        _slopeFromStrain.resize(nbCells);
+        for (std::size_t k = 0; k < nbCells; k++)
+            _slopeFromStrain[k] = (_stressTable[k+1] - _stressTable[k]) * _invStrainStep;
+
+        // Uniform grid in stress. A flat curve (perfect plasticity) gives a
+        // single cell of zero slope.
+        _stressOrigin = samples.front()[1];
+        const Real stressRange = samples.back()[1] - _stressOrigin;
+        if (stressRange > 0)
+        {
+            const Real stressStep = stressRange / nbCells;
+            _invStressStep = 1 / stressStep;
+            _slopeFromStress.resize(nbCells);
+            for (std::size_t k = 0; k < nbCells; k++)
+                _slopeFromStress[k] = segmentSlopeAtStress(_stressOrigin + (k + 0.5)*stressStep);
+        }
+        else
+        {
+            _invStressStep = 0;
+            _slopeFromStress.assign(1, 0);
+        }
+    }
+
+    Real getTangentModulusFromStress(const double effStress) override
+    {
+        return lookup(_slopeFromStress, _stressOrigin, _invStressStep, effStress);
+    }
+
+    Real getTangentModulusFromStrain(const double effPlasticStrain) override
+    {
+        return lookup(_slopeFromStrain, _strainOrigin, _invStrainStep, effPlasticStrain);
+    }
+
+    /// Effective stress on the resampled curve, for a given effective plastic strain
+    Real getStressFromStrain(const double effPlasticStrain) override
+    {
+        const double t = (effPlasticStrain - _strainOrigin) * _invStrainStep;
+        const std::size_t last = _slopeFromStrain.size();
+        if (!(t > 0))
+            return _stressTable.front() + (effPlasticStrain - _strainOrigin)*_slopeFromStrain.front();
+        if (t >= last)
+            return _stressTable.back() + (t - last)*_slopeFromStrain.back() / _invStrainStep;
+        const std::size_t k = static_cast<std::size_t>(t);
+        return _stressTable[k] + (t - k)*(_stressTable[k+1] - _stressTable[k]);
+    }
+
+    /// The resampled curve is piecewise linear, its slope is exactly the tabulated one
+    Real getPlasticModulusFromStrain(const double effPlasticStrain) override
+    {
+        return getTangentModulusFromStrain(effPlasticStrain);
+    }
+
+    const VecSample& getSamples() const { return _samples; }
+
+protected:
+
+    static Real lookup(const std::vector<Real>& table, const Real origin, const Real invStep, const double x)
+    {
+        const double t = (x - origin) * invStep;
+        if (!(t > 0)) // also catches NaN
+            return table.front();
+        if (t >= table.size())
+            return table.back();
+        return table[static_cast<std::size_t>(t)];
+    }
+
+    /// Linear interpolation of the original samples (construction only)
+    Real interpolateStress(const Real effPlasticStrain) const
+    {
+        auto upper = std::upper_bound(_samples.begin(), _samples.end(), effPlasticStrain,
+                                      [](const Real x, const Sample& s) { return x < s[0]; });
+        if (upper == _samples.begin())
+            return _samples.front()[1];
+        if (upper == _samples.end())
+            return _samples.back()[1];
+        const Sample& s0 = *(upper - 1);
+        const Sample& s1 = *upper;
+        return s0[1] + (effPlasticStrain - s0[0]) * (s1[1] - s0[1]) / (s1[0] - s0[0]);
+    }
+
+    /// Slope of the original segment on which the given stress is reached (construction only)
+    Real segmentSlopeAtStress(const Real effStress) const
+    {
+        for (std::size_t k = 1; k < _samples.size(); k++)
+        {
+            if (effStress <= _samples[k][1] && _samples[k][1] > _samples[k-1][1])
+                return (_samples[k][1] - _samples[k-1][1]) / (_samples[k][0] - _samples[k-1][0]);
+        }
+        const Sample& s0 = _samples[_samples.size() - 2];
+        const Sample& s1 = _samples.back();
+        return (s1[1] - s0[1]) / (s1[0] - s0[0]);
+    }
+
+    // Original curve
+    VecSample _samples;
+
+    // Resampled curve, uniform in effective plastic strain
+    Real _strainOrigin;
+    Real _invStrainStep;
+    std::vector<Real> _stressTable;
+    std::vector<Real> _slopeFromStrain;
+
+    // Resampled curve, uniform in effective stress
+    Real _stressOrigin;
+    Real _invStressStep;
+    std::vector<Real> _slopeFromStress;
+
+};
+
+
+} // namespace beamplastic::constitutivelaw
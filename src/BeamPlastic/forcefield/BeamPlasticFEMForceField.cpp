@@ -34,9 +34,11 @@ using namespace sofa::defaulttype;
 void registerBeamPlasticFEMForceField(sofa::core::ObjectFactory* factory)
 {
     factory->registerObjects(core::ObjectRegistrationData("Stent adaptated beam finite elements")
-         .add< BeamPlasticFEMForceField<Rigid3Types> >());
+         .add< BeamPlasticFEMForceField<Rigid3dTypes> >(true)
+         .add< BeamPlasticFEMForceField<Rigid3fTypes> >());
 }
 
-template class BEAMPLASTIC_API BeamPlasticFEMForceField<Rigid3Types>;
+template class BEAMPLASTIC_API BeamPlasticFEMForceField<Rigid3dTypes>;
+template class BEAMPLASTIC_API BeamPlasticFEMForceField<Rigid3fTypes>;
 
 } // namespace beamplastic::forcefield
@@ -24,14 +24,26 @@
 #include <BeamPlastic/config.h>
 
 #include <BeamPlastic/constitutivelaw/PlasticConstitutiveLaw.h>
+#include <BeamPlastic/io/DisplacementTrace.h>
+#include <BeamPlastic/io/GaussPointHistory.h>
 #include <BeamPlastic/quadrature/gaussian.h>
+#include <BeamPlastic/simd/ElasticBatchKernel.h>
+#include <BeamPlastic/utils/ChromeTraceWriter.h>
+#include <BeamPlastic/utils/PhaseTimer.h>
+#include <BeamPlastic/utils/StridedArrayView.h>
 
+#include <sofa/core/behavior/BaseMass.h>
 #include <sofa/core/behavior/ForceField.h>
 #include <sofa/core/topology/TopologyData.h>
 #include <sofa/core/behavior/MultiMatrixAccessor.h>
+#include <sofa/core/objectmodel/DataFileName.h>
+#include <sofa/simulation/TaskScheduler.h>
 
 #include <Eigen/Geometry>
+#include <array>
+#include <memory>
 #include <string>
+#include <vector>
 
 
 namespace beamplastic::forcefield
@@ -97,6 +109,21 @@ public:
     typedef sofa::type::Mat<6, 6, Real> VoigtTensor4; ///< Symmetrical tensor of order 4, written with Voigt notation
     typedef sofa::type::Mat<9, 9, Real> VectTensor4; ///< Symmetrical tensor of order 4, written with vector notation
 
+    /**
+     * Precision in which the Be matrices and the Gauss point history (stresses,
+     * plastic strains, back stresses, yield stresses) are stored. With the
+     * BEAMPLASTIC_MIXED_PRECISION build option, they are stored in single
+     * precision to halve the memory traffic of the element loops on very large
+     * models. The computations and the force accumulation are always made with Real.
+     */
+#ifdef BEAMPLASTIC_MIXED_PRECISION
+    typedef float StorageReal;
+#else
+    typedef Real StorageReal;
+#endif
+    typedef sofa::type::Mat<6, 12, StorageReal> StorageMatrix6x12;
+    typedef sofa::type::Mat<6, 1, StorageReal> StorageVoigtTensor2;
+
     /** \enum class MechanicalState
      *  \brief Types of mechanical state associated with the (Gauss) integration
      *  points. The POSTPLASTIC state corresponds to points which underwent plastic
@@ -109,81 +136,6 @@ public:
         POSTPLASTIC = 2,
     };
 
-    ///<3-dimensional Gauss point for reduced integration
-    class GaussPoint3
-    {
-    public:
-        GaussPoint3() {}
-        GaussPoint3(Real x, Real y, Real z, Real w1, Real w2, Real w3);
-        ~GaussPoint3() {}
-
-        auto getNx() const -> const Matrix3x12&;
-        void setNx(Matrix3x12 Nx);
-
-        auto getGradN() const -> const Matrix9x12&;
-        void setGradN(Matrix9x12 gradN);
-
-        auto getMechanicalState() const -> const MechanicalState;
-        void setMechanicalState(MechanicalState newState);
-
-        auto getPrevStress() const -> const Vec9&;
-        void setPrevStress(Vec9 newStress);
-
-        auto getWeights() const -> const Vec3&;
-        void setWeights(Vec3 weights);
-
-        auto getCoord() const -> const Vec3&;
-        void setCoord(Vec3 coord);
-
-        auto getBackStress() const -> const Vec9&;
-        void setBackStress(Vec9 backStress);
-
-        auto getYieldStress() const ->const Real;
-        void setYieldStress(Real yieldStress);
-
-        auto getPlasticStrain() const -> const Vec9&;
-        void setPlasticStrain(Vec9 plasticStrain);
-
-        auto getEffectivePlasticStrain() const ->const Real;
-        void setEffectivePlasticStrain(Real effectivePlasticStrain);
-
-    protected:
-        Vec3 m_coordinates;
-        Vec3 m_weights;
-
-        Matrix3x12 m_Nx; /// Shape functions value for the Gauss point (matrix form)
-        Matrix9x12 m_gradN; /// Small strain hypothesis deformation gradient, applied to the beam shape functions (matrix form)
-        Matrix6x12 m_gradNVoigt; /// Same in Voigt notation
-        MechanicalState m_mechanicalState; /// State of the Gauss point deformation (elastic, plastic, or postplastic)
-        Vec9 m_prevStress; /// Value of the stress tensor at previous time step
-        Vec9 m_backStress; /// Centre of the yield surface, in stress space
-        Real m_yieldStress; /// Elastic limit, varying if plastic deformation occurs
-
-        //Plasticity history variables
-        Vec9 m_plasticStrain;
-        Real m_effectivePlasticStrain;
-    };
-
-    ///<3 Real intervals [a1,b1], [a2,b2] and [a3,b3], for 3D reduced integration
-    class Interval3
-    {
-    public:
-        //By default, integration is considered over [-1,1]*[-1,1]*[-1,1].
-        Interval3();
-        Interval3(Real a1, Real b1, Real a2, Real b2, Real a3, Real b3);
-        ~Interval3() {}
-
-        auto geta1() const->Real;
-        auto getb1() const->Real;
-        auto geta2() const->Real;
-        auto getb2() const->Real;
-        auto geta3() const->Real;
-        auto getb3() const->Real;
-
-    protected:
-        Real m_a1, m_b1, m_a2, m_b2, m_a3, m_b3;
-    };
-
 protected:
 
     /**
@@ -196,23 +148,10 @@ protected:
      */
     struct BeamInfo
     {
-        /*********************************************************************/
-        /*                     Virtual Displacement method                   */
-        /*********************************************************************/
-
-        /// Precomputed stiffness matrix, used for elastic deformation.
-        Matrix12x12 _Ke_loc;
-        /**
-         * Linearised stiffness matrix (tangent stiffness), updated at each time
-         * step for plastic deformation.
-         */
-        Matrix12x12 _Kt_loc;
-
-        /**
-         * Generalised Hooke's law (4th order tensor connecting strain and stress,
-         * expressed in Voigt notation)
-         */
-        Matrix6x6 _materialBehaviour;
+        /// Index of the beam element material, in the material table (m_materials)
+        unsigned int _materialIndex = 0;
+        /// Index of the beam element cross-section, in the section table (m_sections)
+        unsigned int _sectionIndex = 0;
 
         /**
          * \brief Integration ranges for Gaussian reduced integration.
@@ -224,12 +163,11 @@ protected:
          */
         ozp::quadrature::detail::Interval<3> _integrationInterval;
 
-        /// Shape function matrices, evaluated in each Gauss point used in reduced integration.
-        Vec<27, Matrix3x12> _N;
         // TO DO : define the "27" constant properly ! static const ? ifdef global definition ?
 
-        /// Derivatives of the shape function matrices in _N, also evaluated in each Gauss point
-        Vec<27, Matrix6x12> _BeMatrices;
+        /// Derivatives of the shape function matrices (see computeGaussPointShapeFunctions),
+        /// evaluated in each Gauss point used in reduced integration
+        Vec<27, StorageMatrix6x12> _BeMatrices;
 
         /// Mechanical states (elastic, plastic, or postplastic) of all gauss points in the beam element.
         Vec<27, MechanicalState> _pointMechanicalState;
@@ -244,48 +182,104 @@ protected:
 
         //---------- Plastic variables ----------//
 
+        /// Stress tensors (in Voigt notation) at each Gauss point, computed at the previous time step.
+        /// These stresses are required for the iterative radial return algorithm if plasticity is detected.
+        Vec<27, StorageVoigtTensor2> _prevStresses;
         /// History of plastic strain, one tensor for each Gauss point in the element.
-        Vec<27, VoigtTensor2> _plasticStrainHistory;
+        Vec<27, StorageVoigtTensor2> _plasticStrainHistory;
         /**
          * Effective plastic strain, for each Gauss point in the element.
          * The effective plastic strain is only used to compute the tangent
          * modulus if it is not constant.
          */
-        Vec<27, Real> _effectivePlasticStrains;
+        Vec<27, StorageReal> _effectivePlasticStrains;
 
         /// Tensor representing the yield surface centre, one for each Gauss point in the element.
-        Vec<27, VoigtTensor2> _backStresses;
+        Vec<27, StorageVoigtTensor2> _backStresses;
         /// Yield threshold, one for each Gauss point in the element.
-        Vec<27, Real> _localYieldStresses;
+        Vec<27, StorageReal> _localYieldStresses;
+        /// Plastic multiplier of the last plastic correction, one for each Gauss point
+        /// in the element. Used as initial guess of the local Newton iterations.
+        Vec<27, StorageReal> _plasticMultipliers;
+
+        /// Internal forces of the last force computation, in the local frame.
+        /// Used by the batched elastic kernel, as the starting point of the force increment.
+        Vec12 _internalForces;
 
-        //---------- Visualisation ----------//
+        /// Elastic strain energy of the element, at the last force computation
+        Real _elasticEnergy = 0;
+        /// Plastic work sigma:d(epsilon_p) of the element, accumulated since the undeformed state
+        Real _plasticDissipation = 0;
 
-        /// Number of interpolation segments to visualise the centreline of the beam element
-        sofa::Size _nbCentrelineSeg = 10;
+        /// Local displacement of the last force computation, reused to draw the element
+        Vec12 _currentDisp;
 
-        /// Precomputation of the shape functions matrices for each centreline point coordinates.
-        Vec<9, Matrix3x12> _drawN; //TO DO: allow parameterisation of the number of segments
-                                     //       which discretise the centreline (here : 10)
-                                     // NB: we use 9 shape functions because extremity points are known
+        /// Bounds of the highest squared eigenfrequency of the element (see
+        /// d_criticalTimeStep), with the elastic stiffness matrix, and with the
+        /// current one (the tangent stiffness matrix while the element is plastic)
+        Real _elasticMaxEigenvalue = 0;
+        Real _maxEigenvalue = 0;
 
         /*********************************************************************/
 
-        double _E; ///< Young Modulus
-        double _nu; ///< Poisson ratio
-        double _L; ///< Length of the beam element
-        double _zDim; ///< for rectangular beams: dimension of the cross-section along the local z axis
-        double _yDim; ///< for rectangular beams: dimension of the cross-section along the local y axis
-        double _G; ///< Shear modulus
-        double _Iy; ///< 2nd moment of area with regard to the y axis, for a rectangular beam section
-        double _Iz; ///< 2nd moment of area with regard to the z axis, for a rectangular beam section
-        double _J; ///< Polar moment of inertia (J = Iy + Iz)
-        double _A; ///< Cross-sectional area
-        Matrix12x12 _k_loc; ///< Precomputed stiffness matrix, used only for elastic deformation if d_usePrecomputedStiffness = true
+        Real _E; ///< Young Modulus
+        Real _nu; ///< Poisson ratio
+        Real _L; ///< Length of the beam element
+        Real _zDim; ///< for rectangular beams: dimension of the cross-section along the local z axis
+        Real _yDim; ///< for rectangular beams: dimension of the cross-section along the local y axis
+        Real _G; ///< Shear modulus
+        Real _Iy; ///< 2nd moment of area with regard to the y axis, for a rectangular beam section
+        Real _Iz; ///< 2nd moment of area with regard to the z axis, for a rectangular beam section
+        Real _J; ///< Polar moment of inertia (J = Iy + Iz)
+        Real _A; ///< Cross-sectional area
 
-        sofa::type::Quat<SReal> quat;
+        /*********************************************************************/
+        /*                     Virtual Displacement method                   */
+        /*********************************************************************/
+
+        // The members below are not used by the force computation of the
+        // explicit mode (see d_explicitMode). They are only declared after its
+        // working set, so that the working set spans a contiguous range of
+        // memory: the layout is otherwise the same in all the modes, and no
+        // member is split out of BeamInfo.
+
+        /// Precomputed stiffness matrix, used for elastic deformation.
+        Matrix12x12 _Ke_loc;
+        /**
+         * Linearised stiffness matrix (tangent stiffness), updated at each time
+         * step for plastic deformation.
+         */
+        Matrix12x12 _Kt_loc;
+        Matrix12x12 _k_loc; ///< Precomputed stiffness matrix, used only for elastic deformation if d_usePrecomputedStiffness = true
 
-        /// Initialisation of BeamInfo members from constructor parameters
-        void init(double E, double yS, double L, double nu, double zSection, double ySection, bool isTimoshenko);
+        /// Stress tensors corresponding to the elastic prediction step of the radial return algorithm.
+        /// These are only used for the update of the tangent stiffness matrix, with d_useConsistentTangentOperator
+        Vec<27, StorageVoigtTensor2> _elasticPredictors;
+
+        /// Orientation of the element at the last force computation, used by the stiffness methods
+        sofa::type::Quat<Real> quat;
+
+        /// Diagonal of the lumped mass matrix of the element, in the local frame
+        Vec12 _lumpedMass;
+
+        /// Initialisation of BeamInfo members from constructor parameters.
+        /// If computeMatrices is false, only the section and material properties
+        /// are set, the Gauss point matrices being loaded from a cache.
+        void init(Real E, Real yS, Real L, Real nu, Real zSection, Real ySection, bool isTimoshenko, bool computeMatrices = true);
+        /// Resets the plasticity history and mechanical states to the undeformed state
+        void resetPlasticHistory(Real yS);
+
+        /// Shear deformation coefficients of the Timoshenko model
+        void computeShearCoefficients(Real& phiY, Real& phiZ) const;
+        /// Shape function matrix at a point given in the element local frame at
+        /// rest (origin at the first node, x axis along the element)
+        void computeShapeFunction(const Vec3& localPosition, bool isTimoshenko, Matrix3x12& N) const;
+        /// Shape function matrices, evaluated in each Gauss point. Only used for
+        /// the visualisation, hence not stored in BeamInfo.
+        void computeGaussPointShapeFunctions(Vec<27, Matrix3x12>& shapeFunctions, bool isTimoshenko) const;
+        /// Shape function matrices of the nbSegments - 1 inner points of the centreline,
+        /// regularly spaced (the extremity points being the nodes)
+        void computeCentrelineShapeFunctions(Matrix3x12* shapeFunctions, sofa::Size nbSegments, bool isTimoshenko) const;
 
         /// Output stream
         inline friend std::ostream& operator<< ( std::ostream& os, const BeamInfo& bi )
@@ -328,18 +322,52 @@ protected:
 
     sofa::core::topology::EdgeData<sofa::type::vector<BeamInfo> > m_beamsData;
 
+    /**
+     * Entry of the material table. The Hooke's law matrix and the 1D constitutive
+     * law are stored once per material, and shared by all the beam elements
+     * referring to this entry through BeamInfo::_materialIndex.
+     */
+    struct MaterialInfo
+    {
+        Real _E; ///< Young Modulus
+        Real _nu; ///< Poisson ratio
+        Real _yieldStress; ///< Initial yield stress
+
+        /**
+         * Generalised Hooke's law (4th order tensor connecting strain and stress,
+         * expressed in Voigt notation)
+         */
+        Matrix6x6 _materialBehaviour;
+
+        /// 1D constitutive law. Can be shared between materials (e.g. a single tabulated curve).
+        std::shared_ptr<constitutivelaw::PlasticConstitutiveLaw<DataTypes>> _constitutiveLaw;
+    };
+
+    sofa::type::vector<MaterialInfo> m_materials;
+    sofa::type::vector<Vec<2, Real>> m_sections; ///< (zSection, ySection) of each section table entry
+
+    /// (youngModulus, poissonRatio, initialYieldStress) of each material. If empty,
+    /// a single material is defined by the corresponding scalar fields.
+    Data<sofa::type::vector<Vec<3, Real>>> d_materials;
+    /// (zSection, ySection) of each cross-section. If empty, a single section is
+    /// defined by the corresponding scalar fields.
+    Data<sofa::type::vector<Vec<2, Real>>> d_sections;
+    /// Index in d_materials of each beam element. If empty, all elements use the first material.
+    Data<sofa::type::vector<unsigned int>> d_materialIndices;
+    /// Index in d_sections of each beam element. If empty, all elements use the first section.
+    Data<sofa::type::vector<unsigned int>> d_sectionIndices;
+
+    /// Builds the material and section tables, including the constitutive laws
+    bool initMaterialTables();
+    /// Checks that a per-element index vector is empty or valid for a table of the given size
+    bool checkTableIndices(const sofa::type::vector<unsigned int>& indices, std::size_t tableSize, const std::string& dataName);
+
     virtual void reset() override;
 
     /**************************************************************************/
     /*                     Virtual Displacement Method                        */
     /**************************************************************************/
 
-public:
-
-    typedef Vec<27, GaussPoint3> beamGaussPoints;
-
-protected:
-
     // Rather than computing the elastic stiffness matrix _Ke_loc by Gaussian
     // reduced integration, we can use a precomputed form, as the matrix remains
     // constant during deformation. The precomputed form _k_loc can be found in
@@ -363,27 +391,32 @@ protected:
      */
     Data<bool> d_useConsistentTangentOperator;
 
+    /**
+     * Explicit dynamics only require the internal forces. In this mode, the
+     * tangent stiffness matrices, the elastic predictors of the consistent
+     * tangent operator and the element orientations used by the stiffness
+     * methods are not maintained, and the local displacement of the previous
+     * step is reused instead of being recomputed. addDForce and addKToMatrix
+     * are then unavailable, which rules out implicit solvers.
+     */
+    Data<bool> d_explicitMode;
+    /// Set once the unavailable stiffness has been reported, to avoid flooding the log
+    bool m_explicitModeStiffnessReported = false;
+    /// Returns false, and reports it once, if the stiffness is not maintained (explicit mode)
+    bool checkStiffnessAvailable();
+
     /**
      * Computes the elastic stiffness matrix _Ke_loc using reduced intergation.
      * The alternative is a precomputation of the elastic stiffness matrix, which is
      * possible for beam elements. The corresponding matrix _k_loc is close of the
      * reduced integration matrix _Ke_loc.
      */
-    void computeVDStiffness(int i, Index a, Index b);
-    /// Computes the generalised Hooke's law matrix.
-    void computeMaterialBehaviour(int i, Index a, Index b);
-
-     /// Used to store stress tensor information (in Voigt notation) for each of the 27 points of integration.
-    typedef Vec<27, VoigtTensor2> gaussPointStresses;
-    /// Stress tensors fo each Gauss point in every beam element, computed at the previous time step.
-    /// These stresses are required for the iterative radial return algorithm if plasticity is detected.
-    sofa::type::vector<gaussPointStresses> m_prevStresses;
-    /// Stress tensors corresponding to the elastic prediction step of the radial return algorithm.
-    /// These are stored for the update of the tangent stiffness matrix
-    sofa::type::vector<gaussPointStresses> m_elasticPredictors;
+    void computeVDStiffness(BeamInfo& beam);
+    /// Computes the generalised Hooke's law matrix of a material table entry.
+    void computeMaterialBehaviour(MaterialInfo& material);
 
     /// Position at the last time step, to handle increments for the plasticity resolution
-    VecCoord m_lastPos;
+    sofa::core::topology::PointData<VecCoord> m_lastPos;
 
     /**
      * Indicates if the plasticity model is perfect plasticity, or if hardening
@@ -392,123 +425,225 @@ protected:
      * and kinematic hardening, as described in :
      * Theoretical foundation for large scale computations for nonlinear material
      * behaviour, Hugues(et al) 1984.
+     * The hardening curve is given by the 1D constitutive law (see below), the
+     * plastic multiplier being computed with local Newton iterations.
      */
     Data<bool> d_isPerfectlyPlastic;
 
     //---------- Plastic modulus ----------//
     /**
      * 1D Contitutive law model, which is in charge of computing the
-     * plastic modulus during plastic deformation.
-     * The constitutive law is used to retrieve a non-constant plastic
-     * modulus, with computePlasticModulusFromStress or
-     * computePlasticModulusFromStress, but the computeConstPlasticModulus
-     * method can be used instead.
+     * plastic modulus during plastic deformation. One instance is created
+     * for each entry of the material table (see MaterialInfo).
+     * The constitutive law is used to retrieve the hardening curve and the
+     * non-constant plastic modulus, with computeHardeningStress and
+     * computePlasticModulusFromStrain. The computeConstPlasticModulus method
+     * is only used as a fallback, if no valid model is set.
      */
-    std::unique_ptr<constitutivelaw::PlasticConstitutiveLaw<DataTypes>> m_ConstitutiveLaw;
+    typedef constitutivelaw::PlasticConstitutiveLaw<DataTypes> ConstitutiveLawType;
     Data<std::string> d_modelName; ///< name of the model, for specialisation
 
-    double computePlasticModulusFromStress(const VoigtTensor2& stressState);
-    double computePlasticModulusFromStrain(int index, int gaussPointId);
-    static double computeConstPlasticModulus();
+    /// (effective plastic strain, effective stress) samples of the hardening
+    /// curve, used by the Tabulated model. Overridden by d_hardeningCurveFile if set.
+    Data<sofa::type::vector<Vec<2, Real>>> d_hardeningCurve;
+    sofa::core::objectmodel::DataFileName d_hardeningCurveFile;
+    Data<unsigned int> d_hardeningTableSize; ///< number of cells of the resampled hardening curve
+
+    /// Reads (effective plastic strain, effective stress) pairs from a text file,
+    /// one pair per line. Empty lines and lines starting with '#' are ignored.
+    bool readHardeningCurve(const std::string& filename, sofa::type::vector<Vec<2, Real>>& samples);
+
+    //---------- Local Newton iterations ----------//
+    /// Maximum number of local Newton iterations on the plastic multiplier, for each Gauss point
+    Data<unsigned int> d_maxLocalNewtonIterations;
+    /// Tolerance on the consistency condition residual, relative to the yield stress
+    Data<Real> d_localNewtonTolerance;
+
+    /// Statistics over the last call to addForce (read-only)
+    Data<unsigned int> d_nbLocalNewtonSolves; ///< number of plastic corrections
+    Data<unsigned int> d_nbLocalNewtonIterations; ///< total number of local Newton iterations
+    Data<unsigned int> d_maxLocalNewtonIterationCount; ///< highest number of iterations for a single Gauss point
+    Data<unsigned int> d_nbLocalNewtonFailures; ///< number of plastic corrections which reached the iteration cap
+
+    /// Local Newton statistics, accumulated separately by each chunk of elements
+    /// processed in parallel, and merged at the end of addForce.
+    struct LocalNewtonStatistics
+    {
+        unsigned int nbSolves = 0;
+        unsigned int nbIterations = 0;
+        unsigned int maxIterationCount = 0;
+        unsigned int nbFailures = 0;
+    };
+    sofa::type::vector<LocalNewtonStatistics> m_localNewtonStatistics; ///< one entry per chunk of elements
+
+    //---------- Plasticity activity ----------//
+    /// Counters over the last call to addForce (read-only). A beam element is
+    /// elastic if none of its Gauss points has ever been plastic, plastic if one
+    /// of them is plastic in the last call, and post-plastic otherwise.
+    Data<unsigned int> d_nbElasticBeams;
+    Data<unsigned int> d_nbPlasticBeams;
+    Data<unsigned int> d_nbPostPlasticBeams;
+    Data<unsigned int> d_nbElasticGaussPoints;
+    Data<unsigned int> d_nbPlasticGaussPoints;
+    Data<unsigned int> d_nbPostPlasticGaussPoints;
+    Data<unsigned int> d_nbReturnMappings; ///< Gauss point stress updates by the return mapping (elements not computed by the batched kernel)
+    Data<unsigned int> d_nbTangentUpdates; ///< number of tangent stiffness matrices recomputed
+    Data<Real> d_maxEffectivePlasticStrain; ///< highest effective plastic strain over all Gauss points
+
+    /**
+     * Energy accounting, integrated over the Gauss points during the stress
+     * updates of addForce. The plastic dissipation is the plastic work
+     * sigma:d(epsilon_p) accumulated since the undeformed state (or the last
+     * reset); with hardening, it also includes the energy stored by the
+     * hardening of the material. The totals are updated by addForce, the
+     * energies of each element at the end of the time step.
+     */
+    Data<Real> d_elasticEnergy; ///< elastic strain energy of all the elements (read-only)
+    Data<Real> d_plasticDissipation; ///< plastic work of all the elements (read-only)
+    Data<sofa::type::vector<Real>> d_beamElasticEnergies; ///< elastic strain energy of each element (read-only)
+    Data<sofa::type::vector<Real>> d_beamPlasticDissipations; ///< plastic work of each element (read-only)
+
+    /// Energies summed separately by each chunk of elements processed in
+    /// parallel (on separate cache lines), and merged at the end of addForce.
+    struct alignas(64) ChunkEnergies
+    {
+        Real elasticEnergy = 0;
+        Real plasticDissipation = 0;
+    };
+    sofa::type::vector<ChunkEnergies> m_chunkEnergies; ///< one entry per chunk of elements
+
+    /// Set by addForce: the energies of each element are only copied to
+    /// d_beamElasticEnergies and d_beamPlasticDissipations at the end of the time step
+    bool m_beamEnergiesOutdated = false;
+
+    /// Adds the energies of a beam element, after its force computation, to those of its chunk
+    void accumulateEnergies(const BeamInfo& beam, unsigned int chunk);
+    /// Sums the energies of all the elements, and publishes those of each element
+    void publishEnergies();
+    void publishChunkEnergies();
+    void publishBeamEnergies();
+
+    /// Elastic strain energy density 1/2 sigma:C^-1:sigma of an isotropic material
+    static Real elasticEnergyDensity(const VoigtTensor2& stress, Real E, Real nu);
+
+    /**
+     * Stable time step of explicit (central difference) time integration,
+     * 2 / omega_max. The highest eigenfrequency omega_max of the whole beam is
+     * bounded by the highest eigenfrequency of the elements, when each element
+     * is given its share of the lumped nodal masses. For each element, this
+     * frequency is bounded with the Gershgorin theorem applied to
+     * M^-1/2 K M^-1/2, K being the elastic stiffness matrix, or the tangent
+     * one while the element is plastic. The bound is updated with the tangent
+     * stiffness matrix.
+     * The nodal masses are read from l_mass if it is set, and computed from
+     * d_massDensity otherwise. Without mass, the critical time step is 0.
+     */
+    Data<Real> d_massDensity;
+    sofa::SingleLink<BeamPlasticFEMForceField<DataTypes>, sofa::core::behavior::BaseMass, sofa::BaseLink::FLAG_STOREPATH | sofa::BaseLink::FLAG_STRONGLINK> l_mass;
+    Data<Real> d_criticalTimeStep; ///< (read-only)
+    Data<unsigned int> d_criticalElement; ///< element with the smallest critical time step (read-only)
+
+    /// Set when the elements, the masses or the tangent stiffness matrices
+    /// change outside of the force computation
+    bool m_lumpedMassesOutdated = true;
+
+    /// Element with the highest eigenvalue bound of each chunk of elements
+    /// processed in parallel (on separate cache lines), merged at the end of addForce.
+    struct alignas(64) ChunkCriticalElement
+    {
+        Real maxEigenvalue = 0;
+        unsigned int element = 0;
+    };
+    sofa::type::vector<ChunkCriticalElement> m_chunkCriticalElements; ///< one entry per chunk of elements
+
+    /// Computes the lumped masses and the eigenfrequency bounds of all the elements
+    void updateLumpedMasses();
+    /// Searches all the elements for the critical one
+    void publishCriticalTimeStep();
+    /// Compares the eigenvalue bound of the element i, after its force
+    /// computation, with the highest one of its chunk
+    void accumulateCriticalElement(const BeamInfo& beam, unsigned int i, unsigned int chunk);
+    void publishChunkCriticalTimeStep();
+    /// Gershgorin bound of the highest eigenvalue of M^-1/2 K M^-1/2, M being
+    /// the diagonal lumped mass matrix. A zero mass matrix gives 0.
+    static Real computeMaxEigenvalueBound(const Matrix12x12& K, const Vec12& lumpedMass);
+
+    /// Plasticity activity, accumulated separately by each chunk of elements
+    /// processed in parallel (on separate cache lines), and merged at the end of addForce.
+    struct alignas(64) PlasticityActivity
+    {
+        unsigned int nbBeams[3] = {}; ///< indexed by MechanicalState
+        unsigned int nbGaussPoints[3] = {}; ///< indexed by MechanicalState
+        unsigned int nbReturnMappings = 0;
+        unsigned int nbTangentUpdates = 0;
+        Real maxEffectivePlasticStrain = 0;
+    };
+    sofa::type::vector<PlasticityActivity> m_plasticityActivity; ///< one entry per chunk of elements
+
+    void publishPlasticityActivity();
+
+    /**
+     * Solves the consistency condition of the radial return with nonlinear
+     * hardening for the plastic multiplier (i.e. the effective plastic strain
+     * increment), using Newton iterations safeguarded by bisection.
+     * \param law constitutive law of the beam element material
+     * \param xiTrialNorm norm of the deviatoric shifted trial stress
+     * \param yieldStress yield stress at the beginning of the step
+     * \param effPlasticStrain effective plastic strain at the beginning of the step
+     * \param mu shear modulus
+     * \param initialGuess plastic multiplier of the previous plastic correction
+     * \param hardeningIncrement increment of the hardening curve stress over the step
+     * \param statistics local Newton statistics of the calling chunk of elements
+     */
+    double computePlasticMultiplier(ConstitutiveLawType* law, const double xiTrialNorm, const double yieldStress,
+                                    const double effPlasticStrain, const double mu, const double initialGuess,
+                                    double& hardeningIncrement, LocalNewtonStatistics& statistics);
+
+    Real computeHardeningStress(ConstitutiveLawType* law, const Real effPlasticStrain);
+    Real computePlasticModulusFromStress(int index, const VoigtTensor2& stressState);
+    Real computePlasticModulusFromStrain(ConstitutiveLawType* law, const Real effPlasticStrain);
+    Real computePlasticModulusFromStrain(const BeamInfo& beam, int gaussPointId);
+    static Real computeConstPlasticModulus();
     //-------------------------------------//
 
     /// Tests if the stress tensor of a material point in an elastic state
     /// actually corresponds to plastic deformation.
-    bool goToPlastic(const VoigtTensor2 &stressTensor, const double yieldStress, const bool verbose=false);
+    bool goToPlastic(const VoigtTensor2 &stressTensor, const Real yieldStress, const bool verbose=false);
+
+    // NB: the element methods below only access the data of their own beam element,
+    // passed as a BeamInfo reference, so that they can be called concurrently on
+    // elements which do not share a node (see d_parallelStrategy).
 
     /// Computes local displacement of a beam element using the corotational model
-    void computeLocalDisplacement(const VecCoord& x, Vec12 &localDisp, int i, Index a, Index b);
+    void computeLocalDisplacement(const VecCoord& x, const VecCoord& x0, Vec12 &localDisp, BeamInfo& beam, Index a, Index b);
     /// Computes a displacement increment between to positions of a beam element (with respect to its local frame)
-    void computeDisplacementIncrement(const VecCoord& pos, const VecCoord& lastPos, Vec12 &currentDisp, Vec12 &lastDisp,
-                                      Vec12 &dispIncrement, int i, Index a, Index b);
+    void computeDisplacementIncrement(const VecCoord& pos, const VecCoord& lastPos, const VecCoord& x0, Vec12 &currentDisp,
+                                      Vec12 &lastDisp, Vec12 &dispIncrement, BeamInfo& beam, Index a, Index b);
 
     //---------- Force computation ----------//
 
     /// Force computation and tangent stiffness matrix update for perfect plasticity
-    void computeForceWithPerfectPlasticity(Matrix12x1& internalForces, const VecCoord& x, int index, Index a, Index b);
+    void computeForceWithPerfectPlasticity(Matrix12x1& internalForces, const VecCoord& x, const VecCoord& x0,
+                                           BeamInfo& beam, Index a, Index b, unsigned int chunk);
 
     /// Stress increment computation for perfect plasticity, based on the radial return algorithm
-    void computePerfectPlasticStressIncrement(int index, int gaussPointIt, const VoigtTensor2& lastStress, VoigtTensor2& newStressPoint,
-                                              const VoigtTensor2& strainIncrement, MechanicalState& pointMechanicalState);
+    void computePerfectPlasticStressIncrement(BeamInfo& beam, int gaussPointIt, const VoigtTensor2& lastStress,
+                                              VoigtTensor2& newStressPoint, const VoigtTensor2& strainIncrement,
+                                              MechanicalState& pointMechanicalState);
 
     /// Force computation and tangent stiffness matrix update for linear mixed (isotropic and kinematic) hardening
-    void computeForceWithHardening(Matrix12x1& internalForces, const VecCoord& x, int index, Index a, Index b);
+    void computeForceWithHardening(Matrix12x1& internalForces, const VecCoord& x, const VecCoord& x0,
+                                   BeamInfo& beam, Index a, Index b, LocalNewtonStatistics& statistics,
+                                   unsigned int chunk);
 
     /// Stress increment computation for linear mixed (isotropic and kinematic) hardening, based on the radial return algorithm
-    void computeHardeningStressIncrement(int index, int gaussPointIt, const VoigtTensor2 &lastStress, VoigtTensor2 &newStressPoint,
-                                         const VoigtTensor2 &strainIncrement, MechanicalState &pointMechanicalState);
+    void computeHardeningStressIncrement(BeamInfo& beam, int gaussPointIt, const VoigtTensor2 &lastStress,
+                                         VoigtTensor2 &newStressPoint, const VoigtTensor2 &strainIncrement,
+                                         MechanicalState &pointMechanicalState, LocalNewtonStatistics& statistics);
 
     //---------------------------------------//
 
 
-    //---------- Gaussian integration ----------//
-
-    /**
-     * Vector containing a set of integration Gauss points for each beam element.
-     * These Gauss points contain both the necessary coordinates and weights for
-     * the gaussian quadrature method, and local mechanical information required
-     * for the plasticity computation (shape function matrix, yield stress,
-     * back stress, mechanical state, ...)
-     */
-    sofa::type::vector<beamGaussPoints> m_gaussPoints;
-    /**
-     * Vector containing a set of 3 intervals (Interval3) for each beam element,
-     * corresponding to the 3D integration intervals used in the Gaussian
-     * quadrature method.
-     */
-    sofa::type::vector<Interval3> m_integrationIntervals;
-
-    /// Initialises the integration intervals of a beam element, for the Gaussian quadrature method.
-    void initialiseInterval(int beam, sofa::type::vector<Interval3>& integrationIntervals);
-
-    /// Initialises the Gauss points of a beam element, based on its geometrical info.
-    void initialiseGaussPoints(int beam, sofa::type::vector<beamGaussPoints>& gaussPoints, const Interval3& integrationInterval);
-
-    /**
-     * Computes the matrix form of the beam shape functions, used to interpolate
-     * a continuous displacement inside the element from the nodes discrete
-     * displacement. A timoshenko beam model is used.
-     */
-    auto computeNx(Real x, Real y, Real z, Real L, Real A, Real Iy, Real Iz,
-                   Real E, Real nu, Real kappaY = 1.0, Real kappaZ = 1.0)->Matrix3x12;
-
-    /**
-     * Computes the derivative of the matrix form of the beam shape functions.
-     * The derivation implements the small strain hypothesis. A timoshenko beam
-     * model is used.
-     */
-    auto computeGradN(Real x, Real y, Real z, Real L, Real A, Real Iy, Real Iz,
-                      Real E, Real nu, Real kappaY = 1.0, Real kappaZ = 1.0)->Matrix9x12;
-
-    /**
-     * Auxiliary method to change the integration interval for Gaussian quadrature,
-     * if it differs from [-1, 1].
-     */
-    static double changeCoordinate(double x, double a, double b)
-    {
-        return 0.5 * ((b - a) * x + a + b);
-    }
-    /**
-     * Auxiliary method to change the integration weights for Gaussian quadrature,
-     * if the integration interval is not [-1, 1].
-     */
-    static double changeWeight(double w, double a, double b)
-    {
-        return 0.5 * (b - a) * w;
-    }
-
-    /**
-     * Generic implementation of a Gaussian quadrature. This method simply applies
-     * a lambda function to a provided set of Gauss points with precomputed weights
-     * and coordinates. The actual integration has to be implemented by the lambda
-     * function.
-     */
-    template <typename LambdaType>
-    static void integrateBeam(beamGaussPoints& gaussPoints, LambdaType integrationFun);
-
-    //------------------------------------------//
-
-
     //---------- Auxiliary methods for Voigt to vector notation conversion ----------//
 
     // TO DO :
@@ -533,46 +668,49 @@ protected:
     auto vectToVoigt4(const VectTensor4 &vectTensor) -> VoigtTensor4;
 
     // Special implementation for second-order tensor operations, with the Voigt notation.
-    static double voigtDotProduct(const VoigtTensor2& t1, const VoigtTensor2& t2);
-    double voigtTensorNorm(const VoigtTensor2& t);
+    static Real voigtDotProduct(const VoigtTensor2& t1, const VoigtTensor2& t2);
+    Real voigtTensorNorm(const VoigtTensor2& t);
     auto beTTensor2Mult(const Matrix12x6& BeT, const VoigtTensor2& T) -> Matrix12x1;
     auto beTCBeMult(const Matrix12x6& BeT, const VoigtTensor4& C,
-                    const double nu, const double E) -> Matrix12x12;
+                    const Real nu, const Real E) -> Matrix12x12;
     //-------------------------------------------------------------------------------//
 
     /// Computes the deviatoric stress from a tensor in Voigt notation
     auto deviatoricStress(const VoigtTensor2 &stressTensor) -> VoigtTensor2;
     /// Computes the equivalent stress from a tensor in Voigt notation
-    double equivalentStress(const VoigtTensor2 &stressTensor);
+    Real equivalentStress(const VoigtTensor2 &stressTensor);
     /// Evaluates the Von Mises yield function for given stress tensor (in Voigt notation) and yield stress
-    double vonMisesYield(const VoigtTensor2 &stressTensor, const double yieldStress);
+    Real vonMisesYield(const VoigtTensor2 &stressTensor, const Real yieldStress);
     /// Computes the Von Mises yield function gradient (in Voigt notation) at a given stress tensor (in Voigt notation)
     auto vonMisesGradient(const VoigtTensor2 &stressTensor) -> VoigtTensor2;
     /// Computes the Von Mises yield function hessian (in matrix notation) at a given stress tensor (in Voigt notation)
-    auto vonMisesHessian(const VoigtTensor2 &stressTensor, const double yieldStress) -> VectTensor4;
+    auto vonMisesHessian(const VoigtTensor2 &stressTensor, const Real yieldStress) -> VectTensor4;
 
     //----- Alternative expressions of the above functions with vector notations -----//
     /// Computes the equivalent stress from a tensor in vector notation
-    double vectEquivalentStress(const VectTensor2 &stressTensor);
+    Real vectEquivalentStress(const VectTensor2 &stressTensor);
     /// Evaluates the Von Mises yield function for given stress tensor (in vector notation) and yield stress
-    double vectVonMisesYield(const VectTensor2 &stressTensor, const double yieldStress);
+    Real vectVonMisesYield(const VectTensor2 &stressTensor, const Real yieldStress);
     /// Computes the Von Mises yield function gradient (in vector notation) at a given stress tensor (in vector notation)
     VectTensor2 vectVonMisesGradient(const VectTensor2 &stressTensor);
 
     //----- Alternative functions using the deviatoric stress expression -----//
     // TO DO : is deviatoric computation more efficient than direct computation ?
     /// Computes the equivalent stress from a tensor in Voigt notation, using the deviatoric stress
-    double devEquivalentStress(const VoigtTensor2& stressTensor);
+    Real devEquivalentStress(const VoigtTensor2& stressTensor);
     /// Evaluates the Von Mises yield function for given stress tensor (in Voigt notation), using the deviatoric stress
-    double devVonMisesYield(const VoigtTensor2& stressTensor, const double yieldStress);
+    Real devVonMisesYield(const VoigtTensor2& stressTensor, const Real yieldStress);
     /// Computes the Von Mises yield function gradient (in Voigt notation) at a given stress tensor (in Voigt notation),
     ///  using the deviatoric stress
     auto devVonMisesGradient(const VoigtTensor2& stressTensor) -> VoigtTensor2;
 
     //Methods called by addForce, addDForce and addKToMatrix when deforming plasticly
-    void accumulateNonLinearForce(VecDeriv& f, const VecCoord& x, int i, Index a, Index b);
-    void applyNonLinearStiffness(VecDeriv& df, const VecDeriv& dx, int i, Index a, Index b, double fact);
-    void updateTangentStiffness(int i, Index a, Index b);
+    void accumulateNonLinearForce(VecDeriv& f, const VecCoord& x, const VecCoord& x0, BeamInfo& beam,
+                                  Index a, Index b, LocalNewtonStatistics& statistics, unsigned int chunk);
+    /// Rotates the local internal forces of a beam element to the global frame, and adds them to f
+    void addElementForce(VecDeriv& f, const VecCoord& x, Index a, Index b, const Vec12& force);
+    void applyNonLinearStiffness(VecDeriv& df, const VecDeriv& dx, const BeamInfo& beam, Index a, Index b, double fact);
+    void updateTangentStiffness(BeamInfo& beam);
 
 
     /**********************************************************/
@@ -580,6 +718,322 @@ protected:
 
     const VecElement *m_indexedElements;
 
+    //---------- Element ordering ----------//
+    /**
+     * Ordering of the element loops of addForce, addDForce and addKToMatrix:
+     * "none" (topology order), "RCM" (reverse Cuthill-McKee on the node graph)
+     * or "Morton" (space-filling curve on the rest positions of the nodes).
+     * The nodes belong to the mechanical state and cannot be renumbered by the
+     * force field: the corresponding node renumbering is published in
+     * d_nodePermutation, so that it can be applied to the mesh beforehand to
+     * also reduce the bandwidth of the assembled matrix.
+     */
+    Data<std::string> d_elementOrdering;
+    Data<sofa::type::vector<unsigned int>> d_nodePermutation; ///< new index of each node, for the chosen ordering (read-only)
+
+    /// Element indices, in traversal order
+    sofa::type::vector<unsigned int> m_elementOrder;
+    /// Node indices of each element, in traversal order (contiguous copy of the topology edges)
+    VecElement m_orderedElements;
+
+    void computeElementOrdering();
+
+    //---------- Topological changes ----------//
+    /**
+     * All the element state is stored in m_beamsData, and the positions of the
+     * last time step in m_lastPos: both follow the topological changes (element
+     * additions, removals and renumbering), so that the history of the other
+     * elements is preserved. Added elements are initialised individually.
+     * The structures depending on the element numbering (ordering, coloring,
+     * batches) are updated before the next element loop: the unchanged elements
+     * keep their traversal position, color and batch lane, and the added ones
+     * (or moved by the renumbering) are appended to the traversal order, colored
+     * greedily and put in the free lanes of their color, or in new batches. Only
+     * their batch operators are computed. If more than MaxIncrementalUpdateRatio
+     * of the elements changed, the structures are rebuilt from scratch instead,
+     * which restores the ordering and compacts the colors and batches.
+     */
+    bool m_elementStructuresOutdated = false;
+    static constexpr double MaxIncrementalUpdateRatio = 0.25;
+
+    void initTopologyCallbacks();
+    /// Updates the element ordering, coloring and batches after topological changes
+    void updateElementStructures();
+    /// Incremental update, returns false if a full rebuild is needed
+    bool updateElementStructuresIncrementally();
+
+    //---------- Partial reinitialisation ----------//
+    /**
+     * Options the element structures were last built with. On reinit(), they
+     * are compared to the current Data values, and the element properties to
+     * the material and section tables, so that only the invalidated quantities
+     * are recomputed:
+     * - yield stress or hardening law: material tables and batch yield limits;
+     * - Young modulus: elastic stiffness matrices and batch operators;
+     * - Poisson ratio, section or rest length: all element matrices and batch operators;
+     * - element ordering or parallel strategy: ordering, coloring and batches.
+     * Changing the number of elements, the beam theory or the stiffness
+     * integration rebuilds everything. In all cases, the plastic history and
+     * the last positions are reset, as with a full reinitialisation: the
+     * stresses of the previous material would not be admissible with the new one.
+     */
+    struct ReinitSnapshot
+    {
+        bool valid = false;
+        std::size_t nbElements = 0;
+        bool isTimoshenko = false;
+        bool usePrecomputedStiffness = false;
+        bool isPerfectlyPlastic = false;
+        std::string elementOrdering;
+        std::string parallelStrategy;
+        std::string batchKernel;
+    };
+    ReinitSnapshot m_reinitSnapshot;
+
+    void takeReinitSnapshot();
+    /// Reinitialises the element properties from the material and section
+    /// tables, recomputing only the matrices invalidated by modified values.
+    /// Returns the number of elements whose matrices were recomputed.
+    std::size_t updateBeams();
+
+    //---------- Parallel element loops ----------//
+    /**
+     * Scatter strategy of the element loops of addForce and addDForce, in which
+     * beam elements sharing a node write to the same force entries:
+     * - "none": sequential loop;
+     * - "coloring": the elements are partitioned into colors, such that the
+     *   elements of one color do not share any node (greedy edge coloring).
+     *   The colors are processed one after the other, each of them in parallel,
+     *   writing directly to the force vector;
+     * - "threadBuffers": the elements are processed in parallel all at once,
+     *   each chunk of elements accumulating into its own force vector. The
+     *   buffers are summed afterwards.
+     * Coloring has no extra memory and reduction cost, but needs one
+     * synchronisation per color and degrades with high node valences. Thread
+     * buffers are usually faster for small meshes and highly connected nodes.
+     * The initialisation of the elements (reinitBeams) does not scatter into
+     * shared entries: it runs on the task scheduler whatever the strategy.
+     */
+    Data<std::string> d_parallelStrategy;
+    Data<unsigned int> d_nbColors; ///< number of colors of the element coloring (read-only)
+    Data<sofa::type::vector<unsigned int>> d_colorSizes; ///< number of elements of each color (read-only)
+
+    enum class ParallelStrategy { NONE, COLORING, THREAD_BUFFERS };
+    ParallelStrategy m_parallelStrategy;
+    sofa::simulation::TaskScheduler* m_taskScheduler;
+
+    /// Positions in the traversal order (m_elementOrder) of the elements, grouped by color
+    sofa::type::vector<unsigned int> m_coloredElements;
+    /// The elements of color c are m_coloredElements[m_colorOffsets[c]] to m_coloredElements[m_colorOffsets[c+1]-1]
+    sofa::type::vector<unsigned int> m_colorOffsets;
+    /// One force accumulation buffer per chunk of elements, for the "threadBuffers" strategy
+    sofa::type::vector<VecDeriv> m_threadBuffers;
+
+    void initParallelStrategy();
+    /// Greedy coloring of the elements, in traversal order. The elements with a color
+    /// in elementColors (by traversal position) keep it, the others (topology::NoColor)
+    /// take the smallest free one. All the elements are colored if elementColors is empty.
+    void computeElementColoring(std::vector<unsigned int> elementColors = std::vector<unsigned int>());
+    /// Number of chunks in which the element loops are split (1 if sequential)
+    unsigned int getNbChunks() const;
+    /// Number of chunks of the element initialisation, which only writes to the
+    /// data of each element: one per thread of the task scheduler, whatever the strategy
+    unsigned int getNbInitChunks() const;
+
+    /**
+     * Calls chunkFunction(chunk, begin, end) on each of the getNbChunks()
+     * contiguous chunks [begin, end) of [0, size), in parallel. The chunk index
+     * can be used to access per-chunk data without synchronisation.
+     */
+    template<class ChunkFunction>
+    void forEachChunk(std::size_t size, const ChunkFunction& chunkFunction);
+    /// Same as forEachChunk, on nbChunks chunks
+    template<class ChunkFunction>
+    void forEachChunk(unsigned int nbChunks, std::size_t size, const ChunkFunction& chunkFunction);
+
+    /**
+     * Applies itemFunction(item, output, chunk) to all items [0, groupOffsets.back()),
+     * with the scatter strategy of d_parallelStrategy. itemFunction has to add its
+     * contribution to the output vector it receives, which is either the given
+     * output vector or a per-chunk buffer.
+     * With the "coloring" strategy, the items of a group [groupOffsets[g], groupOffsets[g+1])
+     * must not share any node: the groups are processed one after the other, and
+     * the items of each group in parallel.
+     */
+    template<class ItemFunction>
+    void accumulateOverItems(const sofa::type::vector<unsigned int>& groupOffsets, VecDeriv& output,
+                             const ItemFunction& itemFunction);
+
+    /// accumulateOverItems on the elements, elementFunction receiving the position
+    /// of the element in the traversal order.
+    template<class ElementFunction>
+    void accumulateOverElements(VecDeriv& output, const ElementFunction& elementFunction);
+
+    //---------- Batched elastic kernel ----------//
+    /**
+     * Instruction set of the batched elastic kernel of addForce: "none" (element
+     * by element computation), "auto" (widest instruction set supported by the
+     * CPU), "scalar", "avx2" or "avx512".
+     * The kernel processes simd::BatchWidth beam elements in lock-step, computing
+     * the elastic predictor in all their Gauss points (see simd::ElasticBatchArguments).
+     * It is only used with hardening (isPerfectlyPlastic = false), for the beam
+     * elements whose Gauss points have never been plastic. The elements which
+     * yield during the step are computed again element by element: the kernel is
+     * intended for simulations in which most beam elements remain elastic.
+     * The kernel operators are precomputed for each beam element.
+     */
+    Data<std::string> d_batchKernel;
+    Data<unsigned int> d_nbBatchedElements; ///< number of elements computed by the batched kernel in the last addForce (read-only)
+
+    simd::ElasticBatchKernel m_elasticBatchKernel;
+    /// Traversal positions of the elements of each batch, -1 for the padding lanes
+    sofa::type::vector<int> m_batchElements;
+    /// The batches of group g are [m_batchOffsets[g], m_batchOffsets[g+1]), one group
+    /// per color with the "coloring" strategy (more after incremental topological changes)
+    sofa::type::vector<unsigned int> m_batchOffsets;
+    /// Color of the elements of each batch group, with the "coloring" strategy
+    sofa::type::vector<unsigned int> m_batchGroupColors;
+    /// Kernel operators of each batch, in SoA layout (see simd::ElasticBatchArguments)
+    sofa::type::vector<double> m_batchStressOperators;
+    sofa::type::vector<double> m_batchStiffness;
+    sofa::type::vector<double> m_batchSquaredYieldLimits;
+    sofa::type::vector<double> m_batchGaussWeights; ///< integration weights, for the elastic energy
+    sofa::type::vector<unsigned int> m_nbBatchedElementsPerChunk;
+
+    void initBatchKernel();
+    void computeBatchOperators(std::size_t batch, unsigned int lane, const BeamInfo& beam);
+    /// Zeroes the kernel operators of a lane, before it takes another element
+    void clearBatchLane(std::size_t batch, unsigned int lane);
+    /// Refreshes the yield limits of the batched elements only, after a change
+    /// of the yield stresses which leaves the other kernel operators valid
+    void updateBatchYieldLimits();
+    void accumulateElasticBatch(std::size_t batch, VecDeriv& f, const VecCoord& x, const VecCoord& x0,
+                                sofa::type::vector<BeamInfo>& beams, LocalNewtonStatistics& statistics,
+                                unsigned int& nbBatchedElements, unsigned int chunk);
+
+    //---------- Checkpoint ----------//
+    /**
+     * Binary checkpoint of the plastic state (see io/Checkpoint.h): Gauss point
+     * history of all beam elements (stresses, plastic strains, back stresses,
+     * yield stresses, mechanical states), tangent stiffness matrices, internal
+     * forces and positions at the last time step. Restarting from a checkpoint
+     * avoids simulating again a plastic deformation, e.g. the crimping of a stent.
+     */
+    sofa::core::objectmodel::DataFileName d_checkpointFile;
+    Data<bool> d_loadCheckpoint; ///< if true, the state is loaded from d_checkpointFile at init and reset
+    Data<bool> d_saveCheckpoint; ///< if set to true, the state is saved at the end of the time step, then the flag is cleared
+
+    //---------- Element cache ----------//
+    /**
+     * Optional cache file of the precomputed element matrices (see io/ElementCache.h).
+     * At init, if the file matches the element geometries and materials, the
+     * Gauss point matrices and elastic stiffness matrices are loaded from it
+     * instead of being integrated again. Otherwise, they are computed and the
+     * file is (re)written.
+     */
+    sofa::core::objectmodel::DataFileName d_elementCacheFile;
+
+    /// Hash of the parameters the element matrices are computed from
+    std::uint64_t computeElementCacheKey() const;
+    bool loadElementCache(const std::string& filename);
+    bool saveElementCache(const std::string& filename);
+
+    //---------- Phase timing ----------//
+    /**
+     * Optional timing of the phases of the force computations (see
+     * utils/PhaseTimer.h), enabled by d_timePhases. The times are summed over
+     * each time step and published at its end, in milliseconds. Corotation,
+     * stress update and tangent update are part of addForce, and are summed
+     * over the threads in the parallel loops.
+     * If d_timingTraceFile is set at init, the calls to addForce, addDForce and
+     * addKToMatrix and the per-step times are also written as a Chrome trace.
+     */
+    enum TimedPhase
+    {
+        COROTATION,
+        STRESS_UPDATE,
+        TANGENT_UPDATE,
+        ADD_FORCE,
+        ADD_DFORCE,
+        ADD_K_TO_MATRIX,
+        NB_TIMED_PHASES
+    };
+    typedef utils::PhaseTimer<NB_TIMED_PHASES> PhaseTimer;
+
+    Data<bool> d_timePhases;
+    sofa::core::objectmodel::DataFileName d_timingTraceFile;
+
+    /// Times of the last time step, in milliseconds (read-only)
+    Data<double> d_corotationTime; ///< corotational frames and local displacements
+    Data<double> d_stressUpdateTime; ///< Gauss point stresses and internal forces
+    Data<double> d_tangentUpdateTime; ///< tangent stiffness matrices of the plastic elements
+    Data<double> d_addForceTime;
+    Data<double> d_addDForceTime;
+    Data<double> d_addKToMatrixTime;
+
+    PhaseTimer m_phaseTimer;
+    std::unique_ptr<utils::ChromeTraceWriter> m_traceWriter;
+
+    /// Times a call to addForce, addDForce or addKToMatrix, which is also written to the trace file if any
+    class TopLevelPhaseScope
+    {
+    public:
+        TopLevelPhaseScope(BeamPlasticFEMForceField* forceField, TimedPhase phase);
+        ~TopLevelPhaseScope();
+
+    private:
+        BeamPlasticFEMForceField* m_forceField;
+        TimedPhase m_phase;
+        typename PhaseTimer::Scope m_scope;
+        typename PhaseTimer::Clock::time_point m_start;
+    };
+
+    static const char* getTimedPhaseName(TimedPhase phase);
+    /// Publishes the times of the time step in the Data outputs and the trace, then clears them
+    void publishPhaseTimes();
+
+    //---------- Displacement trace ----------//
+    /**
+     * Optional recording of the loading path (see io/DisplacementTrace.h): if
+     * d_displacementTraceFile is set at init, the positions passed to each call
+     * to addForce, and the resets, are appended to this file. The trace also
+     * holds the attributes of the component, the edges and the rest positions,
+     * so that the BeamPlasticTrace_replay driver can feed it through the force
+     * computations alone, without the rest of the scene.
+     */
+    sofa::core::objectmodel::DataFileName d_displacementTraceFile;
+
+    std::unique_ptr<io::DisplacementTraceWriter> m_displacementTrace;
+
+    void openDisplacementTrace(const std::string& filename);
+
+    //---------- Gauss point history ----------//
+    /**
+     * Optional sampling of the Gauss point history of selected elements, for
+     * long cyclic simulations (see io/GaussPointHistory.h): if d_historyFile is
+     * set at init, the plastic strains, stresses and effective plastic strains
+     * of the 27 Gauss points of the elements are saved at the end of every
+     * d_historySamplingInterval time steps. The files are written by a
+     * background thread: a snapshot is dropped, rather than blocking the
+     * simulation, if the writing falls behind.
+     */
+    sofa::core::objectmodel::DataFileName d_historyFile;
+    Data<sofa::type::vector<unsigned int>> d_historyElements; ///< recorded elements, all of them if empty
+    Data<unsigned int> d_historySamplingInterval; ///< number of time steps between two snapshots
+    Data<unsigned int> d_historyChunkSize; ///< number of snapshots per history file
+    Data<unsigned int> d_nbDroppedHistorySnapshots; ///< snapshots dropped because the writer thread was late (read-only)
+
+    /// Per Gauss point: plastic strain and stress tensors, and effective plastic strain
+    static constexpr std::size_t NbHistoryValuesPerElement = 27*(6 + 6 + 1);
+
+    std::unique_ptr<io::AsyncHistoryWriter<StorageReal>> m_historyWriter;
+    sofa::type::vector<unsigned int> m_historyElements;
+    std::uint64_t m_historyStep = 0;
+
+    void openHistory(const std::string& prefix);
+    void recordHistorySnapshot();
+    void closeHistory();
+
     Data<Real> d_poissonRatio;
     Data<Real> d_youngModulus;
     Data<Real> d_initialYieldStress;
@@ -599,7 +1053,7 @@ protected:
     // at the computation of the threshold in the init() method.
     Real m_stressComparisonThreshold;
 
-    sofa::type::Quat<SReal>& beamQuat(int i);
+    sofa::type::Quat<Real>& beamQuat(int i);
 
     BeamPlasticFEMForceField();
     BeamPlasticFEMForceField(Real poissonRatio, Real youngModulus, Real yieldStress, Real zSection, Real ySection, bool isTimoshenko, bool isPerfectlyPlastic);
@@ -609,37 +1063,172 @@ public:
     void init() override;
     void bwdInit() override;
     void reinit() override;
-    virtual void reinitBeam(unsigned int i);
+    virtual void reinitBeam(unsigned int i, bool computeMatrices = true);
+    /// Initialises all the beam elements, in parallel on the task scheduler
+    void reinitBeams(bool computeMatrices = true);
 
     void addForce(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv &  dataF, const DataVecCoord &  dataX , const DataVecDeriv & dataV ) override;
     void addDForce(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv&   datadF , const DataVecDeriv&   datadX ) override;
     void addKToMatrix(const sofa::core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix ) override;
 
-    // TO DO : necessary ?
+    /// Elastic strain energy of the configuration of the last addForce: the
+    /// energy is integrated with the stress updates, which depend on the
+    /// loading history, and is not recomputed for the given positions.
     SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord&  /* x */) const override
     {
-        msg_error() << "Get potentialEnergy not implemented";
-        return 0.0;
+        return d_elasticEnergy.getValue();
     }
 
+    void handleEvent(sofa::core::objectmodel::Event* event) override;
+
+    /// Writes the plastic state to a binary checkpoint file. Returns false on failure.
+    bool saveCheckpoint(const std::string& filename);
+    /// Restores the plastic state from a binary checkpoint file, written for the
+    /// same topology and precision. Returns false (and leaves the state
+    /// unchanged) if the file is invalid.
+    bool loadCheckpoint(const std::string& filename);
+
+    /**
+     * Zero-copy, read-only views of the Gauss point state, for post-processing:
+     * entry i is the contiguous array of the values of the 27 Gauss points of
+     * the beam element i, in the state of the last addForce. The views must
+     * not be used during addForce, and are invalidated by the topological
+     * changes (which may reallocate the element data).
+     */
+    template<class T>
+    using GaussPointView = utils::StridedArrayView<Vec<27, T>>;
+    GaussPointView<StorageVoigtTensor2> getGaussPointStresses() const { return makeBeamView(&BeamInfo::_prevStresses); }
+    GaussPointView<StorageVoigtTensor2> getGaussPointPlasticStrains() const { return makeBeamView(&BeamInfo::_plasticStrainHistory); }
+    GaussPointView<StorageVoigtTensor2> getGaussPointBackStresses() const { return makeBeamView(&BeamInfo::_backStresses); }
+    GaussPointView<StorageReal> getGaussPointEffectivePlasticStrains() const { return makeBeamView(&BeamInfo::_effectivePlasticStrains); }
+    GaussPointView<MechanicalState> getGaussPointStates() const { return makeBeamView(&BeamInfo::_pointMechanicalState); }
+
     void draw(const sofa::core::visual::VisualParams* vparams) override;
     void computeBBox(const sofa::core::ExecParams* params, bool onlyVisible) override;
 
-    void setBeam(unsigned int i, double E, double yS, double L, double nu, double zSection, double ySection);
+    void setBeam(unsigned int i, Real E, Real yS, Real L, Real nu, Real zSection, Real ySection, bool computeMatrices = true);
     void initBeams(size_t size);
 
+    /// Beam elements (pairs of node indices), available after init
+    const VecElement& getElements() const { return *m_indexedElements; }
+    /**
+     * Interpolation of the displacements inside the beam element i, e.g. for
+     * mappings: the displacement of a point is N*localDisp, where localDisp is
+     * the local displacement of the element (see computeLocalDisplacement) and
+     * localPosition the position of the point in the element local frame at rest.
+     */
+    void computeShapeFunction(unsigned int i, const Vec3& localPosition, Matrix3x12& N) const;
+    /// Displacement of the element (a, b) in the frame of its first node:
+    /// translation and rotation vector of b relative to a, minus their rest values
+    static void computeLocalDisplacement(const VecCoord& x, const VecCoord& x0, Vec12 &localDisp, Index a, Index b);
+
 protected:
 
-    void drawElement(int i, std::vector<Vec3> &gaussPoints,
-                     std::vector<Vec3> &centrelinePoints,
-                     std::vector<RGBAColor> &colours, const VecCoord& x);
+    /// Material and section table entries of the beam element i
+    void getTableIndices(unsigned int i, unsigned int& materialIndex, unsigned int& sectionIndex) const;
+    /// Initialisation of the beam element i, from the rest positions x0.
+    /// Only writes to beam, so that elements can be initialised concurrently.
+    void initBeam(unsigned int i, const Element& element, BeamInfo& beam, const VecCoord& x0, bool computeMatrices);
+
+    //---------- Visualisation ----------//
+    /**
+     * Level of detail of the visualisation, for large beam networks:
+     *   - the centreline of each element is drawn with d_drawCentrelineSegments segments;
+     *   - with d_drawPlasticGaussPointsOnly, the Gauss points of the fully
+     *     elastic elements are not drawn;
+     *   - an element whose length on screen is below d_drawLODPixelLength is
+     *     drawn as a single segment, coloured by its mechanical state.
+     * With d_headless, nothing is drawn: the shape functions of the
+     * visualisation and the draw buffers are never allocated.
+     */
+    Data<unsigned int> d_drawCentrelineSegments;
+    Data<bool> d_drawPlasticGaussPointsOnly;
+    Data<Real> d_drawLODPixelLength; ///< 0 to disable the colour-only mode
+    Data<bool> d_headless;
+
+    /**
+     * Persistent draw buffers, rebuilt only when the positions, the element
+     * data (e.g. the Gauss point states), the drawing options or the camera
+     * (with d_drawLODPixelLength) have changed since the last draw.
+     * The ranges of the elements in the buffers are computed first, then the
+     * elements fill their own ranges in parallel.
+     */
+    std::vector<sofa::type::Vec3> m_drawGaussPoints;
+    std::vector<RGBAColor> m_drawColours; ///< one per Gauss point
+    std::vector<sofa::type::Vec3> m_drawCentrelinePoints;
+    std::vector<sofa::type::Vec3> m_drawLODPoints; ///< ends of the elements drawn as a single segment
+    std::vector<RGBAColor> m_drawLODColours; ///< one per end
+
+    /// First index of each element in the draw buffers (one more entry than elements)
+    struct DrawOffsets
+    {
+        std::size_t gaussPoints = 0;
+        std::size_t centrelinePoints = 0;
+        std::size_t lodPoints = 0;
+    };
+    sofa::type::vector<DrawOffsets> m_drawOffsets;
 
-    void computeStiffness(int i, Index a, Index b);
+    /// State the draw buffers were built from
+    struct DrawCacheKey
+    {
+        int positionCounter = -1;
+        int beamsDataCounter = -1;
+        std::size_t nbElements = 0;
+        unsigned int nbCentrelineSegments = 0;
+        bool plasticGaussPointsOnly = false;
+        Real lodPixelLength = 0;
+        std::array<double, 16> viewProjection {}; ///< only with d_drawLODPixelLength
+        sofa::type::Vec<4, int> viewport;
+
+        bool operator==(const DrawCacheKey& other) const
+        {
+            return positionCounter == other.positionCounter && beamsDataCounter == other.beamsDataCounter
+                && nbElements == other.nbElements && nbCentrelineSegments == other.nbCentrelineSegments
+                && plasticGaussPointsOnly == other.plasticGaussPointsOnly && lodPixelLength == other.lodPixelLength
+                && viewProjection == other.viewProjection && viewport == other.viewport;
+        }
+    };
+    DrawCacheKey m_drawCacheKey;
+
+    /// True if the BeamInfo::_currentDisp are the local displacements of the
+    /// positions saved in m_lastPos, i.e. if addForce was called since the last
+    /// reset, reinit or element creation
+    bool m_hasForceDisplacements = false;
+
+    /// Shape functions of the visualisation, computed at the first draw which needs them
+    sofa::type::vector<Vec<27, Matrix3x12>> m_drawGaussPointShapeFunctions; ///< one entry per element
+    sofa::type::vector<Matrix3x12> m_drawCentrelineShapeFunctions; ///< nbCentrelineSegments - 1 per element
+    unsigned int m_drawNbCentrelineSegments = 0;
+    /// Set when the element geometries change
+    bool m_drawShapeFunctionsOutdated = true;
+
+    static RGBAColor getMechanicalStateColour(MechanicalState state);
+    /// Length of the segment [p1, p2] on screen, in pixels
+    static Real computeScreenLength(const std::array<double, 16>& viewProjection, const sofa::type::Vec<4, int>& viewport,
+                                    const Vec3& p1, const Vec3& p2);
+
+    void updateDrawBuffers(const sofa::core::visual::VisualParams* vparams);
+    /// Fills the ranges of the element i in the draw buffers. If useForceDisplacements
+    /// is set, x are the positions of the last addForce, and the local displacement
+    /// computed there is reused.
+    void drawElement(std::size_t i, const VecCoord& x, const VecCoord& x0, bool useForceDisplacements);
+
+    void computeStiffness(BeamInfo& beam);
+
+    template<class T>
+    utils::StridedArrayView<T> makeBeamView(T BeamInfo::* member) const
+    {
+        const sofa::type::vector<BeamInfo>& bd = m_beamsData.getValue();
+        if (bd.empty())
+            return {};
+        return { &(bd[0].*member), sizeof(BeamInfo), bd.size() };
+    }
 
 };
 
 #if !defined(BEAMPLASTIC_BEAMPLASTICFEMFORCEFIELD_CPP)
-extern template class BEAMPLASTIC_API BeamPlasticFEMForceField<sofa::defaulttype::Rigid3Types>;
+extern template class BEAMPLASTIC_API BeamPlasticFEMForceField<sofa::defaulttype::Rigid3dTypes>;
+extern template class BEAMPLASTIC_API BeamPlasticFEMForceField<sofa::defaulttype::Rigid3fTypes>;
 #endif
 
 } // namespace beamplastic::forcefield
@@ -24,8 +24,27 @@
 
 #include <sofa/core/topology/TopologyData.inl>
 #include <sofa/core/visual/VisualParams.h>
+#include <sofa/linearalgebra/FullMatrix.h>
 
 #include <BeamPlastic/constitutivelaw/RambergOsgood.h>
+#include <BeamPlastic/constitutivelaw/TabulatedConstitutiveLaw.h>
+#include <BeamPlastic/io/Checkpoint.h>
+#include <BeamPlastic/io/ElementCache.h>
+#include <BeamPlastic/topology/ElementColoring.h>
+#include <BeamPlastic/topology/ElementOrdering.h>
+
+#include <sofa/simulation/AnimateEndEvent.h>
+#include <sofa/simulation/MainTaskSchedulerFactory.h>
+#include <sofa/simulation/ParallelForEach.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <numeric>
 
 namespace beamplastic::forcefield
 {
@@ -33,17 +52,79 @@ namespace beamplastic::forcefield
 using namespace sofa;
 using core::objectmodel::BaseContext;
 using beamplastic::constitutivelaw::RambergOsgood;
+using beamplastic::constitutivelaw::TabulatedConstitutiveLaw;
 
 template<class DataTypes>
 BeamPlasticFEMForceField<DataTypes>::BeamPlasticFEMForceField()
     : m_beamsData(initData(&m_beamsData, "beamsData", "Internal element data"))
+    , d_materials(initData(&d_materials, "materials", "(youngModulus poissonRatio initialYieldStress) of each material of the material table. If empty, the scalar fields define a single material"))
+    , d_sections(initData(&d_sections, "sections", "(zSection ySection) of each cross-section of the section table. If empty, the scalar fields define a single section"))
+    , d_materialIndices(initData(&d_materialIndices, "materialIndices", "index in the material table of each beam element. If empty, the first material is used"))
+    , d_sectionIndices(initData(&d_sectionIndices, "sectionIndices", "index in the section table of each beam element. If empty, the first section is used"))
     , d_usePrecomputedStiffness(initData(&d_usePrecomputedStiffness, true, "usePrecomputedStiffness",
                                          "indicates if a precomputed elastic stiffness matrix is used, instead of being computed by reduced integration"))
     , d_useConsistentTangentOperator(initData(&d_useConsistentTangentOperator, false, "useConsistentTangentOperator",
                                               "indicates wether to use a consistent tangent operator in the computation of the plastic stiffness matrix"))
+    , d_explicitMode(initData(&d_explicitMode, false, "explicitMode",
+                              "if true, only the internal forces are computed (explicit dynamics): the tangent stiffness is not maintained and addDForce / addKToMatrix are unavailable"))
+    , m_lastPos(initData(&m_lastPos, "lastPositions", "Internal positions at the last time step"))
     , d_isPerfectlyPlastic(initData(&d_isPerfectlyPlastic, false, "isPerfectlyPlastic", "indicates wether the behaviour model is perfectly plastic"))
-    , d_modelName(initData(&d_modelName, std::string("RambergOsgood"), "modelName", "the name of the 1D contitutive law model to be used in plastic deformation"))
+    , d_modelName(initData(&d_modelName, std::string("RambergOsgood"), "modelName", "the name of the 1D contitutive law model to be used in plastic deformation (RambergOsgood or Tabulated)"))
+    , d_hardeningCurve(initData(&d_hardeningCurve, "hardeningCurve", "(effective plastic strain, effective stress) samples of the hardening curve, for the Tabulated model (shared by all materials)"))
+    , d_hardeningCurveFile(initData(&d_hardeningCurveFile, "hardeningCurveFile", "text file of (effective plastic strain, effective stress) samples, for the Tabulated model. Overrides hardeningCurve"))
+    , d_hardeningTableSize(initData(&d_hardeningTableSize, (unsigned int)1024, "hardeningTableSize", "number of cells of the uniformly resampled hardening curve, for the Tabulated model"))
+    , d_maxLocalNewtonIterations(initData(&d_maxLocalNewtonIterations, (unsigned int)20, "maxLocalNewtonIterations", "maximum number of Newton iterations on the plastic multiplier, for each Gauss point"))
+    , d_localNewtonTolerance(initData(&d_localNewtonTolerance, (Real)1e-10, "localNewtonTolerance", "tolerance on the consistency condition of the plastic correction, relative to the yield stress"))
+    , d_nbLocalNewtonSolves(initData(&d_nbLocalNewtonSolves, (unsigned int)0, "nbLocalNewtonSolves", "number of plastic corrections in the last force computation", true, true))
+    , d_nbLocalNewtonIterations(initData(&d_nbLocalNewtonIterations, (unsigned int)0, "nbLocalNewtonIterations", "total number of local Newton iterations in the last force computation", true, true))
+    , d_maxLocalNewtonIterationCount(initData(&d_maxLocalNewtonIterationCount, (unsigned int)0, "maxLocalNewtonIterationCount", "highest number of local Newton iterations for a single Gauss point in the last force computation", true, true))
+    , d_nbLocalNewtonFailures(initData(&d_nbLocalNewtonFailures, (unsigned int)0, "nbLocalNewtonFailures", "number of plastic corrections which reached maxLocalNewtonIterations in the last force computation", true, true))
+    , d_nbElasticBeams(initData(&d_nbElasticBeams, (unsigned int)0, "nbElasticBeams", "number of beam elements whose Gauss points have never been plastic, in the last force computation", true, true))
+    , d_nbPlasticBeams(initData(&d_nbPlasticBeams, (unsigned int)0, "nbPlasticBeams", "number of beam elements with plastic Gauss points in the last force computation", true, true))
+    , d_nbPostPlasticBeams(initData(&d_nbPostPlasticBeams, (unsigned int)0, "nbPostPlasticBeams", "number of beam elements which were plastic before the last force computation, but not anymore", true, true))
+    , d_nbElasticGaussPoints(initData(&d_nbElasticGaussPoints, (unsigned int)0, "nbElasticGaussPoints", "number of elastic Gauss points in the last force computation", true, true))
+    , d_nbPlasticGaussPoints(initData(&d_nbPlasticGaussPoints, (unsigned int)0, "nbPlasticGaussPoints", "number of plastic Gauss points in the last force computation", true, true))
+    , d_nbPostPlasticGaussPoints(initData(&d_nbPostPlasticGaussPoints, (unsigned int)0, "nbPostPlasticGaussPoints", "number of post-plastic Gauss points in the last force computation", true, true))
+    , d_nbReturnMappings(initData(&d_nbReturnMappings, (unsigned int)0, "nbReturnMappings", "number of Gauss point stress updates by the return mapping algorithm in the last force computation", true, true))
+    , d_nbTangentUpdates(initData(&d_nbTangentUpdates, (unsigned int)0, "nbTangentUpdates", "number of tangent stiffness matrices recomputed in the last force computation", true, true))
+    , d_maxEffectivePlasticStrain(initData(&d_maxEffectivePlasticStrain, (Real)0, "maxEffectivePlasticStrain", "highest effective plastic strain over all Gauss points, after the last force computation", true, true))
+    , d_elasticEnergy(initData(&d_elasticEnergy, (Real)0, "elasticEnergy", "elastic strain energy of all the beam elements, after the last force computation", true, true))
+    , d_plasticDissipation(initData(&d_plasticDissipation, (Real)0, "plasticDissipation", "plastic work of all the beam elements since the undeformed state, after the last force computation", true, true))
+    , d_beamElasticEnergies(initData(&d_beamElasticEnergies, "beamElasticEnergies", "elastic strain energy of each beam element, at the end of the last time step", true, true))
+    , d_beamPlasticDissipations(initData(&d_beamPlasticDissipations, "beamPlasticDissipations", "plastic work of each beam element since the undeformed state, at the end of the last time step", true, true))
+    , d_massDensity(initData(&d_massDensity, (Real)0, "massDensity", "mass density of the beam material, used for the critical time step if no mass component is linked"))
+    , l_mass(initLink("mass", "link to the mass component used for the critical time step"))
+    , d_criticalTimeStep(initData(&d_criticalTimeStep, (Real)0, "criticalTimeStep", "estimate of the largest stable time step of explicit time integration, 0 without mass", true, true))
+    , d_criticalElement(initData(&d_criticalElement, 0u, "criticalElement", "beam element with the smallest critical time step", true, true))
     , m_indexedElements(nullptr)
+    , d_elementOrdering(initData(&d_elementOrdering, std::string("none"), "elementOrdering", "ordering of the element loops, for memory locality: none, RCM (reverse Cuthill-McKee) or Morton (space-filling curve)"))
+    , d_nodePermutation(initData(&d_nodePermutation, "nodePermutation", "new index of each node for the chosen elementOrdering, to be applied to the mesh to reduce the matrix bandwidth", true, true))
+    , d_parallelStrategy(initData(&d_parallelStrategy, std::string("none"), "parallelStrategy", "scatter strategy of the parallel element loops: none (sequential), coloring (node-disjoint element batches) or threadBuffers (per-thread force accumulation)"))
+    , d_nbColors(initData(&d_nbColors, (unsigned int)0, "nbColors", "number of colors of the element coloring", true, true))
+    , d_colorSizes(initData(&d_colorSizes, "colorSizes", "number of elements of each color of the element coloring", true, true))
+    , m_parallelStrategy(ParallelStrategy::NONE)
+    , m_taskScheduler(nullptr)
+    , d_batchKernel(initData(&d_batchKernel, std::string("none"), "batchKernel", "instruction set of the batched elastic kernel of the force computation: none (element by element), auto, scalar, avx2 or avx512"))
+    , d_nbBatchedElements(initData(&d_nbBatchedElements, (unsigned int)0, "nbBatchedElements", "number of elements computed by the batched elastic kernel in the last force computation", true, true))
+    , m_elasticBatchKernel(nullptr)
+    , d_checkpointFile(initData(&d_checkpointFile, "checkpointFile", "binary checkpoint file of the plastic state"))
+    , d_loadCheckpoint(initData(&d_loadCheckpoint, false, "loadCheckpoint", "if true, the plastic state is loaded from checkpointFile at init and reset"))
+    , d_saveCheckpoint(initData(&d_saveCheckpoint, false, "saveCheckpoint", "if set to true, the plastic state is saved to checkpointFile at the end of the time step"))
+    , d_elementCacheFile(initData(&d_elementCacheFile, "elementCacheFile", "cache file of the precomputed element matrices, written if missing or outdated"))
+    , d_timePhases(initData(&d_timePhases, false, "timePhases", "if true, the time spent in each phase of the force computations is measured"))
+    , d_timingTraceFile(initData(&d_timingTraceFile, "timingTraceFile", "Chrome trace file of the force computation calls and phase times, written if timePhases is true at init"))
+    , d_corotationTime(initData(&d_corotationTime, 0.0, "corotationTime", "time spent computing the corotational displacements in the last time step (ms)", true, true))
+    , d_stressUpdateTime(initData(&d_stressUpdateTime, 0.0, "stressUpdateTime", "time spent computing the Gauss point stresses and internal forces in the last time step (ms)", true, true))
+    , d_tangentUpdateTime(initData(&d_tangentUpdateTime, 0.0, "tangentUpdateTime", "time spent computing the tangent stiffness matrices in the last time step (ms)", true, true))
+    , d_addForceTime(initData(&d_addForceTime, 0.0, "addForceTime", "time spent in addForce in the last time step (ms)", true, true))
+    , d_addDForceTime(initData(&d_addDForceTime, 0.0, "addDForceTime", "time spent in addDForce in the last time step (ms)", true, true))
+    , d_addKToMatrixTime(initData(&d_addKToMatrixTime, 0.0, "addKToMatrixTime", "time spent in addKToMatrix in the last time step (ms)", true, true))
+    , d_displacementTraceFile(initData(&d_displacementTraceFile, "displacementTraceFile", "binary trace of the positions passed to addForce, recorded from init if set, to be replayed with BeamPlasticTrace_replay"))
+    , d_historyFile(initData(&d_historyFile, "historyFile", "prefix of the binary files of the Gauss point history of the historyElements, recorded from init if set"))
+    , d_historyElements(initData(&d_historyElements, "historyElements", "indices of the beam elements whose Gauss point history is recorded, all of them if empty"))
+    , d_historySamplingInterval(initData(&d_historySamplingInterval, 1u, "historySamplingInterval", "number of time steps between two snapshots of the Gauss point history"))
+    , d_historyChunkSize(initData(&d_historyChunkSize, 10000u, "historyChunkSize", "number of snapshots of the Gauss point history per file"))
+    , d_nbDroppedHistorySnapshots(initData(&d_nbDroppedHistorySnapshots, 0u, "nbDroppedHistorySnapshots", "number of snapshots of the Gauss point history dropped because the files were not written fast enough", true, true))
     , d_poissonRatio(initData(&d_poissonRatio,(Real)0.3f,"poissonRatio","Potion Ratio"))
     , d_youngModulus(initData(&d_youngModulus, (Real)5000, "youngModulus", "Young Modulus"))
     , d_initialYieldStress(initData(&d_initialYieldStress,(Real)6.0e8,"initialYieldStress","yield stress"))
@@ -52,6 +133,11 @@ BeamPlasticFEMForceField<DataTypes>::BeamPlasticFEMForceField()
     , d_useSymmetricAssembly(initData(&d_useSymmetricAssembly,false,"useSymmetricAssembly","use symmetric assembly of the matrix K"))
     , d_isTimoshenko(initData(&d_isTimoshenko,false,"isTimoshenko","implements a Timoshenko beam model"))
     , d_sectionShape(initData(&d_sectionShape,"rectangular","sectionShape","Geometry of the section shape (rectangular or circular)"))
+    , l_topology(initLink("topology", "link to the topology container"))
+    , d_drawCentrelineSegments(initData(&d_drawCentrelineSegments, 10u, "drawCentrelineSegments", "number of segments drawn along the centreline of each beam element"))
+    , d_drawPlasticGaussPointsOnly(initData(&d_drawPlasticGaussPointsOnly, false, "drawPlasticGaussPointsOnly", "if true, the Gauss points of the beam elements which are entirely elastic are not drawn"))
+    , d_drawLODPixelLength(initData(&d_drawLODPixelLength, (Real)0, "drawLODPixelLength", "beam elements shorter than this length on screen (in pixels) are drawn as a single segment coloured by their mechanical state (0 to disable)"))
+    , d_headless(initData(&d_headless, false, "headless", "if true, the beam elements are never drawn, and the visualisation data is not allocated (batch runs)"))
 {
     d_poissonRatio.setRequired(true);
     d_youngModulus.setReadOnly(true);
@@ -60,33 +146,21 @@ BeamPlasticFEMForceField<DataTypes>::BeamPlasticFEMForceField()
 template<class DataTypes>
 BeamPlasticFEMForceField<DataTypes>::BeamPlasticFEMForceField(Real poissonRatio, Real youngModulus, Real yieldStress, Real zSection,
                                                     Real ySection, bool isTimoshenko, bool isPerfectlyPlastic)
-    : m_beamsData(initData(&m_beamsData, "beamsData", "Internal element data"))
-    , d_usePrecomputedStiffness(initData(&d_usePrecomputedStiffness, true, "usePrecomputedStiffness",
-                                         "indicates if a precomputed elastic stiffness matrix is used, instead of being computed by reduced integration"))
-    , d_useConsistentTangentOperator(initData(&d_useConsistentTangentOperator, false, "useConsistentTangentOperator",
-                                              "indicates wether to use a consistent tangent operator in the computation of the plastic stiffness matrix"))
-    , d_isPerfectlyPlastic(initData(&d_isPerfectlyPlastic, isPerfectlyPlastic, "isPerfectlyPlastic", "indicates wether the behaviour model is perfectly plastic"))
-    , d_modelName(initData(&d_modelName, std::string("RambergOsgood"), "modelName", "the name of the 1D contitutive law model to be used in plastic deformation"))
-    , m_indexedElements(nullptr)
-    , d_poissonRatio(initData(&d_poissonRatio,(Real)poissonRatio,"poissonRatio","Potion Ratio"))
-    , d_youngModulus(initData(&d_youngModulus,(Real)youngModulus,"youngModulus","Young Modulus"))
-    , d_initialYieldStress(initData(&d_initialYieldStress, (Real)yieldStress, "initialYieldStress", "yield stress"))
-    , d_zSection(initData(&d_zSection, (Real)zSection, "zSection", "length of the section in the z direction for rectangular beams"))
-    , d_ySection(initData(&d_ySection, (Real)ySection, "ySection", "length of the section in the y direction for rectangular beams"))
-    , d_useSymmetricAssembly(initData(&d_useSymmetricAssembly,false,"useSymmetricAssembly","use symmetric assembly of the matrix K"))
-    , d_isTimoshenko(initData(&d_isTimoshenko, isTimoshenko, "isTimoshenko", "implements a Timoshenko beam model"))
-    , d_sectionShape(initData(&d_sectionShape, "rectangular", "sectionShape", "Geometry of the section shape (rectangular or circular)"))
-    , l_topology(initLink("topology", "link to the topology container"))
-
+    : BeamPlasticFEMForceField()
 {
-    d_poissonRatio.setRequired(true);
-    d_youngModulus.setReadOnly(true);
+    d_poissonRatio.setValue(poissonRatio);
+    d_youngModulus.setValue(youngModulus);
+    d_initialYieldStress.setValue(yieldStress);
+    d_zSection.setValue(zSection);
+    d_ySection.setValue(ySection);
+    d_isTimoshenko.setValue(isTimoshenko);
+    d_isPerfectlyPlastic.setValue(isPerfectlyPlastic);
 }
 
 template<class DataTypes>
 BeamPlasticFEMForceField<DataTypes>::~BeamPlasticFEMForceField()
 {
-
+    closeHistory();
 }
 
 /*****************************************************************************/
@@ -99,6 +173,13 @@ void BeamPlasticFEMForceField<DataTypes>::bwdInit()
     [[maybe_unused]] core::behavior::BaseMechanicalState* state = this->getContext()->getMechanicalState();
     assert(state);
     m_lastUpdatedStep=-1.0;
+
+    // After the initialisation of the mass component
+    if (this->d_componentState.getValue() != sofa::core::objectmodel::ComponentState::Invalid && !m_beamsData.getValue().empty())
+    {
+        updateLumpedMasses();
+        publishCriticalTimeStep();
+    }
 }
 
 template <class DataTypes>
@@ -128,37 +209,34 @@ void BeamPlasticFEMForceField<DataTypes>::init()
     }
     m_indexedElements = &l_topology->getEdges();
 
-    // Retrieving the 1D plastic constitutive law model
-    std::string constitutiveModel = d_modelName.getValue();
-    if (constitutiveModel == "RambergOsgood")
-    {
-        Real youngModulus = d_youngModulus.getValue();
-        Real yieldStress = d_initialYieldStress.getValue();
-
-        //Initialisation of the comparison threshold for stress tensor norms to 0.
-        // Plasticity computation requires to basically compare stress tensor norms to 0.
-        // As stress norm values can vary of several orders of magnitude, depending on the
-        // considered materials and/or applied forces, this comparison has to be carried out
-        // carefully.
-        // The idea here is to use the initialYieldStress of the material, and the
-        // available precision limit (e.g. std::numeric_limits<double>::epsilon()).
-        // We rely on the value of the initial Yield stress, as we can expect plastic
-        // deformation to occur inside a relatively small intervl of stresses around this value.
-        const int orderOfMagnitude = d_initialYieldStress.getValue(); //Should use std::abs, but d_initialYieldStress > 0
-        m_stressComparisonThreshold = std::numeric_limits<double>::epsilon() * orderOfMagnitude;
-
-        m_ConstitutiveLaw = std::unique_ptr<RambergOsgood<DataTypes>>(new RambergOsgood<DataTypes>(youngModulus, yieldStress));
-        if (this->f_printLog.getValue())
-            msg_info() << "The model is " << constitutiveModel;
-    }
-    else
+    m_beamsData.createTopologyHandler(l_topology.get());
+    m_lastPos.createTopologyHandler(l_topology.get());
+    initTopologyCallbacks();
+
+    // Checkpoints are saved and phase times published on AnimateEndEvent
+    this->f_listening.setValue(true);
+
+    const std::string& traceFile = d_timingTraceFile.getFullPath();
+    if (d_timePhases.getValue() && !traceFile.empty())
     {
-        msg_error() << "constitutive law model name " << constitutiveModel << " is not valid (should be RambergOsgood)";
+        m_traceWriter = std::make_unique<utils::ChromeTraceWriter>();
+        if (!m_traceWriter->open(traceFile))
+        {
+            msg_error() << "Cannot create the timing trace file " << traceFile;
+            m_traceWriter.reset();
+        }
     }
 
-    m_beamsData.createTopologyHandler(l_topology.get());
+    const std::string& displacementTraceFile = d_displacementTraceFile.getFullPath();
+    if (!displacementTraceFile.empty())
+        openDisplacementTrace(displacementTraceFile);
 
     reinit();
+
+    // After reinit, for the number of elements
+    const std::string& historyFile = d_historyFile.getFullPath();
+    if (!historyFile.empty())
+        openHistory(historyFile);
 }
 
 template <class DataTypes>
@@ -166,191 +244,1191 @@ void BeamPlasticFEMForceField<DataTypes>::reinit()
 {
     const auto n = m_indexedElements->size();
 
+    if (!initMaterialTables())
+    {
+        this->d_componentState.setValue(sofa::core::objectmodel::ComponentState::Invalid);
+        return;
+    }
+
     //Initialises the lastPos field with the rest position
-    m_lastPos = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    m_lastPos.setValue(this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue());
+    m_hasForceDisplacements = false;
+    m_drawShapeFunctionsOutdated = true;
+    m_lumpedMassesOutdated = true;
+
+    const std::string& elementCacheFile = d_elementCacheFile.getFullPath();
+    const bool useElementCache = !elementCacheFile.empty();
+
+    const ReinitSnapshot& last = m_reinitSnapshot;
+    const bool reinitAll = !last.valid || n != last.nbElements
+            || d_isTimoshenko.getValue() != last.isTimoshenko
+            || d_usePrecomputedStiffness.getValue() != last.usePrecomputedStiffness;
+
+    // The batch operators depend on the batches and on the element matrices,
+    // the yield limits only on the yield stresses
+    bool batchOperatorsOutdated = reinitAll || d_batchKernel.getValue() != last.batchKernel
+            || d_isPerfectlyPlastic.getValue() != last.isPerfectlyPlastic;
+
+    if (reinitAll)
+    {
+        computeElementOrdering();
+        initParallelStrategy();
+        m_elementStructuresOutdated = false;
+
+        initBeams( n );
 
-    m_prevStresses.resize(n);
-    for (std::size_t i = 0; i < n; i++)
-        for (int j = 0; j < 27; j++)
-            m_prevStresses[i][j] = VoigtTensor2();
+        // With an element cache, the Gauss point and stiffness matrices are only
+        // computed if the cache file is missing or does not match the elements.
+        reinitBeams(!useElementCache);
 
-    if (d_useConsistentTangentOperator.getValue())
+        if (useElementCache && !loadElementCache(elementCacheFile))
+        {
+            reinitBeams();
+            saveElementCache(elementCacheFile);
+        }
+    }
+    else
     {
-        // No need to store elastic predictors at each iteration if the consistent
-        // tangent operator is not used.
-        m_elasticPredictors.resize(n);
-        for (std::size_t i = 0; i < n; i++)
-            for (int j = 0; j < 27; j++)
-                m_elasticPredictors[i][j] = VoigtTensor2();
+        // The element ordering and coloring only depend on the topology
+        if (m_elementStructuresOutdated || d_elementOrdering.getValue() != last.elementOrdering
+                || d_parallelStrategy.getValue() != last.parallelStrategy)
+        {
+            computeElementOrdering();
+            initParallelStrategy();
+            batchOperatorsOutdated = true;
+        }
+        m_elementStructuresOutdated = false;
+
+        const std::size_t nbUpdatedBeams = updateBeams();
+        batchOperatorsOutdated = batchOperatorsOutdated || nbUpdatedBeams > 0;
+        if (useElementCache && nbUpdatedBeams > 0)
+            saveElementCache(elementCacheFile);
+
+        msg_info() << "Matrices of " << nbUpdatedBeams << " elements recomputed.";
     }
+    takeReinitSnapshot();
+
+    if (d_loadCheckpoint.getValue())
+        loadCheckpoint(d_checkpointFile.getFullPath());
+
+    if (batchOperatorsOutdated)
+        initBatchKernel();
+    else
+        updateBatchYieldLimits();
+    publishEnergies();
 
-    initBeams( n );
-    for (unsigned int i=0; i<n; ++i)
-        reinitBeam(i);
+    m_phaseTimer.setEnabled(d_timePhases.getValue());
+    m_phaseTimer.clear();
     msg_info() << "reinit OK, "<<n<<" elements." ;
 }
 
-template<class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::initBeams(size_t size)
+template <class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::initTopologyCallbacks()
+{
+    m_beamsData.setCreationCallback([this](Index edgeIndex, BeamInfo& beam, const Element& edge,
+                                           const sofa::type::vector<Index>&, const sofa::type::vector<SReal>&)
+    {
+        const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+        initBeam(edgeIndex, edge, beam, x0, true);
+        m_elementStructuresOutdated = true;
+        m_hasForceDisplacements = false;
+        m_drawShapeFunctionsOutdated = true;
+        m_lumpedMassesOutdated = true;
+    });
+    m_beamsData.setDestructionCallback([this](Index, BeamInfo&)
+    {
+        m_elementStructuresOutdated = true;
+        m_hasForceDisplacements = false;
+    });
+
+    // A new node has not been displaced yet
+    m_lastPos.setCreationCallback([this](Index pointIndex, Coord& lastPos, const Index&,
+                                         const sofa::type::vector<Index>&, const sofa::type::vector<SReal>&)
+    {
+        const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+        lastPos = pointIndex < x0.size() ? x0[pointIndex] : Coord();
+    });
+}
+
+template <class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::takeReinitSnapshot()
 {
+    m_reinitSnapshot.valid = true;
+    m_reinitSnapshot.nbElements = m_indexedElements->size();
+    m_reinitSnapshot.isTimoshenko = d_isTimoshenko.getValue();
+    m_reinitSnapshot.usePrecomputedStiffness = d_usePrecomputedStiffness.getValue();
+    m_reinitSnapshot.isPerfectlyPlastic = d_isPerfectlyPlastic.getValue();
+    m_reinitSnapshot.elementOrdering = d_elementOrdering.getValue();
+    m_reinitSnapshot.parallelStrategy = d_parallelStrategy.getValue();
+    m_reinitSnapshot.batchKernel = d_batchKernel.getValue();
+}
+
+template <class DataTypes>
+std::size_t BeamPlasticFEMForceField<DataTypes>::updateBeams()
+{
+    const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    const bool usePrecomputedStiffness = d_usePrecomputedStiffness.getValue();
+    std::atomic<std::size_t> nbUpdatedBeams(0);
+
     type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
-    bd.resize(size);
+    forEachChunk(getNbInitChunks(), bd.size(), [&](unsigned int, std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            BeamInfo& beam = bd[i];
+            const Element& element = (*m_indexedElements)[i];
+            unsigned int materialIndex, sectionIndex;
+            getTableIndices(static_cast<unsigned int>(i), materialIndex, sectionIndex);
+            const MaterialInfo& material = m_materials[materialIndex];
+            const Vec<2, Real>& section = m_sections[sectionIndex];
+            const Real length = (x0[element[0]].getCenter() - x0[element[1]].getCenter()).norm();
+
+            // The Gauss point matrices and shape functions depend on the geometry
+            // and, through the shear coefficients, on the Poisson ratio
+            const bool geometryChanged = material._nu != beam._nu || length != beam._L
+                    || section[0] != beam._zDim || section[1] != beam._yDim;
+            const bool stiffnessChanged = geometryChanged || material._E != beam._E;
+
+            // Properties, plastic history and orientation, and the matrices if needed
+            initBeam(static_cast<unsigned int>(i), element, beam, x0, geometryChanged);
+            if (!geometryChanged && stiffnessChanged)
+            {
+                if (usePrecomputedStiffness)
+                    computeStiffness(beam);
+                else
+                    computeVDStiffness(beam);
+            }
+            if (stiffnessChanged)
+                nbUpdatedBeams++;
+        }
+    });
     m_beamsData.endEdit();
+
+    return nbUpdatedBeams;
 }
 
 template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::reinitBeam(unsigned int i)
+void BeamPlasticFEMForceField<DataTypes>::updateElementStructures()
 {
-    double stiffness, yieldStress, length, poisson, zSection, ySection;
-    Index a = (*m_indexedElements)[i][0];
-    Index b = (*m_indexedElements)[i][1];
+    if (!m_elementStructuresOutdated)
+        return;
+    m_elementStructuresOutdated = false;
+
+    if (updateElementStructuresIncrementally())
+        return;
+
+    computeElementOrdering();
+    initParallelStrategy();
+    initBatchKernel();
+
+    msg_info() << "Element structures rebuilt after topological changes, " << m_indexedElements->size() << " elements.";
+}
 
+template <class DataTypes>
+bool BeamPlasticFEMForceField<DataTypes>::updateElementStructuresIncrementally()
+{
+    const VecElement& elements = *m_indexedElements;
+    const std::size_t nbElements = elements.size();
+    const std::size_t nbOldPositions = m_elementOrder.size();
     const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
 
-    stiffness =  d_youngModulus.getValue();
+    // The node permutation of the element ordering does not cover added nodes
+    const auto& nodePermutation = d_nodePermutation.getValue();
+    if (!nodePermutation.empty() && nodePermutation.size() != x0.size())
+        return false;
+
+    // The elements whose index and nodes are unchanged keep their traversal
+    // order. The other ones, added or moved by the renumbering of the removals,
+    // are appended.
+    std::vector<int> newPositions(nbOldPositions, -1);
+    std::vector<bool> isKept(nbElements, false);
+    type::vector<unsigned int> elementOrder;
+    elementOrder.reserve(nbElements);
+    for (std::size_t k = 0; k < nbOldPositions; k++)
+    {
+        const unsigned int i = m_elementOrder[k];
+        if (i < nbElements && elements[i] == m_orderedElements[k])
+        {
+            newPositions[k] = static_cast<int>(elementOrder.size());
+            elementOrder.push_back(i);
+            isKept[i] = true;
+        }
+    }
+    const std::size_t nbKept = elementOrder.size();
+    for (std::size_t i = 0; i < nbElements; i++)
+    {
+        if (!isKept[i])
+            elementOrder.push_back(static_cast<unsigned int>(i));
+    }
 
-    yieldStress = d_initialYieldStress.getValue();
-    length = (x0[a].getCenter()-x0[b].getCenter()).norm() ;
+    const std::size_t nbChanges = (nbOldPositions - nbKept) + (nbElements - nbKept);
+    if (nbChanges > MaxIncrementalUpdateRatio*nbElements)
+        return false;
 
-    zSection = d_zSection.getValue();
-    ySection = d_ySection.getValue();
-    poisson = d_poissonRatio.getValue();
+    // Colors of the kept elements, at their new positions. The others are colored greedily.
+    std::vector<unsigned int> elementColors(nbElements, topology::NoColor);
+    for (std::size_t color = 0; color + 1 < m_colorOffsets.size(); color++)
+    {
+        for (unsigned int j = m_colorOffsets[color]; j < m_colorOffsets[color + 1]; j++)
+        {
+            const int k = newPositions[m_coloredElements[j]];
+            if (k >= 0)
+                elementColors[k] = static_cast<unsigned int>(color);
+        }
+    }
 
-    setBeam(i, stiffness, yieldStress, length, poisson, zSection, ySection);
+    m_elementOrder = elementOrder;
+    m_orderedElements.resize(nbElements);
+    for (std::size_t k = 0; k < nbElements; k++)
+        m_orderedElements[k] = elements[m_elementOrder[k]];
+    computeElementColoring(elementColors);
+    for (std::size_t color = 0; color + 1 < m_colorOffsets.size(); color++)
+    {
+        for (unsigned int j = m_colorOffsets[color]; j < m_colorOffsets[color + 1]; j++)
+            elementColors[m_coloredElements[j]] = static_cast<unsigned int>(color);
+    }
 
-    computeMaterialBehaviour(i, a, b);
+    if (m_elasticBatchKernel)
+    {
+        constexpr unsigned int W = simd::BatchWidth;
+        constexpr unsigned int NbGP = simd::NbGaussPoints;
+        const bool useColoring = m_parallelStrategy == ParallelStrategy::COLORING;
+        auto getGroupKey = [&](unsigned int color) { return useColoring ? color : 0u; };
+
+        // Lanes of the removed or moved elements are freed, the other ones follow
+        // the new positions. The free lanes of each group can take the added
+        // elements of its color.
+        std::map<unsigned int, std::vector<std::size_t>> freeLanes;
+        for (std::size_t group = 0; group + 1 < m_batchOffsets.size(); group++)
+        {
+            for (std::size_t lane = m_batchOffsets[group]*W; lane < m_batchOffsets[group + 1]*W; lane++)
+            {
+                int& k = m_batchElements[lane];
+                if (k >= 0)
+                    k = newPositions[k];
+                if (k < 0)
+                {
+                    clearBatchLane(lane / W, lane % W);
+                    freeLanes[getGroupKey(m_batchGroupColors[group])].push_back(lane);
+                }
+            }
+        }
 
-    // Initialisation of the elastic stiffness matrix
-    if (d_usePrecomputedStiffness.getValue())
-        computeStiffness(i, a, b);
-    else
-        computeVDStiffness(i, a, b);
-    // Initialisation of the tangent stiffness matrix
-    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
-    Matrix12x12& Kt_loc = bd[i]._Kt_loc;
-    Kt_loc.clear();
-    m_beamsData.endEdit();
+        // Lowest free lanes first, to fill the batches in order
+        for (auto& lanes : freeLanes)
+            std::reverse(lanes.second.begin(), lanes.second.end());
 
-    // Initialisation of the beam element orientation
-    //TO DO: is necessary ?
-    beamQuat(i) = x0[a].getOrientation();
-    beamQuat(i).normalize();
-    m_beamsData.endEdit(); // consecutive to beamQuat
+        // Remaining added elements, in new batches: one new group per color
+        std::map<unsigned int, std::vector<unsigned int>> overflowElements;
+        const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+        for (std::size_t k = nbKept; k < nbElements; k++)
+        {
+            std::vector<std::size_t>& lanes = freeLanes[getGroupKey(elementColors[k])];
+            if (lanes.empty())
+            {
+                overflowElements[getGroupKey(elementColors[k])].push_back(static_cast<unsigned int>(k));
+                continue;
+            }
+            const std::size_t lane = lanes.back();
+            lanes.pop_back();
+            m_batchElements[lane] = static_cast<int>(k);
+            computeBatchOperators(lane / W, lane % W, bd[m_elementOrder[k]]);
+        }
+        for (const auto& overflow : overflowElements)
+        {
+            const std::size_t firstBatch = m_batchElements.size() / W;
+            for (const unsigned int k : overflow.second)
+                m_batchElements.push_back(static_cast<int>(k));
+            while (m_batchElements.size() % W != 0)
+                m_batchElements.push_back(-1);
+            const std::size_t nbBatches = m_batchElements.size() / W;
+            m_batchOffsets.push_back(static_cast<unsigned int>(nbBatches));
+            m_batchGroupColors.push_back(overflow.first);
+
+            m_batchStressOperators.resize(nbBatches*NbGP*6*12*W, 0.0);
+            m_batchStiffness.resize(nbBatches*12*12*W, 0.0);
+            m_batchGaussWeights.resize(nbBatches*NbGP*W, 0.0);
+            for (std::size_t lane = firstBatch*W; lane < nbBatches*W; lane++)
+            {
+                if (m_batchElements[lane] >= 0)
+                    computeBatchOperators(lane / W, lane % W, bd[m_elementOrder[m_batchElements[lane]]]);
+            }
+        }
+        updateBatchYieldLimits();
+    }
 
+    msg_info() << "Element structures updated after topological changes, " << nbElements << " elements, "
+               << nbElements - nbKept << " added or moved, " << nbOldPositions - nbKept << " removed or moved.";
+    return true;
 }
 
-template<class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::setBeam(unsigned int i, double E, double yS, double L, double nu, double zSection, double ySection)
+template <class DataTypes>
+bool BeamPlasticFEMForceField<DataTypes>::checkTableIndices(const sofa::type::vector<unsigned int>& indices,
+                                                            std::size_t tableSize, const std::string& dataName)
 {
-    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
-    bd[i].init(E, yS, L, nu, zSection, ySection, d_isTimoshenko.getValue());
-    m_beamsData.endEdit();
+    if (indices.empty())
+        return true;
+
+    if (indices.size() != m_indexedElements->size())
+    {
+        msg_error() << dataName << " should be empty, or contain one index per beam element (" << indices.size()
+                    << " indices for " << m_indexedElements->size() << " elements)";
+        return false;
+    }
+    for (std::size_t i = 0; i < indices.size(); i++)
+    {
+        if (indices[i] >= tableSize)
+        {
+            msg_error() << dataName << ": index " << indices[i] << " of element " << i
+                        << " is out of range (table of size " << tableSize << ")";
+            return false;
+        }
+    }
+    return true;
 }
 
-template<class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::BeamInfo::init(double E, double yS, double L, double nu, double zSection, double ySection, bool isTimoshenko)
+template <class DataTypes>
+bool BeamPlasticFEMForceField<DataTypes>::initMaterialTables()
 {
-    _E = E;
-    _nu = nu;
-    _L = L;
-
-    _zDim = zSection;
-    _yDim = ySection;
+    // Material table, defaulting to a single material defined by the scalar fields
+    m_materials.clear();
+    const auto& materials = d_materials.getValue();
+    if (materials.empty())
+        m_materials.push_back({ d_youngModulus.getValue(), d_poissonRatio.getValue(), d_initialYieldStress.getValue(), Matrix6x6(), nullptr });
+    for (const auto& material : materials)
+        m_materials.push_back({ material[0], material[1], material[2], Matrix6x6(), nullptr });
+
+    for (auto& material : m_materials)
+        computeMaterialBehaviour(material);
+
+    // Section table, defaulting to a single section defined by the scalar fields
+    m_sections = d_sections.getValue();
+    if (m_sections.empty())
+        m_sections.push_back(Vec<2, Real>(d_zSection.getValue(), d_ySection.getValue()));
+
+    if (!checkTableIndices(d_materialIndices.getValue(), m_materials.size(), "materialIndices")
+            || !checkTableIndices(d_sectionIndices.getValue(), m_sections.size(), "sectionIndices"))
+        return false;
+
+    //Initialisation of the comparison threshold for stress tensor norms to 0.
+    // Plasticity computation requires to basically compare stress tensor norms to 0.
+    // As stress norm values can vary of several orders of magnitude, depending on the
+    // considered materials and/or applied forces, this comparison has to be carried out
+    // carefully.
+    // The idea here is to use the initialYieldStress of the material, and the
+    // available precision limit (e.g. std::numeric_limits<double>::epsilon()).
+    // We rely on the value of the initial Yield stress, as we can expect plastic
+    // deformation to occur inside a relatively small intervl of stresses around this value.
+    // With several materials, the highest initial yield stress is used.
+    Real orderOfMagnitude = 0; //Should use std::abs, but yield stresses are > 0
+    for (const auto& material : m_materials)
+        orderOfMagnitude = std::max(orderOfMagnitude, material._yieldStress);
+    m_stressComparisonThreshold = std::numeric_limits<double>::epsilon() * orderOfMagnitude;
 
-    _G = _E / (2.0*(1.0 + _nu));
-    _Iz = ySection*ySection*ySection*zSection / 12.0;
+    // Retrieving the 1D plastic constitutive law model
+    std::string constitutiveModel = d_modelName.getValue();
+    if (constitutiveModel == "RambergOsgood")
+    {
+        for (auto& material : m_materials)
+            material._constitutiveLaw = std::make_shared<RambergOsgood<DataTypes>>(material._E, material._yieldStress);
+        if (this->f_printLog.getValue())
+            msg_info() << "The model is " << constitutiveModel;
+    }
+    else if (constitutiveModel == "Tabulated")
+    {
+        sofa::type::vector<Vec<2, Real>> samples = d_hardeningCurve.getValue();
+        if (!d_hardeningCurveFile.getValue().empty())
+        {
+            if (d_hardeningCurve.isSet())
+                msg_warning() << "Both hardeningCurve and hardeningCurveFile are set, the samples of hardeningCurveFile are used.";
+            if (!readHardeningCurve(d_hardeningCurveFile.getFullPath(), samples))
+                return false;
+        }
 
-    _Iy = zSection*zSection*zSection*ySection / 12.0;
-    _J = _Iz + _Iy;
-    _A = zSection*ySection;
+        std::string errorMessage;
+        if (!TabulatedConstitutiveLaw<DataTypes>::checkSamples(samples, errorMessage))
+        {
+            msg_error() << "Invalid hardening curve for the Tabulated model: " << errorMessage;
+            return false;
+        }
 
-    double phiY, phiZ;
-    double L2 = L*L;
-    double kappaY = 1.0;
-    double kappaZ = 1.0;
+        // The hardening starts from the initial yield stress of each material, and
+        // the tangent moduli are looked up from the stress: a curve which starts
+        // at another stress is shifted to start at the yield stress.
+        typedef TabulatedConstitutiveLaw<DataTypes> TabulatedLaw;
+        const unsigned int tableSize = d_hardeningTableSize.getValue();
+        const auto law = std::make_shared<TabulatedLaw>(samples, tableSize);
+        for (auto& material : m_materials)
+        {
+            const Real shift = material._yieldStress - samples.front()[1];
+            if (shift == 0)
+            {
+                material._constitutiveLaw = law;
+                continue;
+            }
 
-    if (_A == 0)
-    {
-        phiY = 0.0;
-        phiZ = 0.0;
+            msg_warning() << "The stress of the first hardening curve sample (" << samples.front()[1]
+                          << ") differs from the initial yield stress (" << material._yieldStress
+                          << "), the curve is shifted by " << shift << ".";
+            typename TabulatedLaw::VecSample shiftedSamples = samples;
+            for (auto& sample : shiftedSamples)
+                sample[1] += shift;
+            material._constitutiveLaw = std::make_shared<TabulatedLaw>(shiftedSamples, tableSize);
+        }
+        if (this->f_printLog.getValue())
+            msg_info() << "The model is " << constitutiveModel << ", with " << samples.size() << " samples";
     }
     else
     {
-        phiY = (12.0*_E*_Iy / (kappaZ*_G*_A*L2));
-        phiZ = (12.0*_E*_Iz / (kappaY*_G*_A*L2));
+        msg_error() << "constitutive law model name " << constitutiveModel << " is not valid (should be RambergOsgood or Tabulated)";
+        return false;
     }
 
-    double phiYInv = (1 / (1 + phiY));
-    double phiZInv = (1 / (1 + phiZ));
-
-    _integrationInterval = ozp::quadrature::make_interval(0, -ySection / 2, -zSection / 2, L, ySection / 2, zSection / 2);
-
-    //Computation of the Be matrix for this beam element, based on the integration points.
+    return true;
+}
 
-    typedef ozp::quadrature::Gaussian<3> GaussianQuadratureType;
-    typedef std::function<void(double, double, double, double, double, double)> LambdaType;
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::computeElementOrdering()
+{
+    const VecElement& elements = *m_indexedElements;
+    const auto nbElements = elements.size();
+    const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    const std::string& ordering = d_elementOrdering.getValue();
 
-    sofa::Index gaussPointIndex = 0; //Gauss Point iterator
+    std::vector<unsigned int> newNodeIndex;
+    if (ordering == "RCM")
+        newNodeIndex = topology::computeReverseCuthillMcKee(x0.size(), elements);
+    else if (ordering == "Morton")
+    {
+        std::vector<Vec3> restCentres(x0.size());
+        for (std::size_t k = 0; k < x0.size(); k++)
+            restCentres[k] = x0[k].getCenter();
+        newNodeIndex = topology::computeMortonOrder(restCentres);
+    }
+    else if (ordering != "none")
+        msg_error() << "element ordering " << ordering << " is not valid (should be none, RCM or Morton)";
 
-    //Euler-Bernoulli beam theory
-    LambdaType initBeMatrixEulerB = [&](double u1, double u2, double u3, double w1, double w2, double w3)
+    if (newNodeIndex.empty())
     {
-        SOFA_UNUSED(w1);
-        SOFA_UNUSED(w2);
-        SOFA_UNUSED(w3);
-        auto& BeMatrix = _BeMatrices[gaussPointIndex];
-        // Step 1: total strain computation
-        double xi = u1 / _L;
-        double eta = u2 / _L;
-        double zeta = u3 / _L;
+        // Topology order
+        m_elementOrder.resize(nbElements);
+        std::iota(m_elementOrder.begin(), m_elementOrder.end(), 0u);
+        d_nodePermutation.setValue(sofa::type::vector<unsigned int>());
+    }
+    else
+    {
+        const std::vector<unsigned int> elementOrder = topology::computeElementOrder(elements, newNodeIndex);
+        m_elementOrder.assign(elementOrder.begin(), elementOrder.end());
+        d_nodePermutation.setValue(sofa::type::vector<unsigned int>(newNodeIndex.begin(), newNodeIndex.end()));
 
-        BeMatrix(0, 0) = -1 / _L;
-        BeMatrix(1, 0) = BeMatrix(2, 0) = BeMatrix(3, 0) = BeMatrix(4, 0) = BeMatrix(5, 0) = 0.0;
+        if (this->f_printLog.getValue())
+        {
+            std::vector<unsigned int> identity(x0.size());
+            std::iota(identity.begin(), identity.end(), 0u);
+            msg_info() << "Element ordering " << ordering << ": node adjacency bandwidth "
+                       << topology::computeBandwidth(elements, identity) << " with the mesh numbering, "
+                       << topology::computeBandwidth(elements, newNodeIndex) << " with nodePermutation";
+        }
+    }
 
-        BeMatrix(0, 1) = (6 * eta*(1 - 2 * xi)) / _L;
-        BeMatrix(1, 1) = BeMatrix(2, 1) = BeMatrix(3, 1) = BeMatrix(4, 1) = BeMatrix(5, 1) = 0.0;
+    m_orderedElements.resize(nbElements);
+    for (std::size_t k = 0; k < nbElements; k++)
+        m_orderedElements[k] = elements[m_elementOrder[k]];
+}
 
-        BeMatrix(0, 2) = (6 * zeta*(1 - 2 * xi)) / _L;
-        BeMatrix(1, 2) = BeMatrix(2, 2) = BeMatrix(3, 2) = BeMatrix(4, 2) = BeMatrix(5, 2) = 0.0;
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::computeElementColoring(std::vector<unsigned int> elementColors)
+{
+    // The coloring is computed on the traversal order, which is kept inside each
+    // color: the elements of a color remain sorted for memory locality.
+    const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    if (elementColors.empty())
+        elementColors.assign(m_orderedElements.size(), topology::NoColor);
+    const unsigned int nbColors = topology::extendGreedyEdgeColoring(x0.size(), m_orderedElements, elementColors);
+    const topology::ElementColoring coloring = topology::groupElementsByColor(elementColors, nbColors);
+
+    m_coloredElements.assign(coloring.elements.begin(), coloring.elements.end());
+    m_colorOffsets.assign(coloring.colorOffsets.begin(), coloring.colorOffsets.end());
+
+    sofa::type::vector<unsigned int> colorSizes(coloring.getNbColors());
+    for (std::size_t color = 0; color < colorSizes.size(); color++)
+        colorSizes[color] = static_cast<unsigned int>(coloring.getColorSize(color));
+    d_nbColors.setValue(static_cast<unsigned int>(colorSizes.size()));
+    d_colorSizes.setValue(colorSizes);
+}
 
-        BeMatrix(0, 3) = BeMatrix(1, 3) = BeMatrix(2, 3) = 0.0;
-        BeMatrix(3, 3) = 0;
-        BeMatrix(4, 3) = -eta / 2;
-        BeMatrix(5, 3) = zeta / 2;
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::initParallelStrategy()
+{
+    const std::string& strategy = d_parallelStrategy.getValue();
+    if (strategy == "coloring")
+        m_parallelStrategy = ParallelStrategy::COLORING;
+    else if (strategy == "threadBuffers")
+        m_parallelStrategy = ParallelStrategy::THREAD_BUFFERS;
+    else
+    {
+        if (strategy != "none")
+            msg_error() << "parallel strategy " << strategy << " is not valid (should be none, coloring or threadBuffers), "
+                        << "the element loops will be sequential";
+        m_parallelStrategy = ParallelStrategy::NONE;
+    }
 
-        BeMatrix(0, 4) = zeta * (6 * xi - 4);
-        BeMatrix(1, 4) = BeMatrix(2, 4) = BeMatrix(3, 4) = BeMatrix(4, 4) = BeMatrix(5, 4) = 0.0;
+    // The task scheduler is also used by the element initialisation, whatever the strategy
+    if (!m_taskScheduler)
+    {
+        m_taskScheduler = sofa::simulation::MainTaskSchedulerFactory::createInRegistry();
+        assert(m_taskScheduler);
+        if (m_taskScheduler->getThreadCount() < 1)
+            m_taskScheduler->init(0);
+    }
 
-        BeMatrix(0, 5) = eta * (4 - 6 * xi);
-        BeMatrix(1, 5) = BeMatrix(2, 5) = BeMatrix(3, 5) = BeMatrix(4, 5) = BeMatrix(5, 5) = 0.0;
+    // The coloring statistics are computed whatever the strategy, to help choosing one
+    computeElementColoring();
 
-//        BeMatrix.block<6, 1>(0, 6) = -BeMatrix.block<6, 1>(0, 0);
+    if (m_parallelStrategy == ParallelStrategy::THREAD_BUFFERS)
+        m_threadBuffers.resize(getNbChunks());
+    else
+        m_threadBuffers.clear();
 
-//        BeMatrix.block<6, 1>(0, 7) = -BeMatrix.block<6, 1>(0, 1);
+    m_phaseTimer.setNbSlots(getNbChunks());
 
-//        BeMatrix.block<6, 1>(0, 8) = -BeMatrix.block<6, 1>(0, 2);
+    msg_info() << "Parallel strategy: " << strategy << ", " << getNbChunks() << " chunks, "
+               << d_nbColors.getValue() << " element colors";
+}
 
-        Mat<6, 1, Real> subMat;
-        BeMatrix.getsub(0, 0, subMat);
-        BeMatrix.setsub(0, 6, -subMat);
-        BeMatrix.getsub(0, 1, subMat);
-        BeMatrix.setsub(0, 7, -subMat);
-        BeMatrix.getsub(0, 2, subMat);
-        BeMatrix.setsub(0, 8, -subMat);
+template<class DataTypes>
+unsigned int BeamPlasticFEMForceField<DataTypes>::getNbChunks() const
+{
+    if (m_parallelStrategy == ParallelStrategy::NONE || !m_taskScheduler)
+        return 1;
+    return std::max(1u, m_taskScheduler->getThreadCount());
+}
 
-        BeMatrix(0, 9) = BeMatrix(1, 9) = BeMatrix(2, 9) = 0.0;
-        BeMatrix(3, 9) = 0;
-        BeMatrix(4, 9) = eta / 2;
-        BeMatrix(5, 9) = -zeta / 2;
+template<class DataTypes>
+unsigned int BeamPlasticFEMForceField<DataTypes>::getNbInitChunks() const
+{
+    if (!m_taskScheduler)
+        return 1;
+    return std::max(1u, m_taskScheduler->getThreadCount());
+}
 
-        BeMatrix(0, 10) = zeta * (6 * xi - 2);
-        BeMatrix(1, 10) = BeMatrix(2, 10) = BeMatrix(3, 10) = BeMatrix(4, 10) = BeMatrix(5, 10) = 0.0;
+template<class DataTypes>
+template<class ChunkFunction>
+void BeamPlasticFEMForceField<DataTypes>::forEachChunk(std::size_t size, const ChunkFunction& chunkFunction)
+{
+    forEachChunk(getNbChunks(), size, chunkFunction);
+}
 
-        BeMatrix(0, 11) = eta * (2 - 6 * xi);
-        BeMatrix(1, 11) = BeMatrix(2, 11) = BeMatrix(3, 11) = BeMatrix(4, 11) = BeMatrix(5, 11) = 0.0;
+template<class DataTypes>
+template<class ChunkFunction>
+void BeamPlasticFEMForceField<DataTypes>::forEachChunk(unsigned int nbChunks, std::size_t size, const ChunkFunction& chunkFunction)
+{
+    if (nbChunks <= 1)
+    {
+        chunkFunction(0u, std::size_t(0), size);
+        return;
+    }
 
-        gaussPointIndex++;
-    };
+    // Every chunk is called, even if empty, so that per-chunk data is always up to date
+    sofa::simulation::parallelForEach(*m_taskScheduler, 0u, nbChunks, [&](const unsigned int chunk)
+    {
+        chunkFunction(chunk, size*chunk/nbChunks, size*(chunk + 1)/nbChunks);
+    });
+}
+
+template<class DataTypes>
+template<class ItemFunction>
+void BeamPlasticFEMForceField<DataTypes>::accumulateOverItems(const type::vector<unsigned int>& groupOffsets, VecDeriv& output,
+                                                              const ItemFunction& itemFunction)
+{
+    const std::size_t nbItems = groupOffsets.empty() ? 0 : groupOffsets.back();
+
+    switch (m_parallelStrategy)
+    {
+    case ParallelStrategy::COLORING:
+    {
+        // Items of the same group do not share any node: they can write
+        // directly to the output vector
+        for (std::size_t group = 0; group + 1 < groupOffsets.size(); group++)
+        {
+            const std::size_t groupBegin = groupOffsets[group];
+            forEachChunk(groupOffsets[group + 1] - groupBegin, [&](unsigned int chunk, std::size_t begin, std::size_t end)
+            {
+                for (std::size_t item = groupBegin + begin; item < groupBegin + end; item++)
+                    itemFunction(item, output, chunk);
+            });
+        }
+        break;
+    }
+    case ParallelStrategy::THREAD_BUFFERS:
+    {
+        forEachChunk(nbItems, [&](unsigned int chunk, std::size_t begin, std::size_t end)
+        {
+            VecDeriv& buffer = m_threadBuffers[chunk];
+            buffer.assign(output.size(), Deriv());
+            for (std::size_t item = begin; item < end; item++)
+                itemFunction(item, buffer, chunk);
+        });
+
+        // Reduction, over the nodes. The buffers are summed in the same order for
+        // every node, so that the result does not depend on the thread scheduling.
+        forEachChunk(output.size(), [&](unsigned int, std::size_t begin, std::size_t end)
+        {
+            for (const VecDeriv& buffer : m_threadBuffers)
+                for (std::size_t n = begin; n < end; n++)
+                    output[n] += buffer[n];
+        });
+        break;
+    }
+    default:
+        for (std::size_t item = 0; item < nbItems; item++)
+            itemFunction(item, output, 0u);
+    }
+}
+
+template<class DataTypes>
+template<class ElementFunction>
+void BeamPlasticFEMForceField<DataTypes>::accumulateOverElements(VecDeriv& output, const ElementFunction& elementFunction)
+{
+    if (m_parallelStrategy == ParallelStrategy::COLORING)
+    {
+        accumulateOverItems(m_colorOffsets, output, [&](std::size_t j, VecDeriv& out, unsigned int chunk)
+        {
+            elementFunction(m_coloredElements[j], out, chunk);
+        });
+    }
+    else
+    {
+        const type::vector<unsigned int> allElements = { 0u, static_cast<unsigned int>(m_elementOrder.size()) };
+        accumulateOverItems(allElements, output, elementFunction);
+    }
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::initBatchKernel()
+{
+    m_elasticBatchKernel = nullptr;
+    m_batchElements.clear();
+    m_batchOffsets.clear();
+    m_batchGroupColors.clear();
+    m_batchStressOperators.clear();
+    m_batchStiffness.clear();
+    m_batchSquaredYieldLimits.clear();
+    m_batchGaussWeights.clear();
+
+    const std::string& kernel = d_batchKernel.getValue();
+    if (kernel == "none")
+        return;
+
+    simd::InstructionSet instructionSet = simd::getBestInstructionSet();
+    if (kernel == "scalar")
+        instructionSet = simd::InstructionSet::SCALAR;
+    else if (kernel == "avx2")
+        instructionSet = simd::InstructionSet::AVX2;
+    else if (kernel == "avx512")
+        instructionSet = simd::InstructionSet::AVX512;
+    else if (kernel != "auto")
+    {
+        msg_error() << "batch kernel " << kernel << " is not valid (should be none, auto, scalar, avx2 or avx512), "
+                    << "the forces will be computed element by element";
+        return;
+    }
+
+    if (!simd::isInstructionSetSupported(instructionSet))
+    {
+        instructionSet = simd::getBestInstructionSet();
+        msg_warning() << "batch kernel " << kernel << " is not supported by this CPU or build, "
+                      << simd::getInstructionSetName(instructionSet) << " is used instead";
+    }
+
+    if (d_isPerfectlyPlastic.getValue())
+    {
+        msg_warning() << "the batched elastic kernel is only implemented for hardening, "
+                      << "the forces will be computed element by element";
+        return;
+    }
+
+    // Batches of simd::BatchWidth consecutive elements, in traversal order. With
+    // the coloring strategy, the batches are made within each color, so that two
+    // batches of the same color can be processed concurrently.
+    constexpr unsigned int W = simd::BatchWidth;
+    auto addGroup = [this](auto begin, auto end)
+    {
+        for (auto it = begin; it != end; ++it)
+            m_batchElements.push_back(static_cast<int>(*it));
+        while (m_batchElements.size() % W != 0)
+            m_batchElements.push_back(-1);
+        m_batchOffsets.push_back(static_cast<unsigned int>(m_batchElements.size() / W));
+    };
+
+    m_batchOffsets.push_back(0);
+    if (m_parallelStrategy == ParallelStrategy::COLORING)
+    {
+        for (std::size_t color = 0; color + 1 < m_colorOffsets.size(); color++)
+        {
+            addGroup(m_coloredElements.begin() + m_colorOffsets[color], m_coloredElements.begin() + m_colorOffsets[color + 1]);
+            m_batchGroupColors.push_back(static_cast<unsigned int>(color));
+        }
+    }
+    else
+    {
+        std::vector<unsigned int> positions(m_elementOrder.size());
+        std::iota(positions.begin(), positions.end(), 0u);
+        addGroup(positions.begin(), positions.end());
+        m_batchGroupColors.push_back(0);
+    }
+
+    const std::size_t nbBatches = m_batchElements.size() / W;
+    constexpr unsigned int NbGP = simd::NbGaussPoints;
+    m_batchStressOperators.assign(nbBatches*NbGP*6*12*W, 0.0);
+    m_batchStiffness.assign(nbBatches*12*12*W, 0.0);
+    m_batchGaussWeights.assign(nbBatches*NbGP*W, 0.0);
+
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+    for (std::size_t batch = 0; batch < nbBatches; batch++)
+    {
+        for (unsigned int lane = 0; lane < W; lane++)
+        {
+            const int k = m_batchElements[batch*W + lane];
+            if (k >= 0)
+                computeBatchOperators(batch, lane, bd[m_elementOrder[k]]);
+        }
+    }
+
+    m_elasticBatchKernel = simd::getElasticBatchKernel(instructionSet);
+    updateBatchYieldLimits();
+    msg_info() << "Batched elastic kernel: " << simd::getInstructionSetName(instructionSet) << ", "
+               << nbBatches << " batches of " << W << " elements";
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::updateBatchYieldLimits()
+{
+    if (!m_elasticBatchKernel)
+        return;
+
+    constexpr unsigned int W = simd::BatchWidth;
+    constexpr unsigned int NbGP = simd::NbGaussPoints;
+    const std::size_t nbBatches = m_batchElements.size() / W;
+
+    // The padding lanes never yield
+    m_batchSquaredYieldLimits.assign(nbBatches*NbGP*W, std::numeric_limits<double>::max());
+
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+    for (std::size_t batch = 0; batch < nbBatches; batch++)
+    {
+        for (unsigned int lane = 0; lane < W; lane++)
+        {
+            const int k = m_batchElements[batch*W + lane];
+            if (k < 0)
+                continue;
+
+            // Same criterion as goToPlastic, on the squared equivalent stress
+            const BeamInfo& beam = bd[m_elementOrder[k]];
+            for (unsigned int gp = 0; gp < NbGP; gp++)
+            {
+                const double yieldLimit = beam._localYieldStresses[gp] + m_stressComparisonThreshold;
+                m_batchSquaredYieldLimits[(batch*NbGP + gp)*W + lane] = yieldLimit*yieldLimit;
+            }
+        }
+    }
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::clearBatchLane(std::size_t batch, unsigned int lane)
+{
+    constexpr unsigned int W = simd::BatchWidth;
+    constexpr unsigned int NbGP = simd::NbGaussPoints;
+    for (std::size_t k = 0; k < NbGP*6*12; k++)
+        m_batchStressOperators[(batch*NbGP*6*12 + k)*W + lane] = 0.0;
+    for (std::size_t k = 0; k < 12*12; k++)
+        m_batchStiffness[(batch*12*12 + k)*W + lane] = 0.0;
+    for (std::size_t k = 0; k < NbGP; k++)
+        m_batchGaussWeights[(batch*NbGP + k)*W + lane] = 0.0;
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::computeBatchOperators(std::size_t batch, unsigned int lane, const BeamInfo& beam)
+{
+    constexpr unsigned int W = simd::BatchWidth;
+    constexpr unsigned int NbGP = simd::NbGaussPoints;
+    double* stressOperators = m_batchStressOperators.data() + batch*NbGP*6*12*W + lane;
+    double* stiffness = m_batchStiffness.data() + batch*12*12*W + lane;
+    double* gaussWeights = m_batchGaussWeights.data() + batch*NbGP*W + lane;
+
+    const Matrix6x6& C = m_materials[beam._materialIndex]._materialBehaviour;
+
+    typedef std::function<void(double, double, double, double, double, double)> LambdaType;
+    typedef ozp::quadrature::Gaussian<3> GaussianQuadratureType;
+
+    int gaussPointIt = 0;
+    LambdaType computeOperators = [&](double u1, double u2, double u3, double w1, double w2, double w3)
+    {
+        SOFA_UNUSED(u1);
+        SOFA_UNUSED(u2);
+        SOFA_UNUSED(u3);
+        const StorageMatrix6x12& Be = beam._BeMatrices[gaussPointIt];
+        const double weight = w1*w2*w3;
+
+        // Stress operator C*Be
+        double CBe[6][12];
+        for (int r = 0; r < 6; r++)
+            for (int c = 0; c < 12; c++)
+            {
+                double sum = 0.0;
+                for (int m = 0; m < 6; m++)
+                    sum += C[r][m] * Be[m][c];
+                CBe[r][c] = sum;
+                stressOperators[((gaussPointIt*6 + r)*12 + c)*W] = sum;
+            }
+
+        // Stiffness, integrated as the forces in beTTensor2Mult: the 3 shear
+        // components are counted twice (symmetrical terms missing in Voigt notation)
+        for (int r = 0; r < 12; r++)
+            for (int c = 0; c < 12; c++)
+            {
+                double sum = 0.0;
+                for (int m = 0; m < 6; m++)
+                    sum += (m < 3 ? 1.0 : 2.0) * Be[m][r] * CBe[m][c];
+                stiffness[(r*12 + c)*W] += weight*sum;
+            }
+
+        gaussWeights[gaussPointIt*W] = weight;
+
+        gaussPointIt++; //Next Gauss Point
+    };
+
+    ozp::quadrature::detail::Interval<3> interval = beam._integrationInterval;
+    ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(interval, computeOperators);
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::accumulateElasticBatch(std::size_t batch, VecDeriv& f, const VecCoord& x,
+                                                                 const VecCoord& x0, type::vector<BeamInfo>& beams,
+                                                                 LocalNewtonStatistics& statistics,
+                                                                 unsigned int& nbBatchedElements, unsigned int chunk)
+{
+    constexpr unsigned int W = simd::BatchWidth;
+    constexpr unsigned int NbGP = simd::NbGaussPoints;
+
+    double displacementIncrements[12*W] = {};
+    double prevForces[12*W] = {};
+    double prevStresses[NbGP*6*W] = {};
+    double newStresses[NbGP*6*W];
+    double forces[12*W];
+    Vec12 lastDisps[W];
+
+    // Gathers the beam elements whose Gauss points have never been plastic. The
+    // other elements are computed element by element.
+    unsigned int batchedLanes = 0;
+    for (unsigned int lane = 0; lane < W; lane++)
+    {
+        const int k = m_batchElements[batch*W + lane];
+        if (k < 0)
+            continue;
+        const unsigned int i = m_elementOrder[k];
+        const Index a = m_orderedElements[k][0];
+        const Index b = m_orderedElements[k][1];
+        BeamInfo& beam = beams[i];
+
+        const Vec<27, MechanicalState>& pointMechanicalState = beam._pointMechanicalState;
+        if (std::any_of(pointMechanicalState.begin(), pointMechanicalState.end(),
+                        [](MechanicalState state) { return state != MechanicalState::ELASTIC; }))
+        {
+            accumulateNonLinearForce(f, x, x0, beam, a, b, statistics, chunk);
+            accumulateEnergies(beam, chunk);
+            accumulateCriticalElement(beam, i, chunk);
+            continue;
+        }
+
+        Vec12 currentDisp;
+        Vec12 dispIncrement;
+        {
+            typename PhaseTimer::Scope timing(m_phaseTimer, COROTATION, chunk);
+            computeDisplacementIncrement(x, m_lastPos.getValue(), x0, currentDisp, lastDisps[lane], dispIncrement, beam, a, b);
+        }
+        for (unsigned int c = 0; c < 12; c++)
+        {
+            displacementIncrements[c*W + lane] = dispIncrement[c];
+            prevForces[c*W + lane] = beam._internalForces[c];
+        }
+        for (unsigned int gp = 0; gp < NbGP; gp++)
+            for (unsigned int r = 0; r < 6; r++)
+                prevStresses[(gp*6 + r)*W + lane] = beam._prevStresses[gp][r][0];
+
+        batchedLanes |= 1u << lane;
+    }
+
+    if (batchedLanes == 0)
+        return;
+
+    simd::ElasticBatchArguments arguments;
+    arguments.stressOperators = m_batchStressOperators.data() + batch*NbGP*6*12*W;
+    arguments.stiffness = m_batchStiffness.data() + batch*12*12*W;
+    arguments.squaredYieldLimits = m_batchSquaredYieldLimits.data() + batch*NbGP*W;
+    arguments.prevStresses = prevStresses;
+    arguments.prevForces = prevForces;
+    arguments.displacementIncrements = displacementIncrements;
+    arguments.newStresses = newStresses;
+    arguments.forces = forces;
+    unsigned int yieldedLanes;
+    {
+        typename PhaseTimer::Scope timing(m_phaseTimer, STRESS_UPDATE, chunk);
+        yieldedLanes = m_elasticBatchKernel(arguments);
+    }
+
+    const bool storeElasticPredictors = d_useConsistentTangentOperator.getValue() && !d_explicitMode.getValue();
+    const double* gaussWeights = m_batchGaussWeights.data() + batch*NbGP*W;
+    for (unsigned int lane = 0; lane < W; lane++)
+    {
+        if (!(batchedLanes & (1u << lane)))
+            continue;
+
+        const int k = m_batchElements[batch*W + lane];
+        const unsigned int i = m_elementOrder[k];
+        const Index a = m_orderedElements[k][0];
+        const Index b = m_orderedElements[k][1];
+        BeamInfo& beam = beams[i];
+
+        if (yieldedLanes & (1u << lane))
+        {
+            // Plastic deformation: the elastic predictor is discarded. In explicit
+            // mode, the displacement of the previous call has been replaced by the
+            // gathering, and is restored for the new computation of the increment.
+            if (d_explicitMode.getValue())
+                beam._currentDisp = lastDisps[lane];
+            accumulateNonLinearForce(f, x, x0, beam, a, b, statistics, chunk);
+            accumulateEnergies(beam, chunk);
+            accumulateCriticalElement(beam, i, chunk);
+            continue;
+        }
+
+        Real elasticEnergy = 0;
+        for (unsigned int gp = 0; gp < NbGP; gp++)
+        {
+            StorageVoigtTensor2& stress = beam._prevStresses[gp];
+            for (unsigned int r = 0; r < 6; r++)
+                stress[r][0] = newStresses[(gp*6 + r)*W + lane];
+            if (storeElasticPredictors)
+                beam._elasticPredictors[gp] = stress;
+            elasticEnergy += gaussWeights[gp*W + lane]*elasticEnergyDensity(VoigtTensor2(stress), beam._E, beam._nu);
+        }
+        // No plastic work: the element has never been plastic
+        beam._elasticEnergy = elasticEnergy;
+        // Same update as computeForceWithHardening for an element which does not yield
+        beam._beamMechanicalState = MechanicalState::POSTPLASTIC;
+        accumulateEnergies(beam, chunk);
+        accumulateCriticalElement(beam, i, chunk);
+
+        PlasticityActivity& activity = m_plasticityActivity[chunk];
+        activity.nbBeams[int(MechanicalState::ELASTIC)]++;
+        activity.nbGaussPoints[int(MechanicalState::ELASTIC)] += NbGP;
+
+        for (unsigned int c = 0; c < 12; c++)
+            beam._internalForces[c] = forces[c*W + lane];
+        addElementForce(f, x, a, b, beam._internalForces);
+        nbBatchedElements++;
+    }
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::initBeams(size_t size)
+{
+    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
+    bd.resize(size);
+    m_beamsData.endEdit();
+}
+
+template <class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::reinitBeam(unsigned int i, bool computeMatrices)
+{
+    const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+
+    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
+    initBeam(i, (*m_indexedElements)[i], bd[i], x0, computeMatrices);
+    m_beamsData.endEdit();
+    m_drawShapeFunctionsOutdated = true;
+}
+
+template <class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::reinitBeams(bool computeMatrices)
+{
+    const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+
+    // Single edit scope for all elements, which are independent
+    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
+    forEachChunk(getNbInitChunks(), bd.size(), [&](unsigned int, std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+            initBeam(static_cast<unsigned int>(i), (*m_indexedElements)[i], bd[i], x0, computeMatrices);
+    });
+    m_beamsData.endEdit();
+    m_drawShapeFunctionsOutdated = true;
+}
+
+template <class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::getTableIndices(unsigned int i, unsigned int& materialIndex, unsigned int& sectionIndex) const
+{
+    // Elements added by topological changes, beyond the index tables, use the first entries
+    const auto& materialIndices = d_materialIndices.getValue();
+    const auto& sectionIndices = d_sectionIndices.getValue();
+    materialIndex = i < materialIndices.size() ? materialIndices[i] : 0;
+    sectionIndex = i < sectionIndices.size() ? sectionIndices[i] : 0;
+}
+
+template <class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::initBeam(unsigned int i, const Element& element, BeamInfo& beam, const VecCoord& x0, bool computeMatrices)
+{
+    Real stiffness, yieldStress, length, poisson, zSection, ySection;
+    Index a = element[0];
+    Index b = element[1];
+
+    unsigned int materialIndex, sectionIndex;
+    getTableIndices(i, materialIndex, sectionIndex);
+    const MaterialInfo& material = m_materials[materialIndex];
+
+    stiffness = material._E;
+
+    yieldStress = material._yieldStress;
+    length = (x0[a].getCenter()-x0[b].getCenter()).norm() ;
+
+    zSection = m_sections[sectionIndex][0];
+    ySection = m_sections[sectionIndex][1];
+    poisson = material._nu;
+
+    beam.init(stiffness, yieldStress, length, poisson, zSection, ySection, d_isTimoshenko.getValue(), computeMatrices);
+
+    beam._materialIndex = materialIndex;
+    beam._sectionIndex = sectionIndex;
+
+    // Initialisation of the elastic stiffness matrix (otherwise loaded from the element cache)
+    if (computeMatrices)
+    {
+        if (d_usePrecomputedStiffness.getValue())
+            computeStiffness(beam);
+        else
+            computeVDStiffness(beam);
+    }
+    // Initialisation of the tangent stiffness matrix
+    beam._Kt_loc.clear();
+
+    // Initialisation of the beam element orientation
+    //TO DO: is necessary ?
+    beam.quat = x0[a].getOrientation();
+    beam.quat.normalize();
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::computeShapeFunction(unsigned int i, const Vec3& localPosition, Matrix3x12& N) const
+{
+    m_beamsData.getValue()[i].computeShapeFunction(localPosition, d_isTimoshenko.getValue(), N);
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::setBeam(unsigned int i, Real E, Real yS, Real L, Real nu, Real zSection, Real ySection, bool computeMatrices)
+{
+    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
+    bd[i].init(E, yS, L, nu, zSection, ySection, d_isTimoshenko.getValue(), computeMatrices);
+    m_beamsData.endEdit();
+    m_drawShapeFunctionsOutdated = true;
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::BeamInfo::init(Real E, Real yS, Real L, Real nu, Real zSection, Real ySection, bool isTimoshenko, bool computeMatrices)
+{
+    _E = E;
+    _nu = nu;
+    _L = L;
+
+    _zDim = zSection;
+    _yDim = ySection;
+
+    _G = _E / (2.0*(1.0 + _nu));
+    _Iz = ySection*ySection*ySection*zSection / 12.0;
+
+    _Iy = zSection*zSection*zSection*ySection / 12.0;
+    _J = _Iz + _Iy;
+    _A = zSection*ySection;
+
+    Real phiY, phiZ;
+    computeShearCoefficients(phiY, phiZ);
+
+    Real phiYInv = (1 / (1 + phiY));
+    Real phiZInv = (1 / (1 + phiZ));
+
+    _integrationInterval = ozp::quadrature::make_interval(0, -ySection / 2, -zSection / 2, L, ySection / 2, zSection / 2);
+
+    resetPlasticHistory(yS);
+
+    if (!computeMatrices)
+        return;
+
+    //Computation of the Be matrix for this beam element, based on the integration points.
+
+    typedef ozp::quadrature::Gaussian<3> GaussianQuadratureType;
+    typedef std::function<void(double, double, double, double, double, double)> LambdaType;
+
+    sofa::Index gaussPointIndex = 0; //Gauss Point iterator
+
+    //Euler-Bernoulli beam theory
+    LambdaType initBeMatrixEulerB = [&](double u1, double u2, double u3, double w1, double w2, double w3)
+    {
+        SOFA_UNUSED(w1);
+        SOFA_UNUSED(w2);
+        SOFA_UNUSED(w3);
+        auto& BeMatrix = _BeMatrices[gaussPointIndex];
+        // Step 1: total strain computation
+        Real xi = u1 / _L;
+        Real eta = u2 / _L;
+        Real zeta = u3 / _L;
+
+        BeMatrix(0, 0) = -1 / _L;
+        BeMatrix(1, 0) = BeMatrix(2, 0) = BeMatrix(3, 0) = BeMatrix(4, 0) = BeMatrix(5, 0) = 0.0;
+
+        BeMatrix(0, 1) = (6 * eta*(1 - 2 * xi)) / _L;
+        BeMatrix(1, 1) = BeMatrix(2, 1) = BeMatrix(3, 1) = BeMatrix(4, 1) = BeMatrix(5, 1) = 0.0;
+
+        BeMatrix(0, 2) = (6 * zeta*(1 - 2 * xi)) / _L;
+        BeMatrix(1, 2) = BeMatrix(2, 2) = BeMatrix(3, 2) = BeMatrix(4, 2) = BeMatrix(5, 2) = 0.0;
+
+        BeMatrix(0, 3) = BeMatrix(1, 3) = BeMatrix(2, 3) = 0.0;
+        BeMatrix(3, 3) = 0;
+        BeMatrix(4, 3) = -eta / 2;
+        BeMatrix(5, 3) = zeta / 2;
+
+        BeMatrix(0, 4) = zeta * (6 * xi - 4);
+        BeMatrix(1, 4) = BeMatrix(2, 4) = BeMatrix(3, 4) = BeMatrix(4, 4) = BeMatrix(5, 4) = 0.0;
+
+        BeMatrix(0, 5) = eta * (4 - 6 * xi);
+        BeMatrix(1, 5) = BeMatrix(2, 5) = BeMatrix(3, 5) = BeMatrix(4, 5) = BeMatrix(5, 5) = 0.0;
+
+//        BeMatrix.block<6, 1>(0, 6) = -BeMatrix.block<6, 1>(0, 0);
+
+//        BeMatrix.block<6, 1>(0, 7) = -BeMatrix.block<6, 1>(0, 1);
+
+//        BeMatrix.block<6, 1>(0, 8) = -BeMatrix.block<6, 1>(0, 2);
+
+        Mat<6, 1, StorageReal> subMat;
+        BeMatrix.getsub(0, 0, subMat);
+        BeMatrix.setsub(0, 6, -subMat);
+        BeMatrix.getsub(0, 1, subMat);
+        BeMatrix.setsub(0, 7, -subMat);
+        BeMatrix.getsub(0, 2, subMat);
+        BeMatrix.setsub(0, 8, -subMat);
+
+        BeMatrix(0, 9) = BeMatrix(1, 9) = BeMatrix(2, 9) = 0.0;
+        BeMatrix(3, 9) = 0;
+        BeMatrix(4, 9) = eta / 2;
+        BeMatrix(5, 9) = -zeta / 2;
+
+        BeMatrix(0, 10) = zeta * (6 * xi - 2);
+        BeMatrix(1, 10) = BeMatrix(2, 10) = BeMatrix(3, 10) = BeMatrix(4, 10) = BeMatrix(5, 10) = 0.0;
+
+        BeMatrix(0, 11) = eta * (2 - 6 * xi);
+        BeMatrix(1, 11) = BeMatrix(2, 11) = BeMatrix(3, 11) = BeMatrix(4, 11) = BeMatrix(5, 11) = 0.0;
+
+        gaussPointIndex++;
+    };
 
     //Timoshenko beam theory
     LambdaType initBeMatrixTimo = [&](double u1, double u2, double u3, double w1, double w2, double w3)
@@ -361,9 +1439,9 @@ void BeamPlasticFEMForceField<DataTypes>::BeamInfo::init(double E, double yS, do
         auto& BeMatrix = _BeMatrices[gaussPointIndex];
         
         // Step 1: total strain computation
-        double xi = u1 / _L;
-        double eta = u2 / _L;
-        double zeta = u3 / _L;
+        Real xi = u1 / _L;
+        Real eta = u2 / _L;
+        Real zeta = u3 / _L;
 
         //row 0
         BeMatrix(0, 0) = -1 / _L;
@@ -419,25 +1497,50 @@ void BeamPlasticFEMForceField<DataTypes>::BeamInfo::init(double E, double yS, do
         ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(_integrationInterval, initBeMatrixTimo);
     else
         ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(_integrationInterval, initBeMatrixEulerB);
+}
 
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::BeamInfo::computeShearCoefficients(Real& phiY, Real& phiZ) const
+{
+    Real L2 = _L*_L;
+    Real kappaY = 1.0;
+    Real kappaZ = 1.0;
 
-    sofa::Index gaussPointIt = 0; //Gauss Point iterator
+    if (_A == 0)
+    {
+        phiY = 0.0;
+        phiZ = 0.0;
+    }
+    else
+    {
+        phiY = (12.0*_E*_Iy / (kappaZ*_G*_A*L2));
+        phiZ = (12.0*_E*_Iz / (kappaY*_G*_A*L2));
+    }
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::BeamInfo::computeShapeFunction(const Vec3& localPosition, bool isTimoshenko,
+                                                                   Matrix3x12& N) const
+{
+    Real phiY, phiZ;
+    computeShearCoefficients(phiY, phiZ);
 
-    // Euler-Bernoulli beam model
-    LambdaType initialiseEBShapeFunctions = [&](double u1, double u2, double u3, double w1, double w2, double w3)
+    Real phiYInv = (1 / (1 + phiY));
+    Real phiZInv = (1 / (1 + phiZ));
+
+    const Real u1 = localPosition[0];
+    const Real u2 = localPosition[1];
+    const Real u3 = localPosition[2];
+
+    if (!isTimoshenko)
     {
-        SOFA_UNUSED(w1);
-        SOFA_UNUSED(w2);
-        SOFA_UNUSED(w3);
-        auto& N = _N[gaussPointIt];
-        
-        // Step 1: total strain computation
-        double xi = u1 / _L;
-        double eta = u2 / _L;
-        double zeta = u3 / _L;
+        // Euler-Bernoulli beam model
+        Real xi = u1 / _L;
+        Real eta = u2 / _L;
+        Real zeta = u3 / _L;
 
-        double xi2 = xi*xi;
-        double xi3 = xi*xi*xi;
+        Real xi2 = xi*xi;
+        Real xi3 = xi*xi*xi;
 
         N(0, 0) = 1 - xi;
         N(0, 1) = 6 * (xi - xi2)*eta;
@@ -477,24 +1580,16 @@ void BeamPlasticFEMForceField<DataTypes>::BeamInfo::init(double E, double yS, do
         N(2, 9) = _L*xi*eta;
         N(2, 10) = (xi2 - xi3)*_L;
         N(2, 11) = 0;
-
-        gaussPointIt++;
-    };
-
-    // Timoshenko beam model
-    LambdaType initialiseTShapeFunctions = [&](double u1, double u2, double u3, double w1, double w2, double w3)
+    }
+    else
     {
-        SOFA_UNUSED(w1);
-        SOFA_UNUSED(w2);
-        SOFA_UNUSED(w3);
-        auto& N = _N[gaussPointIt];
-        
-        double xi = u1 / _L;
-        double eta = u2 / _L;
-        double zeta = u3 / _L;
+        // Timoshenko beam model
+        Real xi = u1 / _L;
+        Real eta = u2 / _L;
+        Real zeta = u3 / _L;
 
-        double xi2 = xi*xi;
-        double xi3 = xi*xi*xi;
+        Real xi2 = xi*xi;
+        Real xi3 = xi*xi*xi;
 
         N(0, 0) = 1 - xi;
         N(0, 1) = 6 * phiZInv * (xi - xi2)*eta;
@@ -534,25 +1629,49 @@ void BeamPlasticFEMForceField<DataTypes>::BeamInfo::init(double E, double yS, do
         N(2, 9) = _L * xi * eta;
         N(2, 10) = -_L * phiYInv * (-xi2 + xi3 - (phiY / 2)*(xi - xi2));
         N(2, 11) = 0;
+    }
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::BeamInfo::computeGaussPointShapeFunctions(Vec<27, Matrix3x12>& shapeFunctions,
+                                                                                  bool isTimoshenko) const
+{
+    typedef ozp::quadrature::Gaussian<3> GaussianQuadratureType;
+    typedef std::function<void(double, double, double, double, double, double)> LambdaType;
 
+    sofa::Index gaussPointIt = 0; //Gauss Point iterator
+
+    LambdaType initialiseShapeFunctions = [&](double u1, double u2, double u3, double w1, double w2, double w3)
+    {
+        SOFA_UNUSED(w1);
+        SOFA_UNUSED(w2);
+        SOFA_UNUSED(w3);
+        computeShapeFunction(Vec3(u1, u2, u3), isTimoshenko, shapeFunctions[gaussPointIt]);
         gaussPointIt++;
     };
 
-    if (isTimoshenko)
-        ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(_integrationInterval, initialiseTShapeFunctions);
-    else
-        ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(_integrationInterval, initialiseEBShapeFunctions);
+    ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(_integrationInterval, initialiseShapeFunctions);
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::BeamInfo::computeCentrelineShapeFunctions(Matrix3x12* shapeFunctions,
+                                                                                  sofa::Size nbSegments,
+                                                                                  bool isTimoshenko) const
+{
+    Real phiY, phiZ;
+    computeShearCoefficients(phiY, phiZ);
 
-    //Intialises the drawing points shape functions
+    Real phiYInv = (1 / (1 + phiY));
+    Real phiZInv = (1 / (1 + phiZ));
 
     if (!isTimoshenko)
     {
-        for (sofa::Index i = 1; i < _nbCentrelineSeg; i++)
+        for (sofa::Index i = 1; i < nbSegments; i++)
         {
-            auto& drawN = _drawN[i-1];
-            double xi = i*(_L / _nbCentrelineSeg) / _L;
-            double xi2 = xi*xi;
-            double xi3 = xi*xi*xi;
+            auto& drawN = shapeFunctions[i-1];
+            Real xi = Real(i) / nbSegments;
+            Real xi2 = xi*xi;
+            Real xi3 = xi*xi*xi;
 
             //NB :
             //double eta = 0;
@@ -598,103 +1717,814 @@ void BeamPlasticFEMForceField<DataTypes>::BeamInfo::init(double E, double yS, do
             drawN(2, 11) = 0;
         }
     }
-    else
+    else
+    {
+        for (sofa::Index i = 1; i < nbSegments; i++)
+        {
+            auto& drawN = shapeFunctions[i-1];
+            Real xi = Real(i) / nbSegments;
+            Real xi2 = xi*xi;
+            Real xi3 = xi*xi*xi;
+
+            //NB :
+            //double eta = 0;
+            //double zeta = 0;
+            drawN(0, 0) = 1 - xi;
+            drawN(0, 1) = 0;
+            drawN(0, 2) = 0;
+            drawN(0, 3) = 0;
+            drawN(0, 4) = 0;
+            drawN(0, 5) = 0;
+            drawN(0, 6) = xi;
+            drawN(0, 7) = 0;
+            drawN(0, 8) = 0;
+            drawN(0, 9) = 0;
+            drawN(0, 10) = 0;
+            drawN(0, 11) = 0;
+
+            drawN(1, 0) = 0;
+            drawN(1, 1) = phiZInv * (1 - 3 * xi2 + 2 * xi3 + phiZ*(1 - xi));
+            drawN(1, 2) = 0;
+            drawN(1, 3) = 0;
+            drawN(1, 4) = 0;
+            drawN(1, 5) = _L * phiZInv * (xi - 2 * xi2 + xi3 + (phiZ / 2)*(xi - xi2));
+            drawN(1, 6) = 0;
+            drawN(1, 7) = phiZInv * (3 * xi2 - 2 * xi3 + phiZ*xi);
+            drawN(1, 8) = 0;
+            drawN(1, 9) = 0;
+            drawN(1, 10) = 0;
+            drawN(1, 11) = _L * phiZInv *(-xi2 + xi3 - (phiZ / 2)*(xi - xi2));
+
+            drawN(2, 0) = 0;
+            drawN(2, 1) = 0;
+            drawN(2, 2) = phiYInv * (1 - 3 * xi2 + 2 * xi3 + phiY*(1 - xi));
+            drawN(2, 3) = 0;
+            drawN(2, 4) = -_L * phiYInv * (xi - 2 * xi2 + xi3 + (phiY / 2)*(xi - xi2));
+            drawN(2, 5) = 0;
+            drawN(2, 6) = 0;
+            drawN(2, 7) = 0;
+            drawN(2, 8) = phiYInv * (3 * xi2 - 2 * xi3 + phiY*xi);
+            drawN(2, 9) = 0;
+            drawN(2, 10) = -_L * phiYInv * (-xi2 + xi3 - (phiY / 2)*(xi - xi2));
+            drawN(2, 11) = 0;
+        }
+    }
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::BeamInfo::resetPlasticHistory(Real yS)
+{
+    // Initialises the plastic indicators
+    // NB: each vector contains 27 components,
+    // associated with the 27 Gauss points used for reduced integration
+    _pointMechanicalState.assign(MechanicalState::ELASTIC);
+    _beamMechanicalState = MechanicalState::ELASTIC;
+    _maxEigenvalue = _elasticMaxEigenvalue;
+    
+    _prevStresses.assign(StorageVoigtTensor2());
+    _elasticPredictors.assign(StorageVoigtTensor2());
+    _localYieldStresses.assign(yS);
+    _backStresses.assign(StorageVoigtTensor2()); // TO DO: check if zero is correct
+    _plasticStrainHistory.assign(StorageVoigtTensor2());
+    _effectivePlasticStrains.assign(0.0);
+    _plasticMultipliers.assign(0.0);
+    _internalForces.clear();
+    _Kt_loc.clear();
+    _elasticEnergy = 0;
+    _plasticDissipation = 0;
+}
+
+template <class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::reset()
+{
+    // Stresses, plasticity history and internal forces corresponding to the stresses
+    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
+    for (BeamInfo& beam : bd)
+        beam.resetPlasticHistory(m_materials[beam._materialIndex]._yieldStress);
+    m_beamsData.endEdit();
+
+    m_lastPos.setValue(this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue());
+    m_hasForceDisplacements = false;
+
+    if (d_loadCheckpoint.getValue())
+        loadCheckpoint(d_checkpointFile.getFullPath());
+
+    // The yield limits of the batched kernel depend on the yield stresses
+    updateBatchYieldLimits();
+
+    publishEnergies();
+
+    if (m_displacementTrace)
+        m_displacementTrace->writeReset(this->getContext()->getTime());
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::publishPlasticityActivity()
+{
+    PlasticityActivity total;
+    for (const PlasticityActivity& activity : m_plasticityActivity)
+    {
+        for (int state = 0; state < 3; state++)
+        {
+            total.nbBeams[state] += activity.nbBeams[state];
+            total.nbGaussPoints[state] += activity.nbGaussPoints[state];
+        }
+        total.nbReturnMappings += activity.nbReturnMappings;
+        total.nbTangentUpdates += activity.nbTangentUpdates;
+        total.maxEffectivePlasticStrain = std::max(total.maxEffectivePlasticStrain, activity.maxEffectivePlasticStrain);
+    }
+
+    d_nbElasticBeams.setValue(total.nbBeams[int(MechanicalState::ELASTIC)]);
+    d_nbPlasticBeams.setValue(total.nbBeams[int(MechanicalState::PLASTIC)]);
+    d_nbPostPlasticBeams.setValue(total.nbBeams[int(MechanicalState::POSTPLASTIC)]);
+    d_nbElasticGaussPoints.setValue(total.nbGaussPoints[int(MechanicalState::ELASTIC)]);
+    d_nbPlasticGaussPoints.setValue(total.nbGaussPoints[int(MechanicalState::PLASTIC)]);
+    d_nbPostPlasticGaussPoints.setValue(total.nbGaussPoints[int(MechanicalState::POSTPLASTIC)]);
+    d_nbReturnMappings.setValue(total.nbReturnMappings);
+    d_nbTangentUpdates.setValue(total.nbTangentUpdates);
+    d_maxEffectivePlasticStrain.setValue(total.maxEffectivePlasticStrain);
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::accumulateEnergies(const BeamInfo& beam, unsigned int chunk)
+{
+    ChunkEnergies& energies = m_chunkEnergies[chunk];
+    energies.elasticEnergy += beam._elasticEnergy;
+    energies.plasticDissipation += beam._plasticDissipation;
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::publishEnergies()
+{
+    // Sums in element order, so that the totals do not depend on the parallel
+    // processing of the elements
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+    Real elasticEnergy = 0;
+    Real plasticDissipation = 0;
+    for (const BeamInfo& beam : bd)
+    {
+        elasticEnergy += beam._elasticEnergy;
+        plasticDissipation += beam._plasticDissipation;
+    }
+
+    d_elasticEnergy.setValue(elasticEnergy);
+    d_plasticDissipation.setValue(plasticDissipation);
+    publishBeamEnergies();
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::publishChunkEnergies()
+{
+    // The chunks are merged in the same order at each time step: the totals
+    // only depend on the number of chunks
+    ChunkEnergies total;
+    for (const ChunkEnergies& energies : m_chunkEnergies)
+    {
+        total.elasticEnergy += energies.elasticEnergy;
+        total.plasticDissipation += energies.plasticDissipation;
+    }
+
+    d_elasticEnergy.setValue(total.elasticEnergy);
+    d_plasticDissipation.setValue(total.plasticDissipation);
+    m_beamEnergiesOutdated = true;
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::publishBeamEnergies()
+{
+    m_beamEnergiesOutdated = false;
+
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+    type::vector<Real>& beamElasticEnergies = *d_beamElasticEnergies.beginWriteOnly();
+    type::vector<Real>& beamPlasticDissipations = *d_beamPlasticDissipations.beginWriteOnly();
+    beamElasticEnergies.resize(bd.size());
+    beamPlasticDissipations.resize(bd.size());
+    for (std::size_t i = 0; i < bd.size(); i++)
+    {
+        beamElasticEnergies[i] = bd[i]._elasticEnergy;
+        beamPlasticDissipations[i] = bd[i]._plasticDissipation;
+    }
+    d_beamElasticEnergies.endEdit();
+    d_beamPlasticDissipations.endEdit();
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::updateLumpedMasses()
+{
+    m_lumpedMassesOutdated = false;
+
+    const VecElement& elements = *m_indexedElements;
+    const std::size_t nbNodes = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue().size();
+    const sofa::core::behavior::BaseMass* mass = l_mass.get();
+    const Real massDensity = d_massDensity.getValue();
+
+    // Translational and rotational masses of the nodes, shared between their
+    // elements. The rotational inertia of a rigid mass is given in the frame of
+    // the node: its smallest diagonal term is used for the three rotations of
+    // the element frame, which overestimates the eigenfrequencies.
+    type::vector<Vec<2, Real>> nodeMasses;
+    if (mass)
+    {
+        type::vector<unsigned int> nbNodeElements(nbNodes, 0);
+        for (const Element& element : elements)
+        {
+            nbNodeElements[element[0]]++;
+            nbNodeElements[element[1]]++;
+        }
+
+        nodeMasses.resize(nbNodes);
+        sofa::linearalgebra::FullMatrix<SReal> nodeMass;
+        for (std::size_t n = 0; n < nbNodes; n++)
+        {
+            if (nbNodeElements[n] == 0)
+                continue;
+            nodeMass.clear();
+            mass->getElementMass(n, &nodeMass);
+            if (nodeMass.rowSize() < 6 || nodeMass.colSize() < 6)
+            {
+                msg_error() << "the mass component " << mass->getName() << " does not give a 6x6 mass matrix for the node "
+                            << n << ", the critical time step is not computed";
+                nodeMasses.clear();
+                break;
+            }
+            const SReal translationalMass = std::min({nodeMass.element(0, 0), nodeMass.element(1, 1), nodeMass.element(2, 2)});
+            const SReal rotationalMass = std::min({nodeMass.element(3, 3), nodeMass.element(4, 4), nodeMass.element(5, 5)});
+            nodeMasses[n] = Vec<2, Real>(translationalMass, rotationalMass) / nbNodeElements[n];
+        }
+    }
+
+    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
+    for (std::size_t i = 0; i < bd.size(); i++)
+    {
+        BeamInfo& beam = bd[i];
+        Vec12& lumpedMass = beam._lumpedMass;
+        lumpedMass.clear();
+
+        if (!nodeMasses.empty())
+        {
+            for (int node = 0; node < 2; node++)
+            {
+                const Vec<2, Real>& nodeMass = nodeMasses[elements[i][node]];
+                for (int k = 0; k < 3; k++)
+                {
+                    lumpedMass[6*node + k] = nodeMass[0];
+                    lumpedMass[6*node + 3 + k] = nodeMass[1];
+                }
+            }
+        }
+        else if (!mass && massDensity > 0)
+        {
+            // Half of the element mass and rotational inertia on each node
+            const Real halfLength = beam._L / 2;
+            const Vec<6, Real> nodeMass(massDensity*beam._A*halfLength, massDensity*beam._A*halfLength,
+                                        massDensity*beam._A*halfLength, massDensity*beam._J*halfLength,
+                                        massDensity*beam._Iy*halfLength, massDensity*beam._Iz*halfLength);
+            for (int k = 0; k < 6; k++)
+                lumpedMass[k] = lumpedMass[6 + k] = nodeMass[k];
+        }
+
+        beam._elasticMaxEigenvalue = computeMaxEigenvalueBound(d_usePrecomputedStiffness.getValue() ? beam._k_loc : beam._Ke_loc, lumpedMass);
+        const bool isPlastic = std::find(beam._pointMechanicalState.begin(), beam._pointMechanicalState.end(),
+                                         MechanicalState::PLASTIC) != beam._pointMechanicalState.end();
+        beam._maxEigenvalue = isPlastic ? computeMaxEigenvalueBound(beam._Kt_loc, lumpedMass) : beam._elasticMaxEigenvalue;
+    }
+    m_beamsData.endEdit();
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::publishCriticalTimeStep()
+{
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+    Real maxEigenvalue = 0;
+    unsigned int criticalElement = 0;
+    for (std::size_t i = 0; i < bd.size(); i++)
+    {
+        if (bd[i]._maxEigenvalue > maxEigenvalue)
+        {
+            maxEigenvalue = bd[i]._maxEigenvalue;
+            criticalElement = static_cast<unsigned int>(i);
+        }
+    }
+
+    d_criticalTimeStep.setValue(maxEigenvalue > 0 ? 2 / std::sqrt(maxEigenvalue) : Real(0));
+    d_criticalElement.setValue(criticalElement);
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::accumulateCriticalElement(const BeamInfo& beam, unsigned int i, unsigned int chunk)
+{
+    // Ties go to the lowest element index, as in publishCriticalTimeStep,
+    // whatever the order in which the elements are processed
+    ChunkCriticalElement& critical = m_chunkCriticalElements[chunk];
+    if (beam._maxEigenvalue > critical.maxEigenvalue
+        || (beam._maxEigenvalue == critical.maxEigenvalue && beam._maxEigenvalue > 0 && i < critical.element))
+    {
+        critical.maxEigenvalue = beam._maxEigenvalue;
+        critical.element = i;
+    }
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::publishChunkCriticalTimeStep()
+{
+    ChunkCriticalElement critical;
+    for (const ChunkCriticalElement& chunkCritical : m_chunkCriticalElements)
+    {
+        if (chunkCritical.maxEigenvalue > critical.maxEigenvalue
+            || (chunkCritical.maxEigenvalue == critical.maxEigenvalue && chunkCritical.maxEigenvalue > 0
+                && chunkCritical.element < critical.element))
+            critical = chunkCritical;
+    }
+
+    d_criticalTimeStep.setValue(critical.maxEigenvalue > 0 ? 2 / std::sqrt(critical.maxEigenvalue) : Real(0));
+    d_criticalElement.setValue(critical.element);
+}
+
+template<class DataTypes>
+auto BeamPlasticFEMForceField<DataTypes>::computeMaxEigenvalueBound(const Matrix12x12& K, const Vec12& lumpedMass) -> Real
+{
+    if (lumpedMass.norm2() == 0)
+        return 0;
+
+    // A massless degree of freedom with a non-zero stiffness gives an infinite bound
+    Vec12 invSqrtMass;
+    for (int i = 0; i < 12; i++)
+        invSqrtMass[i] = lumpedMass[i] > 0 ? 1 / std::sqrt(lumpedMass[i]) : std::numeric_limits<Real>::infinity();
+
+    Real bound = 0;
+    for (int i = 0; i < 12; i++)
+    {
+        Real rowSum = 0;
+        for (int j = 0; j < 12; j++)
+            if (K[i][j] != 0)
+                rowSum += std::abs(K[i][j])*invSqrtMass[j];
+        if (rowSum != 0)
+            bound = std::max(bound, rowSum*invSqrtMass[i]);
+    }
+    return bound;
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::handleEvent(core::objectmodel::Event* event)
+{
+    if (!sofa::simulation::AnimateEndEvent::checkEventType(event))
+        return;
+
+    if (d_saveCheckpoint.getValue())
+    {
+        saveCheckpoint(d_checkpointFile.getFullPath());
+        d_saveCheckpoint.setValue(false);
+    }
+
+    publishPhaseTimes();
+    if (m_beamEnergiesOutdated)
+        publishBeamEnergies();
+
+    // The trace stays usable if the simulation is interrupted
+    if (m_displacementTrace)
+        m_displacementTrace->flush();
+
+    if (m_historyWriter)
+        recordHistorySnapshot();
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::openDisplacementTrace(const std::string& filename)
+{
+    m_displacementTrace = std::make_unique<io::DisplacementTraceWriter>(filename);
+    if (!m_displacementTrace->isValid())
+    {
+        msg_error() << "Cannot create the displacement trace file " << filename;
+        m_displacementTrace.reset();
+        return;
+    }
+
+    // Attributes given in the scene, to recreate the component at replay. The
+    // internal and output Data are excluded, as well as the trace file itself.
+    std::vector<io::DisplacementTraceAttribute> attributes;
+    for (const sofa::core::BaseData* data : this->getDataFields())
+    {
+        if (!data->isSet() || data->isReadOnly()
+            || data == &d_displacementTraceFile || data == &d_historyFile || data == &m_lastPos || data == &m_beamsData)
+            continue;
+        attributes.emplace_back(data->getName(), data->getValueString());
+    }
+
+    const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    m_displacementTrace->writeHeader(attributes, m_indexedElements->data(), m_indexedElements->size(),
+                                     x0.data(), x0.size());
+    msg_info() << "Recording the displacement trace " << filename << " (" << attributes.size() << " attributes)";
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::openHistory(const std::string& prefix)
+{
+    const std::size_t nbElements = m_beamsData.getValue().size();
+    m_historyElements = d_historyElements.getValue();
+    if (m_historyElements.empty())
+    {
+        m_historyElements.resize(nbElements);
+        std::iota(m_historyElements.begin(), m_historyElements.end(), 0u);
+    }
+    if (std::any_of(m_historyElements.begin(), m_historyElements.end(), [nbElements](unsigned int i) { return i >= nbElements; }))
+    {
+        msg_error() << "historyElements refers to elements beyond the " << nbElements << " beam elements, "
+                    << "the Gauss point history is not recorded";
+        return;
+    }
+
+    const std::vector<std::uint32_t> elements(m_historyElements.begin(), m_historyElements.end());
+    m_historyWriter = std::make_unique<io::AsyncHistoryWriter<StorageReal>>(prefix, elements, NbHistoryValuesPerElement,
+                                                                           d_historyChunkSize.getValue());
+    if (!m_historyWriter->isValid())
+    {
+        msg_error() << "Cannot create the Gauss point history file " << io::getGaussPointHistoryIndexName(prefix);
+        m_historyWriter.reset();
+        return;
+    }
+    m_historyStep = 0;
+    msg_info() << "Recording the Gauss point history of " << elements.size() << " elements in " << prefix;
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::recordHistorySnapshot()
+{
+    const std::uint64_t step = m_historyStep++;
+    if (step % std::max(d_historySamplingInterval.getValue(), 1u) != 0)
+        return;
+
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+    if (std::any_of(m_historyElements.begin(), m_historyElements.end(), [&bd](unsigned int i) { return i >= bd.size(); }))
+    {
+        msg_warning() << "Recorded elements have been removed, the recording of the Gauss point history is stopped";
+        closeHistory();
+        return;
+    }
+
+    StorageReal* values = m_historyWriter->beginSnapshot(this->getContext()->getTime(), step);
+    if (!values)
+    {
+        d_nbDroppedHistorySnapshots.setValue(static_cast<unsigned int>(m_historyWriter->getNbDroppedSnapshots()));
+        return;
+    }
+
+    static_assert(sizeof(Vec<27, StorageVoigtTensor2>) == 27*6*sizeof(StorageReal)
+                  && sizeof(Vec<27, StorageReal>) == 27*sizeof(StorageReal), "unexpected padding of the Gauss point values");
+    for (const unsigned int i : m_historyElements)
+    {
+        const BeamInfo& beam = bd[i];
+        std::memcpy(values, beam._plasticStrainHistory.data(), sizeof(beam._plasticStrainHistory));
+        std::memcpy(values + 27*6, beam._prevStresses.data(), sizeof(beam._prevStresses));
+        std::memcpy(values + 2*27*6, beam._effectivePlasticStrains.data(), sizeof(beam._effectivePlasticStrains));
+        values += NbHistoryValuesPerElement;
+    }
+    m_historyWriter->commitSnapshot();
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::closeHistory()
+{
+    if (!m_historyWriter)
+        return;
+
+    if (!m_historyWriter->close())
+        msg_error() << "Error while writing the Gauss point history";
+    if (m_historyWriter->getNbDroppedSnapshots() > 0)
+        msg_warning() << m_historyWriter->getNbDroppedSnapshots() << " snapshots of the Gauss point history were dropped, "
+                      << "the files were not written fast enough";
+    m_historyWriter.reset();
+}
+
+template<class DataTypes>
+BeamPlasticFEMForceField<DataTypes>::TopLevelPhaseScope::TopLevelPhaseScope(BeamPlasticFEMForceField* forceField, TimedPhase phase)
+    : m_forceField(forceField)
+    , m_phase(phase)
+    , m_scope(forceField->m_phaseTimer, phase, 0)
+{
+    if (m_forceField->m_traceWriter && m_forceField->m_phaseTimer.isEnabled())
+        m_start = PhaseTimer::Clock::now();
+}
+
+template<class DataTypes>
+BeamPlasticFEMForceField<DataTypes>::TopLevelPhaseScope::~TopLevelPhaseScope()
+{
+    if (m_forceField->m_traceWriter && m_forceField->m_phaseTimer.isEnabled())
+        m_forceField->m_traceWriter->writeDuration(m_forceField->getName() + " " + getTimedPhaseName(m_phase),
+                                                   m_start, PhaseTimer::Clock::now());
+}
+
+template<class DataTypes>
+const char* BeamPlasticFEMForceField<DataTypes>::getTimedPhaseName(TimedPhase phase)
+{
+    switch (phase)
+    {
+    case COROTATION: return "corotation";
+    case STRESS_UPDATE: return "stressUpdate";
+    case TANGENT_UPDATE: return "tangentUpdate";
+    case ADD_FORCE: return "addForce";
+    case ADD_DFORCE: return "addDForce";
+    case ADD_K_TO_MATRIX: return "addKToMatrix";
+    default: return "unknown";
+    }
+}
+
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::publishPhaseTimes()
+{
+    if (m_phaseTimer.isEnabled())
+    {
+        d_corotationTime.setValue(m_phaseTimer.getTotal(COROTATION));
+        d_stressUpdateTime.setValue(m_phaseTimer.getTotal(STRESS_UPDATE));
+        d_tangentUpdateTime.setValue(m_phaseTimer.getTotal(TANGENT_UPDATE));
+        d_addForceTime.setValue(m_phaseTimer.getTotal(ADD_FORCE));
+        d_addDForceTime.setValue(m_phaseTimer.getTotal(ADD_DFORCE));
+        d_addKToMatrixTime.setValue(m_phaseTimer.getTotal(ADD_K_TO_MATRIX));
+
+        if (m_traceWriter)
+        {
+            std::vector<std::pair<std::string, double>> times;
+            for (unsigned int phase = 0; phase < NB_TIMED_PHASES; phase++)
+                times.emplace_back(getTimedPhaseName(TimedPhase(phase)), m_phaseTimer.getTotal(phase));
+            m_traceWriter->writeCounters(this->getName() + " phase times (ms)", PhaseTimer::Clock::now(), times);
+            m_traceWriter->flush();
+        }
+    }
+
+    // Enabling or disabling the timing takes effect at the next time step
+    m_phaseTimer.clear();
+    m_phaseTimer.setEnabled(d_timePhases.getValue());
+}
+
+template<class DataTypes>
+bool BeamPlasticFEMForceField<DataTypes>::saveCheckpoint(const std::string& filename)
+{
+    if (filename.empty())
     {
-        for (sofa::Index i = 1; i < _nbCentrelineSeg; i++)
-        {
-            auto& drawN = _drawN[i-1];
-            double xi = i*(_L / _nbCentrelineSeg) / _L;
-            double xi2 = xi*xi;
-            double xi3 = xi*xi*xi;
+        msg_error() << "no checkpoint file given (checkpointFile), the plastic state is not saved";
+        return false;
+    }
 
-            //NB :
-            //double eta = 0;
-            //double zeta = 0;
-            drawN(0, 0) = 1 - xi;
-            drawN(0, 1) = 0;
-            drawN(0, 2) = 0;
-            drawN(0, 3) = 0;
-            drawN(0, 4) = 0;
-            drawN(0, 5) = 0;
-            drawN(0, 6) = xi;
-            drawN(0, 7) = 0;
-            drawN(0, 8) = 0;
-            drawN(0, 9) = 0;
-            drawN(0, 10) = 0;
-            drawN(0, 11) = 0;
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+    const bool hasElasticPredictors = d_useConsistentTangentOperator.getValue();
+
+    io::CheckpointHeader header{};
+    std::copy(std::begin(io::CheckpointMagic), std::end(io::CheckpointMagic), header.magic);
+    header.version = io::CheckpointVersion;
+    header.endiannessCheck = 0x01020304;
+    header.realSize = sizeof(Real);
+    header.storageRealSize = sizeof(StorageReal);
+    header.nbElements = bd.size();
+    header.nbNodes = m_lastPos.getValue().size();
+    header.flags = hasElasticPredictors ? io::CHECKPOINT_HAS_ELASTIC_PREDICTORS : 0;
+
+    io::CheckpointWriter writer(filename);
+    if (!writer.isValid())
+    {
+        msg_error() << "cannot open checkpoint file " << filename << " for writing";
+        return false;
+    }
+    writer.write(header);
 
-            drawN(1, 0) = 0;
-            drawN(1, 1) = phiZInv * (1 - 3 * xi2 + 2 * xi3 + phiZ*(1 - xi));
-            drawN(1, 2) = 0;
-            drawN(1, 3) = 0;
-            drawN(1, 4) = 0;
-            drawN(1, 5) = _L * phiZInv * (xi - 2 * xi2 + xi3 + (phiZ / 2)*(xi - xi2));
-            drawN(1, 6) = 0;
-            drawN(1, 7) = phiZInv * (3 * xi2 - 2 * xi3 + phiZ*xi);
-            drawN(1, 8) = 0;
-            drawN(1, 9) = 0;
-            drawN(1, 10) = 0;
-            drawN(1, 11) = _L * phiZInv *(-xi2 + xi3 - (phiZ / 2)*(xi - xi2));
+    for (std::size_t i = 0; i < bd.size(); i++)
+    {
+        const BeamInfo& beam = bd[i];
+
+        std::int32_t states[27];
+        for (int gp = 0; gp < 27; gp++)
+            states[gp] = static_cast<std::int32_t>(beam._pointMechanicalState[gp]);
+        writer.write(states, 27);
+        writer.write(static_cast<std::int32_t>(beam._beamMechanicalState));
+
+        writer.write(beam._plasticStrainHistory);
+        writer.write(beam._effectivePlasticStrains);
+        writer.write(beam._backStresses);
+        writer.write(beam._localYieldStresses);
+        writer.write(beam._plasticMultipliers);
+        writer.write(beam._internalForces);
+        writer.write(beam._elasticEnergy);
+        writer.write(beam._plasticDissipation);
+        writer.write(beam._Kt_loc);
+        writer.write(beam._prevStresses);
+        if (hasElasticPredictors)
+            writer.write(beam._elasticPredictors);
+    }
+    writer.write(m_lastPos.getValue().data(), m_lastPos.getValue().size());
 
-            drawN(2, 0) = 0;
-            drawN(2, 1) = 0;
-            drawN(2, 2) = phiYInv * (1 - 3 * xi2 + 2 * xi3 + phiY*(1 - xi));
-            drawN(2, 3) = 0;
-            drawN(2, 4) = -_L * phiYInv * (xi - 2 * xi2 + xi3 + (phiY / 2)*(xi - xi2));
-            drawN(2, 5) = 0;
-            drawN(2, 6) = 0;
-            drawN(2, 7) = 0;
-            drawN(2, 8) = phiYInv * (3 * xi2 - 2 * xi3 + phiY*xi);
-            drawN(2, 9) = 0;
-            drawN(2, 10) = -_L * phiYInv * (-xi2 + xi3 - (phiY / 2)*(xi - xi2));
-            drawN(2, 11) = 0;
-        }
+    if (!writer.close())
+    {
+        msg_error() << "error while writing checkpoint file " << filename;
+        return false;
     }
 
-    // Initialises the plastic indicators
-    // NB: each vector contains 27 components,
-    // associated with the 27 Gauss points used for reduced integration
-    _pointMechanicalState.assign(MechanicalState::ELASTIC);
-    _beamMechanicalState = MechanicalState::ELASTIC;
-    
-    _localYieldStresses.assign(yS);
-    _backStresses.assign(VoigtTensor2()); // TO DO: check if zero is correct
-    _effectivePlasticStrains.assign(0.0);
+    msg_info() << "Plastic state of " << bd.size() << " elements saved to " << filename;
+    return true;
+}
 
+template<class DataTypes>
+bool BeamPlasticFEMForceField<DataTypes>::loadCheckpoint(const std::string& filename)
+{
+    io::CheckpointReader reader;
+    if (filename.empty() || !reader.open(filename))
+    {
+        msg_error() << "cannot open checkpoint file '" << filename << "', the plastic state is not loaded";
+        return false;
+    }
+
+    const std::size_t nbElements = m_beamsData.getValue().size();
+    const std::size_t nbNodes = m_lastPos.getValue().size();
+
+    io::CheckpointHeader header;
+    if (!reader.read(header) || !std::equal(std::begin(io::CheckpointMagic), std::end(io::CheckpointMagic), header.magic))
+    {
+        msg_error() << filename << " is not a BeamPlastic checkpoint file";
+        return false;
+    }
+    if (header.version != io::CheckpointVersion || header.endiannessCheck != 0x01020304
+        || header.realSize != sizeof(Real) || header.storageRealSize != sizeof(StorageReal))
+    {
+        msg_error() << "checkpoint file " << filename << " was written with a different version ("
+                    << header.version << "), byte order or floating point precision";
+        return false;
+    }
+    if (header.nbElements != nbElements || header.nbNodes != nbNodes)
+    {
+        msg_error() << "checkpoint file " << filename << " has " << header.nbElements << " elements and "
+                    << header.nbNodes << " nodes, instead of " << nbElements << " and " << nbNodes;
+        return false;
+    }
+
+    const bool hasElasticPredictors = (header.flags & io::CHECKPOINT_HAS_ELASTIC_PREDICTORS) != 0;
+    const std::size_t elementSize = 28*sizeof(std::int32_t) + sizeof(Vec<27, StorageVoigtTensor2>)*(hasElasticPredictors ? 4 : 3)
+            + sizeof(Vec<27, StorageReal>)*3 + sizeof(Vec12) + 2*sizeof(Real) + sizeof(Matrix12x12);
+    if (reader.getRemainingSize() != nbElements*elementSize + nbNodes*sizeof(Coord))
+    {
+        msg_error() << "checkpoint file " << filename << " is truncated or corrupted";
+        return false;
+    }
+
+    // The file size has been checked: the reads below cannot fail
+    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
+    for (std::size_t i = 0; i < nbElements; i++)
+    {
+        BeamInfo& beam = bd[i];
+
+        std::int32_t states[27];
+        std::int32_t beamState;
+        reader.read(states, 27);
+        reader.read(beamState);
+        for (int gp = 0; gp < 27; gp++)
+            beam._pointMechanicalState[gp] = static_cast<MechanicalState>(states[gp]);
+        beam._beamMechanicalState = static_cast<MechanicalState>(beamState);
+
+        reader.read(beam._plasticStrainHistory);
+        reader.read(beam._effectivePlasticStrains);
+        reader.read(beam._backStresses);
+        reader.read(beam._localYieldStresses);
+        reader.read(beam._plasticMultipliers);
+        reader.read(beam._internalForces);
+        reader.read(beam._elasticEnergy);
+        reader.read(beam._plasticDissipation);
+        reader.read(beam._Kt_loc);
+        reader.read(beam._prevStresses);
+
+        // The elastic predictors are overwritten before being used, at the next
+        // force computation: they can be left to zero.
+        if (hasElasticPredictors)
+            reader.read(beam._elasticPredictors);
+        else
+            beam._elasticPredictors.assign(StorageVoigtTensor2());
+    }
+    reader.read(m_lastPos.beginEdit()->data(), nbNodes);
+    m_lastPos.endEdit();
 
-    //**********************************//
+    m_beamsData.endEdit();
+    m_lumpedMassesOutdated = true; // the eigenvalue bounds follow the loaded tangent stiffness matrices
+    m_hasForceDisplacements = false; // the loaded last positions are not the ones of _currentDisp
+
+    msg_info() << "Plastic state of " << nbElements << " elements loaded from " << filename;
+    return true;
 }
 
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::reset()
+template<class DataTypes>
+std::uint64_t BeamPlasticFEMForceField<DataTypes>::computeElementCacheKey() const
+{
+    io::Fnv1aHash hash;
+    hash.add(io::ElementCacheVersion);
+    hash.add(d_isTimoshenko.getValue());
+    hash.add(d_usePrecomputedStiffness.getValue());
+
+    // The element matrices only depend on the element length, section and
+    // elastic material parameters
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+    hash.add(static_cast<std::uint64_t>(bd.size()));
+    for (const BeamInfo& beam : bd)
+    {
+        hash.add(beam._L);
+        hash.add(beam._zDim);
+        hash.add(beam._yDim);
+        hash.add(beam._E);
+        hash.add(beam._nu);
+    }
+    return hash.value();
+}
+
+template<class DataTypes>
+bool BeamPlasticFEMForceField<DataTypes>::loadElementCache(const std::string& filename)
 {
-    for (unsigned i = 0; i < m_prevStresses.size(); ++i)
-        for (unsigned j = 0; j < 27; ++j)
-            m_prevStresses[i][j] = VoigtTensor2();
+    io::CheckpointReader reader;
+    if (!reader.open(filename))
+    {
+        msg_info() << "No element cache file " << filename << ", the element matrices are computed";
+        return false;
+    }
+
+    const std::size_t nbElements = m_beamsData.getValue().size();
+
+    io::ElementCacheHeader header;
+    if (!reader.read(header) || !std::equal(std::begin(io::ElementCacheMagic), std::end(io::ElementCacheMagic), header.magic)
+        || header.version != io::ElementCacheVersion || header.endiannessCheck != 0x01020304
+        || header.realSize != sizeof(Real) || header.storageRealSize != sizeof(StorageReal))
+    {
+        msg_warning() << filename << " is not an element cache file compatible with this build, the element matrices are computed";
+        return false;
+    }
+    if (header.nbElements != nbElements || header.key != computeElementCacheKey())
+    {
+        msg_info() << "Element cache file " << filename << " is outdated, the element matrices are computed";
+        return false;
+    }
+
+    const std::size_t elementSize = sizeof(Vec<27, StorageMatrix6x12>) + 2*sizeof(Matrix12x12);
+    if (reader.getRemainingSize() != nbElements*elementSize)
+    {
+        msg_warning() << "Element cache file " << filename << " is truncated or corrupted, the element matrices are computed";
+        return false;
+    }
+
+    // The file size has been checked: the reads below cannot fail
+    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
+    for (BeamInfo& beam : bd)
+    {
+        reader.read(beam._BeMatrices);
+        reader.read(beam._Ke_loc);
+        reader.read(beam._k_loc);
+    }
+    m_beamsData.endEdit();
+
+    msg_info() << "Element matrices of " << nbElements << " elements loaded from " << filename;
+    return true;
+}
 
-    if (d_useConsistentTangentOperator.getValue())
+template<class DataTypes>
+bool BeamPlasticFEMForceField<DataTypes>::saveElementCache(const std::string& filename)
+{
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+
+    io::ElementCacheHeader header{};
+    std::copy(std::begin(io::ElementCacheMagic), std::end(io::ElementCacheMagic), header.magic);
+    header.version = io::ElementCacheVersion;
+    header.endiannessCheck = 0x01020304;
+    header.realSize = sizeof(Real);
+    header.storageRealSize = sizeof(StorageReal);
+    header.nbElements = bd.size();
+    header.key = computeElementCacheKey();
+
+    io::CheckpointWriter writer(filename);
+    if (!writer.isValid())
+    {
+        msg_warning() << "cannot open element cache file " << filename << " for writing";
+        return false;
+    }
+    writer.write(header);
+    for (const BeamInfo& beam : bd)
     {
-        for (unsigned i = 0; i < m_elasticPredictors.size(); ++i)
-            for (unsigned j = 0; j < 27; ++j)
-                m_elasticPredictors[i][j] = VoigtTensor2();
+        writer.write(beam._BeMatrices);
+        writer.write(beam._Ke_loc);
+        writer.write(beam._k_loc);
+    }
 
+    if (!writer.close())
+    {
+        msg_warning() << "error while writing element cache file " << filename;
+        return false;
     }
 
-    // TO DO: call to init?
+    msg_info() << "Element matrices of " << bd.size() << " elements saved to " << filename;
+    return true;
 }
 
 template<class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::computeStiffness(int i, Index, Index)
+void BeamPlasticFEMForceField<DataTypes>::computeStiffness(BeamInfo& beam)
 {
     Real   phiy, phiz;
-    Real _L = m_beamsData.getValue()[i]._L;
-    Real _A = m_beamsData.getValue()[i]._A;
-    Real _nu = m_beamsData.getValue()[i]._nu;
-    Real _E = m_beamsData.getValue()[i]._E;
-    Real _Iy = m_beamsData.getValue()[i]._Iy;
-    Real _Iz = m_beamsData.getValue()[i]._Iz;
-    Real _G = m_beamsData.getValue()[i]._G;
-    Real _J = m_beamsData.getValue()[i]._J;
+    Real _L = beam._L;
+    Real _A = beam._A;
+    Real _nu = beam._nu;
+    Real _E = beam._E;
+    Real _Iy = beam._Iy;
+    Real _Iz = beam._Iz;
+    Real _G = beam._G;
+    Real _J = beam._J;
     Real L2 = (_L * _L);
     Real L3 = (L2 * _L);
     Real EIy = (_E * _Iy);
@@ -712,8 +2542,7 @@ void BeamPlasticFEMForceField<DataTypes>::computeStiffness(int i, Index, Index)
         phiz = (24.0 * (1.0 + _nu) * _Iy / (_A * L2));
     }
 
-    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
-    Matrix12x12& k_loc = bd[i]._k_loc;
+    Matrix12x12& k_loc = beam._k_loc;
 
     // Define stiffness matrix 'k' in local coordinates
     k_loc.clear();
@@ -742,11 +2571,10 @@ void BeamPlasticFEMForceField<DataTypes>::computeStiffness(int i, Index, Index)
     for (int i = 0; i <= 10; i++)
         for (int j = i + 1; j<12; j++)
             k_loc[i][j] = k_loc[j][i];
-
-    m_beamsData.endEdit();
 }
 
-inline type::Quat<SReal> qDiff(type::Quat<SReal> a, const type::Quat<SReal>& b)
+template<class Real>
+inline type::Quat<Real> qDiff(type::Quat<Real> a, const type::Quat<Real>& b)
 {
     if (a[0]*b[0]+a[1]*b[1]+a[2]*b[2]+a[3]*b[3]<0)
     {
@@ -755,7 +2583,7 @@ inline type::Quat<SReal> qDiff(type::Quat<SReal> a, const type::Quat<SReal>& b)
         a[2] = -a[2];
         a[3] = -a[3];
     }
-    type::Quat<SReal> q = b.inverse() * a;
+    type::Quat<Real> q = b.inverse() * a;
     return q;
 }
 
@@ -767,53 +2595,138 @@ inline type::Quat<SReal> qDiff(type::Quat<SReal> a, const type::Quat<SReal>& b)
 template<class DataTypes>
 void BeamPlasticFEMForceField<DataTypes>::addForce(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv &  dataF, const DataVecCoord &  dataX , const DataVecDeriv & /*dataV*/ )
 {
+    TopLevelPhaseScope timing(this, ADD_FORCE);
+
+    updateElementStructures();
+
     VecDeriv& f = *(dataF.beginEdit());
     const VecCoord& p=dataX.getValue();
     f.resize(p.size());
 
-    typename VecElement::const_iterator it;
-    unsigned int i;
+    if (m_displacementTrace && !m_displacementTrace->writePositions(this->getContext()->getTime(), p.data(), p.size()))
+    {
+        msg_warning() << "The number of nodes has changed, the recording of the displacement trace is stopped";
+        m_displacementTrace.reset();
+    }
+
+    const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+
+    if (m_lumpedMassesOutdated)
+        updateLumpedMasses();
+
+    m_localNewtonStatistics.assign(getNbChunks(), LocalNewtonStatistics());
+    m_plasticityActivity.assign(getNbChunks(), PlasticityActivity());
+    m_chunkEnergies.assign(getNbChunks(), ChunkEnergies());
+    m_chunkCriticalElements.assign(getNbChunks(), ChunkCriticalElement());
+    m_nbBatchedElementsPerChunk.assign(getNbChunks(), 0);
+
+    // Single edition of the beam data for the whole loop: the element methods
+    // only access their own BeamInfo, which allows parallel processing.
+    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
 
-    for (it = m_indexedElements->begin(), i = 0; it != m_indexedElements->end(); ++it, ++i)
+    if (m_elasticBatchKernel)
+    {
+        accumulateOverItems(m_batchOffsets, f, [&](std::size_t batch, VecDeriv& output, unsigned int chunk)
+        {
+            accumulateElasticBatch(batch, output, p, x0, bd, m_localNewtonStatistics[chunk],
+                                   m_nbBatchedElementsPerChunk[chunk], chunk);
+        });
+    }
+    else
     {
-        Index a = (*it)[0];
-        Index b = (*it)[1];
+        accumulateOverElements(f, [&](std::size_t k, VecDeriv& output, unsigned int chunk)
+        {
+            const unsigned int i = m_elementOrder[k];
+            const Index a = m_orderedElements[k][0];
+            const Index b = m_orderedElements[k][1];
+
+            // The choice of computational method (elastic, plastic, or post-plastic)
+            // is made in accumulateNonLinearForce
+            accumulateNonLinearForce(output, p, x0, bd[i], a, b, m_localNewtonStatistics[chunk], chunk);
+            accumulateEnergies(bd[i], chunk);
+            accumulateCriticalElement(bd[i], i, chunk);
+        });
+    }
+
+    m_beamsData.endEdit();
 
-        // The choice of computational method (elastic, plastic, or post-plastic)
-        // is made in accumulateNonLinearForce
-        accumulateNonLinearForce(f, p, i, a, b);
+    d_nbBatchedElements.setValue(std::accumulate(m_nbBatchedElementsPerChunk.begin(), m_nbBatchedElementsPerChunk.end(), 0u));
+
+    LocalNewtonStatistics statistics;
+    for (const LocalNewtonStatistics& chunkStatistics : m_localNewtonStatistics)
+    {
+        statistics.nbSolves += chunkStatistics.nbSolves;
+        statistics.nbIterations += chunkStatistics.nbIterations;
+        statistics.maxIterationCount = std::max(statistics.maxIterationCount, chunkStatistics.maxIterationCount);
+        statistics.nbFailures += chunkStatistics.nbFailures;
     }
 
+    d_nbLocalNewtonSolves.setValue(statistics.nbSolves);
+    d_nbLocalNewtonIterations.setValue(statistics.nbIterations);
+    d_maxLocalNewtonIterationCount.setValue(statistics.maxIterationCount);
+    if (statistics.nbFailures > 0)
+        msg_warning() << statistics.nbFailures << " plastic corrections did not converge in "
+                      << d_maxLocalNewtonIterations.getValue() << " local Newton iterations.";
+    d_nbLocalNewtonFailures.setValue(statistics.nbFailures);
+
+    publishPlasticityActivity();
+    publishChunkEnergies();
+    publishChunkCriticalTimeStep();
+    m_hasForceDisplacements = true;
+
     // Save the current positions as a record for the next time step.
     // This has to be done after the call to accumulateNonLinearForce
     // (otherwise the current position will be used instead in the 
     // computation)
     //TO DO: check if this is copy operator
-    m_lastPos = p;
+    m_lastPos.setValue(p);
 
     dataF.endEdit();
 }
 
+template<class DataTypes>
+bool BeamPlasticFEMForceField<DataTypes>::checkStiffnessAvailable()
+{
+    if (!d_explicitMode.getValue())
+        return true;
+
+    if (!m_explicitModeStiffnessReported)
+    {
+        msg_error() << "The stiffness is not available in explicit mode, an explicit time "
+                    << "integration scheme should be used, or explicitMode set to false.";
+        m_explicitModeStiffnessReported = true;
+    }
+    return false;
+}
+
 template<class DataTypes>
 void BeamPlasticFEMForceField<DataTypes>::addDForce(const sofa::core::MechanicalParams *mparams, DataVecDeriv& datadF , const DataVecDeriv& datadX)
 {
+    TopLevelPhaseScope timing(this, ADD_DFORCE);
+
+    if (!checkStiffnessAvailable())
+        return;
+
+    updateElementStructures();
+
     VecDeriv& df = *(datadF.beginEdit());
     const VecDeriv& dx=datadX.getValue();
     Real kFactor = sofa::core::mechanicalparams::kFactorIncludingRayleighDamping(mparams, this->rayleighStiffness.getValue());
 
     df.resize(dx.size());
 
-    typename VecElement::const_iterator it;
-    unsigned int i = 0;
-    for(it = m_indexedElements->begin() ; it != m_indexedElements->end() ; ++it, ++i)
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+
+    accumulateOverElements(df, [&](std::size_t k, VecDeriv& output, unsigned int)
     {
-        Index a = (*it)[0];
-        Index b = (*it)[1];
+        const unsigned int i = m_elementOrder[k];
+        const Index a = m_orderedElements[k][0];
+        const Index b = m_orderedElements[k][1];
 
         // The choice of the computational method (elastic, plastic, or post-plastic)
         // is made in applyNonLinearStiffness
-        applyNonLinearStiffness(df, dx, i, a, b, kFactor);
-    }
+        applyNonLinearStiffness(output, dx, bd[i], a, b, kFactor);
+    });
 
     datadF.endEdit();
 }
@@ -821,20 +2734,26 @@ void BeamPlasticFEMForceField<DataTypes>::addDForce(const sofa::core::Mechanical
 template<class DataTypes>
 void BeamPlasticFEMForceField<DataTypes>::addKToMatrix(const sofa::core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix )
 {
+    TopLevelPhaseScope timing(this, ADD_K_TO_MATRIX);
+
+    if (!checkStiffnessAvailable())
+        return;
+
+    updateElementStructures();
+
     sofa::core::behavior::MultiMatrixAccessor::MatrixRef r = matrix->getMatrix(this->mstate);
     Real k = sofa::core::mechanicalparams::kFactorIncludingRayleighDamping(mparams, this->rayleighStiffness.getValue());
     linearalgebra::BaseMatrix* mat = r.matrix;
 
     if (r)
     {
-        unsigned int i=0;
         unsigned int &offset = r.offset;
 
-        typename VecElement::const_iterator it;
-        for(it = m_indexedElements->begin() ; it != m_indexedElements->end() ; ++it, ++i)
+        for (std::size_t pos = 0; pos < m_elementOrder.size(); ++pos)
         {
-            Index a = (*it)[0];
-            Index b = (*it)[1];
+            const unsigned int i = m_elementOrder[pos];
+            const Index a = m_orderedElements[pos][0];
+            const Index b = m_orderedElements[pos][1];
 
             const MechanicalState beamMechanicalState = m_beamsData.getValue()[i]._beamMechanicalState;
 
@@ -902,144 +2821,275 @@ void BeamPlasticFEMForceField<DataTypes>::addKToMatrix(const sofa::core::Mechani
 
             //TO DO: m_beamsData.endEdit(); consecutive to the call to beamQuat
 
-        } // end for m_indexedElements
+        } // end for m_elementOrder
     } // end if (r)
 }
 
 template<class DataTypes>
 void BeamPlasticFEMForceField<DataTypes>::draw(const core::visual::VisualParams* vparams)
 {
+    if (d_headless.getValue()) return;
     if (!vparams->displayFlags().getShowForceFields()) return;
     if (!this->mstate) return;
 
-    const VecCoord& x = this->mstate->read(sofa::core::vec_id::read_access::position)->getValue();
-
-    std::vector<Vec3> centrelinePoints;
-    std::vector<Vec3> gaussPoints;
-    std::vector<RGBAColor> colours;
+    updateDrawBuffers(vparams);
 
-    for (unsigned int i=0; i<m_indexedElements->size(); ++i)
-        drawElement(i, gaussPoints, centrelinePoints, colours, x);
+    // Without a draw tool (e.g. offscreen runs), only the buffers are updated
+    if (!vparams->drawTool()) return;
 
     vparams->drawTool()->setPolygonMode(2, true);
     vparams->drawTool()->setLightingEnabled(true);
-    vparams->drawTool()->drawPoints(gaussPoints, 3, colours);
-    vparams->drawTool()->drawLines(centrelinePoints, 1.0, RGBAColor(0.24f, 0.72f, 0.96f, 1.0f));
+    if (!m_drawGaussPoints.empty())
+        vparams->drawTool()->drawPoints(m_drawGaussPoints, 3, m_drawColours);
+    vparams->drawTool()->drawLines(m_drawCentrelinePoints, 1.0, RGBAColor(0.24f, 0.72f, 0.96f, 1.0f));
+    if (!m_drawLODPoints.empty())
+        vparams->drawTool()->drawLines(m_drawLODPoints, 1.0, m_drawLODColours);
     vparams->drawTool()->setLightingEnabled(false);
     vparams->drawTool()->setPolygonMode(0, false);
 }
 
 template<class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::drawElement(int i, std::vector< Vec3 > &gaussPoints,
-                                                 std::vector< Vec3 > &centrelinePoints,
-                                                 std::vector<RGBAColor> &colours,
-                                                 const VecCoord& x)
+auto BeamPlasticFEMForceField<DataTypes>::getMechanicalStateColour(MechanicalState state) -> RGBAColor
 {
-    Index a = (*m_indexedElements)[i][0];
-    Index b = (*m_indexedElements)[i][1];
+    if (state == MechanicalState::ELASTIC)
+        return {1.0f,0.015f,0.015f,1.0f}; //RED
+    else if (state == MechanicalState::PLASTIC)
+        return {0.051f,0.15f,0.64f,1.0f}; //BLUE
+    else
+        return {0.078f,0.41f,0.078f,1.0f}; //GREEN
+}
 
-    Vec3 pa, pb;
-    pa = x[a].getCenter();
-    pb = x[b].getCenter();
+template<class DataTypes>
+auto BeamPlasticFEMForceField<DataTypes>::computeScreenLength(const std::array<double, 16>& viewProjection,
+                                                              const type::Vec<4, int>& viewport,
+                                                              const Vec3& p1, const Vec3& p2) -> Real
+{
+    // Window coordinates of a point, false if it is behind the camera
+    auto project = [&](const Vec3& p, double& px, double& py)
+    {
+        double clip[4];
+        for (int r = 0; r < 4; r++)
+            clip[r] = viewProjection[r]*p[0] + viewProjection[4+r]*p[1] + viewProjection[8+r]*p[2] + viewProjection[12+r];
+        if (clip[3] <= 0)
+            return false;
+        px = 0.5*(clip[0]/clip[3] + 1)*viewport[2];
+        py = 0.5*(clip[1]/clip[3] + 1)*viewport[3];
+        return true;
+    };
 
-    const auto& q = beamQuat(i);
+    double x1, y1, x2, y2;
+    if (!project(p1, x1, y1) || !project(p2, x2, y2))
+        return std::numeric_limits<Real>::max(); // the segment may cross the whole view
+    return static_cast<Real>(std::sqrt((x2 - x1)*(x2 - x1) + (y2 - y1)*(y2 - y1)));
+}
 
-    //***** Gauss points *****//
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::updateDrawBuffers(const core::visual::VisualParams* vparams)
+{
+    const auto* positionData = this->mstate->read(sofa::core::vec_id::read_access::position);
+    const type::vector<BeamInfo>& bd = m_beamsData.getValue();
+    const std::size_t nbElements = std::min<std::size_t>(bd.size(), m_indexedElements->size());
+
+    DrawCacheKey key;
+    key.positionCounter = positionData->getCounter();
+    key.beamsDataCounter = m_beamsData.getCounter();
+    key.nbElements = nbElements;
+    key.nbCentrelineSegments = std::max(1u, d_drawCentrelineSegments.getValue());
+    key.plasticGaussPointsOnly = d_drawPlasticGaussPointsOnly.getValue();
+    key.lodPixelLength = d_drawLODPixelLength.getValue();
+    if (key.lodPixelLength > 0)
+    {
+        // OpenGL matrices, in column-major order
+        double modelView[16], projection[16];
+        vparams->getModelViewMatrix(modelView);
+        vparams->getProjectionMatrix(projection);
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+            {
+                double v = 0;
+                for (int k = 0; k < 4; k++)
+                    v += projection[k*4 + r]*modelView[c*4 + k];
+                key.viewProjection[c*4 + r] = v;
+            }
+        for (int k = 0; k < 4; k++)
+            key.viewport[k] = vparams->viewport()[k];
+    }
 
-    //Compute current displacement
+    if (key == m_drawCacheKey)
+        return;
 
+    const VecCoord& x = positionData->getValue();
     const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    const unsigned int nbSegments = key.nbCentrelineSegments;
 
-    beamQuat(i) = x[a].getOrientation();
-    beamQuat(i).normalize();
+    // Level of detail of each element, and ranges of the elements in the buffers
+    m_drawOffsets.resize(nbElements + 1);
+    DrawOffsets offsets;
+    for (std::size_t i = 0; i < nbElements; i++)
+    {
+        m_drawOffsets[i] = offsets;
 
-    m_beamsData.endEdit();
+        const Index a = (*m_indexedElements)[i][0];
+        const Index b = (*m_indexedElements)[i][1];
+        if (key.lodPixelLength > 0
+                && computeScreenLength(key.viewProjection, key.viewport, x[a].getCenter(), x[b].getCenter()) < key.lodPixelLength)
+        {
+            offsets.lodPoints += 2;
+            continue;
+        }
 
-    Vec3 u, P1P2, P1P2_0;
-    // local displacement
-    Matrix12x1 disp;
+        const Vec<27, MechanicalState>& pointMechanicalState = bd[i]._pointMechanicalState;
+        if (!key.plasticGaussPointsOnly
+                || std::any_of(pointMechanicalState.begin(), pointMechanicalState.end(),
+                               [](MechanicalState state) { return state != MechanicalState::ELASTIC; }))
+            offsets.gaussPoints += 27;
+        offsets.centrelinePoints += 2*nbSegments;
+    }
+    m_drawOffsets[nbElements] = offsets;
 
-    // translations //
-    P1P2_0 = x0[b].getCenter() - x0[a].getCenter();
-    P1P2_0 = x0[a].getOrientation().inverseRotate(P1P2_0);
-    P1P2 = x[b].getCenter() - x[a].getCenter();
-    P1P2 = x[a].getOrientation().inverseRotate(P1P2);
-    u = P1P2 - P1P2_0;
+    // Shape functions of the visualisation, only allocated if some element needs them
+    const bool isTimoshenko = d_isTimoshenko.getValue();
+    if (m_drawShapeFunctionsOutdated || m_drawNbCentrelineSegments != nbSegments)
+    {
+        m_drawGaussPointShapeFunctions.clear();
+        m_drawCentrelineShapeFunctions.clear();
+        m_drawNbCentrelineSegments = nbSegments;
+        m_drawShapeFunctionsOutdated = false;
+    }
+    const bool computeGaussPointShapeFunctions = offsets.gaussPoints > 0 && m_drawGaussPointShapeFunctions.size() != nbElements;
+    const bool computeCentrelineShapeFunctions = offsets.centrelinePoints > 0
+            && m_drawCentrelineShapeFunctions.size() != (nbSegments - 1)*nbElements;
+    if (computeGaussPointShapeFunctions)
+        m_drawGaussPointShapeFunctions.resize(nbElements);
+    if (computeCentrelineShapeFunctions)
+        m_drawCentrelineShapeFunctions.resize((nbSegments - 1)*nbElements);
+
+    // Between the end of a time step and the next addForce, the positions are
+    // usually the ones of the last addForce, for which the local displacements
+    // have already been computed
+    const VecCoord& lastPos = m_lastPos.getValue();
+    const bool useForceDisplacements = m_hasForceDisplacements
+            && lastPos.size() == x.size()
+            && std::equal(x.begin(), x.end(), lastPos.begin(), [](const Coord& p1, const Coord& p2)
+               {
+                   return p1.getCenter() == p2.getCenter()
+                       && std::equal(p1.getOrientation().ptr(), p1.getOrientation().ptr() + 4, p2.getOrientation().ptr());
+               });
+
+    m_drawGaussPoints.resize(offsets.gaussPoints);
+    m_drawColours.resize(offsets.gaussPoints);
+    m_drawCentrelinePoints.resize(offsets.centrelinePoints);
+    m_drawLODPoints.resize(offsets.lodPoints);
+    m_drawLODColours.resize(offsets.lodPoints);
+
+    forEachChunk(nbElements, [&](unsigned int /*chunk*/, std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            if (computeGaussPointShapeFunctions)
+                bd[i].computeGaussPointShapeFunctions(m_drawGaussPointShapeFunctions[i], isTimoshenko);
+            if (computeCentrelineShapeFunctions && nbSegments > 1)
+                bd[i].computeCentrelineShapeFunctions(&m_drawCentrelineShapeFunctions[(nbSegments - 1)*i], nbSegments, isTimoshenko);
 
-    disp[0] = 0.0; 	disp[1] = 0.0; 	disp[2] = 0.0;
-    disp[6] = u[0]; disp[7] = u[1]; disp[8] = u[2];
+            drawElement(i, x, x0, useForceDisplacements);
+        }
+    });
 
-    // rotations //
-    type::Quat<SReal> dQ0, dQ;
+    m_drawCacheKey = key;
+}
 
-    dQ0 = qDiff(x0[b].getOrientation(), x0[a].getOrientation());
-    dQ = qDiff(x[b].getOrientation(), x[a].getOrientation());
+template<class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::drawElement(std::size_t i, const VecCoord& x, const VecCoord& x0,
+                                                      bool useForceDisplacements)
+{
+    const BeamInfo& beam = m_beamsData.getValue()[i];
+    const DrawOffsets& offsets = m_drawOffsets[i];
+    const DrawOffsets& nextOffsets = m_drawOffsets[i+1];
+    const Index a = (*m_indexedElements)[i][0];
+    const Index b = (*m_indexedElements)[i][1];
 
-    dQ0.normalize();
-    dQ.normalize();
+    const Vec3& pa = x[a].getCenter();
+    const Vec3& pb = x[b].getCenter();
 
-    type::Quat<SReal> tmpQ = qDiff(dQ, dQ0);
-    tmpQ.normalize();
+    //***** Colour-only mode *****//
 
-    u = tmpQ.quatToRotationVector();
+    if (nextOffsets.lodPoints > offsets.lodPoints)
+    {
+        const Vec<27, MechanicalState>& pointMechanicalState = beam._pointMechanicalState;
+        MechanicalState state = MechanicalState::ELASTIC;
+        if (std::find(pointMechanicalState.begin(), pointMechanicalState.end(), MechanicalState::PLASTIC) != pointMechanicalState.end())
+            state = MechanicalState::PLASTIC;
+        else if (std::find(pointMechanicalState.begin(), pointMechanicalState.end(), MechanicalState::POSTPLASTIC) != pointMechanicalState.end())
+            state = MechanicalState::POSTPLASTIC;
+
+        m_drawLODPoints[offsets.lodPoints] = type::Vec3(pa);
+        m_drawLODPoints[offsets.lodPoints + 1] = type::Vec3(pb);
+        m_drawLODColours[offsets.lodPoints] = m_drawLODColours[offsets.lodPoints + 1] = getMechanicalStateColour(state);
+        return;
+    }
 
-    disp[3] = 0.0; 	disp[4] = 0.0; 	disp[5] = 0.0;
-    disp[9] = u[0]; disp[10] = u[1]; disp[11] = u[2];
+    type::Quat<Real> q = x[a].getOrientation();
+    q.normalize();
 
-    //Compute the positions of the Gauss points
-    typedef std::function<void(double, double, double, double, double, double)> LambdaType;
-    typedef ozp::quadrature::Gaussian<3> GaussianQuadratureType;
+    // Local displacement
+    Vec12 disp;
+    if (useForceDisplacements)
+        disp = beam._currentDisp;
+    else
+        computeLocalDisplacement(x, x0, disp, a, b);
 
-    Matrix3x12 N;
-    const Vec<27, MechanicalState>& pointMechanicalState = m_beamsData.getValue()[i]._pointMechanicalState;
-    int gaussPointIt = 0; //incremented in the lambda function to iterate over Gauss points
+    //***** Gauss points *****//
 
-    LambdaType computeGaussCoordinates = [&](double u1, double u2, double u3, double w1, double w2, double w3)
+    if (nextOffsets.gaussPoints > offsets.gaussPoints)
     {
-        SOFA_UNUSED(w1);
-        SOFA_UNUSED(w2);
-        SOFA_UNUSED(w3);
-        //Shape function
-        N = m_beamsData.getValue()[i]._N[gaussPointIt];
-        Mat<3, 1, Real> ucol = N*disp;
-
-        type::Vec3d beamVec = {ucol[0][0]+u1, ucol[1][0]+u2, ucol[2][0]+u3};
-        type::Vec3d gp = pa + q.rotate(beamVec);
-        gaussPoints.push_back(gp);
-
-        if (pointMechanicalState[gaussPointIt] == MechanicalState::ELASTIC)
-            colours.push_back({1.0f,0.015f,0.015f,1.0f}); //RED
-        else if (pointMechanicalState[gaussPointIt] == MechanicalState::PLASTIC)
-            colours.push_back({0.051f,0.15f,0.64f,1.0f}); //BLUE
-        else
-            colours.push_back({0.078f,0.41f,0.078f,1.0f}); //GREEN
+        typedef std::function<void(double, double, double, double, double, double)> LambdaType;
+        typedef ozp::quadrature::Gaussian<3> GaussianQuadratureType;
 
-        gaussPointIt++; //next Gauss Point
-    };
+        const Vec<27, Matrix3x12>& shapeFunctions = m_drawGaussPointShapeFunctions[i];
+        type::Vec3* gaussPoints = &m_drawGaussPoints[offsets.gaussPoints];
+        RGBAColor* colours = &m_drawColours[offsets.gaussPoints];
+        int gaussPointIt = 0; //incremented in the lambda function to iterate over Gauss points
+
+        LambdaType computeGaussCoordinates = [&](double u1, double u2, double u3, double w1, double w2, double w3)
+        {
+            SOFA_UNUSED(w1);
+            SOFA_UNUSED(w2);
+            SOFA_UNUSED(w3);
+            //Shape function
+            const Vec3 ucol = shapeFunctions[gaussPointIt]*disp;
 
-    ozp::quadrature::detail::Interval<3> interval = m_beamsData.getValue()[i]._integrationInterval;
-    ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(interval, computeGaussCoordinates);
+            Vec3 beamVec = {ucol[0]+u1, ucol[1]+u2, ucol[2]+u3};
+            gaussPoints[gaussPointIt] = type::Vec3(pa + q.rotate(beamVec));
+            colours[gaussPointIt] = getMechanicalStateColour(beam._pointMechanicalState[gaussPointIt]);
+
+            gaussPointIt++; //next Gauss Point
+        };
+
+        ozp::quadrature::detail::Interval<3> interval = beam._integrationInterval;
+        ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(interval, computeGaussCoordinates);
+    }
 
     //****** Centreline ******//
-    int nbSeg = m_beamsData.getValue()[i]._nbCentrelineSeg; //number of segments descretising the centreline
 
-    centrelinePoints.push_back(pa);
+    const unsigned int nbSeg = m_drawNbCentrelineSegments; //number of segments descretising the centreline
+    type::Vec3* centrelinePoints = &m_drawCentrelinePoints[offsets.centrelinePoints];
+    const Matrix3x12* shapeFunctions = nbSeg > 1 ? &m_drawCentrelineShapeFunctions[(nbSeg - 1)*i] : nullptr;
+
+    *centrelinePoints++ = type::Vec3(pa);
 
-    Matrix3x12 drawN;
-    const double L = m_beamsData.getValue()[i]._L;
-    for (int drawPointIt = 0; drawPointIt < nbSeg - 1; drawPointIt++)
+    const Real L = beam._L;
+    for (unsigned int drawPointIt = 0; drawPointIt + 1 < nbSeg; drawPointIt++)
     {
         //Shape function of the centreline point
-        drawN = m_beamsData.getValue()[i]._drawN[drawPointIt];
-        Mat<3, 1, Real> u = drawN*disp;
+        const Vec3 u = shapeFunctions[drawPointIt]*disp;
 
-        type::Vec3d beamVec = {u[0][0] + (drawPointIt +1)*(L/nbSeg), u[1][0], u[2][0]};
-        type::Vec3d clp = pa + q.rotate(beamVec);
-        centrelinePoints.push_back(clp); //First time as the end of the former segment
-        centrelinePoints.push_back(clp); //Second time as the beginning of the next segment
+        Vec3 beamVec = {u[0] + (drawPointIt +1)*(L/nbSeg), u[1], u[2]};
+        const type::Vec3 clp = type::Vec3(pa + q.rotate(beamVec));
+        *centrelinePoints++ = clp; //First time as the end of the former segment
+        *centrelinePoints++ = clp; //Second time as the beginning of the next segment
     }
 
-    centrelinePoints.push_back(pb);
+    *centrelinePoints = type::Vec3(pb);
 }
 
 template<class DataTypes>
@@ -1052,8 +3102,8 @@ void BeamPlasticFEMForceField<DataTypes>::computeBBox(const core::ExecParams* pa
 
     static const Real max_real = std::numeric_limits<Real>::max();
     static const Real min_real = std::numeric_limits<Real>::min();
-    Real maxBBox[3] = { min_real,min_real,min_real };
-    Real minBBox[3] = { max_real,max_real,max_real };
+    SReal maxBBox[3] = { min_real,min_real,min_real };
+    SReal minBBox[3] = { max_real,max_real,max_real };
 
 
     const size_t npoints = this->mstate->getSize();
@@ -1070,7 +3120,7 @@ void BeamPlasticFEMForceField<DataTypes>::computeBBox(const core::ExecParams* pa
         }
     }
 
-    this->f_bbox.setValue(sofa::type::TBoundingBox<Real>(minBBox, maxBBox));
+    this->f_bbox.setValue(sofa::type::BoundingBox(minBBox, maxBBox));
 
 }
 
@@ -1083,14 +3133,13 @@ void BeamPlasticFEMForceField<DataTypes>::computeBBox(const core::ExecParams* pa
 /***************************** Virtual Displacement **************************/
 
 template<class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::computeVDStiffness(int i, Index, Index)
+void BeamPlasticFEMForceField<DataTypes>::computeVDStiffness(BeamInfo& beam)
 {
-    const double E = m_beamsData.getValue()[i]._E;
-    const double nu = m_beamsData.getValue()[i]._nu;
+    const Real E = beam._E;
+    const Real nu = beam._nu;
 
-    const Matrix6x6& C = m_beamsData.getValue()[i]._materialBehaviour;
-    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
-    Matrix12x12& Ke_loc = bd[i]._Ke_loc;
+    const Matrix6x6& C = m_materials[beam._materialIndex]._materialBehaviour;
+    Matrix12x12& Ke_loc = beam._Ke_loc;
     Ke_loc.clear();
 
     // Reduced integration
@@ -1110,14 +3159,14 @@ void BeamPlasticFEMForceField<DataTypes>::computeVDStiffness(int i, Index, Index
         SOFA_UNUSED(u1);
         SOFA_UNUSED(u2);
         SOFA_UNUSED(u3);
-        Be = m_beamsData.getValue()[i]._BeMatrices[gaussPointIterator];
+        Be = Matrix6x12(beam._BeMatrices[gaussPointIterator]);
 
         stiffness += (w1*w2*w3)*beTCBeMult(Be.transposed(), C, nu, E);
 
         gaussPointIterator++; //next Gauss Point
     };
 
-    ozp::quadrature::detail::Interval<3> interval = m_beamsData.getValue()[i]._integrationInterval;
+    ozp::quadrature::detail::Interval<3> interval = beam._integrationInterval;
     ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(interval, computeStressMatrix);
 
     for (int i = 0; i < 12; i++)
@@ -1125,22 +3174,15 @@ void BeamPlasticFEMForceField<DataTypes>::computeVDStiffness(int i, Index, Index
         {
             Ke_loc[i][j] = stiffness(i, j);
         }
-
-    m_beamsData.endEdit();
 }
 
 template<class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::computeMaterialBehaviour(int i, Index a, Index b)
+void BeamPlasticFEMForceField<DataTypes>::computeMaterialBehaviour(MaterialInfo& material)
 {
-    SOFA_UNUSED(a);
-    SOFA_UNUSED(b);
-    
-    Real E = m_beamsData.getValue()[i]._E; // Young's modulus
-    Real nu = m_beamsData.getValue()[i]._nu; // Poisson ratio
+    Real E = material._E; // Young's modulus
+    Real nu = material._nu; // Poisson ratio
 
-    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
-
-    Matrix6x6& C = bd[i]._materialBehaviour;
+    Matrix6x6& C = material._materialBehaviour;
     // Material behaviour matrix, here: Hooke's law
     //TO DO: handle incompressible materials (with nu = 0.5)
     C(0, 0) = C(1, 1) = C(2, 2) = 1 - nu;
@@ -1153,13 +3195,11 @@ void BeamPlasticFEMForceField<DataTypes>::computeMaterialBehaviour(int i, Index
     C(5, 0) = C(5, 1) = C(5, 2) = C(5, 3) = C(5, 4) = 0;
     C(3, 3) = C(4, 4) = C(5, 5) = 1 - 2*nu;
     C *= E / ( (1 + nu) * (1 - 2*nu) );
-
-    m_beamsData.endEdit();
 }
 
 template< class DataTypes>
 bool BeamPlasticFEMForceField<DataTypes>::goToPlastic(const VoigtTensor2 &stressTensor,
-                                                 const double yieldStress,
+                                                 const Real yieldStress,
                                                  const bool verbose /*=FALSE*/)
 {
     if (verbose)
@@ -1177,7 +3217,7 @@ auto BeamPlasticFEMForceField<DataTypes>::deviatoricStress(const VoigtTensor2 &s
     // Returns the deviatoric stress from a given stress tensor in Voigt notation
 
     VoigtTensor2 deviatoricStress = stressTensor;
-    double mean = (stressTensor[0][0] + stressTensor[1][0] + stressTensor[2][0]) / 3.0;
+    Real mean = (stressTensor[0][0] + stressTensor[1][0] + stressTensor[2][0]) / 3.0;
     for (int i = 0; i < 3; i++)
         deviatoricStress[i][0] -= mean;
 
@@ -1185,28 +3225,28 @@ auto BeamPlasticFEMForceField<DataTypes>::deviatoricStress(const VoigtTensor2 &s
 }
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::equivalentStress(const VoigtTensor2 &stressTensor)
+auto BeamPlasticFEMForceField<DataTypes>::equivalentStress(const VoigtTensor2 &stressTensor) -> Real
 {
-    double res = 0.0;
-    double sigmaX = stressTensor[0][0];
-    double sigmaY = stressTensor[1][0];
-    double sigmaZ = stressTensor[2][0];
-    double sigmaYZ = stressTensor[3][0];
-    double sigmaZX = stressTensor[4][0];
-    double sigmaXY = stressTensor[5][0];
+    Real res = 0.0;
+    Real sigmaX = stressTensor[0][0];
+    Real sigmaY = stressTensor[1][0];
+    Real sigmaZ = stressTensor[2][0];
+    Real sigmaYZ = stressTensor[3][0];
+    Real sigmaZX = stressTensor[4][0];
+    Real sigmaXY = stressTensor[5][0];
 
-    double aux1 = 0.5*((sigmaX - sigmaY)*(sigmaX - sigmaY) + (sigmaY - sigmaZ)*(sigmaY - sigmaZ) + (sigmaZ - sigmaX)*(sigmaZ - sigmaX));
-    double aux2 = 3.0*(sigmaYZ*sigmaYZ + sigmaZX*sigmaZX + sigmaXY*sigmaXY);
+    Real aux1 = 0.5*((sigmaX - sigmaY)*(sigmaX - sigmaY) + (sigmaY - sigmaZ)*(sigmaY - sigmaZ) + (sigmaZ - sigmaX)*(sigmaZ - sigmaX));
+    Real aux2 = 3.0*(sigmaYZ*sigmaYZ + sigmaZX*sigmaZX + sigmaXY*sigmaXY);
 
     res = helper::rsqrt(aux1 + aux2);
     return res;
 }
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::vonMisesYield(const VoigtTensor2 &stressTensor,
-                                                          const double yieldStress)
+auto BeamPlasticFEMForceField<DataTypes>::vonMisesYield(const VoigtTensor2 &stressTensor,
+                                                           const Real yieldStress) -> Real
 {
-    double eqStress = equivalentStress(stressTensor);
+    Real eqStress = equivalentStress(stressTensor);
     return eqStress - yieldStress;
 }
 
@@ -1223,12 +3263,12 @@ auto BeamPlasticFEMForceField<DataTypes>::vonMisesGradient(const VoigtTensor2 &s
     if (equalsZero(sofa::type::scalarProduct(stressTensor, stressTensor)))
         return gradient; //TO DO: is that correct ?
 
-    double sigmaX = stressTensor[0][0];
-    double sigmaY = stressTensor[1][0];
-    double sigmaZ = stressTensor[2][0];
-    double sigmaYZ = stressTensor[3][0];
-    double sigmaZX = stressTensor[4][0];
-    double sigmaXY = stressTensor[5][0];
+    Real sigmaX = stressTensor[0][0];
+    Real sigmaY = stressTensor[1][0];
+    Real sigmaZ = stressTensor[2][0];
+    Real sigmaYZ = stressTensor[3][0];
+    Real sigmaZX = stressTensor[4][0];
+    Real sigmaXY = stressTensor[5][0];
 
     gradient[0] = 2 * sigmaX - sigmaY - sigmaZ;
     gradient[1] = 2 * sigmaY - sigmaZ - sigmaX;
@@ -1237,7 +3277,7 @@ auto BeamPlasticFEMForceField<DataTypes>::vonMisesGradient(const VoigtTensor2 &s
     gradient[4] = 3 * sigmaZX;
     gradient[5] = 3 * sigmaXY;
 
-    double sigmaEq = equivalentStress(stressTensor);
+    Real sigmaEq = equivalentStress(stressTensor);
     gradient *= 1 / (2 * sigmaEq);
 
     return gradient;
@@ -1245,7 +3285,7 @@ auto BeamPlasticFEMForceField<DataTypes>::vonMisesGradient(const VoigtTensor2 &s
 
 template< class DataTypes>
 auto BeamPlasticFEMForceField<DataTypes>::vonMisesHessian(const VoigtTensor2 &stressTensor,
-                                                          const double yieldStress) -> VectTensor4
+                                                          const Real yieldStress) -> VectTensor4
 {
     VectTensor4 hessian = VectTensor4();
 
@@ -1253,33 +3293,33 @@ auto BeamPlasticFEMForceField<DataTypes>::vonMisesHessian(const VoigtTensor2 &st
         return hessian; //TO DO: is that correct ?
 
     //Order 1 terms
-    double sigmaXX = stressTensor[0][0];
-    double sigmaYY = stressTensor[1][0];
-    double sigmaZZ = stressTensor[2][0];
-    double sigmaYZ = stressTensor[3][0];
-    double sigmaZX = stressTensor[4][0];
-    double sigmaXY = stressTensor[5][0];
+    Real sigmaXX = stressTensor[0][0];
+    Real sigmaYY = stressTensor[1][0];
+    Real sigmaZZ = stressTensor[2][0];
+    Real sigmaYZ = stressTensor[3][0];
+    Real sigmaZX = stressTensor[4][0];
+    Real sigmaXY = stressTensor[5][0];
 
-    double auxX = 2 * sigmaXX - sigmaYY - sigmaZZ;
-    double auxY = 2 * sigmaYY - sigmaZZ - sigmaXX;
-    double auxZ = 2 * sigmaZZ - sigmaXX - sigmaYY;
+    Real auxX = 2 * sigmaXX - sigmaYY - sigmaZZ;
+    Real auxY = 2 * sigmaYY - sigmaZZ - sigmaXX;
+    Real auxZ = 2 * sigmaZZ - sigmaXX - sigmaYY;
 
     //Order 2 terms
-    double sX2 = sigmaXX*sigmaXX;
-    double sY2 = sigmaYY*sigmaYY;
-    double sZ2 = sigmaZZ*sigmaZZ;
-    double sYsZ = sigmaYY*sigmaZZ;
-    double sZsX = sigmaZZ*sigmaXX;
-    double sXsY = sigmaXX*sigmaYY;
+    Real sX2 = sigmaXX*sigmaXX;
+    Real sY2 = sigmaYY*sigmaYY;
+    Real sZ2 = sigmaZZ*sigmaZZ;
+    Real sYsZ = sigmaYY*sigmaZZ;
+    Real sZsX = sigmaZZ*sigmaXX;
+    Real sXsY = sigmaXX*sigmaYY;
 
-    double sYZ2 = sigmaYZ*sigmaYZ;
-    double sZX2 = sigmaZX*sigmaZX;
-    double sXY2 = sigmaXY*sigmaXY;
+    Real sYZ2 = sigmaYZ*sigmaYZ;
+    Real sZX2 = sigmaZX*sigmaZX;
+    Real sXY2 = sigmaXY*sigmaXY;
 
     //Others
-    double sigmaE = vonMisesYield(stressTensor, yieldStress) + yieldStress;
-    double sigmaE3 = sigmaE*sigmaE*sigmaE;
-    double invSigmaE = 1 / sigmaE;
+    Real sigmaE = vonMisesYield(stressTensor, yieldStress) + yieldStress;
+    Real sigmaE3 = sigmaE*sigmaE*sigmaE;
+    Real invSigmaE = 1 / sigmaE;
 
     //1st row
     hessian(0, 0) = invSigmaE - (auxX*auxX / (4 * sigmaE3));
@@ -1388,30 +3428,30 @@ auto BeamPlasticFEMForceField<DataTypes>::vonMisesHessian(const VoigtTensor2 &st
 /***************************** Alternative methods for DEBUG **************************/
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::vectEquivalentStress(const VectTensor2 &stressTensor)
+auto BeamPlasticFEMForceField<DataTypes>::vectEquivalentStress(const VectTensor2 &stressTensor) -> Real
 {
     // Compute the equivalent stress using a vector notation
 
-    double eqStress = 0.0;
-    double sigmaXX = stressTensor[0][0];
-    double sigmaXY = stressTensor[1][0];
-    double sigmaXZ = stressTensor[2][0];
-    double sigmaYX = stressTensor[3][0];
-    double sigmaYY = stressTensor[4][0];
-    double sigmaYZ = stressTensor[5][0];
-    double sigmaZX = stressTensor[6][0];
-    double sigmaZY = stressTensor[7][0];
-    double sigmaZZ = stressTensor[8][0];
+    Real eqStress = 0.0;
+    Real sigmaXX = stressTensor[0][0];
+    Real sigmaXY = stressTensor[1][0];
+    Real sigmaXZ = stressTensor[2][0];
+    Real sigmaYX = stressTensor[3][0];
+    Real sigmaYY = stressTensor[4][0];
+    Real sigmaYZ = stressTensor[5][0];
+    Real sigmaZX = stressTensor[6][0];
+    Real sigmaZY = stressTensor[7][0];
+    Real sigmaZZ = stressTensor[8][0];
 
-    double aux1 = 0.5*((sigmaXX - sigmaYY)*(sigmaXX - sigmaYY) + (sigmaYY - sigmaZZ)*(sigmaYY - sigmaZZ) + (sigmaZZ - sigmaXX)*(sigmaZZ - sigmaXX));
-    double aux2 = (3.0 / 2.0)*(sigmaXY*sigmaXY + sigmaYX*sigmaYX + sigmaXZ*sigmaXZ + sigmaZX*sigmaZX + sigmaYZ*sigmaYZ + sigmaZY*sigmaZY);
+    Real aux1 = 0.5*((sigmaXX - sigmaYY)*(sigmaXX - sigmaYY) + (sigmaYY - sigmaZZ)*(sigmaYY - sigmaZZ) + (sigmaZZ - sigmaXX)*(sigmaZZ - sigmaXX));
+    Real aux2 = (3.0 / 2.0)*(sigmaXY*sigmaXY + sigmaYX*sigmaYX + sigmaXZ*sigmaXZ + sigmaZX*sigmaZX + sigmaYZ*sigmaYZ + sigmaZY*sigmaZY);
 
     eqStress = helper::rsqrt(aux1 + aux2);
     return eqStress;
 }
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::devEquivalentStress(const VoigtTensor2 &stressTensor)
+auto BeamPlasticFEMForceField<DataTypes>::devEquivalentStress(const VoigtTensor2 &stressTensor) -> Real
 {
     // Compute the equivalent stress from the expression
     // of the deviatoric stress tensor
@@ -1424,19 +3464,19 @@ double BeamPlasticFEMForceField<DataTypes>::devEquivalentStress(const VoigtTenso
 }
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::devVonMisesYield(const VoigtTensor2 &stressTensor,
-                                                        const double yieldStress)
+auto BeamPlasticFEMForceField<DataTypes>::devVonMisesYield(const VoigtTensor2 &stressTensor,
+                                                         const Real yieldStress) -> Real
 {
-    double devEqStress = devEquivalentStress(stressTensor);
+    Real devEqStress = devEquivalentStress(stressTensor);
     return devEqStress - yieldStress;
 }
 
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::vectVonMisesYield(const VectTensor2 &stressTensor,
-                                                         const double yieldStress)
+auto BeamPlasticFEMForceField<DataTypes>::vectVonMisesYield(const VectTensor2 &stressTensor,
+                                                          const Real yieldStress) -> Real
 {
-    double eqStress = vectEquivalentStress(stressTensor);
+    Real eqStress = vectEquivalentStress(stressTensor);
     return eqStress - yieldStress;
 }
 
@@ -1452,15 +3492,15 @@ auto BeamPlasticFEMForceField<DataTypes>::vectVonMisesGradient(const VectTensor2
     if (equalsZero(sofa::type::scalarProduct(stressTensor, stressTensor)))
         return gradient; //TO DO: is that correct ?
 
-    double sigmaXX = stressTensor[0][0];
-    double sigmaXY = stressTensor[1][0];
-    double sigmaXZ = stressTensor[2][0];
-    double sigmaYX = stressTensor[3][0];
-    double sigmaYY = stressTensor[4][0];
-    double sigmaYZ = stressTensor[5][0];
-    double sigmaZX = stressTensor[6][0];
-    double sigmaZY = stressTensor[7][0];
-    double sigmaZZ = stressTensor[8][0];
+    Real sigmaXX = stressTensor[0][0];
+    Real sigmaXY = stressTensor[1][0];
+    Real sigmaXZ = stressTensor[2][0];
+    Real sigmaYX = stressTensor[3][0];
+    Real sigmaYY = stressTensor[4][0];
+    Real sigmaYZ = stressTensor[5][0];
+    Real sigmaZX = stressTensor[6][0];
+    Real sigmaZY = stressTensor[7][0];
+    Real sigmaZZ = stressTensor[8][0];
 
     gradient[0][0] = 2 * sigmaXX - sigmaYY - sigmaZZ;
     gradient[1][0] = 3 * sigmaXY;
@@ -1472,7 +3512,7 @@ auto BeamPlasticFEMForceField<DataTypes>::vectVonMisesGradient(const VectTensor2
     gradient[7][0] = 3 * sigmaZY;
     gradient[8][0] = 2 * sigmaZZ - sigmaXX - sigmaYY;
 
-    double sigmaEq = vectEquivalentStress(stressTensor);
+    Real sigmaEq = vectEquivalentStress(stressTensor);
     gradient *= 1 / (2 * sigmaEq);
 
     return gradient;
@@ -1491,7 +3531,7 @@ auto BeamPlasticFEMForceField<DataTypes>::devVonMisesGradient(const VoigtTensor2
         return gradient; //TO DO: is that correct ?
 
     VoigtTensor2 devStress = deviatoricStress(stressTensor);
-    double devEqStress = devEquivalentStress(stressTensor);
+    Real devEqStress = devEquivalentStress(stressTensor);
 
     gradient = (3.0 / (2.0*devEqStress))*devStress;
 
@@ -1503,20 +3543,29 @@ auto BeamPlasticFEMForceField<DataTypes>::devVonMisesGradient(const VoigtTensor2
 /*************************** Voigt notation correction ***********************/
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::voigtDotProduct(const VoigtTensor2 &t1, const VoigtTensor2 &t2)
+auto BeamPlasticFEMForceField<DataTypes>::voigtDotProduct(const VoigtTensor2 &t1, const VoigtTensor2 &t2) -> Real
 {
     // This method provides a correct implementation of the dot product for 2nd-order tensors represented
     // with Voigt notation. As the tensors are symmetric, then can be represented with only 6 elements,
     // but all non-diagonal elements have to be taken into account for a dot product.
 
-    double res = 0.0;
+    Real res = 0.0;
     res += t1[0] * t2[0] + t1[1] * t2[1] + t1[2] * t2[2];      //diagonal elements
     res += 2 * (t1[3] * t2[3] + t1[4] * t2[4] + t1[5] * t2[5]);  //non-diagonal elements
     return res;
 }
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::voigtTensorNorm(const VoigtTensor2 &t)
+auto BeamPlasticFEMForceField<DataTypes>::elasticEnergyDensity(const VoigtTensor2& stress, const Real E, const Real nu) -> Real
+{
+    // Inverse of Hooke's law: epsilon = ((1+nu)*sigma - nu*tr(sigma)*I) / E, the
+    // shear components being tensorial as in computeMaterialBehaviour
+    const Real trace = stress[0][0] + stress[1][0] + stress[2][0];
+    return ((1 + nu)*voigtDotProduct(stress, stress) - nu*trace*trace) / (2*E);
+}
+
+template< class DataTypes>
+auto BeamPlasticFEMForceField<DataTypes>::voigtTensorNorm(const VoigtTensor2 &t) -> Real
 {
     // This method provides a correct implementation of the norm for 2nd-order tensors represented
     // with Voigt notation. The unrepresented elements are taken into account in the
@@ -1566,7 +3615,7 @@ auto BeamPlasticFEMForceField<DataTypes>::beTTensor2Mult(const Matrix12x6 &BeT,
 template< class DataTypes>
 auto BeamPlasticFEMForceField<DataTypes>::beTCBeMult(const Matrix12x6 &BeT,
                                                      const VoigtTensor4 &C,
-                                                     const double nu, const double E) -> Matrix12x12
+                                                     const Real nu, const Real E) -> Matrix12x12
 {
     // In Voigt notation, 3 rows in Be (i.e. 3 columns in Be^T) are missing.
     // These rows correspond to the 3 symmetrical non-diagonal elements of the
@@ -1604,8 +3653,11 @@ auto BeamPlasticFEMForceField<DataTypes>::beTCBeMult(const Matrix12x6 &BeT,
 template< class DataTypes>
 void BeamPlasticFEMForceField<DataTypes>::accumulateNonLinearForce(VecDeriv& f,
                                                               const VecCoord& x,
-                                                              int i,
-                                                              Index a, Index b)
+                                                              const VecCoord& x0,
+                                                              BeamInfo& beam,
+                                                              Index a, Index b,
+                                                              LocalNewtonStatistics& statistics,
+                                                              unsigned int chunk)
 {
     //Concrete implementation of addForce
     //Computes f += Kx, assuming that this component is linear
@@ -1614,9 +3666,9 @@ void BeamPlasticFEMForceField<DataTypes>::accumulateNonLinearForce(VecDeriv& f,
     Matrix12x1 fint = Matrix12x1();
 
     if (d_isPerfectlyPlastic.getValue())
-        computeForceWithPerfectPlasticity(fint, x, i, a, b);
+        computeForceWithPerfectPlasticity(fint, x, x0, beam, a, b, chunk);
     else
-        computeForceWithHardening(fint, x, i, a, b);
+        computeForceWithHardening(fint, x, x0, beam, a, b, statistics, chunk);
 
 
     //Passes the contribution to the global system
@@ -1625,6 +3677,13 @@ void BeamPlasticFEMForceField<DataTypes>::accumulateNonLinearForce(VecDeriv& f,
     for (int i = 0; i < 12; i++)
         force[i] = fint[i][0];
 
+    beam._internalForces = force;
+    addElementForce(f, x, a, b, force);
+}
+
+template< class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::addElementForce(VecDeriv& f, const VecCoord& x, Index a, Index b, const Vec12& force)
+{
     Vec3 fa1 = x[a].getOrientation().rotate(Vec3(force[0], force[1], force[2]));
     Vec3 fa2 = x[a].getOrientation().rotate(Vec3(force[3], force[4], force[5]));
 
@@ -1638,7 +3697,7 @@ void BeamPlasticFEMForceField<DataTypes>::accumulateNonLinearForce(VecDeriv& f,
 template< class DataTypes>
 void BeamPlasticFEMForceField<DataTypes>::applyNonLinearStiffness(VecDeriv& df,
                                                              const VecDeriv& dx,
-                                                             int i,
+                                                             const BeamInfo& beam,
                                                              Index a, Index b, double fact)
 {
     //Concrete implementation of addDForce
@@ -1648,7 +3707,7 @@ void BeamPlasticFEMForceField<DataTypes>::applyNonLinearStiffness(VecDeriv& df,
     //Computes displacement increment, from last system solution
     Vec12 local_depl;
     Vec3 u;
-    auto& q = beamQuat(i); //x[a].getOrientation();
+    auto q = beam.quat; //x[a].getOrientation();
     q.normalize();
 
     u = q.inverseRotate(getVCenter(dx[a]));
@@ -1671,22 +3730,20 @@ void BeamPlasticFEMForceField<DataTypes>::applyNonLinearStiffness(VecDeriv& df,
     local_depl[10] = u[1];
     local_depl[11] = u[2];
 
-    m_beamsData.endEdit(); // consecutive to the call to beamQuat
-
-    const MechanicalState beamMechanicalState = m_beamsData.getValue()[i]._beamMechanicalState;
+    const MechanicalState beamMechanicalState = beam._beamMechanicalState;
     Vec12 local_dforce;
 
     // The stiffness matrix we use depends on the mechanical state of the beam element
 
     if (beamMechanicalState == MechanicalState::PLASTIC)
-        local_dforce = m_beamsData.getValue()[i]._Kt_loc * local_depl;
+        local_dforce = beam._Kt_loc * local_depl;
     else
     {
         if (d_usePrecomputedStiffness.getValue())
             // this computation can be optimised: (we know that half of "depl" is null)
-            local_dforce = m_beamsData.getValue()[i]._k_loc * local_depl;
+            local_dforce = beam._k_loc * local_depl;
         else
-            local_dforce = m_beamsData.getValue()[i]._Ke_loc * local_depl;
+            local_dforce = beam._Ke_loc * local_depl;
     }
 
     Vec3 fa1 = q.rotate(Vec3(local_dforce[0], local_dforce[1], local_dforce[2]));
@@ -1699,20 +3756,13 @@ void BeamPlasticFEMForceField<DataTypes>::applyNonLinearStiffness(VecDeriv& df,
 }
 
 template< class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::updateTangentStiffness(int i,
-                                                            Index a,
-                                                            Index b)
+void BeamPlasticFEMForceField<DataTypes>::updateTangentStiffness(BeamInfo& beam)
 {
-    
-    SOFA_UNUSED(a);
-    SOFA_UNUSED(b);
-    
-    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
-    Matrix12x12& Kt_loc = bd[i]._Kt_loc;
-    const Matrix6x6& C = bd[i]._materialBehaviour;
-    const double E = bd[i]._E;
-    const double nu = bd[i]._nu;
-    Vec<27, MechanicalState>& pointMechanicalState = bd[i]._pointMechanicalState;
+    Matrix12x12& Kt_loc = beam._Kt_loc;
+    const Matrix6x6& C = m_materials[beam._materialIndex]._materialBehaviour;
+    const Real E = beam._E;
+    const Real nu = beam._nu;
+    Vec<27, MechanicalState>& pointMechanicalState = beam._pointMechanicalState;
 
     // Reduced integration
     typedef std::function<void(double, double, double, double, double, double)> LambdaType;
@@ -1735,13 +3785,13 @@ void BeamPlasticFEMForceField<DataTypes>::updateTangentStiffness(int i,
         SOFA_UNUSED(u1);
         SOFA_UNUSED(u2);
         SOFA_UNUSED(u3);
-        currentStressPoint = m_prevStresses[i][gaussPointIt];
+        currentStressPoint = VoigtTensor2(beam._prevStresses[gaussPointIt]);
 
-        // Plastic modulus
-        double plasticModulus = computeConstPlasticModulus();
+        // Plastic modulus, at the end of the step
+        Real plasticModulus = computePlasticModulusFromStrain(beam, gaussPointIt);
 
         // Be
-        Be = bd[i]._BeMatrices[gaussPointIt];
+        Be = Matrix6x12(beam._BeMatrices[gaussPointIt]);
 
         // Cep
         gradient = vonMisesGradient(currentStressPoint);
@@ -1792,13 +3842,13 @@ void BeamPlasticFEMForceField<DataTypes>::updateTangentStiffness(int i,
                     //Computation of matrix H as in Studies in anisotropic plasticity with reference to the Hill criterion, De Borst and Feenstra, 1990
                     VectTensor4 H = VectTensor4();
                     VectTensor4 I = VectTensor4::Identity();
-                    VoigtTensor2 elasticPredictor = m_elasticPredictors[i][gaussPointIt];
+                    const VoigtTensor2 elasticPredictor(beam._elasticPredictors[gaussPointIt]);
 
                     VectTensor2 vectGradient = voigtToVect2(gradient);
                     VectTensor4 vectC = voigtToVect4(C);
-                    double yieldStress = m_beamsData.getValue()[i]._localYieldStresses[gaussPointIt];
+                    Real yieldStress = beam._localYieldStresses[gaussPointIt];
                     Mat<1, 1, Real> scalarMatrix = vectGradient.transposed()*vectC*vectGradient;
-                    double DeltaLambda = vonMisesYield(elasticPredictor, yieldStress) / scalarMatrix[0][0];
+                    Real DeltaLambda = vonMisesYield(elasticPredictor, yieldStress) / scalarMatrix[0][0];
                     VectTensor4 vectHessian = vonMisesHessian(elasticPredictor, yieldStress);
 
                     VectTensor4 M = (I + DeltaLambda*vectC*vectHessian);
@@ -1835,14 +3885,14 @@ void BeamPlasticFEMForceField<DataTypes>::updateTangentStiffness(int i,
                     //Computation of matrix H as in Studies in anisotropic plasticity with reference to the Hill criterion, De Borst and Feenstra, 1990
                     VectTensor4 H = VectTensor4();
                     VectTensor4 I = VectTensor4::Identity();
-                    VoigtTensor2 elasticPredictor = m_elasticPredictors[i][gaussPointIt];
+                    const VoigtTensor2 elasticPredictor(beam._elasticPredictors[gaussPointIt]);
 
                     VectTensor2 vectGradient = voigtToVect2(gradient);
                     VectTensor4 vectC = voigtToVect4(C);
-                    double yieldStress = m_beamsData.getValue()[i]._localYieldStresses[gaussPointIt];
+                    Real yieldStress = beam._localYieldStresses[gaussPointIt];
                     // NB: the gradient is the same between the elastic predictor and the new stress
                     Mat<1, 1, Real> scalarMatrix = vectGradient.transposed()*vectC*vectGradient;
-                    double DeltaLambda = vonMisesYield(elasticPredictor, yieldStress) / scalarMatrix[0][0];
+                    Real DeltaLambda = vonMisesYield(elasticPredictor, yieldStress) / scalarMatrix[0][0];
                     VectTensor4 vectHessian = vonMisesHessian(elasticPredictor, yieldStress);
 
                     VectTensor4 M = (I + DeltaLambda*vectC*vectHessian);
@@ -1881,27 +3931,30 @@ void BeamPlasticFEMForceField<DataTypes>::updateTangentStiffness(int i,
         gaussPointIt++; //Next Gauss Point
     };
 
-    ozp::quadrature::detail::Interval<3> interval = bd[i]._integrationInterval;
+    ozp::quadrature::detail::Interval<3> interval = beam._integrationInterval;
     ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(interval, computeTangentStiffness);
 
     for (int i = 0; i < 12; i++)
         for (int j = 0; j < 12; j++)
             Kt_loc[i][j] = tangentStiffness(i, j);
 
-    m_beamsData.endEdit();
+    beam._maxEigenvalue = computeMaxEigenvalueBound(Kt_loc, beam._lumpedMass);
 }
 
 template< class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::computeLocalDisplacement(const VecCoord& x, Vec12 &localDisp,
-                                                              int i, Index a, Index b)
+void BeamPlasticFEMForceField<DataTypes>::computeLocalDisplacement(const VecCoord& x, const VecCoord& x0, Vec12 &localDisp,
+                                                              BeamInfo& beam, Index a, Index b)
 {
-    const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
-
-    beamQuat(i) = x[a].getOrientation();
-    beamQuat(i).normalize();
+    beam.quat = x[a].getOrientation();
+    beam.quat.normalize();
 
-    m_beamsData.endEdit();
+    computeLocalDisplacement(x, x0, localDisp, a, b);
+}
 
+template< class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::computeLocalDisplacement(const VecCoord& x, const VecCoord& x0, Vec12 &localDisp,
+                                                              Index a, Index b)
+{
     Vec3 u, P1P2, P1P2_0;
 
     // translations //
@@ -1915,7 +3968,7 @@ void BeamPlasticFEMForceField<DataTypes>::computeLocalDisplacement(const VecCoor
     localDisp[6] = u[0]; localDisp[7] = u[1]; localDisp[8] = u[2];
 
     // rotations //
-    type::Quat<SReal> dQ0, dQ;
+    type::Quat<Real> dQ0, dQ;
 
     // dQ = QA.i * QB ou dQ = QB * QA.i() ??
     dQ0 = qDiff(x0[b].getOrientation(), x0[a].getOrientation()); // x0[a].getOrientation().inverse() * x0[b].getOrientation();
@@ -1940,17 +3993,35 @@ void BeamPlasticFEMForceField<DataTypes>::computeLocalDisplacement(const VecCoor
 }
 
 
-template< class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::computeDisplacementIncrement(const VecCoord& pos, const VecCoord& lastPos, Vec12 &currentDisp,
-                                                                  Vec12 &lastDisp, Vec12 &dispIncrement, int i, Index a, Index b)
-{
-    // ***** Displacement for current position *****//
+template< class DataTypes>
+void BeamPlasticFEMForceField<DataTypes>::computeDisplacementIncrement(const VecCoord& pos, const VecCoord& lastPos, const VecCoord& x0,
+                                                                  Vec12 &currentDisp, Vec12 &lastDisp, Vec12 &dispIncrement,
+                                                                  BeamInfo& beam, Index a, Index b)
+{
+    // ***** Displacement for current position *****//
+
+    if (d_explicitMode.getValue())
+    {
+        // The element orientation (beam.quat) is only used by the stiffness
+        // methods. The displacement for the last position is the one of the
+        // previous addForce call, unless the positions have been changed since.
+        if (m_hasForceDisplacements)
+            lastDisp = beam._currentDisp;
+        else
+            computeLocalDisplacement(lastPos, x0, lastDisp, a, b);
+
+        computeLocalDisplacement(pos, x0, currentDisp, a, b);
+        beam._currentDisp = currentDisp;
+        dispIncrement = currentDisp - lastDisp;
+        return;
+    }
 
-    computeLocalDisplacement(pos, currentDisp, i, a, b);
+    computeLocalDisplacement(pos, x0, currentDisp, beam, a, b);
+    beam._currentDisp = currentDisp; // reused by draw
 
     // ***** Displacement for last position *****//
 
-    computeLocalDisplacement(lastPos, lastDisp, i, a, b);
+    computeLocalDisplacement(lastPos, x0, lastDisp, beam, a, b);
 
     // ***** Displacement increment *****//
 
@@ -1963,23 +4034,145 @@ void BeamPlasticFEMForceField<DataTypes>::computeDisplacementIncrement(const Vec
 
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::computePlasticModulusFromStress(const VoigtTensor2 &stressState)
+bool BeamPlasticFEMForceField<DataTypes>::readHardeningCurve(const std::string& filename, sofa::type::vector<Vec<2, Real>>& samples)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        msg_error() << "Unable to open hardening curve file: " << filename;
+        return false;
+    }
+
+    samples.clear();
+    std::string line;
+    unsigned int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        // Comma separated values are accepted as well
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream iss(line);
+        std::string first;
+        if (!(iss >> first) || first[0] == '#')
+            continue;
+
+        Vec<2, Real> sample;
+        std::istringstream value(first);
+        if (!(value >> sample[0]) || !(iss >> sample[1]))
+        {
+            msg_error() << "Invalid line " << lineNumber << " in hardening curve file " << filename << ": " << line;
+            return false;
+        }
+        samples.push_back(sample);
+    }
+    return true;
+}
+
+template< class DataTypes>
+auto BeamPlasticFEMForceField<DataTypes>::computePlasticModulusFromStress(int index, const VoigtTensor2 &stressState) -> Real
+{
+    ConstitutiveLawType* law = m_materials[m_beamsData.getValue()[index]._materialIndex]._constitutiveLaw.get();
+    if (!law)
+        return computeConstPlasticModulus();
+    const Real eqStress = equivalentStress(stressState);
+    // A softening branch of the hardening curve is not supported by the radial return
+    return std::max(Real(0), law->getTangentModulusFromStress(eqStress));
+}
+
+template< class DataTypes>
+auto BeamPlasticFEMForceField<DataTypes>::computePlasticModulusFromStrain(ConstitutiveLawType* law, const Real effPlasticStrain) -> Real
+{
+    if (!law)
+        return computeConstPlasticModulus();
+    // A softening branch of the hardening curve is not supported by the radial return
+    return std::max(Real(0), law->getPlasticModulusFromStrain(effPlasticStrain));
+}
+
+template< class DataTypes>
+auto BeamPlasticFEMForceField<DataTypes>::computePlasticModulusFromStrain(const BeamInfo& beam, int gaussPointId) -> Real
+{
+    return computePlasticModulusFromStrain(m_materials[beam._materialIndex]._constitutiveLaw.get(),
+                                           beam._effectivePlasticStrains[gaussPointId]);
+}
+
+template< class DataTypes>
+auto BeamPlasticFEMForceField<DataTypes>::computeHardeningStress(ConstitutiveLawType* law, const Real effPlasticStrain) -> Real
 {
-    const double eqStress = equivalentStress(stressState);
-    double plasticModulus = m_ConstitutiveLaw->getTangentModulusFromStress(eqStress); //TO DO: check for definition of H' in Hugues 1984
-    return plasticModulus;
+    if (!law)
+        return computeConstPlasticModulus()*effPlasticStrain;
+    return law->getStressFromStrain(effPlasticStrain);
 }
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::computePlasticModulusFromStrain(int index, int gaussPointId)
+double BeamPlasticFEMForceField<DataTypes>::computePlasticMultiplier(ConstitutiveLawType* law,
+                                                                     const double xiTrialNorm,
+                                                                     const double yieldStress,
+                                                                     const double effPlasticStrain,
+                                                                     const double mu,
+                                                                     const double initialGuess,
+                                                                     double& hardeningIncrement,
+                                                                     LocalNewtonStatistics& statistics)
 {
-    const Real effPlasticStrain = m_beamsData.getValue()[index]._effectivePlasticStrains[gaussPointId];
-    double plasticModulus = m_ConstitutiveLaw->getTangentModulusFromStrain(effPlasticStrain); //TO DO: check for definition of H' in Hugues 1984
-    return plasticModulus;
+    // Consistency condition, with dK the increment of the hardening curve stress:
+    // r(dLambda) = ||xiTrial|| - sqrt(6)*mu*dLambda - sqrt(2/3)*(yieldStress + dK(dLambda)) = 0
+    // r is decreasing as long as the plastic modulus is positive, and the root is
+    // bracketed by [0, dLambdaMax], dLambdaMax being the perfect plasticity solution.
+    const double sqrt6Mu = helper::rsqrt(6.0)*mu;
+    const double sqrt2Over3 = helper::rsqrt(2.0 / 3.0);
+    const double trialResidual = xiTrialNorm - sqrt2Over3*yieldStress;
+    const double initialHardeningStress = computeHardeningStress(law, effPlasticStrain);
+    const double tolerance = d_localNewtonTolerance.getValue()*sqrt2Over3*yieldStress;
+    const unsigned int maxIterations = std::max(1u, d_maxLocalNewtonIterations.getValue());
+
+    double lowerBound = 0.0;
+    double upperBound = trialResidual / sqrt6Mu;
+
+    // Warm start from the last plastic correction, or linearised solution
+    double plasticMultiplier = initialGuess;
+    if (!(plasticMultiplier > lowerBound && plasticMultiplier < upperBound))
+        plasticMultiplier = trialResidual / (sqrt6Mu + sqrt2Over3*computePlasticModulusFromStrain(law, effPlasticStrain));
+
+    unsigned int nbIterations = 0;
+    bool hasConverged = false;
+    while (nbIterations < maxIterations)
+    {
+        nbIterations++;
+        hardeningIncrement = computeHardeningStress(law, effPlasticStrain + plasticMultiplier) - initialHardeningStress;
+        const double residual = trialResidual - sqrt6Mu*plasticMultiplier - sqrt2Over3*hardeningIncrement;
+        if (std::abs(residual) <= tolerance)
+        {
+            hasConverged = true;
+            break;
+        }
+
+        if (residual > 0)
+            lowerBound = plasticMultiplier;
+        else
+            upperBound = plasticMultiplier;
+
+        const double derivative = sqrt6Mu + sqrt2Over3*computePlasticModulusFromStrain(law, effPlasticStrain + plasticMultiplier);
+        double newMultiplier = plasticMultiplier + residual / derivative;
+        // Bisection if the Newton step leaves the bracket
+        if (!(newMultiplier > lowerBound && newMultiplier < upperBound))
+            newMultiplier = 0.5*(lowerBound + upperBound);
+        plasticMultiplier = newMultiplier;
+    }
+
+    if (!hasConverged)
+    {
+        hardeningIncrement = computeHardeningStress(law, effPlasticStrain + plasticMultiplier) - initialHardeningStress;
+        statistics.nbFailures++;
+    }
+
+    statistics.nbSolves++;
+    statistics.nbIterations += nbIterations;
+    statistics.maxIterationCount = std::max(statistics.maxIterationCount, nbIterations);
+
+    return plasticMultiplier;
 }
 
 template< class DataTypes>
-double BeamPlasticFEMForceField<DataTypes>::computeConstPlasticModulus()
+auto BeamPlasticFEMForceField<DataTypes>::computeConstPlasticModulus() -> Real
 {
     return 34628588874.0; // TO DO: look for proper constant, from Hugues 1984 definition of H'
 }
@@ -2168,13 +4361,18 @@ auto BeamPlasticFEMForceField<DataTypes>::vectToVoigt4(const VectTensor4 &vectTe
 
 template< class DataTypes>
 void BeamPlasticFEMForceField<DataTypes>::computeForceWithPerfectPlasticity(Matrix12x1& internalForces,
-                                                                            const VecCoord& x, int index, Index a, Index b)
+                                                                            const VecCoord& x, const VecCoord& x0,
+                                                                            BeamInfo& beam, Index a, Index b,
+                                                                            unsigned int chunk)
 {
     // Computes displacement increment, from last system solution
     Vec12 currentDisp;
     Vec12 lastDisp;
     Vec12 dispIncrement;
-    computeDisplacementIncrement(x, m_lastPos, currentDisp, lastDisp, dispIncrement, index, a, b);
+    {
+        typename PhaseTimer::Scope timing(m_phaseTimer, COROTATION, chunk);
+        computeDisplacementIncrement(x, m_lastPos.getValue(), x0, currentDisp, lastDisp, dispIncrement, beam, a, b);
+    }
 
     // Converts to Matrix data structure
     Matrix12x1 displacementIncrement;
@@ -2193,10 +4391,14 @@ void BeamPlasticFEMForceField<DataTypes>::computeForceWithPerfectPlasticity(Matr
     VoigtTensor2 strainIncrement = VoigtTensor2();
     VoigtTensor2 newStressPoint = VoigtTensor2();
 
-    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
-    Vec<27, MechanicalState>& pointMechanicalState = bd[index]._pointMechanicalState;
+    Vec<27, MechanicalState>& pointMechanicalState = beam._pointMechanicalState;
     bool isPlasticBeam = false;
+    bool hasPlasticHistory = false;
     int gaussPointIt = 0;
+    PlasticityActivity& activity = m_plasticityActivity[chunk];
+    activity.nbReturnMappings += 27;
+    Real elasticEnergy = 0;
+    Real plasticWork = 0;
 
     // Computation of the new stress point, through material point iterations as in Krabbenhoft lecture notes
 
@@ -2206,45 +4408,78 @@ void BeamPlasticFEMForceField<DataTypes>::computeForceWithPerfectPlasticity(Matr
         SOFA_UNUSED(u1);
         SOFA_UNUSED(u2);
         SOFA_UNUSED(u3);
-        Be = m_beamsData.getValue()[index]._BeMatrices[gaussPointIt];
+        Be = Matrix6x12(beam._BeMatrices[gaussPointIt]);
         MechanicalState &mechanicalState = pointMechanicalState[gaussPointIt];
 
         //Strain
         strainIncrement = Be*displacementIncrement;
 
         //Stress
-        initialStressPoint = m_prevStresses[index][gaussPointIt];
-        computePerfectPlasticStressIncrement(index, gaussPointIt, initialStressPoint, newStressPoint,
+        initialStressPoint = VoigtTensor2(beam._prevStresses[gaussPointIt]);
+        const VoigtTensor2 lastPlasticStrain = VoigtTensor2(beam._plasticStrainHistory[gaussPointIt]);
+        computePerfectPlasticStressIncrement(beam, gaussPointIt, initialStressPoint, newStressPoint,
             strainIncrement, mechanicalState);
 
         isPlasticBeam = isPlasticBeam || (mechanicalState == MechanicalState::PLASTIC);
+        hasPlasticHistory = hasPlasticHistory || (mechanicalState != MechanicalState::ELASTIC);
+        activity.nbGaussPoints[int(mechanicalState)]++;
+        // No effective plastic strain is accumulated without hardening: the
+        // equivalent strain of the plastic strain tensor is reported instead
+        if (mechanicalState != MechanicalState::ELASTIC)
+            activity.maxEffectivePlasticStrain = std::max(activity.maxEffectivePlasticStrain,
+                Real(helper::rsqrt(2.0 / 3.0)*voigtTensorNorm(VoigtTensor2(beam._plasticStrainHistory[gaussPointIt]))));
 
-        m_prevStresses[index][gaussPointIt] = newStressPoint;
+        beam._prevStresses[gaussPointIt] = StorageVoigtTensor2(newStressPoint);
 
-        internalForces += (w1*w2*w3)*beTTensor2Mult(Be.transposed(), newStressPoint);
+        const Real weight = w1*w2*w3;
+        internalForces += weight*beTTensor2Mult(Be.transposed(), newStressPoint);
+
+        // Energy accounting, the plastic strain only changes in a PLASTIC state
+        elasticEnergy += weight*elasticEnergyDensity(newStressPoint, beam._E, beam._nu);
+        if (mechanicalState == MechanicalState::PLASTIC)
+            plasticWork += weight*voigtDotProduct(newStressPoint,
+                VoigtTensor2(beam._plasticStrainHistory[gaussPointIt]) - lastPlasticStrain);
 
         gaussPointIt++; //Next Gauss Point
     };
 
-    ozp::quadrature::detail::Interval<3> interval = m_beamsData.getValue()[index]._integrationInterval;
-    ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(interval, computeStress);
+    ozp::quadrature::detail::Interval<3> interval = beam._integrationInterval;
+    {
+        typename PhaseTimer::Scope timing(m_phaseTimer, STRESS_UPDATE, chunk);
+        ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(interval, computeStress);
+    }
+    beam._elasticEnergy = elasticEnergy;
+    beam._plasticDissipation += plasticWork;
 
     // Updates the beam mechanical state information
     if (!isPlasticBeam)
     {
-        MechanicalState& beamMechanicalState = bd[index]._beamMechanicalState;
+        MechanicalState& beamMechanicalState = beam._beamMechanicalState;
         beamMechanicalState = MechanicalState::POSTPLASTIC;
     }
-    m_beamsData.endEdit();
+    if (isPlasticBeam)
+        activity.nbBeams[int(MechanicalState::PLASTIC)]++;
+    else if (hasPlasticHistory)
+        activity.nbBeams[int(MechanicalState::POSTPLASTIC)]++;
+    else
+        activity.nbBeams[int(MechanicalState::ELASTIC)]++;
 
     //Update the tangent stiffness matrix with the new computed stresses
     //This matrix will then be used in addDForce and addKToMatrix methods
-    updateTangentStiffness(index, a, b);
+    if (d_explicitMode.getValue())
+    {
+        // Kt <= Ke, the elastic bound remains a valid one
+        beam._maxEigenvalue = beam._elasticMaxEigenvalue;
+        return;
+    }
+    typename PhaseTimer::Scope timing(m_phaseTimer, TANGENT_UPDATE, chunk);
+    updateTangentStiffness(beam);
+    activity.nbTangentUpdates++;
 }
 
 
 template< class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::computePerfectPlasticStressIncrement(int index,
+void BeamPlasticFEMForceField<DataTypes>::computePerfectPlasticStressIncrement(BeamInfo& beam,
                                                                                int gaussPointIt,
                                                                                const VoigtTensor2& lastStress,
                                                                                VoigtTensor2& newStressPoint,
@@ -2255,7 +4490,7 @@ void BeamPlasticFEMForceField<DataTypes>::computePerfectPlasticStressIncrement(i
     //NB: we consider that the yield function and the plastic flow are equal (f=g)
     //    This corresponds to an associative flow rule (for plasticity)
 
-    const Matrix6x6& C = m_beamsData.getValue()[index]._materialBehaviour; //Matrix D in Krabbenhoft's
+    const Matrix6x6& C = m_materials[beam._materialIndex]._materialBehaviour; //Matrix D in Krabbenhoft's
 
     /***************************************************/
     /*  Radial return in perfect plasticity - Hugues   */
@@ -2267,19 +4502,16 @@ void BeamPlasticFEMForceField<DataTypes>::computePerfectPlasticStressIncrement(i
         VoigtTensor2 elasticIncrement = C * strainIncrement;
         VoigtTensor2 trialStress = lastStress + elasticIncrement;
 
-        if (d_useConsistentTangentOperator.getValue())
-            m_elasticPredictors[index][gaussPointIt] = trialStress;
-
-        type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
+        if (d_useConsistentTangentOperator.getValue() && !d_explicitMode.getValue())
+            beam._elasticPredictors[gaussPointIt] = StorageVoigtTensor2(trialStress);
 
-        Vec<27, Real>& localYieldStresses = bd[index]._localYieldStresses;
-        Real& yieldStress = localYieldStresses[gaussPointIt];
+        const Real yieldStress = beam._localYieldStresses[gaussPointIt];
 
         VoigtTensor2 devTrialStress = deviatoricStress(trialStress);
 
-        double A = voigtDotProduct(devTrialStress, devTrialStress);
-        double R = helper::rsqrt(2.0 / 3) * yieldStress;
-        const double R2 = R * R;
+        Real A = voigtDotProduct(devTrialStress, devTrialStress);
+        Real R = helper::rsqrt(2.0 / 3) * yieldStress;
+        const Real R2 = R * R;
 
         if (A <= R2) //TO DO: proper comparison
         {
@@ -2303,7 +4535,7 @@ void BeamPlasticFEMForceField<DataTypes>::computePerfectPlasticStressIncrement(i
             // Ref: Theoretical foundation for large scale computations for nonlinear
             // material behaviour, Hugues (et al) 1984
 
-            double meanStress = (1.0 / 3) * (trialStress[0][0] + trialStress[1][0] + trialStress[2][0]);
+            Real meanStress = (1.0 / 3) * (trialStress[0][0] + trialStress[1][0] + trialStress[2][0]);
 
             // Computing the new stress
             VoigtTensor2 voigtIdentityTensor = VoigtTensor2();
@@ -2316,31 +4548,36 @@ void BeamPlasticFEMForceField<DataTypes>::computePerfectPlasticStressIncrement(i
             // Updating the plastic strain
             VoigtTensor2 yieldNormal = helper::rsqrt(3.0 / 2) * (1.0 / equivalentStress(trialStress)) * devTrialStress;
 
-            double lambda = voigtDotProduct(yieldNormal, strainIncrement);
+            Real lambda = voigtDotProduct(yieldNormal, strainIncrement);
 
             VoigtTensor2 plasticStrainIncrement = lambda * yieldNormal;
-            type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
-            Vec<27, VoigtTensor2>& plasticStrainHistory = bd[index]._plasticStrainHistory;
-            plasticStrainHistory[gaussPointIt] += plasticStrainIncrement;
-            m_beamsData.endEdit();
+            StorageVoigtTensor2& plasticStrain = beam._plasticStrainHistory[gaussPointIt];
+            plasticStrain = StorageVoigtTensor2(VoigtTensor2(plasticStrain) + plasticStrainIncrement);
+
         }
 
     }
 }
 
 
-//---------- Incremental force computation for linear mixed (isotropic and kinematic) hardening ----------//
+//---------- Incremental force computation for mixed (isotropic and kinematic) hardening ----------//
 
 
 template< class DataTypes>
 void BeamPlasticFEMForceField<DataTypes>::computeForceWithHardening(Matrix12x1 &internalForces,
-                                                                    const VecCoord& x, int index, Index a, Index b)
+                                                                    const VecCoord& x, const VecCoord& x0,
+                                                                    BeamInfo& beam, Index a, Index b,
+                                                                    LocalNewtonStatistics& statistics,
+                                                                    unsigned int chunk)
 {
     // Computes displacement increment, from last system solution
     Vec12 currentDisp;
     Vec12 lastDisp;
     Vec12 dispIncrement;
-    computeDisplacementIncrement(x, m_lastPos, currentDisp, lastDisp, dispIncrement, index, a, b);
+    {
+        typename PhaseTimer::Scope timing(m_phaseTimer, COROTATION, chunk);
+        computeDisplacementIncrement(x, m_lastPos.getValue(), x0, currentDisp, lastDisp, dispIncrement, beam, a, b);
+    }
 
     // Converts to Matrix data structure
     Matrix12x1 displacementIncrement;
@@ -2359,10 +4596,14 @@ void BeamPlasticFEMForceField<DataTypes>::computeForceWithHardening(Matrix12x1 &
     VoigtTensor2 strainIncrement = VoigtTensor2();
     VoigtTensor2 newStressPoint = VoigtTensor2();
 
-    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
-    Vec<27, MechanicalState>& pointMechanicalState = bd[index]._pointMechanicalState;
+    Vec<27, MechanicalState>& pointMechanicalState = beam._pointMechanicalState;
     bool isPlasticBeam = false;
+    bool hasPlasticHistory = false;
     int gaussPointIt = 0;
+    PlasticityActivity& activity = m_plasticityActivity[chunk];
+    activity.nbReturnMappings += 27;
+    Real elasticEnergy = 0;
+    Real plasticWork = 0;
 
     // Computation of the new stress point, through material point iterations as in Krabbenhoft lecture notes
 
@@ -2372,57 +4613,86 @@ void BeamPlasticFEMForceField<DataTypes>::computeForceWithHardening(Matrix12x1 &
         SOFA_UNUSED(u1);
         SOFA_UNUSED(u2);
         SOFA_UNUSED(u3);
-        Be = m_beamsData.getValue()[index]._BeMatrices[gaussPointIt];
+        Be = Matrix6x12(beam._BeMatrices[gaussPointIt]);
         MechanicalState &mechanicalState = pointMechanicalState[gaussPointIt];
 
         //Strain
         strainIncrement = Be*displacementIncrement;
 
         //Stress
-        initialStressPoint = m_prevStresses[index][gaussPointIt];
-        computeHardeningStressIncrement(index, gaussPointIt, initialStressPoint, newStressPoint,
-            strainIncrement, mechanicalState);
+        initialStressPoint = VoigtTensor2(beam._prevStresses[gaussPointIt]);
+        const VoigtTensor2 lastPlasticStrain = VoigtTensor2(beam._plasticStrainHistory[gaussPointIt]);
+        computeHardeningStressIncrement(beam, gaussPointIt, initialStressPoint, newStressPoint,
+            strainIncrement, mechanicalState, statistics);
 
         isPlasticBeam = isPlasticBeam || (mechanicalState == MechanicalState::PLASTIC);
+        hasPlasticHistory = hasPlasticHistory || (mechanicalState != MechanicalState::ELASTIC);
+        activity.nbGaussPoints[int(mechanicalState)]++;
+        activity.maxEffectivePlasticStrain = std::max(activity.maxEffectivePlasticStrain,
+                                                      Real(beam._effectivePlasticStrains[gaussPointIt]));
+
+        beam._prevStresses[gaussPointIt] = StorageVoigtTensor2(newStressPoint);
 
-        m_prevStresses[index][gaussPointIt] = newStressPoint;
+        const Real weight = w1*w2*w3;
+        internalForces += weight*beTTensor2Mult(Be.transposed(), newStressPoint);
 
-        internalForces += (w1*w2*w3)*beTTensor2Mult(Be.transposed(), newStressPoint);
+        // Energy accounting, the plastic strain only changes in a PLASTIC state
+        elasticEnergy += weight*elasticEnergyDensity(newStressPoint, beam._E, beam._nu);
+        if (mechanicalState == MechanicalState::PLASTIC)
+            plasticWork += weight*voigtDotProduct(newStressPoint,
+                VoigtTensor2(beam._plasticStrainHistory[gaussPointIt]) - lastPlasticStrain);
 
         gaussPointIt++; //Next Gauss Point
     };
 
-    ozp::quadrature::detail::Interval<3> interval = m_beamsData.getValue()[index]._integrationInterval;
-    ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(interval, computeStress);
+    ozp::quadrature::detail::Interval<3> interval = beam._integrationInterval;
+    {
+        typename PhaseTimer::Scope timing(m_phaseTimer, STRESS_UPDATE, chunk);
+        ozp::quadrature::integrate <GaussianQuadratureType, 3, LambdaType>(interval, computeStress);
+    }
+    beam._elasticEnergy = elasticEnergy;
+    beam._plasticDissipation += plasticWork;
 
     // Updates the beam mechanical state information
     if (!isPlasticBeam)
     {
-        MechanicalState& beamMechanicalState = bd[index]._beamMechanicalState;
+        MechanicalState& beamMechanicalState = beam._beamMechanicalState;
         beamMechanicalState = MechanicalState::POSTPLASTIC;
     }
-    m_beamsData.endEdit();
+    if (isPlasticBeam)
+        activity.nbBeams[int(MechanicalState::PLASTIC)]++;
+    else if (hasPlasticHistory)
+        activity.nbBeams[int(MechanicalState::POSTPLASTIC)]++;
+    else
+        activity.nbBeams[int(MechanicalState::ELASTIC)]++;
 
     //Update the tangent stiffness matrix with the new computed stresses
     //This matrix will then be used in addDForce and addKToMatrix methods
-    if (isPlasticBeam)
-        updateTangentStiffness(index, a, b);
+    if (isPlasticBeam && !d_explicitMode.getValue())
+    {
+        typename PhaseTimer::Scope timing(m_phaseTimer, TANGENT_UPDATE, chunk);
+        updateTangentStiffness(beam);
+        activity.nbTangentUpdates++;
+    }
+    else
+        beam._maxEigenvalue = beam._elasticMaxEigenvalue;
 }
 
 
 template< class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::computeHardeningStressIncrement(int index,
+void BeamPlasticFEMForceField<DataTypes>::computeHardeningStressIncrement(BeamInfo& beam,
                                                                      int gaussPointIt,
                                                                      const VoigtTensor2 &lastStress,
                                                                      VoigtTensor2 &newStressPoint,
                                                                      const VoigtTensor2 &strainIncrement,
-                                                                     MechanicalState &pointMechanicalState)
+                                                                     MechanicalState &pointMechanicalState,
+                                                                     LocalNewtonStatistics& statistics)
 {
     /** Material point iterations **/
     //NB: we consider that the yield function and the plastic flow are equal (f=g)
     //    This corresponds to an associative flow rule (for plasticity)
 
-    const Matrix6x6& C = m_beamsData.getValue()[index]._materialBehaviour; //Matrix D in Krabbenhoft's
+    const Matrix6x6& C = m_materials[beam._materialIndex]._materialBehaviour; //Matrix D in Krabbenhoft's
 
     /***************************************************/
     /*      Radial return with hardening - Hugues      */
@@ -2434,16 +4704,14 @@ void BeamPlasticFEMForceField<DataTypes>::computeHardeningStressIncrement(int in
     VoigtTensor2 elasticIncrement = C*strainIncrement;
     VoigtTensor2 trialStress = lastStress + elasticIncrement;
 
-    if (d_useConsistentTangentOperator.getValue())
-        m_elasticPredictors[index][gaussPointIt] = trialStress;
-
-    type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
+    if (d_useConsistentTangentOperator.getValue() && !d_explicitMode.getValue())
+        beam._elasticPredictors[gaussPointIt] = StorageVoigtTensor2(trialStress);
 
-    Vec<27, VoigtTensor2> &backStresses = bd[index]._backStresses;
-    VoigtTensor2 &backStress = backStresses[gaussPointIt];
+    // Plasticity history, converted to the computation precision (see StorageReal)
+    StorageVoigtTensor2 &storedBackStress = beam._backStresses[gaussPointIt];
+    const VoigtTensor2 backStress(storedBackStress);
 
-    Vec<27, Real> &localYieldStresses = bd[index]._localYieldStresses;
-    Real &yieldStress = localYieldStresses[gaussPointIt];
+    StorageReal &yieldStress = beam._localYieldStresses[gaussPointIt];
 
     if (!goToPlastic(trialStress - backStress, yieldStress))
     {
@@ -2465,266 +4733,37 @@ void BeamPlasticFEMForceField<DataTypes>::computeHardeningStressIncrement(int in
         const VoigtTensor2 xiTrial = deviatoricStress(shiftedTrialStress);
 
         // Normal at the end of the time step
-        const double xiTrialNorm = voigtTensorNorm(xiTrial);
+        const Real xiTrialNorm = voigtTensorNorm(xiTrial);
         const VoigtTensor2 finalN = xiTrial / xiTrialNorm;
 
-        const double beta = 0.5; // Indicates the proportion of Kinematic vs isotropic hardening. beta=0 <=> kinematic, beta=1 <=> isotropic
+        const Real beta = 0.5; // Indicates the proportion of Kinematic vs isotropic hardening. beta=0 <=> kinematic, beta=1 <=> isotropic
 
-        const double E = m_beamsData.getValue()[index]._E;
-        const double nu = m_beamsData.getValue()[index]._nu;
-        const double mu = E / (2 * (1 + nu)); // Lame coefficient
+        const Real E = beam._E;
+        const Real nu = beam._nu;
+        const Real mu = E / (2 * (1 + nu)); // Lame coefficient
 
-        const double H = computeConstPlasticModulus();
+        Vec<27, StorageReal> &effectivePlasticStrain = beam._effectivePlasticStrains;
+        StorageReal &lastPlasticMultiplier = beam._plasticMultipliers[gaussPointIt];
 
-        // Computation of the plastic multiplier
-        const double plasticMultiplier = (xiTrialNorm - helper::rsqrt(2.0 / 3.0)*yieldStress) / ( mu*helper::rsqrt(6.0) * (1 + H / (3 * mu)));
+        // Computation of the plastic multiplier, with the hardening curve of the constitutive law
+        double hardeningIncrement = 0.0;
+        ConstitutiveLawType* law = m_materials[beam._materialIndex]._constitutiveLaw.get();
+        const double plasticMultiplier = computePlasticMultiplier(law, xiTrialNorm, yieldStress, effectivePlasticStrain[gaussPointIt],
+                                                                  mu, lastPlasticMultiplier, hardeningIncrement, statistics);
+        lastPlasticMultiplier = plasticMultiplier;
 
         // Updating plastic variables
         newStressPoint = trialStress - helper::rsqrt(6.0)*mu*plasticMultiplier*finalN;
 
-        yieldStress += beta*H*plasticMultiplier;
+        yieldStress += beta*hardeningIncrement;
 
-        backStress += helper::rsqrt(2.0 / 3.0)*(1 - beta)*H*plasticMultiplier*finalN;
+        storedBackStress = StorageVoigtTensor2(backStress + helper::rsqrt(2.0 / 3.0)*(1 - beta)*hardeningIncrement*finalN);
 
-        //type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit()); //Done in the beginning to modify the yield and back stresses
-        Vec<27, VoigtTensor2> &plasticStrainHistory = bd[index]._plasticStrainHistory;
+        StorageVoigtTensor2 &plasticStrain = beam._plasticStrainHistory[gaussPointIt];
         VoigtTensor2 plasticStrainIncrement = helper::rsqrt(3.0/2.0)*plasticMultiplier*finalN;
-        plasticStrainHistory[gaussPointIt] += plasticStrainIncrement;
-        //m_beamsData.endEdit();
+        plasticStrain = StorageVoigtTensor2(VoigtTensor2(plasticStrain) + plasticStrainIncrement);
 
-        Vec<27, Real> &effectivePlasticStrain = bd[index]._effectivePlasticStrains;
         effectivePlasticStrain[gaussPointIt] += plasticMultiplier;
-
-        m_beamsData.endEdit(); //end edit _backStresses, _localYieldStresses, _plasticStrainHistory, and _effectivePlasticStrains
-    }
-}
-
-
-//---------- Gaussian quadrature integration methods ----------//
-
-template< class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::initialiseInterval(int beam, type::vector<Interval3>& integrationIntervals)
-{
-    if (d_sectionShape.getValue() == "rectangular")
-    {
-        Real L = m_beamsData.getValue()[beam]._L;
-        Real Ly = d_ySection.getValue();
-        Real Lz = d_zSection.getValue();
-
-        // Integration interval definition for a local frame at the centre of the beam
-        integrationIntervals.push_back(Interval3(-L / 2, L / 2, -Ly / 2, Ly / 2, -Lz / 2, Lz / 2));
-    }
-    else if (d_sectionShape.getValue() == "circular")
-    {
-        //TO DO: implement quadrature method for a disc and a hollow-disc cross section
-        msg_error() << "Quadrature method for " << d_sectionShape.getValue()
-            << " shape cross section has not been implemented yet. Methods for rectangular cross sections are available";
-    }
-    else
-    {
-        msg_error() << "Quadrature method for " << d_sectionShape.getValue()
-            << " shape cross section has not been implemented yet. Methods for rectangular cross sections are available";
-    }
-}
-
-template< class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::initialiseGaussPoints(int beam, type::vector<beamGaussPoints>& gaussPoints, const Interval3& integrationInterval)
-{
-    //Gaussian nodes coordinates and weights for a 1D integration on [-1,1]
-    const double sqrt3_5 = helper::rsqrt(3.0 / 5);
-    Vec3 canonical3NodesCoordinates = { -sqrt3_5, 0, sqrt3_5 };
-    Vec3 canonical3NodesWeights = { 5.0 / 9, 8.0 / 9, 5.0 / 9 };
-
-    Real L = m_beamsData.getValue()[beam]._L;
-    Real A = m_beamsData.getValue()[beam]._A;
-    Real Iy = m_beamsData.getValue()[beam]._Iy;
-    Real Iz = m_beamsData.getValue()[beam]._Iz;
-
-    Real nu = m_beamsData.getValue()[beam]._nu;
-    Real E = m_beamsData.getValue()[beam]._E;
-
-    //Compute actual Gauss points coordinates and weights, with a 3D integration
-    //NB: 3 loops because integration is in 3D, 3 iterations per loop because it's a 3 point integration
-    unsigned int gaussPointIt = 0;
-    for (unsigned int i = 0; i < 3; i++)
-    {
-        double x = canonical3NodesCoordinates[i];
-        double w1 = canonical3NodesWeights[i];
-        // Changing first coordinate and weight to adapt to the integration interval
-        double a1 = integrationInterval.geta1();
-        double b1 = integrationInterval.getb1();
-        double xChanged = changeCoordinate(x, a1, b1);
-        double w1Changed = changeWeight(w1, a1, b1);
-
-        for (unsigned int j = 0; j < 3; j++)
-        {
-            double y = canonical3NodesCoordinates[j];
-            double w2 = canonical3NodesWeights[j];
-            // Changing second coordinate and weight to adapt to the integration interval
-            double a2 = integrationInterval.geta2();
-            double b2 = integrationInterval.getb2();
-            double yChanged = changeCoordinate(y, a2, b2);
-            double w2Changed = changeWeight(w2, a2, b2);
-
-            for (unsigned int k = 0; k < 3; k++)
-            {
-                double z = canonical3NodesCoordinates[k];
-                double w3 = canonical3NodesWeights[k];
-                // Changing third coordinate and weight to adapt to the integration interval
-                double a3 = integrationInterval.geta3();
-                double b3 = integrationInterval.getb3();
-                double zChanged = changeCoordinate(z, a3, b3);
-                double w3Changed = changeWeight(w3, a3, b3);
-
-                GaussPoint3 newGaussPoint = GaussPoint3(xChanged, yChanged, zChanged, w1Changed, w2Changed, w3Changed);
-                newGaussPoint.setGradN(computeGradN(xChanged, yChanged, zChanged, L, A, Iy, Iz, E, nu));
-                newGaussPoint.setNx(computeNx(xChanged, yChanged, zChanged, L, A, Iy, Iz, E, nu));
-                newGaussPoint.setYieldStress(d_initialYieldStress.getValue());
-                gaussPoints[beam][gaussPointIt] = newGaussPoint;
-                gaussPointIt++;
-            }
-        }
-    }
-}
-
-template< class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::computeNx(Real x, Real y, Real z, Real L, Real A, Real Iy, Real Iz,
-                                                    Real E, Real nu, Real kappaY, Real kappaZ)->Matrix3x12
-{
-    Matrix3x12 Nx = Matrix3x12(); // Sets each element to 0
-    Real xi = x / L;
-    Real eta = y / L;
-    Real zeta = z / L;
-
-    Real xi2 = xi * xi;
-    Real xi3 = xi * xi * xi;
-
-    Real L2 = L * L;
-    Real G = E / (2.0 * (1.0 + nu));
-
-    Real phiY, phiZ;
-    if (A == 0)
-    {
-        phiY = 0.0;
-        phiZ = 0.0;
-    }
-    else
-    {
-        phiY = (12.0 * E * Iy / (kappaZ * G * A * L2));
-        phiZ = (12.0 * E * Iz / (kappaY * G * A * L2));
-    }
-    Real phiYInv = ( 1 / (phiY - 1) );
-    Real phiZInv = ( 1 / (1 + phiZ) );
-
-    Nx(0, 0) = 1 - xi;
-    Nx(0, 1) = 6 * phiZInv * (xi - xi2) * eta;
-    Nx(0, 2) = 6 * phiYInv * (xi - xi2) * zeta;
-    //Nx(0, 3) = 0;
-    Nx(0, 4) = L * phiYInv * (1 - 4 * xi + 3 * xi2 + phiY * (1 - xi)) * zeta;
-    Nx(0, 5) = - L * phiZInv * (1 - 4 * xi + 3 * xi2 + phiZ * (1 - xi)) * eta;
-    Nx(0, 6) = xi;
-    Nx(0, 7) = 6 * phiZInv * (-xi + xi2) * eta;
-    Nx(0, 8) = 6 * phiYInv * (-xi + xi2) * zeta;
-    //Nx(0, 9) = 0;
-    Nx(0, 10) = L * phiYInv * (-2 * xi + 3 * xi2 + phiY * xi) * zeta;
-    Nx(0, 11) = - L * phiZInv * (-2 * xi + 3 * xi2 + phiZ * xi) * eta;
-
-    //Nx(1, 0) = 0;
-    Nx(1, 1) = phiZInv * (1 - 3 * xi2 + 2 * xi3 + phiZ * (1 - xi));
-    //Nx(1, 2) = 0;
-    Nx(1, 3) = (xi - 1) * L * zeta;
-    //Nx(1, 4) = 0;
-    Nx(1, 5) = L * phiZInv * (xi - 2 * xi2 + xi3 + (phiZ / 2) * (xi - xi2));
-    //Nx(1, 6) = 0;
-    Nx(1, 7) = phiZInv * (3 * xi2 - 2 * xi3 + phiZ * xi);
-    //Nx(1, 8) = 0;
-    Nx(1, 9) = - L * xi * zeta;
-    //Nx(1, 10) = 0;
-    Nx(1, 11) = L * phiZInv * (-xi2 + xi3 - (phiZ / 2) * (xi - xi2));
-
-    //Nx(2, 0) = 0;
-    //Nx(2, 1) = 0;
-    Nx(2, 2) = phiYInv * (1 - 3 * xi2 + 2 * xi3 + phiY * (1 - xi));
-    Nx(2, 3) = (1 - xi) * L * eta;
-    Nx(2, 4) = - L * phiYInv * (xi - 2 * xi2 + xi3 + (phiY / 2) * (xi - xi2));
-    //Nx(2, 5) = 0;
-    //Nx(2, 6) = 0;
-    //Nx(2, 7) = 0;
-    Nx(2, 8) = phiYInv * (3 * xi2 - 2 * xi3 + phiY * xi);
-    Nx(2, 9) = L * xi * eta;
-    Nx(2, 10) = - L * phiYInv * (-xi2 + xi3 - (phiY / 2) * (xi - xi2));
-    //Nx(2, 11) = 0;
-
-    return Nx;
-}
-
-template< class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::computeGradN(Real x, Real y, Real z, Real L, Real A, Real Iy, Real Iz,
-                                                       Real E, Real nu, Real kappaY, Real kappaZ)->Matrix9x12
-{
-    Matrix9x12 gradN = Matrix9x12(); // Sets each element to 0
-    Real xi = x / L;
-    Real eta = y / L;
-    Real zeta = z / L;
-
-    Real L2 = L * L;
-    Real G = E / (2.0 * (1.0 + nu));
-
-    Real phiY, phiZ;
-    if (A == 0)
-    {
-        phiY = 0.0;
-        phiZ = 0.0;
-    }
-    else
-    {
-        phiY = (12.0 * E * Iy / (kappaZ * G * A * L2));
-        phiZ = (12.0 * E * Iz / (kappaY * G * A * L2));
-    }
-    Real phiYInv = ( 1 / (phiY - 1) );
-    Real phiZInv = ( 1 / (1 + phiZ) );
-
-    //Row 0
-    gradN(0, 0) = - 1 / L;
-    gradN(0, 1) = - ( 12*phiZInv * xi * eta ) / L;
-    gradN(0, 2) = ( 12*phiYInv * xi * zeta ) / L;
-    // gradN(0, 3) = 0;
-    gradN(0, 4) = - ( 1 + 6*phiYInv * xi ) * zeta;
-    gradN(0, 5) = ( 1 - 6*phiZInv * xi) * eta;
-    gradN(0, 6) = 1 / L;
-    gradN(0, 7) = - gradN(0, 1);
-    gradN(0, 8) = - gradN(0, 2);
-    // gradN(0, 9) = 0;
-    gradN(0, 10) = gradN(0, 4) + 2 * zeta;
-    gradN(0, 11) = gradN(0, 5) - 2 * eta;
-
-    //Rows 1 and 3
-    gradN(1, 3) = zeta / 2;
-    gradN(1, 9) = -zeta / 2;
-
-    gradN(3, 3) = zeta / 2;
-    gradN(3, 9) = -zeta / 2;
-
-    //Rows 2 and 6
-    gradN(2, 3) = -eta / 2;
-    gradN(2, 9) = eta / 2;
-
-    gradN(6, 3) = -eta / 2;
-    gradN(6, 9) = eta / 2;
-
-    //Rows 4, 5, 7, 8 are null
-
-    return gradN;
-}
-
-template <class DataTypes>
-template <typename LambdaType>
-void BeamPlasticFEMForceField<DataTypes>::integrateBeam(beamGaussPoints& gaussPoints, LambdaType integrationFun)
-{
-    //Apply a generic (lambda) integration function to each Gauss point of a beam element
-    for (unsigned int gp = 0; gp < gaussPoints.size(); gp++)
-    {
-        integrationFun(gaussPoints[gp]);
     }
 }
 
@@ -2734,7 +4773,7 @@ void BeamPlasticFEMForceField<DataTypes>::integrateBeam(beamGaussPoints& gaussPo
 /*****************************************************************************/
 
 template<class DataTypes>
-type::Quat<SReal>& BeamPlasticFEMForceField<DataTypes>::beamQuat(int i)
+auto BeamPlasticFEMForceField<DataTypes>::beamQuat(int i) -> type::Quat<Real>&
 {
     type::vector<BeamInfo>& bd = *(m_beamsData.beginEdit());
     return bd[i].quat;
@@ -2743,201 +4782,4 @@ type::Quat<SReal>& BeamPlasticFEMForceField<DataTypes>::beamQuat(int i)
 /**************************************************************************/
 
 
-/*****************************************************************************/
-/*                               GaussPoint3                                 */
-/*****************************************************************************/
-
-template <class DataTypes>
-BeamPlasticFEMForceField<DataTypes>::GaussPoint3::GaussPoint3(Real x, Real y, Real z, Real w1, Real w2, Real w3)
-{
-    m_coordinates = { x, y, z };
-    m_weights = { w1, w2, w3 };
-    m_mechanicalState = MechanicalState::ELASTIC; //By default, before any deformation occurs
-    m_prevStress = Vec9(); //By default, no deformation => 0 stress tensor
-    m_backStress = Vec9(); //By default, no plastic deformation => back stress is 0
-    m_yieldStress = 0; //Changed by initialiseGaussPoints, depends on the material
-    m_plasticStrain = Vec9(); //By default, no plastic deformation => no history
-    m_effectivePlasticStrain = 0; //By default, no plastic deformation => no history
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::GaussPoint3::getNx() const -> const Matrix3x12&
-{
-    return m_Nx;
-}
-
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::GaussPoint3::setNx(Matrix3x12 Nx)
-{
-    m_Nx = Nx;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::GaussPoint3::getGradN() const -> const Matrix9x12&
-{
-    return m_gradN;
-}
-
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::GaussPoint3::setGradN(Matrix9x12 gradN)
-{
-    m_gradN = gradN;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::GaussPoint3::getMechanicalState() const -> const MechanicalState
-{
-    return m_mechanicalState;
-}
-
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::GaussPoint3::setMechanicalState(MechanicalState newState)
-{
-    m_mechanicalState = newState;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::GaussPoint3::getPrevStress() const -> const Vec9&
-{
-    return m_prevStress;
-}
-
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::GaussPoint3::setPrevStress(Vec9 newStress)
-{
-    m_prevStress = newStress;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::GaussPoint3::getCoord() const -> const Vec3&
-{
-    return m_coordinates;
-}
-
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::GaussPoint3::setCoord(Vec3 coord)
-{
-    m_coordinates = coord;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::GaussPoint3::getWeights() const -> const Vec3&
-{
-    return m_weights;
-}
-
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::GaussPoint3::setWeights(Vec3 weights)
-{
-    m_weights = weights;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::GaussPoint3::getBackStress() const -> const Vec9&
-{
-    return m_backStress;
-}
-
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::GaussPoint3::setBackStress(Vec9 backStress)
-{
-    m_backStress = backStress;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::GaussPoint3::getYieldStress() const ->const Real
-{
-    return m_yieldStress;
-}
-
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::GaussPoint3::setYieldStress(Real yieldStress)
-{
-    m_yieldStress = yieldStress;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::GaussPoint3::getPlasticStrain() const -> const Vec9&
-{
-    return m_plasticStrain;
-}
-
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::GaussPoint3::setPlasticStrain(Vec9 plasticStrain)
-{
-    m_plasticStrain = plasticStrain;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::GaussPoint3::getEffectivePlasticStrain() const ->const Real
-{
-    return m_effectivePlasticStrain;
-}
-
-template <class DataTypes>
-void BeamPlasticFEMForceField<DataTypes>::GaussPoint3::setEffectivePlasticStrain(Real effectivePlasticStrain)
-{
-    m_effectivePlasticStrain = effectivePlasticStrain;
-}
-
-
-/*****************************************************************************/
-/*                                Interval3                                  */
-/*****************************************************************************/
-
-template <class DataTypes>
-BeamPlasticFEMForceField<DataTypes>::Interval3::Interval3()
-{
-    //By default, integration is considered over [-1,1]*[-1,1]*[-1,1].
-    m_a1 = m_a2 = m_a3 = -1;
-    m_b1 = m_b2 = m_b3 = 1;
-}
-
-template <class DataTypes>
-BeamPlasticFEMForceField<DataTypes>::Interval3::Interval3(Real a1, Real b1, Real a2, Real b2, Real a3, Real b3)
-{
-    m_a1 = a1;
-    m_b1 = b1;
-    m_a2 = a2;
-    m_b2 = b2;
-    m_a3 = a3;
-    m_b3 = b3;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::Interval3::geta1() const -> Real
-{
-    return m_a1;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::Interval3::getb1() const -> Real
-{
-    return m_b1;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::Interval3::geta2() const -> Real
-{
-    return m_a2;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::Interval3::getb2() const -> Real
-{
-    return m_b2;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::Interval3::geta3() const -> Real
-{
-    return m_a3;
-}
-
-template <class DataTypes>
-auto BeamPlasticFEMForceField<DataTypes>::Interval3::getb3() const -> Real
-{
-    return m_b3;
-}
-
 } // namespace beamplastic::forcefield
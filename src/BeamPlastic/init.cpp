@@ -34,6 +34,13 @@ extern void registerBeamPlasticFEMForceField(sofa::core::ObjectFactory* factory)
 
 }
 
+namespace mapping
+{
+
+extern void registerBeamPlasticShapeFunctionMapping(sofa::core::ObjectFactory* factory);
+
+}
+
 extern "C" {
     BEAMPLASTIC_API void initExternalModule();
     BEAMPLASTIC_API const char* getModuleName();
@@ -80,6 +87,7 @@ const char* getModuleDescription()
 void registerObjects(sofa::core::ObjectFactory* factory)
 {
     forcefield::registerBeamPlasticFEMForceField(factory);
+    mapping::registerBeamPlasticShapeFunctionMapping(factory);
 }
 
 } // namespace beamplastic
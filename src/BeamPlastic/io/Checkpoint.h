@@ -0,0 +1,134 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+#include <BeamPlastic/io/MappedFile.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+
+namespace beamplastic::io
+{
+
+/**
+ * Binary checkpoint files of the plastic state of the force field.
+ * A checkpoint is made of a fixed-size header followed by raw arrays
+ * (sections), written and read in the same order. The arrays are copied
+ * as is, in the native byte order: a checkpoint can only be read on a
+ * platform with the same endianness and floating point precisions, which
+ * are recorded in the header.
+ */
+
+constexpr char CheckpointMagic[8] = { 'B', 'P', 'C', 'K', 'P', 'T', '\0', '\0' };
+/// To be incremented at each change of the checkpoint layout
+constexpr std::uint32_t CheckpointVersion = 2;
+
+struct CheckpointHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t endiannessCheck;  ///< 0x01020304, written in the native byte order
+    std::uint32_t realSize;         ///< size of the template floating point type
+    std::uint32_t storageRealSize;  ///< size of the history floating point type (see StorageReal)
+    std::uint64_t nbElements;
+    std::uint64_t nbNodes;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+};
+
+enum CheckpointFlags : std::uint32_t
+{
+    CHECKPOINT_HAS_ELASTIC_PREDICTORS = 1
+};
+
+/// Sequential writing of the checkpoint sections
+class CheckpointWriter
+{
+public:
+    explicit CheckpointWriter(const std::string& filename)
+        : m_stream(filename, std::ios::out | std::ios::binary | std::ios::trunc)
+    {}
+
+    bool isValid() const { return m_stream.good(); }
+
+    template<class T>
+    void write(const T* values, std::size_t count)
+    {
+        m_stream.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count*sizeof(T)));
+    }
+
+    template<class T>
+    void write(const T& value) { write(&value, 1); }
+
+    void flush() { m_stream.flush(); }
+
+    /// Flushes the file, returns false if any write failed
+    bool close()
+    {
+        m_stream.close();
+        return !m_stream.fail();
+    }
+
+private:
+    std::ofstream m_stream;
+};
+
+/// Sequential reading of the checkpoint sections, from a memory-mapped file
+class CheckpointReader
+{
+public:
+    bool open(const std::string& filename)
+    {
+        m_offset = 0;
+        return m_file.open(filename);
+    }
+
+    std::size_t getRemainingSize() const { return m_file.size() - m_offset; }
+    std::size_t getOffset() const { return m_offset; }
+    void seek(std::size_t offset) { m_offset = std::min(offset, m_file.size()); }
+
+    /// Copies the next count values, returns false if the file is too short
+    template<class T>
+    bool read(T* values, std::size_t count)
+    {
+        const std::size_t size = count*sizeof(T);
+        if (size > getRemainingSize())
+            return false;
+        std::memcpy(static_cast<void*>(values), m_file.data() + m_offset, size);
+        m_offset += size;
+        return true;
+    }
+
+    template<class T>
+    bool read(T& value) { return read(&value, 1); }
+
+private:
+    MappedFile m_file;
+    std::size_t m_offset = 0;
+};
+
+} // namespace beamplastic::io
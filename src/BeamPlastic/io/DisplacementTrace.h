@@ -0,0 +1,284 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+#include <BeamPlastic/io/Checkpoint.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace beamplastic::io
+{
+
+/**
+ * Binary trace of the positions passed to the force computations, to replay
+ * the loading path of a simulation on the force field alone (see the
+ * BeamPlasticTrace_replay driver).
+ * The file uses the same sequential layout as the checkpoints (see
+ * CheckpointWriter and CheckpointReader): a fixed-size header, the attributes
+ * of the recorded component as (name, value) strings, the element edges and
+ * the rest positions, then one record per call to addForce (or to reset).
+ * Each record is a record header, followed by the positions of all nodes for
+ * position records. The coordinates are copied as is, in the native byte order
+ * and template precision, which are recorded in the header.
+ */
+
+constexpr char DisplacementTraceMagic[8] = { 'B', 'P', 'T', 'R', 'A', 'C', 'E', '\0' };
+/// To be incremented at each change of the trace layout
+constexpr std::uint32_t DisplacementTraceVersion = 1;
+
+struct DisplacementTraceHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t endiannessCheck;  ///< 0x01020304, written in the native byte order
+    std::uint32_t realSize;         ///< size of the template floating point type
+    std::uint32_t coordSize;        ///< size of a node coordinate
+    std::uint64_t nbNodes;
+    std::uint64_t nbElements;
+    std::uint64_t nbAttributes;
+};
+
+enum DisplacementTraceRecordType : std::uint32_t
+{
+    DISPLACEMENT_TRACE_POSITIONS = 0, ///< positions passed to addForce
+    DISPLACEMENT_TRACE_RESET = 1      ///< reset of the plastic state
+};
+
+struct DisplacementTraceRecord
+{
+    std::uint32_t type;
+    std::uint32_t reserved;
+    double time;                    ///< simulation time of the record
+};
+
+typedef std::pair<std::string, std::string> DisplacementTraceAttribute;
+
+
+/// Writing of a trace: header, then records appended one at a time
+class DisplacementTraceWriter
+{
+public:
+    explicit DisplacementTraceWriter(const std::string& filename)
+        : m_writer(filename)
+    {}
+
+    bool isValid() const { return m_writer.isValid(); }
+
+    template<class Coord, class Edge>
+    void writeHeader(const std::vector<DisplacementTraceAttribute>& attributes,
+                     const Edge* edges, std::size_t nbElements, const Coord* restPositions, std::size_t nbNodes)
+    {
+        DisplacementTraceHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, DisplacementTraceMagic, sizeof(header.magic));
+        header.version = DisplacementTraceVersion;
+        header.endiannessCheck = 0x01020304;
+        header.realSize = sizeof(typename Coord::value_type);
+        header.coordSize = sizeof(Coord);
+        header.nbNodes = nbNodes;
+        header.nbElements = nbElements;
+        header.nbAttributes = attributes.size();
+        m_writer.write(header);
+
+        for (const DisplacementTraceAttribute& attribute : attributes)
+        {
+            writeString(attribute.first);
+            writeString(attribute.second);
+        }
+
+        for (std::size_t k = 0; k < nbElements; k++)
+        {
+            const std::array<std::uint32_t, 2> edge { std::uint32_t(edges[k][0]), std::uint32_t(edges[k][1]) };
+            m_writer.write(edge.data(), 2);
+        }
+
+        m_writer.write(restPositions, nbNodes);
+        m_nbNodes = nbNodes;
+    }
+
+    /// Appends a record of the positions of all nodes. Returns false, without
+    /// writing anything, if the number of nodes differs from the header one.
+    template<class Coord>
+    bool writePositions(const double time, const Coord* positions, std::size_t nbNodes)
+    {
+        if (nbNodes != m_nbNodes)
+            return false;
+        writeRecordHeader(DISPLACEMENT_TRACE_POSITIONS, time);
+        m_writer.write(positions, m_nbNodes);
+        return true;
+    }
+
+    void writeReset(const double time) { writeRecordHeader(DISPLACEMENT_TRACE_RESET, time); }
+
+    void flush() { m_writer.flush(); }
+    bool close() { return m_writer.close(); }
+
+private:
+    void writeRecordHeader(const DisplacementTraceRecordType type, const double time)
+    {
+        DisplacementTraceRecord record;
+        record.type = type;
+        record.reserved = 0;
+        record.time = time;
+        m_writer.write(record);
+    }
+
+    void writeString(const std::string& value)
+    {
+        const std::uint64_t size = value.size();
+        m_writer.write(size);
+        m_writer.write(value.data(), value.size());
+    }
+
+    CheckpointWriter m_writer;
+    std::size_t m_nbNodes = 0;
+};
+
+
+/// Sequential reading of a trace, from a memory-mapped file
+class DisplacementTraceReader
+{
+public:
+    /// Size of the floating point type a trace was written with, 0 if the file is not a valid trace
+    static std::uint32_t getRealSize(const std::string& filename)
+    {
+        CheckpointReader reader;
+        DisplacementTraceHeader header;
+        if (!reader.open(filename) || !reader.read(header)
+            || std::memcmp(header.magic, DisplacementTraceMagic, sizeof(header.magic)) != 0)
+            return 0;
+        return header.realSize;
+    }
+
+    /// Opens the trace and reads its header, for the given coordinate type.
+    /// Returns false, with an error message, if the trace cannot be read.
+    template<class Coord>
+    bool open(const std::string& filename, std::string& errorMessage)
+    {
+        if (!m_reader.open(filename))
+        {
+            errorMessage = "cannot open " + filename;
+            return false;
+        }
+
+        if (!m_reader.read(m_header)
+            || std::memcmp(m_header.magic, DisplacementTraceMagic, sizeof(m_header.magic)) != 0)
+        {
+            errorMessage = filename + " is not a displacement trace";
+            return false;
+        }
+        if (m_header.version != DisplacementTraceVersion || m_header.endiannessCheck != 0x01020304
+            || m_header.realSize != sizeof(typename Coord::value_type) || m_header.coordSize != sizeof(Coord))
+        {
+            errorMessage = filename + " was written with another version, byte order or precision";
+            return false;
+        }
+
+        // The counts of the header are checked against the size of the file
+        // before any allocation: each attribute holds at least two string sizes
+        if (m_header.nbAttributes > m_reader.getRemainingSize() / (2*sizeof(std::uint64_t)))
+        {
+            errorMessage = filename + " has an invalid number of attributes";
+            return false;
+        }
+        m_attributes.resize(m_header.nbAttributes);
+        for (DisplacementTraceAttribute& attribute : m_attributes)
+        {
+            if (!readString(attribute.first) || !readString(attribute.second))
+            {
+                errorMessage = filename + " is truncated";
+                return false;
+            }
+        }
+
+        const std::size_t remainingSize = m_reader.getRemainingSize();
+        if (m_header.nbElements > remainingSize / sizeof(std::array<std::uint32_t, 2>)
+            || m_header.nbNodes > (remainingSize - m_header.nbElements*sizeof(std::array<std::uint32_t, 2>)) / sizeof(Coord))
+        {
+            errorMessage = filename + " has an invalid number of elements or nodes";
+            return false;
+        }
+        m_edges.resize(m_header.nbElements);
+        m_restPositions.resize(m_header.nbNodes * sizeof(Coord));
+        if (!m_reader.read(m_edges.data(), m_edges.size())
+            || !m_reader.read(m_restPositions.data(), m_restPositions.size()))
+        {
+            errorMessage = filename + " is truncated";
+            return false;
+        }
+
+        m_firstRecordOffset = m_reader.getOffset();
+        return true;
+    }
+
+    std::size_t getNbNodes() const { return m_header.nbNodes; }
+    std::size_t getNbElements() const { return m_header.nbElements; }
+    const std::vector<DisplacementTraceAttribute>& getAttributes() const { return m_attributes; }
+    const std::vector<std::array<std::uint32_t, 2>>& getEdges() const { return m_edges; }
+
+    template<class Coord>
+    void getRestPositions(Coord* positions) const
+    {
+        std::memcpy(static_cast<void*>(positions), m_restPositions.data(), m_restPositions.size());
+    }
+
+    /// Reads the next record, and the positions of all nodes for position
+    /// records. Returns false at the end of the trace, or on a truncated record.
+    template<class Coord>
+    bool readRecord(DisplacementTraceRecord& record, Coord* positions)
+    {
+        if (!m_reader.read(record))
+            return false;
+        if (record.type == DISPLACEMENT_TRACE_POSITIONS)
+            return m_reader.read(positions, m_header.nbNodes);
+        return record.type == DISPLACEMENT_TRACE_RESET;
+    }
+
+    /// Restarts the reading at the first record
+    void rewind() { m_reader.seek(m_firstRecordOffset); }
+
+private:
+    bool readString(std::string& value)
+    {
+        std::uint64_t size;
+        if (!m_reader.read(size) || size > m_reader.getRemainingSize())
+            return false;
+        value.resize(size);
+        return m_reader.read(&value[0], size);
+    }
+
+    CheckpointReader m_reader;
+    DisplacementTraceHeader m_header {};
+    std::vector<DisplacementTraceAttribute> m_attributes;
+    std::vector<std::array<std::uint32_t, 2>> m_edges;
+    std::vector<char> m_restPositions;
+    std::size_t m_firstRecordOffset = 0;
+};
+
+} // namespace beamplastic::io
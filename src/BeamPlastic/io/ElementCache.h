@@ -0,0 +1,82 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+#include <BeamPlastic/io/Checkpoint.h>
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace beamplastic::io
+{
+
+/**
+ * Cache file of the precomputed element matrices (strain-displacement
+ * matrices at the Gauss points, elastic stiffness matrices).
+ * The file uses the same sequential layout as the checkpoints (see
+ * CheckpointWriter and CheckpointReader). It is only valid for the
+ * parameters it was computed from: the header stores a hash of the element
+ * geometries, materials and formulation options, which is compared to the
+ * one of the scene before loading.
+ */
+
+constexpr char ElementCacheMagic[8] = { 'B', 'P', 'E', 'C', 'A', 'C', 'H', 'E' };
+/// To be incremented at each change of the cache layout or of the element formulation
+constexpr std::uint32_t ElementCacheVersion = 2;
+
+struct ElementCacheHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t endiannessCheck;  ///< 0x01020304, written in the native byte order
+    std::uint32_t realSize;         ///< size of the template floating point type
+    std::uint32_t storageRealSize;  ///< size of the Gauss point matrices floating point type (see StorageReal)
+    std::uint64_t nbElements;
+    std::uint64_t key;              ///< hash of the parameters the matrices were computed from
+};
+
+/// 64-bit FNV-1a hash, computed incrementally on the raw bytes of the values
+class Fnv1aHash
+{
+public:
+    void add(const void* data, std::size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t k = 0; k < size; k++)
+        {
+            m_hash ^= bytes[k];
+            m_hash *= 0x100000001b3ull;
+        }
+    }
+
+    template<class T>
+    void add(const T& value) { add(&value, sizeof(T)); }
+
+    std::uint64_t value() const { return m_hash; }
+
+private:
+    std::uint64_t m_hash = 0xcbf29ce484222325ull;
+};
+
+} // namespace beamplastic::io
@@ -0,0 +1,427 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+#include <BeamPlastic/io/Checkpoint.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace beamplastic::io
+{
+
+/**
+ * Gauss point history of selected beam elements, sampled during long
+ * (e.g. cyclic) simulations.
+ * The snapshots are written in chunk files of a fixed number of snapshots,
+ * named <prefix>_<chunk number>.bphist, and listed in the index file
+ * <prefix>.bphidx, which is updated each time a chunk is completed.
+ * A chunk file is a fixed-size header, the indices of the recorded elements,
+ * then the snapshots. Each snapshot is a snapshot header followed by the
+ * values of the recorded elements, nbValuesPerElement values per element, in
+ * the element order of the header. As for the checkpoints, the values are
+ * copied as is, in the native byte order and precision recorded in the header.
+ */
+
+constexpr char GaussPointHistoryMagic[8] = { 'B', 'P', 'H', 'I', 'S', 'T', '\0', '\0' };
+constexpr char GaussPointHistoryIndexMagic[8] = { 'B', 'P', 'H', 'I', 'D', 'X', '\0', '\0' };
+/// To be incremented at each change of the history layout
+constexpr std::uint32_t GaussPointHistoryVersion = 1;
+
+struct GaussPointHistoryHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t endiannessCheck;     ///< 0x01020304, written in the native byte order
+    std::uint32_t realSize;            ///< size of the floating point type of the values
+    std::uint32_t nbValuesPerElement;
+    std::uint64_t nbElements;          ///< number of recorded elements
+    std::uint64_t firstSnapshot;       ///< index of the first snapshot of the chunk, in the whole history
+};
+
+/// Entry of the index file, one per completed chunk
+struct GaussPointHistoryChunkEntry
+{
+    std::uint64_t chunk;
+    std::uint64_t firstSnapshot;
+    std::uint64_t nbSnapshots;
+    double firstTime;
+    double lastTime;
+};
+
+struct GaussPointHistorySnapshot
+{
+    double time;                       ///< simulation time of the snapshot
+    std::uint64_t step;                ///< time step of the snapshot
+};
+
+inline std::string getGaussPointHistoryChunkName(const std::string& prefix, std::uint64_t chunk)
+{
+    char number[32];
+    std::snprintf(number, sizeof(number), "_%06llu", static_cast<unsigned long long>(chunk));
+    return prefix + number + ".bphist";
+}
+
+inline std::string getGaussPointHistoryIndexName(const std::string& prefix)
+{
+    return prefix + ".bphidx";
+}
+
+
+/**
+ * Writing of a Gauss point history by a background thread, so that the
+ * simulation thread never waits for the disk.
+ * The snapshots are copied by the simulation thread into one of two buffers of
+ * a few snapshots. A full buffer is handed over to the writer thread through an
+ * atomic flag, and the copies continue in the other buffer. If the writer thread
+ * has not yet released the other buffer, the snapshots are dropped (and counted)
+ * instead of blocking the simulation. The wake-up mutex of the writer thread is
+ * never held during the file operations.
+ */
+template<class Real>
+class AsyncHistoryWriter
+{
+public:
+    /// Starts the writer thread. The elements are the indices recorded in the files.
+    AsyncHistoryWriter(const std::string& prefix, const std::vector<std::uint32_t>& elements,
+                       std::size_t nbValuesPerElement, std::size_t nbSnapshotsPerChunk,
+                       std::size_t nbSnapshotsPerBuffer = 16)
+        : m_prefix(prefix)
+        , m_elements(elements)
+        , m_snapshotSize(elements.size() * nbValuesPerElement)
+        , m_nbValuesPerElement(nbValuesPerElement)
+        , m_nbSnapshotsPerChunk(std::max<std::size_t>(nbSnapshotsPerChunk, 1))
+        , m_nbSnapshotsPerBuffer(std::max<std::size_t>(std::min(nbSnapshotsPerBuffer, m_nbSnapshotsPerChunk), 1))
+        , m_index(getGaussPointHistoryIndexName(prefix))
+    {
+        if (!m_index.isValid())
+            return;
+
+        GaussPointHistoryHeader header = makeHeader(0);
+        std::memcpy(header.magic, GaussPointHistoryIndexMagic, sizeof(header.magic));
+        m_index.write(header);
+        m_index.flush();
+
+        for (Buffer& buffer : m_buffers)
+        {
+            buffer.snapshots.resize(m_nbSnapshotsPerBuffer);
+            buffer.values.resize(m_nbSnapshotsPerBuffer * m_snapshotSize);
+        }
+        m_thread = std::thread([this]() { writeBuffers(); });
+    }
+
+    ~AsyncHistoryWriter() { close(); }
+
+    AsyncHistoryWriter(const AsyncHistoryWriter&) = delete;
+    AsyncHistoryWriter& operator=(const AsyncHistoryWriter&) = delete;
+
+    bool isValid() const { return m_index.isValid() && !m_hasFailed.load(std::memory_order_relaxed); }
+
+    /// Number of values of a snapshot: nbValuesPerElement values per recorded element
+    std::size_t getSnapshotSize() const { return m_snapshotSize; }
+
+    /**
+     * Start of a snapshot (simulation thread): returns the values to be filled,
+     * then passed with commitSnapshot, or nullptr if no buffer is available,
+     * in which case the snapshot is dropped.
+     */
+    Real* beginSnapshot(const double time, const std::uint64_t step)
+    {
+        if (!m_thread.joinable())
+            return nullptr;
+
+        Buffer& buffer = m_buffers[m_activeBuffer];
+        if (buffer.isFull.load(std::memory_order_acquire))
+        {
+            m_nbDroppedSnapshots++;
+            return nullptr;
+        }
+        buffer.snapshots[m_nbBufferedSnapshots] = GaussPointHistorySnapshot{ time, step };
+        return buffer.values.data() + m_nbBufferedSnapshots * m_snapshotSize;
+    }
+
+    /// End of the snapshot started with beginSnapshot (simulation thread)
+    void commitSnapshot()
+    {
+        if (++m_nbBufferedSnapshots == m_nbSnapshotsPerBuffer)
+            publishBuffer();
+    }
+
+    /// Number of snapshots dropped because the writer thread was late
+    std::size_t getNbDroppedSnapshots() const { return m_nbDroppedSnapshots; }
+
+    /// Writes the pending snapshots, stops the writer thread and completes the
+    /// index. Returns false if an error occurred while writing the files.
+    bool close()
+    {
+        if (!m_thread.joinable())
+            return isValid();
+
+        // Waiting is allowed here: the last buffer must not be dropped
+        if (m_nbBufferedSnapshots > 0)
+        {
+            while (m_buffers[m_activeBuffer].isFull.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            publishBuffer();
+        }
+
+        m_isStopping.store(true, std::memory_order_release);
+        wakeWriter();
+        m_thread.join();
+
+        return m_index.close() && isValid();
+    }
+
+private:
+    struct Buffer
+    {
+        std::vector<GaussPointHistorySnapshot> snapshots;
+        std::vector<Real> values;
+        std::size_t nbSnapshots = 0;
+        std::atomic<bool> isFull { false }; ///< set by the simulation thread, cleared by the writer thread
+    };
+
+    GaussPointHistoryHeader makeHeader(const std::uint64_t firstSnapshot) const
+    {
+        GaussPointHistoryHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, GaussPointHistoryMagic, sizeof(header.magic));
+        header.version = GaussPointHistoryVersion;
+        header.endiannessCheck = 0x01020304;
+        header.realSize = sizeof(Real);
+        header.nbValuesPerElement = static_cast<std::uint32_t>(m_nbValuesPerElement);
+        header.nbElements = m_elements.size();
+        header.firstSnapshot = firstSnapshot;
+        return header;
+    }
+
+    void publishBuffer()
+    {
+        Buffer& buffer = m_buffers[m_activeBuffer];
+        buffer.nbSnapshots = m_nbBufferedSnapshots;
+        buffer.isFull.store(true, std::memory_order_release);
+        wakeWriter();
+
+        m_activeBuffer ^= 1;
+        m_nbBufferedSnapshots = 0;
+    }
+
+    void wakeWriter()
+    {
+        // Empty critical section: the writer thread is either waiting, or will
+        // check the flags before waiting again
+        { std::lock_guard<std::mutex> lock(m_wakeMutex); }
+        m_wakeCondition.notify_one();
+    }
+
+    /// Writer thread: writes the buffers in the order they were published
+    void writeBuffers()
+    {
+        unsigned int current = 0;
+        while (true)
+        {
+            Buffer& buffer = m_buffers[current];
+            {
+                std::unique_lock<std::mutex> lock(m_wakeMutex);
+                m_wakeCondition.wait(lock, [&]() {
+                    return buffer.isFull.load(std::memory_order_acquire) || m_isStopping.load(std::memory_order_acquire);
+                });
+            }
+            if (!buffer.isFull.load(std::memory_order_acquire))
+                break;
+
+            for (std::size_t s = 0; s < buffer.nbSnapshots; s++)
+                writeSnapshot(buffer.snapshots[s], buffer.values.data() + s * m_snapshotSize);
+            if (m_chunk)
+                m_chunk->flush();
+
+            buffer.isFull.store(false, std::memory_order_release);
+            current ^= 1;
+        }
+        closeChunk();
+    }
+
+    void writeSnapshot(const GaussPointHistorySnapshot& snapshot, const Real* values)
+    {
+        if (!m_chunk)
+        {
+            m_chunkEntry = GaussPointHistoryChunkEntry{ m_nbChunks, m_nbWrittenSnapshots, 0, snapshot.time, snapshot.time };
+            m_chunk = std::make_unique<CheckpointWriter>(getGaussPointHistoryChunkName(m_prefix, m_nbChunks));
+            m_chunk->write(makeHeader(m_nbWrittenSnapshots));
+            m_chunk->write(m_elements.data(), m_elements.size());
+        }
+
+        m_chunk->write(snapshot);
+        m_chunk->write(values, m_snapshotSize);
+        m_chunkEntry.nbSnapshots++;
+        m_chunkEntry.lastTime = snapshot.time;
+        m_nbWrittenSnapshots++;
+
+        if (m_chunkEntry.nbSnapshots == m_nbSnapshotsPerChunk)
+            closeChunk();
+    }
+
+    void closeChunk()
+    {
+        if (!m_chunk)
+            return;
+        if (!m_chunk->close())
+            m_hasFailed.store(true, std::memory_order_relaxed);
+        m_chunk.reset();
+
+        m_index.write(m_chunkEntry);
+        m_index.flush();
+        m_nbChunks++;
+    }
+
+    const std::string m_prefix;
+    const std::vector<std::uint32_t> m_elements;
+    const std::size_t m_snapshotSize;
+    const std::size_t m_nbValuesPerElement;
+    const std::size_t m_nbSnapshotsPerChunk;
+    const std::size_t m_nbSnapshotsPerBuffer;
+
+    // Simulation thread
+    std::array<Buffer, 2> m_buffers;
+    unsigned int m_activeBuffer = 0;
+    std::size_t m_nbBufferedSnapshots = 0;
+    std::size_t m_nbDroppedSnapshots = 0;
+
+    // Writer thread
+    CheckpointWriter m_index;
+    std::unique_ptr<CheckpointWriter> m_chunk;
+    GaussPointHistoryChunkEntry m_chunkEntry {};
+    std::uint64_t m_nbChunks = 0;
+    std::uint64_t m_nbWrittenSnapshots = 0;
+
+    std::thread m_thread;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+    std::atomic<bool> m_isStopping { false };
+    std::atomic<bool> m_hasFailed { false };
+};
+
+
+/// Random access to the snapshots of a history, through its index
+template<class Real>
+class GaussPointHistoryReader
+{
+public:
+    /// Reads the index of the history. Returns false, with an error message,
+    /// if the history cannot be read.
+    bool open(const std::string& prefix, std::string& errorMessage)
+    {
+        m_prefix = prefix;
+        m_entries.clear();
+        m_currentChunk = -1;
+
+        const std::string indexName = getGaussPointHistoryIndexName(prefix);
+        CheckpointReader index;
+        if (!index.open(indexName))
+        {
+            errorMessage = "cannot open " + indexName;
+            return false;
+        }
+        if (!index.read(m_header) || std::memcmp(m_header.magic, GaussPointHistoryIndexMagic, sizeof(m_header.magic)) != 0)
+        {
+            errorMessage = indexName + " is not a Gauss point history index";
+            return false;
+        }
+        if (m_header.version != GaussPointHistoryVersion || m_header.endiannessCheck != 0x01020304
+            || m_header.realSize != sizeof(Real))
+        {
+            errorMessage = indexName + " was written with another version, byte order or precision";
+            return false;
+        }
+
+        m_entries.resize(index.getRemainingSize() / sizeof(GaussPointHistoryChunkEntry));
+        index.read(m_entries.data(), m_entries.size());
+        return true;
+    }
+
+    std::size_t getNbElements() const { return m_header.nbElements; }
+    std::size_t getNbValuesPerElement() const { return m_header.nbValuesPerElement; }
+    std::size_t getNbSnapshots() const { return m_entries.empty() ? 0 : m_entries.back().firstSnapshot + m_entries.back().nbSnapshots; }
+    const std::vector<GaussPointHistoryChunkEntry>& getChunks() const { return m_entries; }
+    /// Indices of the recorded elements, available after the first readSnapshot
+    const std::vector<std::uint32_t>& getElements() const { return m_elements; }
+
+    /// Reads a snapshot, getNbElements()*getNbValuesPerElement() values. Returns
+    /// false if the snapshot does not exist or if its chunk cannot be read.
+    bool readSnapshot(const std::size_t index, GaussPointHistorySnapshot& snapshot, Real* values)
+    {
+        const auto entry = std::upper_bound(m_entries.begin(), m_entries.end(), index,
+            [](std::size_t i, const GaussPointHistoryChunkEntry& e) { return i < e.firstSnapshot; });
+        if (entry == m_entries.begin() || index >= getNbSnapshots())
+            return false;
+        const GaussPointHistoryChunkEntry& chunk = *(entry - 1);
+
+        if (m_currentChunk != static_cast<std::int64_t>(chunk.chunk) && !openChunk(chunk))
+            return false;
+
+        const std::size_t snapshotSize = m_header.nbElements * m_header.nbValuesPerElement;
+        m_chunk.seek(m_firstSnapshotOffset + (index - chunk.firstSnapshot)
+                     * (sizeof(GaussPointHistorySnapshot) + snapshotSize * sizeof(Real)));
+        return m_chunk.read(snapshot) && m_chunk.read(values, snapshotSize);
+    }
+
+private:
+    bool openChunk(const GaussPointHistoryChunkEntry& entry)
+    {
+        m_currentChunk = -1;
+        GaussPointHistoryHeader header;
+        if (!m_chunk.open(getGaussPointHistoryChunkName(m_prefix, entry.chunk)) || !m_chunk.read(header)
+            || std::memcmp(header.magic, GaussPointHistoryMagic, sizeof(header.magic)) != 0
+            || header.nbElements != m_header.nbElements || header.nbValuesPerElement != m_header.nbValuesPerElement)
+            return false;
+
+        m_elements.resize(header.nbElements);
+        if (!m_chunk.read(m_elements.data(), m_elements.size()))
+            return false;
+        m_firstSnapshotOffset = m_chunk.getOffset();
+        m_currentChunk = static_cast<std::int64_t>(entry.chunk);
+        return true;
+    }
+
+    std::string m_prefix;
+    GaussPointHistoryHeader m_header {};
+    std::vector<GaussPointHistoryChunkEntry> m_entries;
+    std::vector<std::uint32_t> m_elements;
+
+    CheckpointReader m_chunk;
+    std::int64_t m_currentChunk = -1;
+    std::size_t m_firstSnapshotOffset = 0;
+};
+
+} // namespace beamplastic::io
@@ -0,0 +1,43 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#define BEAMPLASTIC_BEAMPLASTICSHAPEFUNCTIONMAPPING_CPP
+#include <BeamPlastic/mapping/BeamPlasticShapeFunctionMapping.inl>
+
+#include <sofa/core/ObjectFactory.h>
+
+
+namespace beamplastic::mapping
+{
+
+using namespace sofa::defaulttype;
+
+void registerBeamPlasticShapeFunctionMapping(sofa::core::ObjectFactory* factory)
+{
+    factory->registerObjects(sofa::core::ObjectRegistrationData("Maps points on plastic beam elements through their shape functions")
+         .add< BeamPlasticShapeFunctionMapping<Rigid3dTypes, Vec3dTypes> >(true)
+         .add< BeamPlasticShapeFunctionMapping<Rigid3fTypes, Vec3fTypes> >());
+}
+
+template class BEAMPLASTIC_API BeamPlasticShapeFunctionMapping<Rigid3dTypes, Vec3dTypes>;
+template class BEAMPLASTIC_API BeamPlasticShapeFunctionMapping<Rigid3fTypes, Vec3fTypes>;
+
+} // namespace beamplastic::mapping
@@ -0,0 +1,176 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+
+#include <BeamPlastic/forcefield/BeamPlasticFEMForceField.h>
+
+#include <sofa/core/Mapping.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/defaulttype/VecTypes.h>
+#include <sofa/simulation/TaskScheduler.h>
+
+
+namespace beamplastic::mapping
+{
+
+/** \class BeamPlasticShapeFunctionMapping
+ *  \brief Maps points (e.g. collision or visual surfaces) on the beam elements
+ *  of a BeamPlasticFEMForceField, through the element shape functions.
+ *
+ *  Unlike BeamLinearMapping, which rigidly attaches each point to the frame
+ *  of a node, the displacement of a point is interpolated inside its element
+ *  with the Euler-Bernoulli or Timoshenko shape functions of the force field,
+ *  which gives smooth bending surfaces with few elements.
+ *  At init, each point of the output rest positions is attached to an element
+ *  (the closest one at rest, unless d_pointElements is set), and its shape
+ *  function matrix is precomputed. The position of a point is then
+ *
+ *      p = x_a + R_a (N u + p_local)
+ *
+ *  where x_a and R_a are the position and rotation of the first node of the
+ *  element, u the local displacement of the element, N the shape function
+ *  matrix and p_local the rest position of the point in the element frame.
+ *  The Jacobian is the one of this expression, the rotation vector of the
+ *  element being linearised for small relative rotations of its nodes.
+ */
+template<class TIn, class TOut>
+class BEAMPLASTIC_API BeamPlasticShapeFunctionMapping : public sofa::core::Mapping<TIn, TOut>
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE2(BeamPlasticShapeFunctionMapping, TIn, TOut), SOFA_TEMPLATE2(sofa::core::Mapping, TIn, TOut));
+
+    typedef sofa::core::Mapping<TIn, TOut> Inherit;
+    typedef TIn In;
+    typedef TOut Out;
+
+    typedef typename In::Real Real;
+    typedef typename In::Coord InCoord;
+    typedef typename In::Deriv InDeriv;
+    typedef typename In::VecCoord InVecCoord;
+    typedef typename In::VecDeriv InVecDeriv;
+    typedef typename In::MatrixDeriv InMatrixDeriv;
+    typedef typename Out::Coord OutCoord;
+    typedef typename Out::Deriv OutDeriv;
+    typedef typename Out::VecCoord OutVecCoord;
+    typedef typename Out::VecDeriv OutVecDeriv;
+    typedef typename Out::MatrixDeriv OutMatrixDeriv;
+
+    typedef typename Inherit::InDataVecCoord InDataVecCoord;
+    typedef typename Inherit::InDataVecDeriv InDataVecDeriv;
+    typedef typename Inherit::InDataMatrixDeriv InDataMatrixDeriv;
+    typedef typename Inherit::OutDataVecCoord OutDataVecCoord;
+    typedef typename Inherit::OutDataVecDeriv OutDataVecDeriv;
+    typedef typename Inherit::OutDataMatrixDeriv OutDataMatrixDeriv;
+
+    typedef forcefield::BeamPlasticFEMForceField<In> ForceField;
+    typedef typename ForceField::Vec3 Vec3;
+    typedef typename ForceField::Vec12 Vec12;
+    typedef typename ForceField::Matrix3x12 Matrix3x12;
+    typedef sofa::type::Mat<3, 3, Real> Matrix3x3;
+
+    void init() override;
+
+    void apply(const sofa::core::MechanicalParams* mparams, OutDataVecCoord& out, const InDataVecCoord& in) override;
+    void applyJ(const sofa::core::MechanicalParams* mparams, OutDataVecDeriv& out, const InDataVecDeriv& in) override;
+    void applyJT(const sofa::core::MechanicalParams* mparams, InDataVecDeriv& out, const OutDataVecDeriv& in) override;
+    void applyJT(const sofa::core::ConstraintParams* cparams, InDataMatrixDeriv& out, const OutDataMatrixDeriv& in) override;
+
+protected:
+
+    BeamPlasticShapeFunctionMapping();
+    ~BeamPlasticShapeFunctionMapping() override = default;
+
+    sofa::SingleLink<BeamPlasticShapeFunctionMapping<TIn, TOut>, ForceField,
+                     sofa::BaseLink::FLAG_STOREPATH | sofa::BaseLink::FLAG_STRONGLINK> l_forceField;
+
+    /// Element of each mapped point. If empty at init, each point is attached
+    /// to the closest element at rest, and the chosen elements are written back.
+    sofa::Data<sofa::type::vector<unsigned int>> d_pointElements;
+    sofa::Data<bool> d_parallel;
+
+    /// Precomputed interpolation of a mapped point
+    struct MappedPoint
+    {
+        unsigned int element;
+        Vec3 localPosition; ///< rest position in the frame of the first node of the element
+        Matrix3x12 N; ///< shape function matrix at localPosition
+    };
+    sofa::type::vector<MappedPoint> m_points;
+
+    /// Elements with at least one mapped point, and their state at the last apply
+    struct MappedElement
+    {
+        unsigned int element;
+        sofa::Index a, b; ///< nodes
+        Vec12 localDisplacement;
+        Matrix3x3 rotation; ///< rotation of the first node
+        Vec3 axis; ///< from the first to the second node
+    };
+    sofa::type::vector<MappedElement> m_elements;
+    sofa::type::vector<unsigned int> m_pointMappedElements; ///< index in m_elements of each point
+
+    /**
+     * Jacobian of each point at the last apply. With dx and dw the velocities
+     * of the element nodes a and b, the velocity of the point is
+     *   dx_a + A (dx_b - dx_a - dw_a x axis) + B (dw_b - dw_a) + dw_a x r
+     */
+    struct JacobianBlock
+    {
+        Matrix3x3 A; ///< R_a N_translation R_a^T
+        Matrix3x3 B; ///< R_a N_rotation R_a^T
+        Vec3 r; ///< position of the point relative to the node a
+    };
+    sofa::type::vector<JacobianBlock> m_jacobian;
+
+    /// Mapped points of each input node, for the parallel applyJT: entry
+    /// 2*point + k, for the first (k = 0) or second (k = 1) node of the element
+    sofa::type::vector<unsigned int> m_nodePointOffsets;
+    sofa::type::vector<unsigned int> m_nodePoints;
+    /// Forces of the last applyJT on the two nodes of the element of each point
+    sofa::type::vector<InDeriv> m_pointForces;
+
+    sofa::simulation::TaskScheduler* m_taskScheduler = nullptr;
+
+    bool attachPoints(const InVecCoord& x0, const OutVecCoord& points);
+    /// Closest element at rest of each point, with the distance to the segment
+    /// between the nodes. The elements are bucketed in a uniform grid, whose
+    /// cells are about the mean element length, and only the cells around each
+    /// point are searched, by increasing distance.
+    void findClosestElements(const InVecCoord& x0, const OutVecCoord& points, sofa::type::vector<unsigned int>& pointElements);
+    void computeNodePoints(std::size_t nbNodes);
+
+    /// Forces on the two nodes of the element of point i, for the force f on the point
+    void computePointForces(std::size_t i, const OutDeriv& f, InDeriv& forceA, InDeriv& forceB) const;
+
+    /// Calls function(begin, end) on ranges of [0, size), in parallel if d_parallel is set
+    template<class RangeFunction>
+    void forEachRange(std::size_t size, const RangeFunction& function);
+};
+
+#if !defined(BEAMPLASTIC_BEAMPLASTICSHAPEFUNCTIONMAPPING_CPP)
+extern template class BEAMPLASTIC_API BeamPlasticShapeFunctionMapping<sofa::defaulttype::Rigid3dTypes, sofa::defaulttype::Vec3dTypes>;
+extern template class BEAMPLASTIC_API BeamPlasticShapeFunctionMapping<sofa::defaulttype::Rigid3fTypes, sofa::defaulttype::Vec3fTypes>;
+#endif
+
+} // namespace beamplastic::mapping
@@ -0,0 +1,493 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/mapping/BeamPlasticShapeFunctionMapping.h>
+
+#include <sofa/simulation/MainTaskSchedulerFactory.h>
+#include <sofa/simulation/ParallelForEach.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+
+namespace beamplastic::mapping
+{
+
+template<class TIn, class TOut>
+BeamPlasticShapeFunctionMapping<TIn, TOut>::BeamPlasticShapeFunctionMapping()
+    : l_forceField(this->initLink("forceField", "link to the BeamPlasticFEMForceField whose elements interpolate the points"))
+    , d_pointElements(initData(&d_pointElements, "pointElements", "index of the beam element of each mapped point. If empty, each point is attached to the closest element at rest"))
+    , d_parallel(initData(&d_parallel, false, "parallel", "if true, the mapped points are processed in parallel"))
+{
+}
+
+template<class TIn, class TOut>
+void BeamPlasticShapeFunctionMapping<TIn, TOut>::init()
+{
+    Inherit::init();
+
+    if (l_forceField.empty())
+    {
+        msg_info() << "link to the force field should be set to ensure right behavior. First BeamPlasticFEMForceField found in current context will be used.";
+        l_forceField.set(this->getContext()->template get<ForceField>());
+    }
+
+    if (l_forceField.get() == nullptr)
+    {
+        msg_error() << "No BeamPlasticFEMForceField found, the points cannot be mapped";
+        this->d_componentState.setValue(sofa::core::objectmodel::ComponentState::Invalid);
+        return;
+    }
+
+    if (!this->fromModel || !this->toModel)
+    {
+        msg_error() << "The input and output mechanical states are required";
+        this->d_componentState.setValue(sofa::core::objectmodel::ComponentState::Invalid);
+        return;
+    }
+
+    if (d_parallel.getValue() && !m_taskScheduler)
+    {
+        m_taskScheduler = sofa::simulation::MainTaskSchedulerFactory::createInRegistry();
+        assert(m_taskScheduler);
+        if (m_taskScheduler->getThreadCount() < 1)
+            m_taskScheduler->init(0);
+    }
+
+    const InVecCoord& x0 = this->fromModel->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    const OutVecCoord& points = this->toModel->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+
+    if (!attachPoints(x0, points))
+    {
+        this->d_componentState.setValue(sofa::core::objectmodel::ComponentState::Invalid);
+        return;
+    }
+    computeNodePoints(x0.size());
+
+    this->d_componentState.setValue(sofa::core::objectmodel::ComponentState::Valid);
+    msg_info() << m_points.size() << " points mapped on " << m_elements.size() << " beam elements";
+}
+
+template<class TIn, class TOut>
+bool BeamPlasticShapeFunctionMapping<TIn, TOut>::attachPoints(const InVecCoord& x0, const OutVecCoord& points)
+{
+    const ForceField* forceField = l_forceField.get();
+    const auto& elements = forceField->getElements();
+    const std::size_t nbPoints = points.size();
+
+    sofa::type::vector<unsigned int> pointElements = d_pointElements.getValue();
+    if (pointElements.empty())
+    {
+        findClosestElements(x0, points, pointElements);
+        d_pointElements.setValue(pointElements);
+    }
+    else if (pointElements.size() != nbPoints)
+    {
+        msg_error() << "pointElements has " << pointElements.size() << " entries, for " << nbPoints << " mapped points";
+        return false;
+    }
+
+    // Elements with mapped points
+    sofa::type::vector<int> elementSlots(elements.size(), -1);
+    for (std::size_t i = 0; i < nbPoints; i++)
+    {
+        if (pointElements[i] >= elements.size())
+        {
+            msg_error() << "point " << i << " is mapped on the element " << pointElements[i] << ", but there are only "
+                        << elements.size() << " elements";
+            return false;
+        }
+        elementSlots[pointElements[i]] = 0;
+    }
+    m_elements.clear();
+    for (std::size_t e = 0; e < elements.size(); e++)
+    {
+        if (elementSlots[e] < 0)
+            continue;
+        elementSlots[e] = static_cast<int>(m_elements.size());
+        MappedElement element;
+        element.element = static_cast<unsigned int>(e);
+        element.a = elements[e][0];
+        element.b = elements[e][1];
+        m_elements.push_back(element);
+    }
+
+    // Shape functions of the points, in the frame of the first node of their element at rest
+    m_points.resize(nbPoints);
+    m_pointMappedElements.resize(nbPoints);
+    m_jacobian.resize(nbPoints);
+    forEachRange(nbPoints, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            MappedPoint& point = m_points[i];
+            point.element = pointElements[i];
+            const InCoord& restFrame = x0[elements[point.element][0]];
+            const Vec3 p(points[i][0], points[i][1], points[i][2]);
+            point.localPosition = restFrame.getOrientation().inverseRotate(p - restFrame.getCenter());
+            forceField->computeShapeFunction(point.element, point.localPosition, point.N);
+            m_pointMappedElements[i] = static_cast<unsigned int>(elementSlots[point.element]);
+        }
+    });
+
+    return true;
+}
+
+template<class TIn, class TOut>
+void BeamPlasticShapeFunctionMapping<TIn, TOut>::findClosestElements(const InVecCoord& x0, const OutVecCoord& points,
+                                                                     sofa::type::vector<unsigned int>& pointElements)
+{
+    const auto& elements = l_forceField.get()->getElements();
+    const std::size_t nbElements = elements.size();
+    pointElements.assign(points.size(), 0);
+    if (nbElements == 0)
+        return;
+
+    // Bounding box and mean length of the elements
+    Vec3 gridMin(std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max());
+    Vec3 gridMax(std::numeric_limits<Real>::lowest(), std::numeric_limits<Real>::lowest(), std::numeric_limits<Real>::lowest());
+    Real meanLength = 0;
+    for (const auto& element : elements)
+    {
+        const Vec3& pa = x0[element[0]].getCenter();
+        const Vec3& pb = x0[element[1]].getCenter();
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            gridMin[k] = std::min({ gridMin[k], pa[k], pb[k] });
+            gridMax[k] = std::max({ gridMax[k], pa[k], pb[k] });
+        }
+        meanLength += (pb - pa).norm();
+    }
+    meanLength /= nbElements;
+
+    // Cells of the mean element length, enlarged until there are at most a few
+    // cells per element (e.g. for sparse elements in a large box)
+    const Vec3 extent = gridMax - gridMin;
+    const double maxNbCells = 8.0*nbElements + 64;
+    Real cellSize = meanLength > 0 ? meanLength : std::max({ extent[0], extent[1], extent[2], Real(1) });
+    auto nbCellsOf = [&](Real size) { return (extent[0]/size + 1) * (extent[1]/size + 1) * (extent[2]/size + 1); };
+    while (nbCellsOf(cellSize) > maxNbCells)
+        cellSize *= 2;
+
+    int dims[3];
+    for (unsigned int k = 0; k < 3; k++)
+        dims[k] = static_cast<int>(extent[k] / cellSize) + 1;
+    const int maxDim = std::max({ dims[0], dims[1], dims[2] });
+
+    // Cell of a position, clamped to the grid
+    auto getCell = [&](const Vec3& p, int cell[3])
+    {
+        for (unsigned int k = 0; k < 3; k++)
+            cell[k] = static_cast<int>(std::clamp(std::floor((p[k] - gridMin[k]) / cellSize), Real(0), Real(dims[k] - 1)));
+    };
+    auto getCellIndex = [&](int x, int y, int z) { return (static_cast<std::size_t>(z)*dims[1] + y)*dims[0] + x; };
+
+    // Elements of each cell overlapped by their bounding box, in compressed rows
+    sofa::type::vector<unsigned int> cellOffsets(static_cast<std::size_t>(dims[0])*dims[1]*dims[2] + 1, 0);
+    sofa::type::vector<unsigned int> cellElements;
+    for (unsigned int pass = 0; pass < 2; pass++)
+    {
+        sofa::type::vector<unsigned int> next;
+        if (pass == 1)
+        {
+            for (std::size_t c = 1; c < cellOffsets.size(); c++)
+                cellOffsets[c] += cellOffsets[c - 1];
+            cellElements.resize(cellOffsets.back());
+            next.assign(cellOffsets.begin(), cellOffsets.end() - 1);
+        }
+        for (std::size_t e = 0; e < nbElements; e++)
+        {
+            const Vec3& pa = x0[elements[e][0]].getCenter();
+            const Vec3& pb = x0[elements[e][1]].getCenter();
+            int cellMin[3], cellMax[3];
+            getCell(Vec3(std::min(pa[0], pb[0]), std::min(pa[1], pb[1]), std::min(pa[2], pb[2])), cellMin);
+            getCell(Vec3(std::max(pa[0], pb[0]), std::max(pa[1], pb[1]), std::max(pa[2], pb[2])), cellMax);
+            for (int z = cellMin[2]; z <= cellMax[2]; z++)
+                for (int y = cellMin[1]; y <= cellMax[1]; y++)
+                    for (int x = cellMin[0]; x <= cellMax[0]; x++)
+                    {
+                        if (pass == 0)
+                            cellOffsets[getCellIndex(x, y, z) + 1]++;
+                        else
+                            cellElements[next[getCellIndex(x, y, z)]++] = static_cast<unsigned int>(e);
+                    }
+        }
+    }
+
+    forEachRange(points.size(), [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const Vec3 p(points[i][0], points[i][1], points[i][2]);
+            int cell[3];
+            getCell(p, cell);
+
+            Real minDistance = std::numeric_limits<Real>::max();
+            unsigned int closest = 0;
+            auto visitCell = [&](int x, int y, int z)
+            {
+                const std::size_t c = getCellIndex(x, y, z);
+                for (unsigned int k = cellOffsets[c]; k < cellOffsets[c + 1]; k++)
+                {
+                    const unsigned int e = cellElements[k];
+                    const Vec3& pa = x0[elements[e][0]].getCenter();
+                    const Vec3 ab = x0[elements[e][1]].getCenter() - pa;
+                    const Real length2 = ab.norm2();
+                    const Real t = length2 > 0 ? std::clamp((p - pa)*ab / length2, Real(0), Real(1)) : Real(0);
+                    const Real distance = (p - pa - ab*t).norm2();
+                    if (distance < minDistance || (distance == minDistance && e < closest))
+                    {
+                        minDistance = distance;
+                        closest = e;
+                    }
+                }
+            };
+
+            // Shells of cells at increasing Chebyshev distances r from the cell
+            // of the point. The projection of the point on the grid lies in its
+            // cell, so the elements of the cells beyond the shell r are at least
+            // r cell sizes away from the point.
+            for (int r = 0; r < maxDim; r++)
+            {
+                for (int z = std::max(cell[2] - r, 0); z <= std::min(cell[2] + r, dims[2] - 1); z++)
+                {
+                    for (int y = std::max(cell[1] - r, 0); y <= std::min(cell[1] + r, dims[1] - 1); y++)
+                    {
+                        const bool onShellFace = std::abs(z - cell[2]) == r || std::abs(y - cell[1]) == r;
+                        const int step = (onShellFace || r == 0) ? 1 : 2*r;
+                        for (int x = cell[0] - r; x <= cell[0] + r; x += step)
+                        {
+                            if (x >= 0 && x < dims[0])
+                                visitCell(x, y, z);
+                        }
+                    }
+                }
+
+                const Real shellDistance = r*cellSize;
+                if (minDistance <= shellDistance*shellDistance)
+                    break;
+            }
+            pointElements[i] = closest;
+        }
+    });
+}
+
+template<class TIn, class TOut>
+void BeamPlasticShapeFunctionMapping<TIn, TOut>::computeNodePoints(std::size_t nbNodes)
+{
+    m_nodePointOffsets.assign(nbNodes + 1, 0);
+    for (const MappedPoint& point : m_points)
+    {
+        const MappedElement& element = m_elements[m_pointMappedElements[&point - m_points.data()]];
+        m_nodePointOffsets[element.a + 1]++;
+        m_nodePointOffsets[element.b + 1]++;
+    }
+    for (std::size_t n = 0; n < nbNodes; n++)
+        m_nodePointOffsets[n + 1] += m_nodePointOffsets[n];
+
+    m_nodePoints.resize(m_nodePointOffsets.back());
+    sofa::type::vector<unsigned int> next(m_nodePointOffsets.begin(), m_nodePointOffsets.end() - 1);
+    for (std::size_t i = 0; i < m_points.size(); i++)
+    {
+        const MappedElement& element = m_elements[m_pointMappedElements[i]];
+        m_nodePoints[next[element.a]++] = static_cast<unsigned int>(2*i);
+        m_nodePoints[next[element.b]++] = static_cast<unsigned int>(2*i + 1);
+    }
+}
+
+template<class TIn, class TOut>
+template<class RangeFunction>
+void BeamPlasticShapeFunctionMapping<TIn, TOut>::forEachRange(std::size_t size, const RangeFunction& function)
+{
+    const unsigned int nbChunks = (d_parallel.getValue() && m_taskScheduler) ? std::max(1u, m_taskScheduler->getThreadCount()) : 1u;
+    if (nbChunks == 1)
+    {
+        function(std::size_t(0), size);
+        return;
+    }
+
+    sofa::simulation::parallelForEach(*m_taskScheduler, 0u, nbChunks, [&](const unsigned int chunk)
+    {
+        function(size*chunk/nbChunks, size*(chunk + 1)/nbChunks);
+    });
+}
+
+template<class TIn, class TOut>
+void BeamPlasticShapeFunctionMapping<TIn, TOut>::apply(const sofa::core::MechanicalParams* /*mparams*/, OutDataVecCoord& out, const InDataVecCoord& in)
+{
+    if (this->d_componentState.getValue() != sofa::core::objectmodel::ComponentState::Valid)
+        return;
+
+    const InVecCoord& x = in.getValue();
+    const InVecCoord& x0 = this->fromModel->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    OutVecCoord& y = *out.beginWriteOnly();
+    y.resize(m_points.size());
+
+    // Corotational frame and local displacement of the elements
+    forEachRange(m_elements.size(), [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t e = begin; e < end; e++)
+        {
+            MappedElement& element = m_elements[e];
+            ForceField::computeLocalDisplacement(x, x0, element.localDisplacement, element.a, element.b);
+            auto q = x[element.a].getOrientation();
+            q.normalize();
+            q.toMatrix(element.rotation);
+            element.axis = x[element.b].getCenter() - x[element.a].getCenter();
+        }
+    });
+
+    forEachRange(m_points.size(), [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const MappedPoint& point = m_points[i];
+            const MappedElement& element = m_elements[m_pointMappedElements[i]];
+            const Matrix3x3& R = element.rotation;
+
+            JacobianBlock& J = m_jacobian[i];
+            J.r = R*(point.N*element.localDisplacement + point.localPosition);
+            y[i] = x[element.a].getCenter() + J.r;
+
+            Matrix3x3 translationN, rotationN;
+            point.N.getsub(0, 6, translationN);
+            point.N.getsub(0, 9, rotationN);
+            const Matrix3x3 Rt = R.transposed();
+            J.A = R*translationN*Rt;
+            J.B = R*rotationN*Rt;
+        }
+    });
+
+    out.endEdit();
+}
+
+template<class TIn, class TOut>
+void BeamPlasticShapeFunctionMapping<TIn, TOut>::applyJ(const sofa::core::MechanicalParams* /*mparams*/, OutDataVecDeriv& out, const InDataVecDeriv& in)
+{
+    if (this->d_componentState.getValue() != sofa::core::objectmodel::ComponentState::Valid)
+        return;
+
+    const InVecDeriv& v = in.getValue();
+    OutVecDeriv& dy = *out.beginWriteOnly();
+    dy.resize(m_points.size());
+
+    forEachRange(m_points.size(), [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const MappedElement& element = m_elements[m_pointMappedElements[i]];
+            const JacobianBlock& J = m_jacobian[i];
+            const Vec3& va = getVCenter(v[element.a]);
+            const Vec3& wa = getVOrientation(v[element.a]);
+            const Vec3& vb = getVCenter(v[element.b]);
+            const Vec3& wb = getVOrientation(v[element.b]);
+
+            dy[i] = va + J.A*(vb - va - sofa::type::cross(wa, element.axis)) + J.B*(wb - wa) + sofa::type::cross(wa, J.r);
+        }
+    });
+
+    out.endEdit();
+}
+
+template<class TIn, class TOut>
+void BeamPlasticShapeFunctionMapping<TIn, TOut>::computePointForces(std::size_t i, const OutDeriv& f,
+                                                                    InDeriv& forceA, InDeriv& forceB) const
+{
+    const MappedElement& element = m_elements[m_pointMappedElements[i]];
+    const JacobianBlock& J = m_jacobian[i];
+    const Vec3 force(f[0], f[1], f[2]);
+    const Vec3 Atf = J.A.transposed()*force;
+    const Vec3 Btf = J.B.transposed()*force;
+
+    forceA = InDeriv(force - Atf, sofa::type::cross(J.r, force) - sofa::type::cross(element.axis, Atf) - Btf);
+    forceB = InDeriv(Atf, Btf);
+}
+
+template<class TIn, class TOut>
+void BeamPlasticShapeFunctionMapping<TIn, TOut>::applyJT(const sofa::core::MechanicalParams* /*mparams*/, InDataVecDeriv& out, const OutDataVecDeriv& in)
+{
+    if (this->d_componentState.getValue() != sofa::core::objectmodel::ComponentState::Valid)
+        return;
+
+    const OutVecDeriv& f = in.getValue();
+    InVecDeriv& nodeForces = *out.beginEdit();
+
+    // Forces of each point on the two nodes of its element, then gathered per
+    // node, so that the nodes can be processed in parallel without conflicts,
+    // and the sums do not depend on the thread scheduling
+    m_pointForces.resize(2*m_points.size());
+    forEachRange(std::min(f.size(), m_points.size()), [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+            computePointForces(i, f[i], m_pointForces[2*i], m_pointForces[2*i + 1]);
+    });
+
+    const std::size_t nbNodes = std::min(nodeForces.size() + 1, m_nodePointOffsets.size()) - 1;
+    forEachRange(nbNodes, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t n = begin; n < end; n++)
+            for (unsigned int k = m_nodePointOffsets[n]; k < m_nodePointOffsets[n + 1]; k++)
+            {
+                const unsigned int entry = m_nodePoints[k];
+                if (entry/2 < f.size())
+                    nodeForces[n] += m_pointForces[entry];
+            }
+    });
+
+    out.endEdit();
+}
+
+template<class TIn, class TOut>
+void BeamPlasticShapeFunctionMapping<TIn, TOut>::applyJT(const sofa::core::ConstraintParams* /*cparams*/, InDataMatrixDeriv& out, const OutDataMatrixDeriv& in)
+{
+    if (this->d_componentState.getValue() != sofa::core::objectmodel::ComponentState::Valid)
+        return;
+
+    InMatrixDeriv& nodeConstraints = *out.beginEdit();
+    const OutMatrixDeriv& constraints = in.getValue();
+
+    for (auto rowIt = constraints.begin(), rowItEnd = constraints.end(); rowIt != rowItEnd; ++rowIt)
+    {
+        auto colIt = rowIt.begin();
+        auto colItEnd = rowIt.end();
+        if (colIt == colItEnd)
+            continue;
+
+        auto o = nodeConstraints.writeLine(rowIt.index());
+        for (; colIt != colItEnd; ++colIt)
+        {
+            const std::size_t i = colIt.index();
+            const MappedElement& element = m_elements[m_pointMappedElements[i]];
+            InDeriv forceA, forceB;
+            computePointForces(i, colIt.val(), forceA, forceB);
+            o.addCol(element.a, forceA);
+            o.addCol(element.b, forceB);
+        }
+    }
+
+    out.endEdit();
+}
+
+} // namespace beamplastic::mapping
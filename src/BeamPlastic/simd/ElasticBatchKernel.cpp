@@ -0,0 +1,159 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <BeamPlastic/simd/ElasticBatchKernel.inl>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+
+namespace beamplastic::simd
+{
+
+namespace detail
+{
+
+/// Portable implementation, one lane at a time
+struct ScalarOps
+{
+    typedef double Vector;
+    typedef bool Mask;
+    static constexpr unsigned int Width = 1;
+
+    static Vector load(const double* p) { return *p; }
+    static void store(double* p, Vector v) { *p = v; }
+    static Vector set(double v) { return v; }
+    static Vector sub(Vector a, Vector b) { return a - b; }
+    static Vector mul(Vector a, Vector b) { return a * b; }
+    static Vector fmadd(Vector a, Vector b, Vector c) { return a * b + c; }
+    static Mask noMask() { return false; }
+    static Mask orGreater(Mask m, Vector a, Vector b) { return m || a > b; }
+    static unsigned int toBits(Mask m) { return m ? 1u : 0u; }
+};
+
+unsigned int computeElasticBatchScalar(const ElasticBatchArguments& arguments)
+{
+    return computeElasticBatch<ScalarOps>(arguments);
+}
+
+namespace
+{
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+bool cpuSupports(InstructionSet instructionSet)
+{
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool hasFma = (info[2] & (1 << 12)) != 0;
+    const bool hasOsXSave = (info[2] & (1 << 27)) != 0;
+    if (!hasOsXSave)
+        return false;
+    const unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    if (instructionSet == InstructionSet::AVX2)
+        return hasFma && (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+    if (instructionSet == InstructionSet::AVX512)
+        return (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+    return true;
+}
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+bool cpuSupports(InstructionSet instructionSet)
+{
+    if (instructionSet == InstructionSet::AVX2)
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (instructionSet == InstructionSet::AVX512)
+        return __builtin_cpu_supports("avx512f");
+    return true;
+}
+#else
+bool cpuSupports(InstructionSet instructionSet)
+{
+    return instructionSet == InstructionSet::SCALAR;
+}
+#endif
+
+} // namespace
+
+} // namespace detail
+
+const char* getInstructionSetName(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case InstructionSet::AVX2: return "avx2";
+    case InstructionSet::AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+bool isInstructionSetSupported(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+#ifdef BEAMPLASTIC_HAVE_AVX2_KERNEL
+    case InstructionSet::AVX2:
+    {
+        static const bool supported = detail::cpuSupports(InstructionSet::AVX2);
+        return supported;
+    }
+#endif
+#ifdef BEAMPLASTIC_HAVE_AVX512_KERNEL
+    case InstructionSet::AVX512:
+    {
+        static const bool supported = detail::cpuSupports(InstructionSet::AVX512);
+        return supported;
+    }
+#endif
+    case InstructionSet::SCALAR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+InstructionSet getBestInstructionSet()
+{
+    if (isInstructionSetSupported(InstructionSet::AVX512))
+        return InstructionSet::AVX512;
+    if (isInstructionSetSupported(InstructionSet::AVX2))
+        return InstructionSet::AVX2;
+    return InstructionSet::SCALAR;
+}
+
+ElasticBatchKernel getElasticBatchKernel(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+#ifdef BEAMPLASTIC_HAVE_AVX2_KERNEL
+    case InstructionSet::AVX2: return &detail::computeElasticBatchAVX2;
+#endif
+#ifdef BEAMPLASTIC_HAVE_AVX512_KERNEL
+    case InstructionSet::AVX512: return &detail::computeElasticBatchAVX512;
+#endif
+    default: return &detail::computeElasticBatchScalar;
+    }
+}
+
+} // namespace beamplastic::simd
@@ -0,0 +1,89 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+
+
+namespace beamplastic::simd
+{
+
+/**
+ * Batched computation of the elastic predictor of beam elements, processing
+ * BatchWidth beam elements in lock-step. All arrays are in structure of
+ * arrays (SoA) layout: the BatchWidth values of one coefficient are stored
+ * contiguously, e.g. displacementIncrements[c*BatchWidth + lane].
+ *
+ * For each beam element (lane) and each of the NbGaussPoints Gauss points:
+ *   newStress = prevStress + stressOperator*displacementIncrement
+ * with stressOperator = C*Be (6x12), and the element internal forces are
+ *   forces = prevForces + stiffness*displacementIncrement
+ * stiffness being the elastic stiffness matrix integrated with the same
+ * Gauss points (12x12).
+ * The kernels return a bit mask of the lanes in which the Von Mises
+ * equivalent stress of at least one Gauss point exceeds the yield limit.
+ * These beam elements are plastic, and their results have to be discarded.
+ */
+
+constexpr unsigned int BatchWidth = 8;
+constexpr unsigned int NbGaussPoints = 27;
+
+struct ElasticBatchArguments
+{
+    const double* stressOperators;        ///< [NbGaussPoints][6][12][BatchWidth]
+    const double* stiffness;              ///< [12][12][BatchWidth]
+    const double* squaredYieldLimits;     ///< [NbGaussPoints][BatchWidth], squared equivalent stress limits
+    const double* prevStresses;           ///< [NbGaussPoints][6][BatchWidth], Voigt notation
+    const double* prevForces;             ///< [12][BatchWidth]
+    const double* displacementIncrements; ///< [12][BatchWidth]
+    double* newStresses;                  ///< [NbGaussPoints][6][BatchWidth]
+    double* forces;                       ///< [12][BatchWidth]
+};
+
+typedef unsigned int (*ElasticBatchKernel)(const ElasticBatchArguments& arguments);
+
+enum class InstructionSet { SCALAR, AVX2, AVX512 };
+
+/// Name of the instruction set, as used in the batchKernel data of the force field
+BEAMPLASTIC_API const char* getInstructionSetName(InstructionSet instructionSet);
+
+/// Indicates if a kernel is compiled for this instruction set, and if the CPU supports it
+BEAMPLASTIC_API bool isInstructionSetSupported(InstructionSet instructionSet);
+
+/// Widest supported instruction set
+BEAMPLASTIC_API InstructionSet getBestInstructionSet();
+
+/// Kernel for the given instruction set, which has to be supported
+BEAMPLASTIC_API ElasticBatchKernel getElasticBatchKernel(InstructionSet instructionSet);
+
+namespace detail
+{
+unsigned int computeElasticBatchScalar(const ElasticBatchArguments& arguments);
+#ifdef BEAMPLASTIC_HAVE_AVX2_KERNEL
+unsigned int computeElasticBatchAVX2(const ElasticBatchArguments& arguments);
+#endif
+#ifdef BEAMPLASTIC_HAVE_AVX512_KERNEL
+unsigned int computeElasticBatchAVX512(const ElasticBatchArguments& arguments);
+#endif
+} // namespace detail
+
+} // namespace beamplastic::simd
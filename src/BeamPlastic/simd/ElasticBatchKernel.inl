@@ -0,0 +1,102 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/simd/ElasticBatchKernel.h>
+
+
+namespace beamplastic::simd::detail
+{
+
+/**
+ * Generic implementation of the elastic batch kernel, over a vector type
+ * provided by Ops, of Ops::Width lanes:
+ *   Vector load(const double*), store(double*, Vector), set(double),
+ *   add, sub, mul, fmadd(a, b, c) = a*b + c,
+ *   Mask noMask(), Mask orGreater(Mask, Vector a, Vector b) = mask | (a > b),
+ *   unsigned int toBits(Mask).
+ * This file is included by the translation units compiled for each
+ * instruction set.
+ */
+template<class Ops>
+unsigned int computeElasticBatch(const ElasticBatchArguments& args)
+{
+    typedef typename Ops::Vector Vector;
+    typedef typename Ops::Mask Mask;
+    constexpr unsigned int W = BatchWidth;
+
+    const Vector half = Ops::set(0.5);
+    const Vector three = Ops::set(3.0);
+
+    unsigned int yieldBits = 0;
+    for (unsigned int lane = 0; lane < W; lane += Ops::Width)
+    {
+        Vector du[12];
+        for (unsigned int c = 0; c < 12; c++)
+            du[c] = Ops::load(args.displacementIncrements + c*W + lane);
+
+        // Trial stresses and yield test, Gauss point by Gauss point
+        Mask yielded = Ops::noMask();
+        for (unsigned int gp = 0; gp < NbGaussPoints; gp++)
+        {
+            Vector stress[6];
+            for (unsigned int r = 0; r < 6; r++)
+            {
+                const unsigned int row = gp*6 + r;
+                const double* op = args.stressOperators + row*12*W + lane;
+                Vector s = Ops::load(args.prevStresses + row*W + lane);
+                for (unsigned int c = 0; c < 12; c++)
+                    s = Ops::fmadd(Ops::load(op + c*W), du[c], s);
+                Ops::store(args.newStresses + row*W + lane, s);
+                stress[r] = s;
+            }
+
+            // Squared Von Mises equivalent stress
+            const Vector dXY = Ops::sub(stress[0], stress[1]);
+            const Vector dYZ = Ops::sub(stress[1], stress[2]);
+            const Vector dZX = Ops::sub(stress[2], stress[0]);
+            Vector normal = Ops::mul(dXY, dXY);
+            normal = Ops::fmadd(dYZ, dYZ, normal);
+            normal = Ops::fmadd(dZX, dZX, normal);
+            Vector shear = Ops::mul(stress[3], stress[3]);
+            shear = Ops::fmadd(stress[4], stress[4], shear);
+            shear = Ops::fmadd(stress[5], stress[5], shear);
+            const Vector squaredEqStress = Ops::fmadd(half, normal, Ops::mul(three, shear));
+
+            yielded = Ops::orGreater(yielded, squaredEqStress, Ops::load(args.squaredYieldLimits + gp*W + lane));
+        }
+        yieldBits |= Ops::toBits(yielded) << lane;
+
+        // Internal forces
+        for (unsigned int r = 0; r < 12; r++)
+        {
+            const double* k = args.stiffness + r*12*W + lane;
+            Vector f = Ops::load(args.prevForces + r*W + lane);
+            for (unsigned int c = 0; c < 12; c++)
+                f = Ops::fmadd(Ops::load(k + c*W), du[c], f);
+            Ops::store(args.forces + r*W + lane, f);
+        }
+    }
+    return yieldBits;
+}
+
+} // namespace beamplastic::simd::detail
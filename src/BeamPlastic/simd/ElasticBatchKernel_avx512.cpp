@@ -0,0 +1,54 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+// This translation unit is compiled with AVX-512F code generation enabled
+// (see CMakeLists.txt). Its code is only run if the CPU supports it.
+#include <BeamPlastic/simd/ElasticBatchKernel.inl>
+
+#include <immintrin.h>
+
+
+namespace beamplastic::simd::detail
+{
+
+struct Avx512Ops
+{
+    typedef __m512d Vector;
+    typedef __mmask8 Mask;
+    static constexpr unsigned int Width = 8;
+
+    static Vector load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, Vector v) { _mm512_storeu_pd(p, v); }
+    static Vector set(double v) { return _mm512_set1_pd(v); }
+    static Vector sub(Vector a, Vector b) { return _mm512_sub_pd(a, b); }
+    static Vector mul(Vector a, Vector b) { return _mm512_mul_pd(a, b); }
+    static Vector fmadd(Vector a, Vector b, Vector c) { return _mm512_fmadd_pd(a, b, c); }
+    static Mask noMask() { return 0; }
+    static Mask orGreater(Mask m, Vector a, Vector b) { return m | _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    static unsigned int toBits(Mask m) { return static_cast<unsigned int>(m); }
+};
+
+unsigned int computeElasticBatchAVX512(const ElasticBatchArguments& arguments)
+{
+    return computeElasticBatch<Avx512Ops>(arguments);
+}
+
+} // namespace beamplastic::simd::detail
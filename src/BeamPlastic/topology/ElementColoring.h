@@ -0,0 +1,130 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+
+#include <algorithm>
+#include <vector>
+
+
+namespace beamplastic::topology
+{
+
+/**
+ * Partition of the elements of an edge mesh into colors, such that two elements
+ * of the same color never share a node. The elements of one color can then
+ * scatter their nodal contributions concurrently, without any synchronisation.
+ * The elements of color c are elements[colorOffsets[c]] to elements[colorOffsets[c+1]-1].
+ */
+struct ElementColoring
+{
+    std::vector<unsigned int> colorOffsets;
+    std::vector<unsigned int> elements;
+
+    std::size_t getNbColors() const { return colorOffsets.empty() ? 0 : colorOffsets.size() - 1; }
+    std::size_t getColorSize(std::size_t color) const { return colorOffsets[color + 1] - colorOffsets[color]; }
+};
+
+/// Color of an element which has not been colored yet
+constexpr unsigned int NoColor = ~0u;
+
+/**
+ * Greedy edge coloring of the uncolored edges (NoColor in elementColors): they
+ * are visited in the given order, and each of them takes the smallest color
+ * which is not used yet by an edge sharing one of its nodes. The colors of the
+ * other edges are kept, so that the coloring can be extended to new edges.
+ * Returns the number of colors.
+ */
+template<class EdgeContainer>
+unsigned int extendGreedyEdgeColoring(std::size_t nbNodes, const EdgeContainer& edges, std::vector<unsigned int>& elementColors)
+{
+    const std::size_t nbElements = edges.size();
+
+    // Colors already used at each node
+    std::vector<std::vector<unsigned int>> nodeColors(nbNodes);
+    unsigned int nbColors = 0;
+    for (std::size_t k = 0; k < nbElements; k++)
+    {
+        if (elementColors[k] == NoColor)
+            continue;
+        nodeColors[edges[k][0]].push_back(elementColors[k]);
+        nodeColors[edges[k][1]].push_back(elementColors[k]);
+        nbColors = std::max(nbColors, elementColors[k] + 1);
+    }
+
+    for (std::size_t k = 0; k < nbElements; k++)
+    {
+        if (elementColors[k] != NoColor)
+            continue;
+
+        const std::vector<unsigned int>& colorsA = nodeColors[edges[k][0]];
+        const std::vector<unsigned int>& colorsB = nodeColors[edges[k][1]];
+
+        unsigned int color = 0;
+        while (std::find(colorsA.begin(), colorsA.end(), color) != colorsA.end()
+               || std::find(colorsB.begin(), colorsB.end(), color) != colorsB.end())
+            color++;
+
+        elementColors[k] = color;
+        nodeColors[edges[k][0]].push_back(color);
+        nodeColors[edges[k][1]].push_back(color);
+        nbColors = std::max(nbColors, color + 1);
+    }
+    return nbColors;
+}
+
+/// Groups the elements by color (counting sort, stable: the element order is
+/// preserved inside each color)
+inline ElementColoring groupElementsByColor(const std::vector<unsigned int>& elementColors, unsigned int nbColors)
+{
+    ElementColoring coloring;
+    coloring.colorOffsets.assign(nbColors + 1, 0);
+    for (const unsigned int color : elementColors)
+        coloring.colorOffsets[color + 1]++;
+    for (unsigned int color = 0; color < nbColors; color++)
+        coloring.colorOffsets[color + 1] += coloring.colorOffsets[color];
+
+    coloring.elements.resize(elementColors.size());
+    std::vector<unsigned int> fill(coloring.colorOffsets.begin(), coloring.colorOffsets.end() - 1);
+    for (std::size_t k = 0; k < elementColors.size(); k++)
+        coloring.elements[fill[elementColors[k]]++] = static_cast<unsigned int>(k);
+
+    return coloring;
+}
+
+/**
+ * Greedy edge coloring: the edges are visited in the given order, and each
+ * edge takes the smallest color which is not used yet by an edge sharing one
+ * of its nodes. At most 2*maxDegree-1 colors are used.
+ * The returned element indices are positions in the edge container, and the
+ * visiting order is preserved inside each color.
+ */
+template<class EdgeContainer>
+ElementColoring computeGreedyEdgeColoring(std::size_t nbNodes, const EdgeContainer& edges)
+{
+    std::vector<unsigned int> elementColors(edges.size(), NoColor);
+    const unsigned int nbColors = extendGreedyEdgeColoring(nbNodes, edges, elementColors);
+    return groupElementsByColor(elementColors, nbColors);
+}
+
+} // namespace beamplastic::topology
@@ -0,0 +1,252 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+
+namespace beamplastic::topology
+{
+
+/**
+ * Node and element orderings of a beam (edge) mesh, used to improve the memory
+ * locality of the element loops. All node orderings are returned as the new
+ * index of each node: newIndex[oldIndex].
+ */
+
+namespace detail
+{
+
+/// Compressed adjacency of the nodes of an edge graph
+struct NodeAdjacency
+{
+    std::vector<std::size_t> offsets;
+    std::vector<unsigned int> neighbours;
+
+    std::size_t degree(unsigned int node) const { return offsets[node + 1] - offsets[node]; }
+};
+
+template<class EdgeContainer>
+NodeAdjacency computeNodeAdjacency(std::size_t nbNodes, const EdgeContainer& edges)
+{
+    NodeAdjacency adjacency;
+    adjacency.offsets.assign(nbNodes + 1, 0);
+    for (const auto& edge : edges)
+    {
+        adjacency.offsets[edge[0] + 1]++;
+        adjacency.offsets[edge[1] + 1]++;
+    }
+    std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+    adjacency.neighbours.resize(adjacency.offsets.back());
+    std::vector<std::size_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (const auto& edge : edges)
+    {
+        adjacency.neighbours[fill[edge[0]]++] = edge[1];
+        adjacency.neighbours[fill[edge[1]]++] = edge[0];
+    }
+    return adjacency;
+}
+
+/// Breadth-first traversal from start, visiting neighbours by increasing degree.
+/// Appends the visited nodes to order and returns the last visited node.
+inline unsigned int cuthillMcKeeTraversal(const NodeAdjacency& adjacency, unsigned int start,
+                                          std::vector<char>& visited, std::vector<unsigned int>& order)
+{
+    std::vector<unsigned int> neighbours;
+    std::size_t head = order.size();
+    order.push_back(start);
+    visited[start] = 1;
+    while (head < order.size())
+    {
+        const unsigned int node = order[head++];
+        neighbours.clear();
+        for (std::size_t k = adjacency.offsets[node]; k < adjacency.offsets[node + 1]; k++)
+        {
+            const unsigned int neighbour = adjacency.neighbours[k];
+            if (!visited[neighbour])
+            {
+                visited[neighbour] = 1;
+                neighbours.push_back(neighbour);
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end(), [&adjacency](unsigned int n1, unsigned int n2)
+                  { return adjacency.degree(n1) < adjacency.degree(n2); });
+        order.insert(order.end(), neighbours.begin(), neighbours.end());
+    }
+    return order.back();
+}
+
+/// Inserts two zero bits between each of the 21 lower bits of x
+inline std::uint64_t spreadBits(std::uint64_t x)
+{
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffff;
+    x = (x | x << 16) & 0x1f0000ff0000ff;
+    x = (x | x << 8) & 0x100f00f00f00f00f;
+    x = (x | x << 4) & 0x10c30c30c30c30c3;
+    x = (x | x << 2) & 0x1249249249249249;
+    return x;
+}
+
+} // namespace detail
+
+/**
+ * Reverse Cuthill-McKee ordering of the nodes of an edge graph, reducing the
+ * bandwidth of the node adjacency (and thus of the assembled stiffness matrix).
+ * Each connected component is traversed from a pseudo-peripheral node. Nodes
+ * which do not belong to any edge are numbered last.
+ */
+template<class EdgeContainer>
+std::vector<unsigned int> computeReverseCuthillMcKee(std::size_t nbNodes, const EdgeContainer& edges)
+{
+    const detail::NodeAdjacency adjacency = detail::computeNodeAdjacency(nbNodes, edges);
+
+    std::vector<unsigned int> nodesByDegree(nbNodes);
+    std::iota(nodesByDegree.begin(), nodesByDegree.end(), 0u);
+    std::stable_sort(nodesByDegree.begin(), nodesByDegree.end(), [&adjacency](unsigned int n1, unsigned int n2)
+                     { return adjacency.degree(n1) < adjacency.degree(n2); });
+
+    std::vector<char> visited(nbNodes, 0);
+    std::vector<char> componentVisited(nbNodes, 0);
+    std::vector<unsigned int> order;
+    std::vector<unsigned int> componentOrder;
+    order.reserve(nbNodes);
+
+    for (const unsigned int node : nodesByDegree)
+    {
+        if (visited[node] || adjacency.degree(node) == 0)
+            continue;
+
+        // Pseudo-peripheral start node: last node reached by a first traversal
+        // from the lowest degree node of the component
+        componentOrder.clear();
+        const unsigned int start = detail::cuthillMcKeeTraversal(adjacency, node, componentVisited, componentOrder);
+        detail::cuthillMcKeeTraversal(adjacency, start, visited, order);
+    }
+
+    std::reverse(order.begin(), order.end());
+    for (const unsigned int node : nodesByDegree)
+        if (adjacency.degree(node) == 0)
+            order.push_back(node);
+
+    std::vector<unsigned int> newIndex(nbNodes);
+    for (std::size_t k = 0; k < order.size(); k++)
+        newIndex[order[k]] = static_cast<unsigned int>(k);
+    return newIndex;
+}
+
+/**
+ * Space-filling curve (Morton / Z-order) ordering of points, each coordinate
+ * being quantised on 21 bits inside the bounding box of the points.
+ */
+template<class PointContainer>
+std::vector<unsigned int> computeMortonOrder(const PointContainer& points)
+{
+    const std::size_t nbPoints = points.size();
+    std::vector<unsigned int> newIndex(nbPoints);
+    if (nbPoints == 0)
+        return newIndex;
+
+    double minCoord[3], maxCoord[3];
+    for (int d = 0; d < 3; d++)
+    {
+        minCoord[d] = std::numeric_limits<double>::max();
+        maxCoord[d] = std::numeric_limits<double>::lowest();
+    }
+    for (const auto& point : points)
+        for (int d = 0; d < 3; d++)
+        {
+            minCoord[d] = std::min(minCoord[d], (double)point[d]);
+            maxCoord[d] = std::max(maxCoord[d], (double)point[d]);
+        }
+
+    double scale[3];
+    const double nbCells = double((1 << 21) - 1);
+    for (int d = 0; d < 3; d++)
+        scale[d] = maxCoord[d] > minCoord[d] ? nbCells / (maxCoord[d] - minCoord[d]) : 0.0;
+
+    std::vector<std::uint64_t> keys(nbPoints);
+    for (std::size_t k = 0; k < nbPoints; k++)
+    {
+        std::uint64_t key = 0;
+        for (int d = 0; d < 3; d++)
+        {
+            const auto cell = static_cast<std::uint64_t>(((double)points[k][d] - minCoord[d]) * scale[d]);
+            key |= detail::spreadBits(cell) << d;
+        }
+        keys[k] = key;
+    }
+
+    std::vector<unsigned int> order(nbPoints);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&keys](unsigned int p1, unsigned int p2) { return keys[p1] < keys[p2]; });
+
+    for (std::size_t k = 0; k < nbPoints; k++)
+        newIndex[order[k]] = static_cast<unsigned int>(k);
+    return newIndex;
+}
+
+/**
+ * Element traversal order induced by a node ordering: elements are sorted by
+ * their lowest, then highest, new node index. Returns the list of element
+ * indices in traversal order.
+ */
+template<class EdgeContainer>
+std::vector<unsigned int> computeElementOrder(const EdgeContainer& edges, const std::vector<unsigned int>& newNodeIndex)
+{
+    const std::size_t nbElements = edges.size();
+    std::vector<std::uint64_t> keys(nbElements);
+    for (std::size_t i = 0; i < nbElements; i++)
+    {
+        const std::uint64_t n1 = newNodeIndex[edges[i][0]];
+        const std::uint64_t n2 = newNodeIndex[edges[i][1]];
+        keys[i] = (std::min(n1, n2) << 32) | std::max(n1, n2);
+    }
+
+    std::vector<unsigned int> order(nbElements);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&keys](unsigned int e1, unsigned int e2) { return keys[e1] < keys[e2]; });
+    return order;
+}
+
+/// Largest difference between the node indices of an element, for a given node ordering
+template<class EdgeContainer>
+unsigned int computeBandwidth(const EdgeContainer& edges, const std::vector<unsigned int>& newNodeIndex)
+{
+    unsigned int bandwidth = 0;
+    for (const auto& edge : edges)
+    {
+        const unsigned int n1 = newNodeIndex[edge[0]];
+        const unsigned int n2 = newNodeIndex[edge[1]];
+        bandwidth = std::max(bandwidth, n1 > n2 ? n1 - n2 : n2 - n1);
+    }
+    return bandwidth;
+}
+
+} // namespace beamplastic::topology
@@ -0,0 +1,120 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <BeamPlastic/utils/ChromeTraceWriter.h>
+
+#include <iomanip>
+
+
+namespace beamplastic::utils
+{
+
+namespace
+{
+
+/// Names are provided by the code, only the characters special to JSON are escaped
+std::string escapeJson(const std::string& text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+} // namespace
+
+ChromeTraceWriter::~ChromeTraceWriter()
+{
+    close();
+}
+
+bool ChromeTraceWriter::open(const std::string& filename)
+{
+    close();
+
+    m_file.open(filename, std::ios::out | std::ios::trunc);
+    if (!m_file)
+        return false;
+
+    m_file << std::fixed << std::setprecision(3) << "[";
+    m_origin = Clock::now();
+    m_firstEvent = true;
+    return true;
+}
+
+void ChromeTraceWriter::close()
+{
+    if (!m_file.is_open())
+        return;
+
+    m_file << "\n]\n";
+    m_file.close();
+}
+
+void ChromeTraceWriter::writeDuration(const std::string& name, Clock::time_point start, Clock::time_point end,
+                                      unsigned int threadId)
+{
+    if (!m_file.is_open())
+        return;
+
+    beginEvent();
+    m_file << "{\"name\":\"" << escapeJson(name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadId
+           << ",\"ts\":" << toMicroseconds(start)
+           << ",\"dur\":" << std::chrono::duration<double, std::micro>(end - start).count() << "}";
+}
+
+void ChromeTraceWriter::writeCounters(const std::string& name, Clock::time_point time,
+                                      const std::vector<std::pair<std::string, double>>& values)
+{
+    if (!m_file.is_open())
+        return;
+
+    beginEvent();
+    m_file << "{\"name\":\"" << escapeJson(name) << "\",\"ph\":\"C\",\"pid\":1,\"ts\":" << toMicroseconds(time)
+           << ",\"args\":{";
+    for (std::size_t k = 0; k < values.size(); k++)
+        m_file << (k ? "," : "") << "\"" << escapeJson(values[k].first) << "\":" << values[k].second;
+    m_file << "}}";
+}
+
+void ChromeTraceWriter::flush()
+{
+    if (m_file.is_open())
+        m_file.flush();
+}
+
+void ChromeTraceWriter::beginEvent()
+{
+    m_file << (m_firstEvent ? "\n" : ",\n");
+    m_firstEvent = false;
+}
+
+double ChromeTraceWriter::toMicroseconds(Clock::time_point time) const
+{
+    return std::chrono::duration<double, std::micro>(time - m_origin).count();
+}
+
+} // namespace beamplastic::utils
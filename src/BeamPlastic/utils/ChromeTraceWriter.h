@@ -0,0 +1,79 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace beamplastic::utils
+{
+
+/**
+ * Writes a trace in the Chrome trace event format (JSON array of events),
+ * which can be loaded in chrome://tracing or https://ui.perfetto.dev.
+ * The events are written as they come, and the file is flushed by flush(): the
+ * closing bracket of the array is optional in this format, so that the trace of
+ * an interrupted run can still be loaded.
+ * Timestamps are relative to the opening of the file.
+ */
+class BEAMPLASTIC_API ChromeTraceWriter
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    ChromeTraceWriter() = default;
+    ~ChromeTraceWriter();
+
+    ChromeTraceWriter(const ChromeTraceWriter&) = delete;
+    ChromeTraceWriter& operator=(const ChromeTraceWriter&) = delete;
+
+    /// Creates the trace file, closing any previously opened one. Returns false on failure.
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const { return m_file.is_open(); }
+
+    /// Complete event: a named duration on a thread
+    void writeDuration(const std::string& name, Clock::time_point start, Clock::time_point end,
+                       unsigned int threadId = 0);
+
+    /// Counter event: named values, displayed as a stacked graph over time
+    void writeCounters(const std::string& name, Clock::time_point time,
+                       const std::vector<std::pair<std::string, double>>& values);
+
+    void flush();
+
+private:
+    void beginEvent();
+    double toMicroseconds(Clock::time_point time) const;
+
+    std::ofstream m_file;
+    Clock::time_point m_origin;
+    bool m_firstEvent = true;
+};
+
+} // namespace beamplastic::utils
@@ -0,0 +1,119 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+
+namespace beamplastic::utils
+{
+
+/**
+ * Accumulates the wall-clock time spent in NbPhases phases of a computation.
+ * The time can be accumulated concurrently in separate slots (e.g. one per
+ * chunk of elements processed in parallel), each slot being padded to its own
+ * cache line. When disabled, a scope costs a single test, and no clock is read.
+ * Phases may be nested: the time of an inner phase is also counted in the
+ * enclosing one.
+ */
+template <std::size_t NbPhases>
+class PhaseTimer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /// Adds the time elapsed between its construction and destruction to a phase
+    class Scope
+    {
+    public:
+        Scope(PhaseTimer& timer, std::size_t phase, std::size_t slot)
+            : m_timer(timer.isEnabled() ? &timer : nullptr), m_phase(phase), m_slot(slot)
+        {
+            if (m_timer)
+                m_start = Clock::now();
+        }
+
+        ~Scope()
+        {
+            if (m_timer)
+                m_timer->add(m_phase, m_slot, Clock::now() - m_start);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        PhaseTimer* m_timer;
+        std::size_t m_phase;
+        std::size_t m_slot;
+        Clock::time_point m_start;
+    };
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+
+    /// Number of concurrent slots. Resizing clears the accumulated times.
+    void setNbSlots(std::size_t nbSlots)
+    {
+        m_slots.assign(std::max<std::size_t>(nbSlots, 1), Slot());
+    }
+    std::size_t getNbSlots() const { return m_slots.size(); }
+
+    void add(std::size_t phase, std::size_t slot, Clock::duration duration)
+    {
+        assert(phase < NbPhases && slot < m_slots.size());
+        m_slots[slot].durations[phase] += duration;
+    }
+
+    /// Time of a phase, summed over all the slots since the last clear, in milliseconds
+    double getTotal(std::size_t phase) const
+    {
+        Clock::duration total = Clock::duration::zero();
+        for (const Slot& slot : m_slots)
+            total += slot.durations[phase];
+        return std::chrono::duration<double, std::milli>(total).count();
+    }
+
+    void clear()
+    {
+        for (Slot& slot : m_slots)
+            slot.durations.fill(Clock::duration::zero());
+    }
+
+private:
+    struct alignas(64) Slot
+    {
+        std::array<Clock::duration, NbPhases> durations;
+        Slot() { durations.fill(Clock::duration::zero()); }
+    };
+
+    bool m_enabled = false;
+    std::vector<Slot> m_slots = std::vector<Slot>(1);
+};
+
+} // namespace beamplastic::utils
@@ -0,0 +1,69 @@
+/******************************************************************************
+*                               BeamPlastic plugin                            *
+*                  (c) 2024 Universite Clermont Auvergne (UCA)                *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <BeamPlastic/config.h>
+
+#include <cassert>
+#include <cstddef>
+
+
+namespace beamplastic::utils
+{
+
+/**
+ * Read-only view of one member of each element of an array of structures,
+ * without any copy: entry i is at data() + i*getStride() bytes. The stride
+ * and the data pointer allow strided array wrappers (e.g. numpy arrays) to
+ * map the values directly.
+ * The view does not own the values, and is invalidated when the underlying
+ * array is reallocated.
+ */
+template <class T>
+class StridedArrayView
+{
+public:
+    StridedArrayView() = default;
+    StridedArrayView(const T* data, std::size_t stride, std::size_t size)
+        : m_data(reinterpret_cast<const char*>(data)), m_stride(stride), m_size(size)
+    {}
+
+    const T& operator[](std::size_t i) const
+    {
+        assert(i < m_size);
+        return *reinterpret_cast<const T*>(m_data + i*m_stride);
+    }
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const T* data() const { return reinterpret_cast<const T*>(m_data); }
+    /// Distance between two consecutive entries, in bytes
+    std::size_t getStride() const { return m_stride; }
+
+private:
+    const char* m_data = nullptr;
+    std::size_t m_stride = 0;
+    std::size_t m_size = 0;
+};
+
+} // namespace beamplastic::utils